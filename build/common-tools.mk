@@ -20,5 +20,8 @@ CURL = curl
 CRC = crc32
 XXD = xxd
 
+# compiler for the tools that run on the build machine
+HOST_CPP = g++
+
 CPPFLAGS +=
 
@@ -51,6 +51,7 @@ elf: $(TARGET_BASE).elf
 bin: $(TARGET_BASE).bin
 hex: $(TARGET_BASE).hex
 lst: $(TARGET_BASE).lst
+lz: $(TARGET_BASE).lz
 exe: $(TARGET_BASE)$(EXECUTABLE_EXTENSION)
 	@echo Built x-compile executable at $(TARGET_BASE)$(EXECUTABLE_EXTENSION)
 none:
@@ -178,6 +179,21 @@ endif
 	$(VERBOSE)mv $@.pre_crc $@
 	$(call echo,)
 
+# The tool that compresses modules for compressed OTA updates
+LZSS_TOOL = $(BUILD_PATH_BASE)/tools/lzss
+
+$(LZSS_TOOL): $(PROJECT_ROOT)/misc/tools/lzss/lzss.cpp $(PROJECT_ROOT)/services/inc/lzss.h $(PROJECT_ROOT)/services/inc/lzss_compress.h
+	$(call echo,'Building host tool: $@')
+	$(VERBOSE)$(MKDIR) $(dir $@)
+	$(VERBOSE)$(HOST_CPP) -std=gnu++11 -O2 -I$(PROJECT_ROOT)/services/inc $< -o $@
+	$(call echo,)
+
+# Create a compressed module from a bin file, for a compressed OTA update
+%.lz : %.bin $(LZSS_TOOL)
+	$(call echo,'Invoking: LZSS Compress')
+	$(VERBOSE)$(LZSS_TOOL) $< $@
+	$(call echo,)
+
 
 $(TARGET_BASE).elf : $(ALLOBJ) $(LIB_DEPS) $(LINKER_DEPS)
 	$(call echo,'Building target: $@')
@@ -234,7 +250,7 @@ clean: clean_deps
 	$(VERBOSE)$(RMDIR) $(BUILD_PATH)
 	$(call,echo,)
 
-.PHONY: all none elf bin hex size program-dfu program-cloud st-flash program-serial
+.PHONY: all none elf bin hex lz size program-dfu program-cloud st-flash program-serial
 .SECONDARY:
 
 include $(COMMON_BUILD)/recurse.mk
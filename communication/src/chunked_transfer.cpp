@@ -38,6 +38,7 @@ ProtocolError ChunkedTransfer::handle_update_begin(
 		file.store = FileTransfer::Store::Enum(decode_uint8(queue + 15));
 		file.file_address = decode_uint32(queue + 16);
 		file.chunk_address = file.file_address;
+		file.flags = (flags & 2) ? FileTransfer::Flags::DELTA : 0;
 	}
 	else
 	{
@@ -46,6 +47,7 @@ ProtocolError ChunkedTransfer::handle_update_begin(
 		file.store = FileTransfer::Store::FIRMWARE;
 		file.file_address = 0;
 		file.chunk_address = 0;
+		file.flags = 0;
 	}
 	// check the parameters only
 	bool success = !callbacks->prepare_for_firmware_update(file, 1, NULL);
@@ -28,6 +28,7 @@ ProtocolError CoAPMessageStore::send_message(CoAPMessage* msg, Channel& channel)
 {
 	Message m((uint8_t*)msg->get_data(), msg->get_data_length(), msg->get_data_length());
 	m.decode_id();
+	m.set_retransmit(true);
 	return channel.send(m);
 }
 
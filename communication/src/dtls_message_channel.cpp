@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "dtls_session_persist.h"
+#include "messages.h"
 #include "core_hal.h"
 #include "service_debug.h"
 
@@ -245,6 +246,10 @@ int DTLSMessageChannel::send_( void *ctx, const unsigned char *buf, size_t len )
 	if (count == 0)
 		return MBEDTLS_ERR_SSL_WANT_WRITE;
 
+	if (count > 0) {
+		size_t payload = channel->tx_payload;
+		channel->notify_data(channel->tx_category, true, count, (payload && size_t(count) > payload) ? count - payload : 0);
+	}
 	return count;
 }
 
@@ -255,9 +260,44 @@ int DTLSMessageChannel::recv_( void *ctx, unsigned char *buf, size_t len ) {
 		// 0 means EOF in this context
 		return MBEDTLS_ERR_SSL_WANT_READ;
 	}
+	if (count > 0) {
+		// application data is attributed once it's decrypted
+		if (channel->ssl_context.state == MBEDTLS_SSL_HANDSHAKE_OVER)
+			channel->rx_bytes += count;
+		else
+			channel->notify_data(SparkCallbacks::DATA_HANDSHAKE, false, count, 0);
+	}
 	return count;
 }
 
+/**
+ * Determines what a CoAP message is for, for the data usage notifications.
+ */
+static uint8_t data_category(const Message& message)
+{
+	if (message.is_retransmit())
+		return SparkCallbacks::DATA_RETRANSMIT;
+
+	switch (Messages::decodeType(message.buf(), message.length()))
+	{
+	case CoAPMessageType::HELLO:
+		return SparkCallbacks::DATA_HANDSHAKE;
+	case CoAPMessageType::PING:
+		return SparkCallbacks::DATA_PING;
+	case CoAPMessageType::EMPTY_ACK:
+		return SparkCallbacks::DATA_ACK;
+	case CoAPMessageType::EVENT:
+		return SparkCallbacks::DATA_EVENT;
+	case CoAPMessageType::SAVE_BEGIN:
+	case CoAPMessageType::UPDATE_BEGIN:
+	case CoAPMessageType::UPDATE_DONE:
+	case CoAPMessageType::CHUNK:
+		return SparkCallbacks::DATA_OTA;
+	default:
+		return SparkCallbacks::DATA_OTHER;
+	}
+}
+
 
 void DTLSMessageChannel::init()
 {
@@ -335,6 +375,7 @@ ProtocolError DTLSMessageChannel::establish()
 	}
 	uint8_t random[64];
 
+	tx_category = SparkCallbacks::DATA_HANDSHAKE;
 	do
 	{
 		while (ssl_context.state != MBEDTLS_SSL_HANDSHAKE_OVER)
@@ -354,6 +395,7 @@ ProtocolError DTLSMessageChannel::establish()
 	}
 	while(ret == MBEDTLS_ERR_SSL_WANT_READ ||
 	      ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+	tx_category = SparkCallbacks::DATA_OTHER;
 
 	if (ret)
 	{
@@ -385,7 +427,15 @@ ProtocolError DTLSMessageChannel::receive(Message& message)
 	size_t len = message.capacity();
 
 	conf.read_timeout = 0;
+	rx_bytes = 0;
 	int ret = mbedtls_ssl_read(&ssl_context, buf, len);
+	if (rx_bytes)
+	{
+		// records that don't decrypt to a message, such as alerts, are counted as other
+		Message received(buf, len, ret>0 ? ret : 0);
+		uint8_t category = ret>0 ? data_category(received) : SparkCallbacks::DATA_OTHER;
+		notify_data(category, false, rx_bytes, (ret>0 && rx_bytes>size_t(ret)) ? rx_bytes-ret : 0);
+	}
 	if (ret<0) {
 		switch (ret) {
 		case MBEDTLS_ERR_SSL_WANT_READ:
@@ -435,7 +485,11 @@ ProtocolError DTLSMessageChannel::send(Message& message)
       log_direct_("\n");
 #endif
 
+  tx_category = data_category(message);
+  tx_payload = message.length();
   int ret = mbedtls_ssl_write(&ssl_context, message.buf(), message.length());
+  tx_category = SparkCallbacks::DATA_OTHER;
+  tx_payload = 0;
   if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
   {
 		mbedtls_ssl_session_reset(&ssl_context);
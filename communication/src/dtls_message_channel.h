@@ -22,6 +22,7 @@
 #include "device_keys.h"
 #include "message_channel.h"
 #include "buffer_message_channel.h"
+#include "spark_protocol_functions.h"
 
 #include "mbedtls/ssl.h"
 #include "mbedtls/ssl_internal.h"
@@ -68,6 +69,11 @@ public:
 		 * Restore to the given buffer. Returns the number of bytes restored.
 		 */
 		int (*restore)(void* data, size_t max_length, uint8_t type, void* reserved);
+
+		/**
+		 * Notifies the bytes sent or received, see SparkCallbacks::notify_data.
+		 */
+		void (*notify_data)(uint8_t category, bool sent, size_t bytes, size_t security, void* reserved);
 	};
 
 private:
@@ -89,6 +95,19 @@ private:
 	 */
 	message_id_t* coap_state;
 
+	/**
+	 * What the data being sent is for, and the size of the message it
+	 * encrypts, 0 during the handshake.
+	 */
+	uint8_t tx_category;
+	size_t tx_payload;
+
+	/**
+	 * The bytes received for the message being read, which are attributed
+	 * once the message is decrypted.
+	 */
+	size_t rx_bytes;
+
     void init();
     void dispose();
 
@@ -101,11 +120,17 @@ private:
     int send(const uint8_t* data, size_t len);
     int recv(uint8_t* data, size_t len);
 
+    void notify_data(uint8_t category, bool sent, size_t bytes, size_t security)
+    {
+    		if (callbacks.notify_data && bytes)
+    			callbacks.notify_data(category, sent, bytes, security, nullptr);
+    }
+
 	ProtocolError setup_context();
 
 
  public:
-	DTLSMessageChannel() : coap_state(nullptr) {}
+	DTLSMessageChannel() : coap_state(nullptr), tx_category(SparkCallbacks::DATA_OTHER), tx_payload(0), rx_bytes(0) {}
 
 	ProtocolError init(const uint8_t* core_private, size_t core_private_len,
 		const uint8_t* core_public, size_t core_public_len,
@@ -22,6 +22,9 @@ void DTLSProtocol::init(const char *id,
 		channelCallbacks.save = callbacks.save;
 		channelCallbacks.restore = callbacks.restore;
 	}
+	if (callbacks.size>=60) {
+		channelCallbacks.notify_data = callbacks.notify_data;
+	}
 
 	channel.set_millis(callbacks.millis);
 
@@ -28,10 +28,17 @@ namespace FileTransfer {
         enum __attribute__ ((__packed__)) Enum {
             FIRMWARE,
             SYSTEM,          // storage provided by the platform, e.g. external flash
+            FIRMWARE_COMPRESSED,    // firmware compressed as in services/inc/lzss.h, expanded into OTA storage
             APPLICATION=128, // storage provided by the application.
         };
     };
 
+    namespace Flags {
+        enum Enum {
+            DELTA = 1,      // the file is a patch to the installed module (services/inc/delta_patch.h)
+        };
+    };
+
     struct __attribute__((packed)) Chunk
     {
         uint16_t size;
@@ -51,17 +58,22 @@ namespace FileTransfer {
          * The target device ID.
          * 0 means OTA storage.
          * 1 means system-provided storage
-         * 2 means application-provided storage
+         * 2 means firmware compressed, which is expanded into OTA storage
+         * 128 means application-provided storage
          */
         Store::Enum store;
-        uint8_t reserved;       // padding
+
+        /**
+         * A combination of Flags.
+         */
+        uint8_t flags;
     };
 
     STATIC_ASSERT(Chunk_size, sizeof(Chunk)==12);
 
     struct Descriptor : public Chunk
     {
-        Descriptor() { size = sizeof(*this); }
+        Descriptor() { size = sizeof(*this); flags = 0; }
 
         /**
          * The length of the file data.
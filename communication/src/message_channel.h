@@ -39,6 +39,7 @@ class Message
 	size_t message_length;
     int id;                     // if < 0 then not-defined.
     bool confirm_received;
+    bool retransmit;
 
 	size_t trim_capacity()
 	{
@@ -63,7 +64,7 @@ class Message
 public:
 	Message() : Message(nullptr, 0, 0) {}
 
-	Message(uint8_t* buf, size_t buflen, size_t msglen=0) : buffer(buf), buffer_length(buflen), message_length(msglen), id(-1), confirm_received(false) {}
+	Message(uint8_t* buf, size_t buflen, size_t msglen=0) : buffer(buf), buffer_length(buflen), message_length(msglen), id(-1), confirm_received(false), retransmit(false) {}
 
 	void clear() { id = -1; }
 
@@ -109,6 +110,13 @@ public:
 
     bool get_confirm_received() const { return confirm_received; }
 
+    /**
+     * Marks this message as a copy of one already sent.
+     */
+    void set_retransmit(bool retransmit) { this->retransmit = retransmit; }
+
+    bool is_retransmit() const { return retransmit; }
+
     /**
      * Set the contents of this message.
      */
@@ -207,6 +207,7 @@ int Protocol::begin()
 		WARN("handshake failed with code %d", error);
 		return error;
 	}
+	notify_handshake(session_resumed ? SparkCallbacks::HANDSHAKE_SESSION_RESUMED : SparkCallbacks::HANDSHAKE_SECURED);
 
 	// resumed an existing session and don't need the hello
 	if (session_resumed && (flags & SKIP_SESSION_RESUME_HELLO))
@@ -232,6 +233,7 @@ int Protocol::begin()
 			return error;
 	}
 	INFO("Hanshake: completed");
+	notify_handshake(SparkCallbacks::HANDSHAKE_HELLO_COMPLETE);
 	channel.notify_established();
 	flags |= SKIP_SESSION_RESUME_HELLO;
 	return error;
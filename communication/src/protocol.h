@@ -222,6 +222,15 @@ protected:
 	 */
 	void handle_time_response(uint32_t time);
 
+	/**
+	 * Notifies the system of progress through the handshake.
+	 */
+	void notify_handshake(SparkCallbacks::HandshakeEvent event)
+	{
+		if (callbacks.notify_handshake)
+			callbacks.notify_handshake(event, nullptr);
+	}
+
 	/**
 	 * Copy an initialize a block of memory from a source to a target, where the source may be smaller than the target.
 	 * This handles the case where the caller was compiled using a smaller version of the struct memory than what is the current.
@@ -109,6 +109,8 @@ int SparkProtocol::handshake(void)
 
   err = set_key(queue);
   if (err) { ERROR("Handshake:  could not set key, %d"); return err; }
+  if (callbacks.notify_handshake)
+      callbacks.notify_handshake(SparkCallbacks::HANDSHAKE_SECURED, nullptr);
 
   hello(queue, descriptor.was_ota_upgrade_successful());
 
@@ -121,6 +123,8 @@ int SparkProtocol::handshake(void)
       return -1;
   }
   INFO("Hanshake: completed");
+  if (callbacks.notify_handshake)
+      callbacks.notify_handshake(SparkCallbacks::HANDSHAKE_HELLO_COMPLETE, nullptr);
   return 0;
 }
 
@@ -976,6 +980,7 @@ bool SparkProtocol::handle_update_begin(msg& message)
         file.store = FileTransfer::Store::Enum(decode_uint8(queue+15));
         file.file_address = decode_uint32(queue+16);
         file.chunk_address = file.file_address;
+        file.flags = (flags & 2) ? FileTransfer::Flags::DELTA : 0;
     }
     else {
         file.chunk_size = 0;
@@ -983,6 +988,7 @@ bool SparkProtocol::handle_update_begin(msg& message)
         file.store = FileTransfer::Store::FIRMWARE;
         file.file_address = 0;
         file.chunk_address = 0;
+        file.flags = 0;
     }
 
     // check the parameters only
@@ -115,9 +115,43 @@ struct SparkCallbacks
 	int (*restore)(void* data, size_t max_length, uint8_t type, void* reserved);
 
 	// size == 52
+
+	enum HandshakeEvent
+	{
+		HANDSHAKE_SECURED = 0,			// the secure channel handshake completed
+		HANDSHAKE_SESSION_RESUMED = 1,	// the secure channel was restored from a saved session
+		HANDSHAKE_HELLO_COMPLETE = 2,	// the hello message was sent (and the response received when required)
+	};
+	/**
+	 * Notifies progress through the handshake. May be null.
+	 */
+	void (*notify_handshake)(uint8_t event, void* reserved);
+
+	// size == 56
+
+	enum DataCategory
+	{
+		DATA_HANDSHAKE = 0,		// the secure channel handshake and the hello
+		DATA_PING = 1,			// keep-alive pings
+		DATA_ACK = 2,			// empty acknowledgements
+		DATA_EVENT = 3,			// published and subscribed events
+		DATA_OTA = 4,			// firmware update requests and chunks
+		DATA_RETRANSMIT = 5,	// messages resent, whatever they were for
+		DATA_OTHER = 6,			// functions, variables, time and the rest
+	};
+	/**
+	 * Notifies the data sent or received on the connection, once for each
+	 * datagram or block passed to send or receive. May be null.
+	 * @param category	A DataCategory.
+	 * @param bytes		The bytes sent or received.
+	 * @param security	The bytes of security framing within them, 0 during the handshake.
+	 */
+	void (*notify_data)(uint8_t category, bool sent, size_t bytes, size_t security, void* reserved);
+
+	// size == 60
 };
 
-STATIC_ASSERT(SparkCallbacks_size, sizeof(SparkCallbacks)==(sizeof(void*)*13));
+STATIC_ASSERT(SparkCallbacks_size, sizeof(SparkCallbacks)==(sizeof(void*)*15));
 
 /**
  * Application-supplied callbacks. (Deliberately distinct from the system-supplied
@@ -162,6 +162,100 @@ cellular_result_t cellular_signal(CellularSignalHal &signal, void* reserved);
 cellular_result_t cellular_command(_CALLBACKPTR_MDM cb, void* param,
                          system_tick_t timeout_ms, const char* format, ...);
 
+/**
+ * Bytes and packets moved in each direction. A packet is a UDP datagram, or
+ * a block written to or read from a TCP socket.
+ */
+typedef struct {
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t tx_packets;
+    uint32_t rx_packets;
+} CellularDataCount;
+
+/**
+ * What the cloud connection's traffic was for.
+ */
+typedef enum {
+    CELLULAR_DATA_HANDSHAKE = 0,    // the secure channel handshake and the hello
+    CELLULAR_DATA_PING = 1,         // keep-alive pings
+    CELLULAR_DATA_ACK = 2,          // empty acknowledgements, including those of pings
+    CELLULAR_DATA_EVENT = 3,        // published and subscribed events
+    CELLULAR_DATA_OTA = 4,          // firmware updates
+    CELLULAR_DATA_RETRANSMIT = 5,   // messages resent, whatever they were for
+    CELLULAR_DATA_OTHER = 6,        // functions, variables, time and the rest
+    CELLULAR_DATA_CATEGORIES = 7
+} cellular_data_category_t;
+
+/**
+ * The data usage counters, without a constructor so that they can be kept
+ * in retained memory.
+ */
+typedef struct {
+    uint16_t size;
+    uint16_t reserved;
+    CellularDataCount tcp;          // payload on TCP sockets
+    CellularDataCount udp;          // payload on UDP sockets
+    uint32_t tx_headers;            // IP, TCP and UDP headers, estimated per packet
+    uint32_t rx_headers;
+    uint32_t tx_security;           // record framing, nonces and MACs on cloud events, updates and other messages
+    uint32_t rx_security;
+    CellularDataCount cloud[CELLULAR_DATA_CATEGORIES];  // the cloud connection's share of tcp and udp
+} CellularDataCounters;
+
+#ifdef __cplusplus
+struct CellularDataUsage : CellularDataCounters
+{
+    CellularDataUsage() : CellularDataCounters()
+    {
+        size = sizeof(*this);
+    }
+};
+#else
+typedef struct CellularDataUsage CellularDataUsage;
+#endif
+
+/**
+ * Retrieve the data counted since the last reset of the counters. The
+ * counters are kept in retained memory, so they survive sleep and reset.
+ */
+cellular_result_t cellular_data_usage_get(CellularDataUsage* usage, void* reserved);
+
+/**
+ * Set the data usage counters to zero.
+ */
+cellular_result_t cellular_data_usage_reset(void* reserved);
+
+/**
+ * Retrieve the data counted on a socket since it was created.
+ */
+cellular_result_t cellular_data_usage_socket(int socket, CellularDataCount* count, void* reserved);
+
+/**
+ * Attribute traffic on the cloud connection, which is also counted by the
+ * socket it was sent or received on, to a category.
+ * @param bytes     the size of the datagram or block
+ * @param security  how much of it is security framing
+ */
+void cellular_data_usage_cloud(uint8_t category, bool sent, size_t bytes, size_t security, void* reserved);
+
+/**
+ * Formats data usage as JSON, with the overhead spent on headers, security,
+ * the handshake, pings, acknowledgements and retransmits. Counts are given as
+ * [tx_bytes, rx_bytes, tx_packets, rx_packets].
+ * @return the length of the report, which is truncated when it doesn't fit
+ */
+size_t cellular_data_usage_format(const CellularDataUsage* usage, char* buf, size_t length);
+
+/**
+ * Selects how socket data is passed to the modem. In hex mode the data is
+ * encoded in the write command itself, which saves the prompt round trip and
+ * the pause the modem needs before binary data, but doubles the bytes on the
+ * serial line, so suits applications that make many short writes.
+ * The mode is kept when the modem is powered off and on again.
+ */
+cellular_result_t cellular_socket_hex_mode(bool hex, void* reserved);
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,6 +50,16 @@ uint8_t HAL_EEPROM_Read(uint32_t address);
 void HAL_EEPROM_Write(uint32_t address, uint8_t data);
 size_t HAL_EEPROM_Length();
 
+/**
+ * Reads a contiguous range of EEPROM cells.
+ */
+void HAL_EEPROM_Get(uint32_t address, void* data, size_t length);
+
+/**
+ * Writes a contiguous range of EEPROM cells. Only cells that change are written.
+ */
+void HAL_EEPROM_Put(uint32_t address, const void* data, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
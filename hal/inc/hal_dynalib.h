@@ -69,4 +69,6 @@ DYNALIB_FN(hal,HAL_EEPROM_Length)
 
 DYNALIB_FN(hal,HAL_disable_irq)
 DYNALIB_FN(hal,HAL_enable_irq)
+DYNALIB_FN(hal,HAL_EEPROM_Get)
+DYNALIB_FN(hal,HAL_EEPROM_Put)
 DYNALIB_END(hal)
@@ -51,6 +51,13 @@ DYNALIB_FN(hal_cellular, inet_gethostbyname)
 DYNALIB_FN(hal_cellular, inet_ping)
 DYNALIB_FN(hal_cellular, cellular_signal)
 DYNALIB_FN(hal_cellular, cellular_command)
+DYNALIB_FN(hal_cellular, inet_dns_cache_invalidate)
+DYNALIB_FN(hal_cellular, cellular_data_usage_get)
+DYNALIB_FN(hal_cellular, cellular_data_usage_reset)
+DYNALIB_FN(hal_cellular, cellular_data_usage_socket)
+DYNALIB_FN(hal_cellular, cellular_data_usage_cloud)
+DYNALIB_FN(hal_cellular, cellular_data_usage_format)
+DYNALIB_FN(hal_cellular, cellular_socket_hex_mode)
 
 DYNALIB_END(hal_cellular)
 
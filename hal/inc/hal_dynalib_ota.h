@@ -48,6 +48,7 @@ DYNALIB_FN(hal_ota,HAL_OTA_Flashed_ResetStatus)
 DYNALIB_FN(hal_ota,HAL_FLASH_Begin)
 DYNALIB_FN(hal_ota,HAL_FLASH_Update)
 DYNALIB_FN(hal_ota,HAL_FLASH_End)
+DYNALIB_FN(hal_ota,HAL_FLASH_ApplyPatch)
 DYNALIB_END(hal_ota)
 
 #endif	/* HAL_DYNALIB_OTA_H */
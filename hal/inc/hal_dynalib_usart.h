@@ -60,6 +60,17 @@ DYNALIB_FN(hal_usart,HAL_USART_Peek_Data)
 DYNALIB_FN(hal_usart,HAL_USART_Flush_Data)
 DYNALIB_FN(hal_usart,HAL_USART_Is_Enabled)
 DYNALIB_FN(hal_usart,HAL_USART_Half_Duplex)
+DYNALIB_FN(hal_usart,HAL_USART_Wait_Available)
+
+#ifdef USB_CDC_ENABLE
+DYNALIB_FN(hal_usart,USB_USART_Wait_Available)
+#endif
+DYNALIB_FN(hal_usart,HAL_USART_Set_Buffers)
+
+#ifdef USB_CDC_ENABLE
+DYNALIB_FN(hal_usart,USB_USART_Send_Data_Bulk)
+DYNALIB_FN(hal_usart,USB_USART_Receive_Data_Bulk)
+#endif
 
 DYNALIB_END(hal_usart)
 
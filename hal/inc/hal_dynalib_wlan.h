@@ -67,6 +67,7 @@ DYNALIB_FN(hal_wlan,wlan_select_antenna)
 DYNALIB_FN(hal_wlan,wlan_set_ipaddress)
 DYNALIB_FN(hal_wlan,wlan_set_ipaddress_source)
 DYNALIB_FN(hal_wlan,wlan_scan)
+DYNALIB_FN(hal_wlan,inet_dns_cache_invalidate)
 DYNALIB_END(hal_wlan)
 
 #endif	/* HAL_DYNALIB_WLAN_H */
@@ -92,11 +92,21 @@ typedef uint32_t network_interface_t;
  * @param hostname      buffer to receive the hostname
  * @param hostnameLen   length of the hostname buffer
  * @param out_ip_addr   The ip address in network byte order.
+ * @param nif           Not used. Each platform resolves hostnames on its one
+ *                      network interface, so lookups are cached by hostname only.
  * @return
  */
 int inet_gethostbyname(const char* hostname, uint16_t hostnameLen, HAL_IPAddress* out_ip_addr,
         network_interface_t nif, void* reserved);
 
+/**
+ * Discards the cached result of a previous inet_gethostbyname() lookup, so
+ * the next lookup of the hostname queries the network again.
+ * @param hostname      The hostname to discard, or NULL to discard all cached lookups.
+ * @return 0 on success.
+ */
+int inet_dns_cache_invalidate(const char* hostname, network_interface_t nif, void* reserved);
+
 
 /**
  *
@@ -34,6 +34,16 @@
 #include "module_info_hal.h"
 #include "module_info.h"
 
+/**
+ * Delta patches and compressed images are read back from the OTA region in
+ * place, so can only be applied when it is in memory mapped internal flash.
+ */
+#if PLATFORM_ID>3 && !defined(USE_SERIAL_FLASH)
+#define HAL_OTA_MEMORY_MAPPED 1
+#else
+#define HAL_OTA_MEMORY_MAPPED 0
+#endif
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -132,6 +142,17 @@ typedef enum {
 
 hal_update_complete_t HAL_FLASH_End(void* reserved);
 
+/**
+ * Rebuilds a module at the start of the OTA region from a delta patch
+ * (services/inc/delta_patch.h) and the module installed where the patch says.
+ * Called before HAL_FLASH_End() when the file sent was a patch.
+ * @param address   where the patch was written, after the space for the module
+ * @param length    the length of the patch
+ * @result 0 on success. non-zero when the installed module isn't the one the
+ * patch was made from, or the patch doesn't apply.
+ */
+int HAL_FLASH_ApplyPatch(uint32_t address, uint32_t length, void* reserved);
+
 uint32_t HAL_FLASH_ModuleAddress(uint32_t address);
 uint32_t HAL_FLASH_ModuleLength(uint32_t address);
 bool HAL_FLASH_VerifyCRC32(uint32_t address, uint32_t length);
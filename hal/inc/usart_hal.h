@@ -28,9 +28,11 @@
 #define __USART_HAL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /* Includes ------------------------------------------------------------------*/
 #include "pinmap_hal.h"
+#include "system_tick_hal.h"
 
 /* Exported defines ----------------------------------------------------------*/
 #if PLATFORM_ID == 10 // Electron
@@ -79,6 +81,22 @@ void HAL_USART_Flush_Data(HAL_USART_Serial serial);
 bool HAL_USART_Is_Enabled(HAL_USART_Serial serial);
 void HAL_USART_Half_Duplex(HAL_USART_Serial serial, bool Enable);
 
+/**
+ * Waits until received data is available or the timeout in milliseconds elapses.
+ * The calling thread is blocked rather than polling where the platform supports it.
+ * @return the number of bytes available, which is 0 when the timeout elapsed.
+ */
+int32_t HAL_USART_Wait_Available(HAL_USART_Serial serial, system_tick_t timeout);
+
+/**
+ * Sets the storage used to buffer received and transmitted data, which can be
+ * any size. Passing NULL for a buffer restores the default SERIAL_BUFFER_SIZE
+ * buffer given to HAL_USART_Init(), as HAL_USART_End() does. Must be called while
+ * the USART is not enabled.
+ * The buffers hold one byte less than their size.
+ */
+void HAL_USART_Set_Buffers(HAL_USART_Serial serial, uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "system_tick_hal.h"
 /* Exported types ------------------------------------------------------------*/
 
 /* Exported constants --------------------------------------------------------*/
@@ -95,6 +97,29 @@ int32_t USB_USART_Receive_Data(uint8_t peek);
  * @param Data      The data to write.
  */
 void USB_USART_Send_Data(uint8_t Data);
+
+/**
+ * Waits until data from the host is available or the timeout in milliseconds elapses.
+ * @return the number of bytes available, which is 0 when the timeout elapsed.
+ */
+int32_t USB_USART_Wait_Available(system_tick_t timeout);
+
+/**
+ * Sends a block of data to the USB serial.
+ * @param data      The data to write.
+ * @param length    The number of bytes to write.
+ * @param timeout   How long in milliseconds to wait for the host to make room
+ * when the transmit buffer is full. When 0, only what fits is written.
+ * @return the number of bytes written, which is less than `length` when the
+ * timeout elapsed or the host is not connected.
+ */
+int32_t USB_USART_Send_Data_Bulk(const uint8_t* data, size_t length, system_tick_t timeout);
+
+/**
+ * Reads up to `length` bytes received from the host without waiting.
+ * @return the number of bytes read, which is 0 when none are available.
+ */
+int32_t USB_USART_Receive_Data_Bulk(uint8_t* data, size_t length);
 #endif
 
 #ifdef USB_HID_ENABLE
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file    retained_block.h
+ * @brief   Data kept in retained memory across sleep and reset
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef RETAINED_BLOCK_H
+#define RETAINED_BLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#if defined(STM32F2XX)
+#define PLATFORM_BACKUP_RAM 1
+#include "platform_headers.h"
+#else
+#define PLATFORM_BACKUP_RAM 0
+#define retained_system
+#endif
+
+/**
+ * A struct in retained memory, with a signature to tell data that survived
+ * a reset from memory that was never written. The struct starts with its
+ * size as a uint16_t, as the HAL structs do, so a struct that has changed
+ * size since it was written isn't valid either.
+ *
+ * T must be trivial, so that a static instance has no constructor to clear
+ * it at startup.
+ */
+template <typename T, uint32_t SIGNATURE>
+struct RetainedBlock
+{
+    static_assert(std::is_trivial<T>::value, "retained data must not have a constructor");
+
+    uint32_t signature;
+    T data;
+
+    /**
+     * @return true if the data survived the last reset. Always false on
+     * platforms without retained memory.
+     */
+    bool is_valid() const
+    {
+        return PLATFORM_BACKUP_RAM && signature==SIGNATURE && data.size==sizeof(data);
+    }
+
+    void clear()
+    {
+        memset(&data, 0, sizeof(data));
+        data.size = sizeof(data);
+        signature = SIGNATURE;
+    }
+};
+
+#endif	/* RETAINED_BLOCK_H */
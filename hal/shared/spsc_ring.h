@@ -0,0 +1,242 @@
+/**
+ ******************************************************************************
+ * @file    spsc_ring.h
+ * @brief   Lock-free ring buffer for one producer and one consumer
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * A ring buffer with one producer and one consumer, such as an interrupt handler
+ * and the application thread, that needs no locking. The producer only moves
+ * the head and the consumer only moves the tail.
+ *
+ * The storage is supplied by the caller and can be any size. One element is
+ * kept free to tell a full buffer from an empty one, except when the head is
+ * moved by hardware with setHead(), such as a circular DMA transfer.
+ *
+ * The default constructor is constexpr so that static instances are
+ * initialized before any constructors run.
+ */
+template <typename T>
+class SPSCRing
+{
+    T* buffer_;
+    size_t size_;
+    std::atomic<size_t> head_;
+    std::atomic<size_t> tail_;
+
+    size_t next(size_t index) const
+    {
+        return ++index==size_ ? 0 : index;
+    }
+
+    size_t count(size_t head, size_t tail) const
+    {
+        return head>=tail ? head-tail : head+size_-tail;
+    }
+
+public:
+    constexpr SPSCRing() : buffer_(nullptr), size_(0), head_(0), tail_(0) {}
+
+    SPSCRing(T* buffer, size_t size) : SPSCRing()
+    {
+        init(buffer, size);
+    }
+
+    /**
+     * Sets the storage and empties the buffer. Neither the producer nor the
+     * consumer may be using the buffer.
+     */
+    void init(T* buffer, size_t size)
+    {
+        buffer_ = buffer;
+        size_ = buffer ? size : 0;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_release);
+    }
+
+    T* buffer() const { return buffer_; }
+    size_t size() const { return size_; }
+
+    /**
+     * The most elements the buffer can hold.
+     */
+    size_t capacity() const { return size_ ? size_-1 : 0; }
+
+    // Consumer
+
+    /**
+     * The number of elements that can be read.
+     */
+    size_t available() const
+    {
+        return count(head_.load(std::memory_order_acquire), tail_.load(std::memory_order_relaxed));
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire)==tail_.load(std::memory_order_relaxed);
+    }
+
+    bool peek(T& value) const
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire)==tail)
+            return false;
+        value = buffer_[tail];
+        return true;
+    }
+
+    bool get(T& value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire)==tail)
+            return false;
+        value = buffer_[tail];
+        tail_.store(next(tail), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Reads up to `length` elements, returning the number read.
+     */
+    size_t read(T* data, size_t length)
+    {
+        size_t read = 0;
+        const T* block;
+        size_t n;
+        while (read<length && (n = readable(block))>0) {
+            if (n>length-read)
+                n = length-read;
+            for (size_t i=0; i<n; i++)
+                data[read+i] = block[i];
+            consume(n);
+            read += n;
+        }
+        return read;
+    }
+
+    /**
+     * Points `data` at the elements that can be read without wrapping, and
+     * returns how many there are. Call consume() once they have been used.
+     */
+    size_t readable(const T*& data) const
+    {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        data = buffer_+tail;
+        return head>=tail ? head-tail : size_-tail;
+    }
+
+    void consume(size_t n)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed)+n;
+        tail_.store(tail>=size_ ? tail-size_ : tail, std::memory_order_release);
+    }
+
+    /**
+     * Discards everything that can be read.
+     */
+    void clear()
+    {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Producer
+
+    /**
+     * The number of elements that can be written.
+     */
+    size_t space() const
+    {
+        return capacity()-count(head_.load(std::memory_order_relaxed), tail_.load(std::memory_order_acquire));
+    }
+
+    bool full() const
+    {
+        return size_==0 || next(head_.load(std::memory_order_relaxed))==tail_.load(std::memory_order_acquire);
+    }
+
+    bool put(const T& value)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t after = next(head);
+        if (size_==0 || after==tail_.load(std::memory_order_acquire))
+            return false;
+        buffer_[head] = value;
+        head_.store(after, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Writes up to `length` elements, returning the number written.
+     */
+    size_t write(const T* data, size_t length)
+    {
+        size_t written = 0;
+        T* block;
+        size_t n;
+        while (written<length && (n = writable(block))>0) {
+            if (n>length-written)
+                n = length-written;
+            for (size_t i=0; i<n; i++)
+                block[i] = data[written+i];
+            produce(n);
+            written += n;
+        }
+        return written;
+    }
+
+    /**
+     * Points `data` at the free elements that can be written without wrapping,
+     * and returns how many there are. Call produce() once they have been filled.
+     */
+    size_t writable(T*& data) const
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        data = buffer_+head;
+        if (size_==0)
+            return 0;
+        if (head<tail)
+            return tail-head-1;
+        return tail ? size_-head : size_-head-1;
+    }
+
+    void produce(size_t n)
+    {
+        size_t head = head_.load(std::memory_order_relaxed)+n;
+        head_.store(head>=size_ ? head-size_ : head, std::memory_order_release);
+    }
+
+    /**
+     * Moves the head to where hardware has written up to.
+     */
+    void setHead(size_t head)
+    {
+        head_.store(head>=size_ ? 0 : head, std::memory_order_release);
+    }
+};
+
+#endif  /* SPSC_RING_H */
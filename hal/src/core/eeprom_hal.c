@@ -110,6 +110,29 @@ void HAL_EEPROM_Write(uint32_t address, uint8_t data)
     }
 }
 
+void HAL_EEPROM_Get(uint32_t address, void* data, size_t length)
+{
+    uint8_t* bytes = (uint8_t*)data;
+    while (length--)
+    {
+        *bytes++ = HAL_EEPROM_Read(address++);
+    }
+}
+
+void HAL_EEPROM_Put(uint32_t address, const void* data, size_t length)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (length--)
+    {
+        if (HAL_EEPROM_Read(address) != *bytes)
+        {
+            HAL_EEPROM_Write(address, *bytes);
+        }
+        address++;
+        bytes++;
+    }
+}
+
 /**
  * @brief  Erases PAGE0 and PAGE1 and writes VALID_PAGE header to PAGE0
  * @param  None
@@ -41,4 +41,9 @@ int inet_gethostbyname(const char* hostname, uint16_t hostnameLen, HAL_IPAddress
     return result;
 }
 
+int inet_dns_cache_invalidate(const char* hostname, network_interface_t nif, void* reserved)
+{
+    return 0;
+}
+
 // inet_ping in wlan_hal.c
@@ -70,6 +70,11 @@ hal_update_complete_t HAL_FLASH_End( void* reserved)
     return HAL_UPDATE_APPLIED_PENDING_RESTART;
 }
 
+int HAL_FLASH_ApplyPatch(uint32_t address, uint32_t length, void* reserved)
+{
+    return -1;
+}
+
 void HAL_FLASH_Read_ServerAddress(ServerAddress* server_addr)
 {
     uint8_t buf[EXTERNAL_FLASH_SERVER_DOMAIN_LENGTH];
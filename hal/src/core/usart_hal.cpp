@@ -1,6 +1,6 @@
 /**
  ******************************************************************************
- * @file    usart_hal.c
+ * @file    usart_hal.cpp
  * @author  Satish Nair, Brett Walach
  * @version V1.0.0
  * @date    12-Sept-2014
@@ -27,6 +27,8 @@
 #include "usart_hal.h"
 #include "gpio_hal.h"
 #include "stm32f10x.h"
+#include "timer_hal.h"
+#include "spsc_ring.h"
 #include <string.h>
 
 /* Private typedef -----------------------------------------------------------*/
@@ -53,10 +55,6 @@ typedef struct STM32_USART_Info {
 
   uint32_t usart_pin_remap;
 
-  // Buffer pointers. These need to be global for IRQ handler access
-  Ring_Buffer* usart_tx_buffer;
-  Ring_Buffer* usart_rx_buffer;
-
   bool usart_enabled;
   bool usart_transmitting;
 } STM32_USART_Info;
@@ -74,8 +72,6 @@ STM32_USART_Info USART_MAP[TOTAL_USARTS] =
      * TX pin
      * RX pin
      * GPIO Remap (RCC_APB2Periph_USART2 or GPIO_Remap_None )
-     * <tx_buffer pointer> used internally and does not appear below
-     * <rx_buffer pointer> used internally and does not appear below
      * <usart enabled> used internally and does not appear below
      * <usart transmitting> used internally and does not appear below
      */
@@ -90,17 +86,18 @@ static STM32_USART_Info *usartMap[TOTAL_USARTS]; // pointer to USART_MAP[] conta
 
 /* Private function prototypes -----------------------------------------------*/
 
-inline void store_char(unsigned char c, Ring_Buffer *buffer) __attribute__((always_inline));
-inline void store_char(unsigned char c, Ring_Buffer *buffer)
+// Kept apart from USART_MAP so they are constant initialized, since
+// HAL_USART_Init() is called from global constructors.
+struct USART_Buffers
 {
-  unsigned i = (unsigned int)(buffer->head + 1) % SERIAL_BUFFER_SIZE;
+  SPSCRing<uint8_t> rx;
+  SPSCRing<uint8_t> tx;
+  // the default storage given to HAL_USART_Init()
+  Ring_Buffer* default_rx;
+  Ring_Buffer* default_tx;
+};
 
-  if (i != buffer->tail)
-  {
-    buffer->buffer[buffer->head] = c;
-    buffer->head = i;
-  }
-}
+static USART_Buffers usartBuffers[TOTAL_USARTS];
 
 void HAL_USART_Init(HAL_USART_Serial serial, Ring_Buffer *rx_buffer, Ring_Buffer *tx_buffer)
 {
@@ -113,16 +110,31 @@ void HAL_USART_Init(HAL_USART_Serial serial, Ring_Buffer *rx_buffer, Ring_Buffer
     usartMap[serial] = &USART_MAP[USART_D1_D0];
   }
 
-  usartMap[serial]->usart_rx_buffer = rx_buffer;
-  usartMap[serial]->usart_tx_buffer = tx_buffer;
-
-  memset(usartMap[serial]->usart_rx_buffer, 0, sizeof(Ring_Buffer));
-  memset(usartMap[serial]->usart_tx_buffer, 0, sizeof(Ring_Buffer));
+  usartBuffers[serial].default_rx = rx_buffer;
+  usartBuffers[serial].default_tx = tx_buffer;
+  HAL_USART_Set_Buffers(serial, NULL, 0, NULL, 0);
 
   usartMap[serial]->usart_enabled = false;
   usartMap[serial]->usart_transmitting = false;
 }
 
+void HAL_USART_Set_Buffers(HAL_USART_Serial serial, uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size)
+{
+  USART_Buffers& buffers = usartBuffers[serial];
+  if (!rx_buffer && buffers.default_rx)
+  {
+    rx_buffer = buffers.default_rx->buffer;
+    rx_size = SERIAL_BUFFER_SIZE;
+  }
+  if (!tx_buffer && buffers.default_tx)
+  {
+    tx_buffer = buffers.default_tx->buffer;
+    tx_size = SERIAL_BUFFER_SIZE;
+  }
+  buffers.rx.init(rx_buffer, rx_size);
+  buffers.tx.init(tx_buffer, tx_size);
+}
+
 void HAL_USART_Begin(HAL_USART_Serial serial, uint32_t baud)
 {
   // AFIO clock enable
@@ -182,7 +194,7 @@ void HAL_USART_Begin(HAL_USART_Serial serial, uint32_t baud)
 void HAL_USART_End(HAL_USART_Serial serial)
 {
   // wait for transmission of outgoing data
-  while (usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail);
+  while (!usartBuffers[serial].tx.empty());
 
   // Disable the USART
   USART_Cmd(usartMap[serial]->usart_peripheral, DISABLE);
@@ -205,14 +217,11 @@ void HAL_USART_End(HAL_USART_Serial serial)
   // Disable USART Clock
   *usartMap[serial]->usart_apbReg &= ~usartMap[serial]->usart_clock_en;
 
-  // clear any received data
-  usartMap[serial]->usart_rx_buffer->head = usartMap[serial]->usart_rx_buffer->tail;
-
   // Undo any pin re-mapping done for this USART
   GPIO_PinRemapConfig(usartMap[serial]->usart_pin_remap, DISABLE);
 
-  memset(usartMap[serial]->usart_rx_buffer, 0, sizeof(Ring_Buffer));
-  memset(usartMap[serial]->usart_tx_buffer, 0, sizeof(Ring_Buffer));
+  // clear any received data, and stop using the application's buffers
+  HAL_USART_Set_Buffers(serial, NULL, 0, NULL, 0);
 
   usartMap[serial]->usart_enabled = false;
   usartMap[serial]->usart_transmitting = false;
@@ -220,20 +229,20 @@ void HAL_USART_End(HAL_USART_Serial serial)
 
 uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
 {
+  SPSCRing<uint8_t>& tx = usartBuffers[serial].tx;
+
   // interrupts are off and data in queue;
   if ((USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_TXE) == RESET)
-      && usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail) {
+      && !tx.empty()) {
     // Get him busy
     USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
   }
 
-  unsigned i = (usartMap[serial]->usart_tx_buffer->head + 1) % SERIAL_BUFFER_SIZE;
-
   // If the output buffer is full, there's nothing for it other than to
   // wait for the interrupt handler to empty it a bit
   //         no space so       or  Called Off Panic with interrupt off get the message out!
   //         make space                     Enter Polled IO mode
-  while (i == usartMap[serial]->usart_tx_buffer->tail || ((__get_PRIMASK() & 1) && usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail) ) {
+  while (tx.full() || ((__get_PRIMASK() & 1) && !tx.empty()) ) {
     // Interrupts are on but they are not being serviced because this was called from a higher
     // Priority interrupt
 
@@ -242,15 +251,17 @@ uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
       // protect for good measure
       USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
       // Write out a byte
-      USART_SendData(usartMap[serial]->usart_peripheral,  usartMap[serial]->usart_tx_buffer->buffer[usartMap[serial]->usart_tx_buffer->tail++]);
-      usartMap[serial]->usart_tx_buffer->tail %= SERIAL_BUFFER_SIZE;
+      uint8_t c;
+      if (tx.get(c))
+        USART_SendData(usartMap[serial]->usart_peripheral, c);
       // unprotect
       USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
     }
+    if (!tx.size())
+      return 0;
   }
 
-  usartMap[serial]->usart_tx_buffer->buffer[usartMap[serial]->usart_tx_buffer->head] = data;
-  usartMap[serial]->usart_tx_buffer->head = i;
+  tx.put(data);
   usartMap[serial]->usart_transmitting = true;
   USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
 
@@ -259,40 +270,26 @@ uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
 
 int32_t HAL_USART_Available_Data(HAL_USART_Serial serial)
 {
-  return (unsigned int)(SERIAL_BUFFER_SIZE + usartMap[serial]->usart_rx_buffer->head - usartMap[serial]->usart_rx_buffer->tail) % SERIAL_BUFFER_SIZE;
+  return usartBuffers[serial].rx.available();
 }
 
 int32_t HAL_USART_Read_Data(HAL_USART_Serial serial)
 {
+  uint8_t c;
   // if the head isn't ahead of the tail, we don't have any characters
-  if (usartMap[serial]->usart_rx_buffer->head == usartMap[serial]->usart_rx_buffer->tail)
-  {
-    return -1;
-  }
-  else
-  {
-    unsigned char c = usartMap[serial]->usart_rx_buffer->buffer[usartMap[serial]->usart_rx_buffer->tail];
-    usartMap[serial]->usart_rx_buffer->tail = (unsigned int)(usartMap[serial]->usart_rx_buffer->tail + 1) % SERIAL_BUFFER_SIZE;
-    return c;
-  }
+  return usartBuffers[serial].rx.get(c) ? c : -1;
 }
 
 int32_t HAL_USART_Peek_Data(HAL_USART_Serial serial)
 {
-  if (usartMap[serial]->usart_rx_buffer->head == usartMap[serial]->usart_rx_buffer->tail)
-  {
-    return -1;
-  }
-  else
-  {
-    return usartMap[serial]->usart_rx_buffer->buffer[usartMap[serial]->usart_rx_buffer->tail];
-  }
+  uint8_t c;
+  return usartBuffers[serial].rx.peek(c) ? c : -1;
 }
 
 void HAL_USART_Flush_Data(HAL_USART_Serial serial)
 {
   // Loop until USART DR register is empty
-  while ( usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail );
+  while (!usartBuffers[serial].tx.empty());
   // Loop until last frame transmission complete
   while (usartMap[serial]->usart_transmitting && (USART_GetFlagStatus(usartMap[serial]->usart_peripheral, USART_FLAG_TC) == RESET));
   usartMap[serial]->usart_transmitting = false;
@@ -308,6 +305,15 @@ void HAL_USART_Half_Duplex(HAL_USART_Serial serial, bool Enable)
     USART_HalfDuplexCmd(usartMap[serial]->usart_peripheral, Enable ? ENABLE : DISABLE);
 }
 
+int32_t HAL_USART_Wait_Available(HAL_USART_Serial serial, system_tick_t timeout)
+{
+    // there are no other threads to run, so this polls
+    system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+    int32_t available;
+    while (!(available = HAL_USART_Available_Data(serial)) && HAL_Timer_Get_Milli_Seconds()-start<timeout);
+    return available;
+}
+
 // Shared Interrupt Handler for USART2/Serial1 and USART1/Serial2
 // WARNING: This function MUST remain reentrance compliant -- no local static variables etc.
 static void HAL_USART_Handler(HAL_USART_Serial serial)
@@ -316,22 +322,22 @@ static void HAL_USART_Handler(HAL_USART_Serial serial)
   {
     // Read byte from the receive data register
     unsigned char c = USART_ReceiveData(usartMap[serial]->usart_peripheral);
-    store_char(c, usartMap[serial]->usart_rx_buffer);
+    usartBuffers[serial].rx.put(c);
   }
 
   if(USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_TXE) != RESET)
   {
     // Write byte to the transmit data register
-    if (usartMap[serial]->usart_tx_buffer->head == usartMap[serial]->usart_tx_buffer->tail)
+    uint8_t c;
+    if (usartBuffers[serial].tx.get(c))
     {
-      // Buffer empty, so disable the USART Transmit interrupt
-      USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
+      // There is more data in the output buffer. Send the next byte
+      USART_SendData(usartMap[serial]->usart_peripheral, c);
     }
     else
     {
-      // There is more data in the output buffer. Send the next byte
-      USART_SendData(usartMap[serial]->usart_peripheral, usartMap[serial]->usart_tx_buffer->buffer[usartMap[serial]->usart_tx_buffer->tail++]);
-      usartMap[serial]->usart_tx_buffer->tail %= SERIAL_BUFFER_SIZE;
+      // Buffer empty, so disable the USART Transmit interrupt
+      USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
     }
   }
 }
@@ -345,7 +351,7 @@ static void HAL_USART_Handler(HAL_USART_Serial serial)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART2_Handler(void)
+extern "C" void HAL_USART2_Handler(void)
 {
   HAL_USART_Handler(HAL_USART_SERIAL1);
 }
@@ -359,7 +365,7 @@ void HAL_USART2_Handler(void)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART1_Handler(void)
+extern "C" void HAL_USART1_Handler(void)
 {
   HAL_USART_Handler(HAL_USART_SERIAL2);
 }
@@ -32,6 +32,8 @@
 #include "usb_pwr.h"
 #include "usb_prop.h"
 #include "delay_hal.h"
+#include "timer_hal.h"
+#include <string.h>
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -55,6 +57,9 @@ volatile uint8_t  USB_Rx_State = 0;
 
 uint32_t USB_USART_BaudRate = 9600;
 
+// Set when the host stopped taking data, so later writes don't wait
+static bool USB_Tx_Stalled;
+
 __IO uint8_t PrevXferComplete;
 #endif
 
@@ -224,6 +229,109 @@ void USB_USART_Send_Data(uint8_t Data)
     }
   }
 }
+
+/*
+ * The space free in the transmit buffer. One byte is kept free so a full
+ * buffer isn't seen as empty, and a packet is kept free for the one being sent.
+ */
+static uint32_t USB_USART_Tx_Free(void)
+{
+  uint32_t out = USART_Rx_ptr_out;
+  uint32_t in = USART_Rx_ptr_in;
+  if (out == USART_RX_DATA_SIZE)
+    out = 0;
+  uint32_t used = (in >= out) ? in - out : in + USART_RX_DATA_SIZE - out;
+  uint32_t reserved = 1 + (USB_Tx_State ? CDC_DATA_SIZE : 0);
+  return (used + reserved < USART_RX_DATA_SIZE) ? USART_RX_DATA_SIZE - used - reserved : 0;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Send_Data_Bulk.
+ * Description    : Copy a block of data to the buffer sent to the USB Host,
+ *                  waiting up to timeout milliseconds for the host to make room.
+ * Input          : data, length and timeout.
+ * Return         : Length written.
+ *******************************************************************************/
+int32_t USB_USART_Send_Data_Bulk(const uint8_t* data, size_t length, system_tick_t timeout)
+{
+  system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+  size_t written = 0;
+  while (written < length && bDeviceState == CONFIGURED)
+  {
+    uint32_t n = USB_USART_Tx_Free();
+    if (!n)
+    {
+      // once the host has stopped reading, don't wait on every write
+      if (USB_Tx_Stalled || HAL_Timer_Get_Milli_Seconds()-start >= timeout)
+      {
+        if (timeout)
+          USB_Tx_Stalled = true;
+        break;
+      }
+      continue;
+    }
+    USB_Tx_Stalled = false;
+    if (n > length - written)
+      n = length - written;
+
+    // at most two copies, either side of the end of the buffer
+    uint32_t in = USART_Rx_ptr_in;
+    uint32_t first = USART_RX_DATA_SIZE - in;
+    if (first > n)
+      first = n;
+    memcpy((uint8_t*)USART_Rx_Buffer + in, data + written, first);
+    memcpy((uint8_t*)USART_Rx_Buffer, data + written + first, n - first);
+    in += n;
+    if (in >= USART_RX_DATA_SIZE)
+      in -= USART_RX_DATA_SIZE;
+    // the data must be in the buffer before the USB interrupt sees it
+    __DMB();
+    USART_Rx_ptr_in = in;
+    written += n;
+  }
+  return written;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Receive_Data_Bulk.
+ * Description    : Copy the data received from the USB Host.
+ * Input          : data and length.
+ * Return         : Length read.
+ *******************************************************************************/
+int32_t USB_USART_Receive_Data_Bulk(uint8_t* data, size_t length)
+{
+  if (bDeviceState != CONFIGURED || USB_Rx_State != 1)
+    return 0;
+
+  uint32_t n = USB_Rx_length - USB_Rx_ptr;
+  if (n > length)
+    n = length;
+  memcpy(data, (const uint8_t*)USB_Rx_Buffer + USB_Rx_ptr, n);
+  USB_Rx_ptr += n;
+  if (USB_Rx_ptr == USB_Rx_length)
+  {
+    USB_Rx_State = 0;
+
+    /* Enable the receive of data on EP3 */
+    SetEPRxValid(ENDP3);
+  }
+  return n;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Wait_Available.
+ * Description    : Wait for data from the USB Host. There are no other threads
+ *                  to run, so this polls.
+ * Input          : timeout in milliseconds.
+ * Return         : Length available, 0 if the timeout elapsed.
+ *******************************************************************************/
+int32_t USB_USART_Wait_Available(system_tick_t timeout)
+{
+  system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+  int32_t available;
+  while (!(available = USB_USART_Available_Data()) && HAL_Timer_Get_Milli_Seconds()-start<timeout);
+  return available;
+}
 #endif
 
 #ifdef USB_HID_ENABLE
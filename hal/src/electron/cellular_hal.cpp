@@ -137,3 +137,38 @@ cellular_result_t cellular_command(_CALLBACKPTR_MDM cb, void* param,
 
     return electronMDM.waitFinalResp((MDMParser::_CALLBACKPTR)cb, (void*)param, timeout_ms);
 }
+
+cellular_result_t cellular_data_usage_get(CellularDataUsage* usage, void* reserved)
+{
+    CHECK_SUCCESS(usage);
+    electronMDM.getDataUsage(usage);
+    return 0;
+}
+
+cellular_result_t cellular_data_usage_reset(void* reserved)
+{
+    electronMDM.resetDataUsage();
+    return 0;
+}
+
+cellular_result_t cellular_data_usage_socket(int socket, CellularDataCount* count, void* reserved)
+{
+    CHECK_SUCCESS(electronMDM.socketDataCount(socket, count));
+    return 0;
+}
+
+void cellular_data_usage_cloud(uint8_t category, bool sent, size_t bytes, size_t security, void* reserved)
+{
+    electronMDM.countCloudData(category, sent, bytes, security);
+}
+
+size_t cellular_data_usage_format(const CellularDataUsage* usage, char* buf, size_t length)
+{
+    return MDMParser::formatDataUsage(usage, buf, length);
+}
+
+cellular_result_t cellular_socket_hex_mode(bool hex, void* reserved)
+{
+    CHECK_SUCCESS(electronMDM.socketSetHexMode(hex));
+    return 0;
+}
@@ -18,17 +18,40 @@
  */
 
 #include "inet_hal.h"
+#include "timer_hal.h"
+#include "interrupts_hal.h"
+#include "dns_cache.h"
 #include "parser.h"
 
+struct DNSCacheLock
+{
+	int is;
+	DNSCacheLock() : is(HAL_disable_irq()) {}
+	~DNSCacheLock() { HAL_enable_irq(is); }
+};
+
+/**
+ * Each lookup is a +UDNSRN round trip to the modem, so the results are cached.
+ */
+static DNSCache<HAL_IPAddress, DNSCacheLock> dns_cache;
+
 int inet_gethostbyname(const char* hostname, uint16_t hostnameLen, HAL_IPAddress* out_ip_addr,
 		network_interface_t nif, void* reserved)
 {
-	uint32_t result = electronMDM.gethostbyname(hostname);
-	if (result > 0) {
-		out_ip_addr->ipv4 = result;
-		return 0;
-	}
-    return 1;
+	return dns_cache.resolve(hostname, *out_ip_addr, HAL_Timer_Get_Milli_Seconds(), [](const char* hostname, HAL_IPAddress& ip_addr) {
+		uint32_t result = electronMDM.gethostbyname(hostname);
+		if (result > 0) {
+			ip_addr.ipv4 = result;
+			return 0;
+		}
+		return 1;
+	});
+}
+
+int inet_dns_cache_invalidate(const char* hostname, network_interface_t nif, void* reserved)
+{
+	dns_cache.invalidate(hostname);
+	return 0;
 }
 
 int inet_ping(const HAL_IPAddress* address, network_interface_t nif, uint8_t nTries,
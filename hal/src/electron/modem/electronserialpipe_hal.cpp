@@ -170,10 +170,9 @@ int ElectronSerialPipe::put(const void* buffer, int length, bool blocking)
 
 void ElectronSerialPipe::txCopy(void)
 {
-    if (_pipeTx.readable()) {
-        char c = _pipeTx.getc();
+    char c;
+    if (_pipeTx.get(&c, 1))
         USART_SendData(USART3, c);
-    }
 }
 
 void ElectronSerialPipe::txIrqBuf(void)
@@ -215,9 +214,7 @@ int ElectronSerialPipe::get(void* buffer, int length, bool blocking)
 void ElectronSerialPipe::rxIrqBuf(void)
 {
     char c = USART_ReceiveData(USART3);
-    if (_pipeRx.writeable())
-        _pipeRx.putc(c);
-    else
+    if (!_pipeRx.put(&c, 1))
         /* overflow */;
 }
 
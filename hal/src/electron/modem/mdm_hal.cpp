@@ -33,6 +33,7 @@
 #include "stm32f2xx.h"
 #include "service_debug.h"
 #include "concurrent_hal.h"
+#include "retained_block.h"
 #include <mutex>
 
 std::recursive_mutex mdm_mutex;
@@ -45,6 +46,14 @@ std::recursive_mutex mdm_mutex;
 #define PROFILE         "0"   //!< this is the psd profile used
 #define MAX_SIZE        1024  //!< max expected messages (used with RX)
 #define USO_MAX_WRITE   1024  //!< maximum number of bytes to write to socket (used with TX)
+#define USO_MAX_WRITE_HEX 512 //!< maximum number of bytes to write to socket in hex mode
+#define USO_MAX_READ    1024  //!< maximum number of bytes to read from socket
+#define USO_MAX_READ_HEX 512  //!< maximum number of bytes to read from socket in hex mode
+#define USO_PROMPT_GUARD 50   //!< minimum time from the socket write command to its data in ms
+#define REG_BACKOFF_MIN 1000  //!< first wait between registration checks in ms
+#define REG_BACKOFF_MAX 15000 //!< longest wait between registration checks in ms
+#define UDP_HEADERS     28    //!< IPv4 and UDP header bytes per datagram
+#define TCP_HEADERS     40    //!< IPv4 and TCP header bytes per segment, without options
 // num sockets
 #define NUMSOCKETS      ((int)(sizeof(_sockets)/sizeof(*_sockets)))
 //! test if it is a socket is ok to use
@@ -133,6 +142,12 @@ void MDMParser::_debugPrint(int level, const char* color, const char* format, ..
 
 MDMParser* MDMParser::inst;
 
+/**
+ * The data usage counters are kept in retained memory so that usage over a
+ * billing period survives sleep and reset.
+ */
+static retained_system RetainedBlock<CellularDataCounters, 0xDA7A05A6> dataUsage;
+
 /* Extern variables ---------------------------------------------------------*/
 
 /* Private function prototypes ----------------------------------------------*/
@@ -150,6 +165,10 @@ MDMParser::MDMParser(void)
     _activated = false;
     _attached  = false;
     _cancel_all_operations = false;
+    _hexMode   = false;
+    _stepCount = 0;
+    if (!dataUsage.is_valid())
+        dataUsage.clear();
     memset(_sockets, 0, sizeof(_sockets));
     for (int socket = 0; socket < NUMSOCKETS; socket ++)
         _sockets[socket].handle = MDM_SOCKET_ERROR;
@@ -200,7 +219,9 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
     char buf[MAX_SIZE + 64 /* add some more space for framing */];
     system_tick_t start = HAL_Timer_Get_Milli_Seconds();
     do {
-        int ret = getLine(buf, sizeof(buf));
+        int ret = getLine(buf, sizeof(buf) - 1);
+        if ((ret != WAIT) && (ret != NOT_FOUND))
+            buf[LENGTH(ret)] = '\0';
 #ifdef MDM_DEBUG
         if ((_debugLevel >= 3) && (ret != WAIT) && (ret != NOT_FOUND))
         {
@@ -224,74 +245,25 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
             int type = TYPE(ret);
             // handle unsolicited commands here
             if (type == TYPE_PLUS) {
+                static const struct {
+                    const char* cmd; _URCPTR handler;
+                } urcs[] = {
+                    { "CMTI:",      &MDMParser::_urcCMTI    },
+                    { "UUSORD:",    &MDMParser::_urcUUSORD  },
+                    { "UUSORF:",    &MDMParser::_urcUUSORD  },
+                    { "UUSOCL:",    &MDMParser::_urcUUSOCL  },
+                    { "UUPSDD:",    &MDMParser::_urcUUPSDD  },
+                    { "CREG:",      &MDMParser::_urcCREG    },
+                    { "CGREG:",     &MDMParser::_urcCGREG   },
+                };
                 const char* cmd = buf+3;
-                int a, b, c, d, r;
-                char s[32];
-
-                // SMS Command ---------------------------------
-                // +CNMI: <mem>,<index>
-                if (sscanf(cmd, "CMTI: \"%*[^\"]\",%d", &a) == 1) {
-                    DEBUG_D("New SMS at index %d\r\n", a);
-                // Socket Specific Command ---------------------------------
-                // +UUSORD: <socket>,<length>
-                } else if ((sscanf(cmd, "UUSORD: %d,%d", &a, &b) == 2)) {
-                    int socket = _findSocket(a);
-                    DEBUG_D("Socket %d: handle %d has %d bytes pending\r\n", socket, a, b);
-                    if (socket != MDM_SOCKET_ERROR)
-                        _sockets[socket].pending = b;
-                // +UUSORF: <socket>,<length>
-                } else if ((sscanf(cmd, "UUSORF: %d,%d", &a, &b) == 2)) {
-                    int socket = _findSocket(a);
-                    DEBUG_D("Socket %d: handle %d has %d bytes pending\r\n", socket, a, b);
-                    if (socket != MDM_SOCKET_ERROR)
-                        _sockets[socket].pending = b;
-                // +UUSOCL: <socket>
-                } else if ((sscanf(cmd, "UUSOCL: %d", &a) == 1)) {
-                    int socket = _findSocket(a);
-                    DEBUG_D("Socket %d: handle %d closed by remote host\r\n", socket, a);
-                    if ((socket != MDM_SOCKET_ERROR) && _sockets[socket].connected) {
-                        _sockets[socket].open = false;
-                        _sockets[socket].connected = false;
-                    }
-                }
-
-                // GSM/UMTS Specific -------------------------------------------
-                // +UUPSDD: <profile_id>
-                if (sscanf(cmd, "UUPSDD: %d",&a) == 1) {
-                    if (*PROFILE == a) {
-                        _ip = NOIP;
-                        _attached = false;
-                    }
-                } else {
-                    // +CREG|CGREG: <n>,<stat>[,<lac>,<ci>[,AcT[,<rac>]]] // reply to AT+CREG|AT+CGREG
-                    // +CREG|CGREG: <stat>[,<lac>,<ci>[,AcT[,<rac>]]]     // URC
-                    b = (int)0xFFFF; c = (int)0xFFFFFFFF; d = -1;
-                    r = sscanf(cmd, "%s %*d,%d,\"%x\",\"%x\",%d",s,&a,&b,&c,&d);
-                    if (r <= 1)
-                        r = sscanf(cmd, "%s %d,\"%x\",\"%x\",%d",s,&a,&b,&c,&d);
-                    if (r >= 2) {
-                        Reg *reg = !strcmp(s, "CREG:")  ? &_net.csd :
-                                   !strcmp(s, "CGREG:") ? &_net.psd : NULL;
-                        if (reg) {
-                            // network status
-                            if      (a == 0) *reg = REG_NONE;     // 0: not registered, home network
-                            else if (a == 1) *reg = REG_HOME;     // 1: registered, home network
-                            else if (a == 2) *reg = REG_NONE;     // 2: not registered, but MT is currently searching a new operator to register to
-                            else if (a == 3) *reg = REG_DENIED;   // 3: registration denied
-                            else if (a == 4) *reg = REG_UNKNOWN;  // 4: unknown
-                            else if (a == 5) *reg = REG_ROAMING;  // 5: registered, roaming
-                            if ((r >= 3) && (b != (int)0xFFFF))      _net.lac = b; // location area code
-                            if ((r >= 4) && (c != (int)0xFFFFFFFF))  _net.ci  = c; // cell ID
-                            // access technology
-                            if (r >= 5) {
-                                if      (d == 0) _net.act = ACT_GSM;      // 0: GSM
-                                else if (d == 1) _net.act = ACT_GSM;      // 1: GSM COMPACT
-                                else if (d == 2) _net.act = ACT_UTRAN;    // 2: UTRAN
-                                else if (d == 3) _net.act = ACT_EDGE;     // 3: GSM with EDGE availability
-                                else if (d == 4) _net.act = ACT_UTRAN;    // 4: UTRAN with HSDPA availability
-                                else if (d == 5) _net.act = ACT_UTRAN;    // 5: UTRAN with HSUPA availability
-                                else if (d == 6) _net.act = ACT_UTRAN;    // 6: UTRAN with HSDPA and HSUPA availability
-                            }
+                const char* colon = (const char*)memchr(cmd, ':', LENGTH(ret)-3);
+                if (colon) {
+                    size_t n = colon+1-cmd;
+                    for (size_t i = 0; i < sizeof(urcs)/sizeof(*urcs); i++) {
+                        if (!strncmp(urcs[i].cmd, cmd, n) && !urcs[i].cmd[n]) {
+                            (this->*urcs[i].handler)(colon+1);
+                            break;
                         }
                     }
                 }
@@ -311,8 +283,10 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
             if (type == TYPE_ABORTED)
                 return RESP_ABORTED; // This means the current command was ABORTED, so retry your command if critical.
         }
-        // relax a bit
-        HAL_Delay_Milliseconds(10);
+        else {
+            // relax a bit until more data arrives
+            HAL_Delay_Milliseconds(10);
+        }
     }
     while (!TIMEOUT(start, timeout_ms) && !_cancel_all_operations);
     //_cancel_all_operations = false; // ensure we don't block future commands.
@@ -337,6 +311,183 @@ int MDMParser::_cbInt(int type, const char* buf, int len, int* val)
     return WAIT;
 }
 
+// +CMTI: <mem>,<index>
+void MDMParser::_urcCMTI(const char* args)
+{
+    int a;
+    if (sscanf(args, " \"%*[^\"]\",%d", &a) == 1) {
+        DEBUG_D("New SMS at index %d\r\n", a);
+    }
+}
+
+// +UUSORD: <socket>,<length>
+// +UUSORF: <socket>,<length>
+void MDMParser::_urcUUSORD(const char* args)
+{
+    int a, b;
+    if (sscanf(args, "%d,%d", &a, &b) == 2) {
+        int socket = _findSocket(a);
+        DEBUG_D("Socket %d: handle %d has %d bytes pending\r\n", socket, a, b);
+        if (socket != MDM_SOCKET_ERROR)
+            _sockets[socket].pending = b;
+    }
+}
+
+// +UUSOCL: <socket>
+void MDMParser::_urcUUSOCL(const char* args)
+{
+    int a;
+    if (sscanf(args, "%d", &a) == 1) {
+        int socket = _findSocket(a);
+        DEBUG_D("Socket %d: handle %d closed by remote host\r\n", socket, a);
+        if ((socket != MDM_SOCKET_ERROR) && _sockets[socket].connected) {
+            _sockets[socket].open = false;
+            _sockets[socket].connected = false;
+        }
+    }
+}
+
+// +UUPSDD: <profile_id>
+void MDMParser::_urcUUPSDD(const char* args)
+{
+    int a;
+    if (sscanf(args, "%d", &a) == 1) {
+        if (*PROFILE == a) {
+            _ip = NOIP;
+            _attached = false;
+        }
+    }
+}
+
+void MDMParser::_urcCREG(const char* args)
+{
+    _urcRegistration(args, &_net.csd);
+}
+
+void MDMParser::_urcCGREG(const char* args)
+{
+    _urcRegistration(args, &_net.psd);
+}
+
+// +CREG|CGREG: <n>,<stat>[,<lac>,<ci>[,AcT[,<rac>]]] // reply to AT+CREG|AT+CGREG
+// +CREG|CGREG: <stat>[,<lac>,<ci>[,AcT[,<rac>]]]     // URC
+void MDMParser::_urcRegistration(const char* args, Reg* reg)
+{
+    int a, b, c, d, r;
+    b = (int)0xFFFF; c = (int)0xFFFFFFFF; d = -1;
+    r = sscanf(args, "%*d,%d,\"%x\",\"%x\",%d",&a,&b,&c,&d);
+    if (r <= 0)
+        r = sscanf(args, "%d,\"%x\",\"%x\",%d",&a,&b,&c,&d);
+    if (r >= 1) {
+        // network status
+        if      (a == 0) *reg = REG_NONE;     // 0: not registered, home network
+        else if (a == 1) *reg = REG_HOME;     // 1: registered, home network
+        else if (a == 2) *reg = REG_NONE;     // 2: not registered, but MT is currently searching a new operator to register to
+        else if (a == 3) *reg = REG_DENIED;   // 3: registration denied
+        else if (a == 4) *reg = REG_UNKNOWN;  // 4: unknown
+        else if (a == 5) *reg = REG_ROAMING;  // 5: registered, roaming
+        if ((r >= 2) && (b != (int)0xFFFF))      _net.lac = b; // location area code
+        if ((r >= 3) && (c != (int)0xFFFFFFFF))  _net.ci  = c; // cell ID
+        // access technology
+        if (r >= 4) {
+            if      (d == 0) _net.act = ACT_GSM;      // 0: GSM
+            else if (d == 1) _net.act = ACT_GSM;      // 1: GSM COMPACT
+            else if (d == 2) _net.act = ACT_UTRAN;    // 2: UTRAN
+            else if (d == 3) _net.act = ACT_EDGE;     // 3: GSM with EDGE availability
+            else if (d == 4) _net.act = ACT_UTRAN;    // 4: UTRAN with HSDPA availability
+            else if (d == 5) _net.act = ACT_UTRAN;    // 5: UTRAN with HSUPA availability
+            else if (d == 6) _net.act = ACT_UTRAN;    // 6: UTRAN with HSDPA and HSUPA availability
+        }
+    }
+}
+
+// ----------------------------------------------------------------
+// bring-up sequences
+
+void MDMParser::_recordStep(const char* stage, const char* cmd, int count, system_tick_t start, int resp)
+{
+    system_tick_t ms = HAL_Timer_Get_Milli_Seconds() - start;
+#ifdef MDM_DEBUG
+    if (_debugLevel >= 2)
+        DEBUG_D("%s: AT%s (%d commands) %d in %u ms\r\n", stage, cmd, count, resp, (unsigned)ms);
+#endif
+    if (_stepCount < (int)(sizeof(_stepTimes)/sizeof(*_stepTimes))) {
+        StepTime& step = _stepTimes[_stepCount++];
+        step.stage = stage;
+        strncpy(step.cmd, cmd, sizeof(step.cmd) - 1);
+        step.cmd[sizeof(step.cmd) - 1] = '\0';
+        step.count = count;
+        step.ms = ms;
+        step.resp = resp;
+    }
+}
+
+int MDMParser::_runStep(const char* stage, const AtStep& step)
+{
+    system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+    sendFormated("AT%s\r\n", step.cmd);
+    int ret = step.timeout_ms ? waitFinalResp(step.cb, step.param, step.timeout_ms) :
+                                waitFinalResp(step.cb, step.param);
+    _recordStep(stage, step.cmd, 1, start, ret);
+    return ret;
+}
+
+/* Runs the steps in order, sending each run of STEP_CONCAT steps as one
+ * command line, e.g. "AT+CMGF=1;+CNMI=2,1", which saves a round trip to the
+ * modem per command. The modem stops at the first command on a line that
+ * fails, so after a failure the line's commands are sent one at a time.
+ */
+bool MDMParser::_runSteps(const char* stage, const AtStep* steps, int count)
+{
+    int i = 0;
+    while ((i < count) && !_cancel_all_operations) {
+        const AtStep& step = steps[i];
+        if (!step.cmd) {
+            i++;
+            continue;
+        }
+        // this runs on the system thread's small stack, and the combined
+        // lines are under 100 characters. A single step is sent by _runStep().
+        char line[128];
+        int len = snprintf(line, sizeof(line), "AT%s", step.cmd);
+        int commands = 1;
+        int end = i + 1;
+        system_tick_t timeout_ms = step.timeout_ms;
+        if ((step.flags & STEP_CONCAT) && !step.cb) {
+            for (; end < count; end++) {
+                const AtStep& next = steps[end];
+                if (!next.cmd)
+                    continue;
+                if (!(next.flags & STEP_CONCAT) || next.cb ||
+                        (len + 1 + strlen(next.cmd) + 2 >= sizeof(line)))
+                    break;
+                len += snprintf(line + len, sizeof(line) - len, ";%s", next.cmd);
+                timeout_ms += next.timeout_ms;
+                commands++;
+            }
+        }
+        if (commands == 1) {
+            if ((RESP_OK != _runStep(stage, step)) && !(step.flags & STEP_OPTIONAL))
+                return false;
+        }
+        else {
+            system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+            sendFormated("%s\r\n", line);
+            int ret = timeout_ms ? waitFinalResp(NULL, NULL, timeout_ms) : waitFinalResp();
+            _recordStep(stage, step.cmd, commands, start, ret);
+            if (RESP_OK != ret) {
+                for (int j = i; (j < end) && !_cancel_all_operations; j++) {
+                    if (steps[j].cmd && (RESP_OK != _runStep(stage, steps[j])) &&
+                            !(steps[j].flags & STEP_OPTIONAL))
+                        return false;
+                }
+            }
+        }
+        i = end;
+    }
+    return !_cancel_all_operations;
+}
+
 // ----------------------------------------------------------------
 
 bool MDMParser::connect(
@@ -464,22 +615,20 @@ bool MDMParser::_powerOn(void)
         goto failure;
     }
 
-    // echo off
-    sendFormated("AT E0\r\n");
-    if(RESP_OK != waitFinalResp())
-        goto failure;
-    // enable verbose error messages
-    sendFormated("AT+CMEE=2\r\n");
-    if(RESP_OK != waitFinalResp())
-        goto failure;
-    // Configures sending of URCs from MT to DTE for indications
-    sendFormated("AT+CMER=1,0,0,2,1\r\n");
-    if(RESP_OK != waitFinalResp())
-        goto failure;
-    // set baud rate
-    sendFormated("AT+IPR=115200\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
+    {
+        const AtStep steps[] = {
+            // echo off
+            { "E0" },
+            // enable verbose error messages
+            { "+CMEE=2",            NULL, NULL, STEP_CONCAT },
+            // Configures sending of URCs from MT to DTE for indications
+            { "+CMER=1,0,0,2,1",    NULL, NULL, STEP_CONCAT },
+            // set baud rate
+            { "+IPR=115200" },
+        };
+        if (!_runSteps("powerOn", steps, sizeof(steps)/sizeof(*steps)))
+            goto failure;
+    }
     // wait some time until baudrate is applied
     HAL_Delay_Milliseconds(100); // SARA-G > 40ms
 
@@ -494,6 +643,7 @@ bool MDMParser::powerOn(const char* simpin)
 {
     LOCK();
     memset(&_dev, 0, sizeof(_dev));
+    _stepCount = 0;
 
     /* Power on the modem and perform basic initialization */
     if (!_powerOn())
@@ -571,67 +721,56 @@ bool MDMParser::init(DevStatus* status)
     LOCK();
     MDM_INFO("\r\n[ Modem::init ] = = = = = = = = = = = = = = =");
 
-    // Returns the product serial number, IMEI (International Mobile Equipment Identity)
-    sendFormated("AT+CGSN\r\n");
-    if (RESP_OK != waitFinalResp(_cbString, _dev.imei))
-        goto failure;
+    {
+        // Returns the product serial number, IMEI (International Mobile Equipment Identity)
+        const AtStep imei = { "+CGSN", (_CALLBACKPTR)_cbString, _dev.imei };
+        if (RESP_OK != _runStep("init", imei))
+            goto failure;
+    }
 
     if (_dev.sim != SIM_READY) {
         if (_dev.sim == SIM_MISSING)
             MDM_ERROR("SIM not inserted\r\n");
         goto failure;
     }
-    // get the manufacturer
-    sendFormated("AT+CGMI\r\n");
-    if (RESP_OK != waitFinalResp(_cbString, _dev.manu))
-        goto failure;
-    // get the model identification
-    sendFormated("AT+CGMM\r\n");
-    if (RESP_OK != waitFinalResp(_cbString, _dev.model))
-        goto failure;
-    // get the version
-    sendFormated("AT+CGMR\r\n");
-    if (RESP_OK != waitFinalResp(_cbString, _dev.ver))
-        goto failure;
-    // Returns the ICCID (Integrated Circuit Card ID) of the SIM-card.
-    // ICCID is a serial number identifying the SIM.
-    sendFormated("AT+CCID\r\n");
-    if (RESP_OK != waitFinalResp(_cbCCID, _dev.ccid))
-        goto failure;
-    // enable power saving
-    if (_dev.lpm != LPM_DISABLED) {
-         // enable power saving (requires flow control, cts at least)
-        sendFormated("AT+UPSV=1\r\n");
-        if (RESP_OK != waitFinalResp())
+    {
+        const AtStep steps[] = {
+            // get the manufacturer
+            { "+CGMI",  (_CALLBACKPTR)_cbString, _dev.manu },
+            // get the model identification
+            { "+CGMM",  (_CALLBACKPTR)_cbString, _dev.model },
+            // get the version
+            { "+CGMR",  (_CALLBACKPTR)_cbString, _dev.ver },
+            // Returns the ICCID (Integrated Circuit Card ID) of the SIM-card.
+            // ICCID is a serial number identifying the SIM.
+            { "+CCID",  (_CALLBACKPTR)_cbCCID, _dev.ccid },
+            // enable power saving (requires flow control, cts at least)
+            { (_dev.lpm != LPM_DISABLED) ? "+UPSV=1" : NULL, NULL, NULL, STEP_CONCAT },
+            // setup the GPRS network registration URC (Unsolicited Response Code)
+            // 0: (default value and factory-programmed value): network registration URC disabled
+            // 1: network registration URC enabled
+            // 2: network registration and location information URC enabled
+            { "+CGREG=2",   NULL, NULL, STEP_CONCAT },
+            // setup the network registration URC (Unsolicited Response Code)
+            // 0: (default value and factory-programmed value): network registration URC disabled
+            // 1: network registration URC enabled
+            // 2: network registration and location information URC enabled
+            { "+CREG=2",    NULL, NULL, STEP_CONCAT },
+            // Setup SMS in text mode
+            { "+CMGF=1",    NULL, NULL, STEP_CONCAT },
+            // setup new message indication
+            { "+CNMI=2,1",  NULL, NULL, STEP_CONCAT },
+            // restore the socket data format, which the modem resets on power on
+            { _hexMode ? "+UDCONF=1,1" : NULL, NULL, NULL, STEP_CONCAT },
+            // Request IMSI (International Mobile Subscriber Identification)
+            { "+CIMI",  (_CALLBACKPTR)_cbString, _dev.imsi },
+        };
+        if (!_runSteps("init", steps, sizeof(steps)/sizeof(*steps)))
             goto failure;
-        _dev.lpm = LPM_ACTIVE;
     }
-    // setup the GPRS network registration URC (Unsolicited Response Code)
-    // 0: (default value and factory-programmed value): network registration URC disabled
-    // 1: network registration URC enabled
-    // 2: network registration and location information URC enabled
-    sendFormated("AT+CGREG=2\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // setup the network registration URC (Unsolicited Response Code)
-    // 0: (default value and factory-programmed value): network registration URC disabled
-    // 1: network registration URC enabled
-    // 2: network registration and location information URC enabled
-    sendFormated("AT+CREG=2\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // Setup SMS in text mode
-    sendFormated("AT+CMGF=1\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // setup new message indication
-    sendFormated("AT+CNMI=2,1\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // Request IMSI (International Mobile Subscriber Identification)
-    sendFormated("AT+CIMI\r\n");
-    if (RESP_OK != waitFinalResp(_cbString, _dev.imsi))
-        goto failure;
+    if (_dev.lpm != LPM_DISABLED)
+        _dev.lpm = LPM_ACTIVE;
+    _lexer.setHex(_hexMode);
     if (status)
         memcpy(status, &_dev, sizeof(DevStatus));
     UNLOCK();
@@ -728,12 +867,16 @@ bool MDMParser::registerNet(NetStatus* status /*= NULL*/, system_tick_t timeout_
     LOCK();
     if (_init && _pwr) {
         system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+        system_tick_t backoff = REG_BACKOFF_MIN;
         MDM_INFO("\r\n[ Modem::register ] = = = = = = = = = = = = = =");
         while (!checkNetStatus(status) && !TIMEOUT(start, timeout_ms) && !_cancel_all_operations) {
-            system_tick_t start = HAL_Timer_Get_Milli_Seconds();
-            while ((HAL_Timer_Get_Milli_Seconds() - start < 15000UL) && !_cancel_all_operations); // just wait
-            //HAL_Delay_Milliseconds(15000);
+            // wait for the +CREG and +CGREG URCs to report the registration
+            // done, and poll again at increasing intervals in case they don't
+            waitFinalResp(_cbRegistered, &_net, backoff);
+            backoff = (backoff < REG_BACKOFF_MAX / 2) ? backoff * 2 : REG_BACKOFF_MAX;
         }
+        _recordStep("register", "+CREG?", 1, start,
+                (REG_OK(_net.csd) && REG_OK(_net.psd)) ? RESP_OK : RESP_ERROR);
         if (_net.csd == REG_DENIED) MDM_ERROR("CSD Registration Denied\r\n");
         if (_net.psd == REG_DENIED) MDM_ERROR("PSD Registration Denied\r\n");
         // if (_net.csd == REG_DENIED || _net.psd == REG_DENIED) {
@@ -845,6 +988,14 @@ int MDMParser::_cbCSQ(int type, const char* buf, int len, NetStatus* status)
     return WAIT;
 }
 
+int MDMParser::_cbRegistered(int type, const char* buf, int len, NetStatus* status)
+{
+    // the URC has been handled by the time the callback sees it
+    if ((type == TYPE_PLUS) && status && REG_DONE(status->csd) && REG_DONE(status->psd))
+        return RESP_OK;
+    return WAIT;
+}
+
 int MDMParser::_cbUACTIND(int type, const char* buf, int len, int* i)
 {
     if ((type == TYPE_PLUS) && i){
@@ -953,8 +1104,8 @@ MDM_IP MDMParser::join(const char* apn /*= NULL*/, const char* username /*= NULL
         bool force = false; // If we are already connected, don't force a reconnect.
 
         // perform GPRS attach
-        sendFormated("AT+CGATT=1\r\n");
-        if (RESP_OK != waitFinalResp(NULL,NULL,3*60*1000))
+        const AtStep attach = { "+CGATT=1", NULL, NULL, 0, 3*60*1000 };
+        if (RESP_OK != _runStep("join", attach))
             goto failure;
 
         // Check the if the PSD profile is activated (a=1)
@@ -979,11 +1130,6 @@ MDM_IP MDMParser::join(const char* apn /*= NULL*/, const char* username /*= NULL
             if (!apn && !username && !password)
                 config = apnconfig(_dev.imsi);
 
-            // Set up the dynamic IP address assignment.
-            sendFormated("AT+UPSD=" PROFILE ",7,\"0.0.0.0\"\r\n");
-            if (RESP_OK != waitFinalResp())
-                goto failure;
-
             do {
                 if (config) {
                     apn      = _APN_GET(config);
@@ -991,35 +1137,33 @@ MDM_IP MDMParser::join(const char* apn /*= NULL*/, const char* username /*= NULL
                     password = _APN_GET(config);
                     DEBUG_D("Testing APN Settings(\"%s\",\"%s\",\"%s\")\r\n", apn, username, password);
                 }
-                // Set up the APN
-                if (apn && *apn) {
-                    sendFormated("AT+UPSD=" PROFILE ",1,\"%s\"\r\n", apn);
-                    if (RESP_OK != waitFinalResp())
-                        goto failure;
-                }
-                if (username && *username) {
-                    sendFormated("AT+UPSD=" PROFILE ",2,\"%s\"\r\n", username);
-                    if (RESP_OK != waitFinalResp())
-                        goto failure;
-                }
-                if (password && *password) {
-                    sendFormated("AT+UPSD=" PROFILE ",3,\"%s\"\r\n", password);
-                    if (RESP_OK != waitFinalResp())
-                        goto failure;
-                }
+                char apnCmd[128], usernameCmd[128], passwordCmd[128];
+                snprintf(apnCmd, sizeof(apnCmd), "+UPSD=" PROFILE ",1,\"%s\"", apn);
+                snprintf(usernameCmd, sizeof(usernameCmd), "+UPSD=" PROFILE ",2,\"%s\"", username);
+                snprintf(passwordCmd, sizeof(passwordCmd), "+UPSD=" PROFILE ",3,\"%s\"", password);
                 // try different Authentication Protocols
                 // 0 = none
                 // 1 = PAP (Password Authentication Protocol)
                 // 2 = CHAP (Challenge Handshake Authentication Protocol)
                 for (int i = AUTH_NONE; i <= AUTH_CHAP && !ok; i ++) {
                     if ((auth == AUTH_DETECT) || (auth == i)) {
-                        // Set up the Authentication Protocol
-                        sendFormated("AT+UPSD=" PROFILE ",6,%d\r\n", i);
-                        if (RESP_OK != waitFinalResp())
+                        char authCmd[16];
+                        snprintf(authCmd, sizeof(authCmd), "+UPSD=" PROFILE ",6,%d", i);
+                        const AtStep profile[] = {
+                            // Set up the dynamic IP address assignment.
+                            { "+UPSD=" PROFILE ",7,\"0.0.0.0\"",        NULL, NULL, STEP_CONCAT },
+                            // Set up the APN
+                            { (apn && *apn) ? apnCmd : NULL,            NULL, NULL, STEP_CONCAT },
+                            { (username && *username) ? usernameCmd : NULL, NULL, NULL, STEP_CONCAT },
+                            { (password && *password) ? passwordCmd : NULL, NULL, NULL, STEP_CONCAT },
+                            // Set up the Authentication Protocol
+                            { authCmd,                                  NULL, NULL, STEP_CONCAT },
+                        };
+                        if (!_runSteps("join", profile, sizeof(profile)/sizeof(*profile)))
                             goto failure;
                         // Activate the PSD profile and make connection
-                        sendFormated("AT+UPSDA=" PROFILE ",3\r\n");
-                        if (RESP_OK == waitFinalResp(NULL,NULL,150*1000)) {
+                        const AtStep activate = { "+UPSDA=" PROFILE ",3", NULL, NULL, 0, 150*1000 };
+                        if (RESP_OK == _runStep("join", activate)) {
                             _activated = true; // PDP activated
                             ok = true;
                         }
@@ -1285,6 +1429,8 @@ int MDMParser::_socketSocket(int socket, IpProtocol ipproto, int port)
         _sockets[socket].connected  = (ipproto == MDM_IPPROTO_UDP);
         _sockets[socket].pending    = 0;
         _sockets[socket].open       = true;
+        _sockets[socket].ipproto    = ipproto;
+        memset(&_sockets[socket].data, 0, sizeof(_sockets[socket].data));
     }
     else {
         rv = MDM_SOCKET_ERROR;
@@ -1442,25 +1588,75 @@ bool MDMParser::socketFree(int socket)
     return _socketFree(socket);
 }
 
+bool MDMParser::socketSetHexMode(bool hex)
+{
+    bool ok = false;
+    LOCK();
+    if (_init && _pwr) {
+        sendFormated("AT+UDCONF=1,%d\r\n", hex ? 1 : 0);
+        ok = (RESP_OK == waitFinalResp());
+    }
+    else {
+        ok = true; // applied by init()
+    }
+    if (ok) {
+        _hexMode = hex;
+        _lexer.setHex(hex);
+    }
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::_socketSendBlock(const char* cmd, const char* buf, int len)
+{
+    if (_hexMode) {
+        // the data is part of the command, so there is no prompt to wait for.
+        // Each piece is encoded while the serial port sends the one before.
+        static const char digits[] = "0123456789ABCDEF";
+        char hex[128];
+        sendFormated("%s,%d,\"", cmd, len);
+        while (len > 0) {
+            int n = 0;
+            for (; (n < (int)sizeof(hex)) && (len > 0); len--, buf++) {
+                hex[n++] = digits[(*buf >> 4) & 0xF];
+                hex[n++] = digits[*buf & 0xF];
+            }
+            send(hex, n);
+        }
+        send("\"\r\n", 3);
+    }
+    else {
+        system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+        sendFormated("%s,%d\r\n", cmd, len);
+        if (RESP_PROMPT != waitFinalResp())
+            return false;
+        // the modem needs a pause before the data, less the time spent
+        // waiting for the prompt
+        system_tick_t elapsed = HAL_Timer_Get_Milli_Seconds() - start;
+        if (elapsed < USO_PROMPT_GUARD)
+            HAL_Delay_Milliseconds(USO_PROMPT_GUARD - elapsed);
+        send(buf, len);
+    }
+    return (RESP_OK == waitFinalResp());
+}
+
 int MDMParser::socketSend(int socket, const char * buf, int len)
 {
     //DEBUG_D("socketSend(%d,,%d)\r\n", socket,len);
     int cnt = len;
     while (cnt > 0) {
-        int blk = USO_MAX_WRITE;
+        int blk = _hexMode ? USO_MAX_WRITE_HEX : USO_MAX_WRITE;
         if (cnt < blk)
             blk = cnt;
         bool ok = false;
         {
 			LOCK();
 			if (ISSOCKET(socket)) {
-				sendFormated("AT+USOWR=%d,%d\r\n",_sockets[socket].handle,blk);
-				if (RESP_PROMPT == waitFinalResp()) {
-					HAL_Delay_Milliseconds(50);
-					send(buf, blk);
-					if (RESP_OK == waitFinalResp())
-						ok = true;
-				}
+				char cmd[32];
+				sprintf(cmd, "AT+USOWR=%d", _sockets[socket].handle);
+				ok = _socketSendBlock(cmd, buf, blk);
+				if (ok)
+					_countData(socket, true, blk);
 			}
 			UNLOCK();
         }
@@ -1477,20 +1673,18 @@ int MDMParser::socketSendTo(int socket, MDM_IP ip, int port, const char * buf, i
     DEBUG_D("socketSendTo(%d," IPSTR ",%d,,%d)\r\n", socket,IPNUM(ip),port,len);
     int cnt = len;
     while (cnt > 0) {
-        int blk = USO_MAX_WRITE;
+        int blk = _hexMode ? USO_MAX_WRITE_HEX : USO_MAX_WRITE;
         if (cnt < blk)
             blk = cnt;
         bool ok = false;
         {
 			LOCK();
 			if (ISSOCKET(socket)) {
-				sendFormated("AT+USOST=%d,\"" IPSTR "\",%d,%d\r\n",_sockets[socket].handle,IPNUM(ip),port,blk);
-				if (RESP_PROMPT == waitFinalResp()) {
-					HAL_Delay_Milliseconds(50);
-					send(buf, blk);
-					if (RESP_OK == waitFinalResp())
-						ok = true;
-				}
+				char cmd[64];
+				sprintf(cmd, "AT+USOST=%d,\"" IPSTR "\",%d", _sockets[socket].handle, IPNUM(ip), port);
+				ok = _socketSendBlock(cmd, buf, blk);
+				if (ok)
+					_countData(socket, true, blk);
 			}
 			UNLOCK();
         }
@@ -1521,8 +1715,11 @@ int MDMParser::_cbUSORD(int type, const char* buf, int len, USORDparam* param)
 {
     if ((type == TYPE_PLUS) && param) {
         int sz, sk;
-        if ((sscanf(buf, "\r\n+USORD: %d,%d,", &sk, &sz) == 2) &&
-            (buf[len-sz-2] == '\"') && (buf[len-1] == '\"')) {
+        if (param->lexer->payloadLength() >= 0) {
+            // the payload was copied to param->buf as it arrived
+            param->len = param->lexer->payloadLength();
+        } else if ((sscanf(buf, "\r\n+USORD: %d,%d,", &sk, &sz) == 2) &&
+            (len >= sz + 2) && (buf[len-sz-2] == '\"') && (buf[len-1] == '\"')) {
             memcpy(param->buf, &buf[len-1-sz], sz);
             param->len = sz;
         } else {
@@ -1541,7 +1738,8 @@ int MDMParser::socketRecv(int socket, char* buf, int len)
 #endif
     system_tick_t start = HAL_Timer_Get_Milli_Seconds();
     while (len) {
-        int blk = MAX_SIZE; // still need space for headers and unsolicited  commands
+        // the payload is copied to buf as it arrives, so isn't limited by the line buffer
+        int blk = _hexMode ? USO_MAX_READ_HEX : USO_MAX_READ;
         if (len < blk) blk = len;
         bool ok = false;
         {
@@ -1553,9 +1751,16 @@ int MDMParser::socketRecv(int socket, char* buf, int len)
 						sendFormated("AT+USORD=%d,%d\r\n",_sockets[socket].handle, blk);
 						USORDparam param;
 						param.buf = buf;
-						if (RESP_OK == waitFinalResp(_cbUSORD, &param)) {
+						param.len = 0;
+						param.lexer = &_lexer;
+						_lexer.setPayload(buf, blk);
+						int ret = waitFinalResp(_cbUSORD, &param);
+						_lexer.setPayload(NULL, 0);
+						if (RESP_OK == ret) {
 							blk = param.len;
 							_sockets[socket].pending -= blk;
+							if (blk > 0)
+								_countData(socket, false, blk);
 							len -= blk;
 							cnt += blk;
 							buf += blk;
@@ -1592,7 +1797,12 @@ int MDMParser::_cbUSORF(int type, const char* buf, int len, USORFparam* param)
         int sz, sk, p, a,b,c,d;
         int r = sscanf(buf, "\r\n+USORF: %d,\"" IPSTR "\",%d,%d,",
             &sk,&a,&b,&c,&d,&p,&sz);
-        if ((r == 7) && (buf[len-sz-2] == '\"') && (buf[len-1] == '\"')) {
+        if ((r == 7) && (param->lexer->payloadLength() >= 0)) {
+            // the payload was copied to param->buf as it arrived
+            param->ip = IPADR(a,b,c,d);
+            param->port = p;
+            param->len = param->lexer->payloadLength();
+        } else if ((r == 7) && (len >= sz + 2) && (buf[len-sz-2] == '\"') && (buf[len-1] == '\"')) {
             memcpy(param->buf, &buf[len-1-sz], sz);
             param->ip = IPADR(a,b,c,d);
             param->port = p;
@@ -1613,7 +1823,7 @@ int MDMParser::socketRecvFrom(int socket, MDM_IP* ip, int* port, char* buf, int
 #endif
     system_tick_t start = HAL_Timer_Get_Milli_Seconds();
     while (len) {
-        int blk = MAX_SIZE; // still need space for headers and unsolicited commands
+        int blk = _hexMode ? USO_MAX_READ_HEX : USO_MAX_READ;
         if (len < blk) blk = len;
         bool ok = false;
         {
@@ -1623,11 +1833,18 @@ int MDMParser::socketRecvFrom(int socket, MDM_IP* ip, int* port, char* buf, int
 					sendFormated("AT+USORF=%d,%d\r\n",_sockets[socket].handle, blk);
 					USORFparam param;
 					param.buf = buf;
-					if (RESP_OK == waitFinalResp(_cbUSORF, &param)) {
+					param.len = 0;
+					param.lexer = &_lexer;
+					_lexer.setPayload(buf, blk);
+					int ret = waitFinalResp(_cbUSORF, &param);
+					_lexer.setPayload(NULL, 0);
+					if (RESP_OK == ret) {
 						*ip = param.ip;
 						*port = param.port;
 						blk = param.len;
 						_sockets[socket].pending -= blk;
+						if (blk > 0)
+							_countData(socket, false, blk);
 						len -= blk;
 						cnt += blk;
 						buf += blk;
@@ -1660,6 +1877,141 @@ int MDMParser::_findSocket(int handle) {
     return MDM_SOCKET_ERROR;
 }
 
+bool MDMParser::socketDataCount(int socket, CellularDataCount* count)
+{
+    bool ok = false;
+    LOCK();
+    if (ISSOCKET(socket)) {
+        *count = _sockets[socket].data;
+        ok = true;
+    }
+    UNLOCK();
+    return ok;
+}
+
+// ----------------------------------------------------------------
+
+static void countData(CellularDataCount& count, bool sent, int bytes)
+{
+    if (sent) {
+        count.tx_bytes += bytes;
+        count.tx_packets++;
+    } else {
+        count.rx_bytes += bytes;
+        count.rx_packets++;
+    }
+}
+
+void MDMParser::_countData(int socket, bool sent, int bytes)
+{
+    CellularDataCounters& usage = dataUsage.data;
+    bool tcp = (_sockets[socket].ipproto == MDM_IPPROTO_TCP);
+    countData(_sockets[socket].data, sent, bytes);
+    countData(tcp ? usage.tcp : usage.udp, sent, bytes);
+    // the modem's TCP stack doesn't say how it segments the stream, so each
+    // block is taken to be a segment, which suits small writes and reads
+    (sent ? usage.tx_headers : usage.rx_headers) += tcp ? TCP_HEADERS : UDP_HEADERS;
+}
+
+/** cloud traffic that is overhead in full, rather than carrying the
+    application's data */
+static bool isOverhead(int category)
+{
+    return category == CELLULAR_DATA_HANDSHAKE || category == CELLULAR_DATA_PING ||
+        category == CELLULAR_DATA_ACK || category == CELLULAR_DATA_RETRANSMIT;
+}
+
+void MDMParser::countCloudData(int category, bool sent, int bytes, int security)
+{
+    if (category < 0 || category >= CELLULAR_DATA_CATEGORIES || bytes <= 0)
+        return;
+    LOCK();
+    CellularDataCounters& usage = dataUsage.data;
+    countData(usage.cloud[category], sent, bytes);
+    if (!isOverhead(category))
+        (sent ? usage.tx_security : usage.rx_security) += security;
+    UNLOCK();
+}
+
+void MDMParser::getDataUsage(CellularDataUsage* usage)
+{
+    LOCK();
+    CellularDataCounters* counters = usage;
+    size_t size = usage->size < sizeof(dataUsage.data) ? usage->size : sizeof(dataUsage.data);
+    memcpy(counters, &dataUsage.data, size);
+    usage->size = size;
+    UNLOCK();
+}
+
+void MDMParser::resetDataUsage(void)
+{
+    LOCK();
+    dataUsage.clear();
+    UNLOCK();
+}
+
+static void appendf(char* buf, int len, int& written, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(written < len ? buf + written : NULL, written < len ? len - written : 0, format, args);
+    va_end(args);
+    if (n > 0)
+        written += n;
+}
+
+static void appendCount(char* buf, int len, int& written, const char* name, const CellularDataCount& count)
+{
+    appendf(buf, len, written, "\"%s\":[%u,%u,%u,%u]",
+            name, (unsigned)count.tx_bytes, (unsigned)count.rx_bytes,
+            (unsigned)count.tx_packets, (unsigned)count.rx_packets);
+}
+
+int MDMParser::formatDataUsage(const CellularDataUsage* usage, char* buf, int len)
+{
+    static const char* const categories[CELLULAR_DATA_CATEGORIES] = {
+        "handshake", "ping", "ack", "event", "ota", "retransmit", "other"
+    };
+    if (usage->size < sizeof(CellularDataUsage))
+        return 0;
+
+    // security framing is only counted on traffic that isn't overhead in full
+    uint32_t cloud = 0, overhead = 0;
+    for (int i = 0; i < CELLULAR_DATA_CATEGORIES; i++) {
+        uint32_t bytes = usage->cloud[i].tx_bytes + usage->cloud[i].rx_bytes;
+        cloud += bytes;
+        if (isOverhead(i))
+            overhead += bytes;
+    }
+    uint32_t headers = usage->tx_headers + usage->rx_headers;
+    uint32_t security = usage->tx_security + usage->rx_security;
+    overhead += headers + security;
+    uint32_t total = usage->tcp.tx_bytes + usage->tcp.rx_bytes +
+            usage->udp.tx_bytes + usage->udp.rx_bytes + headers;
+
+    int written = 0;
+    appendf(buf, len, written, "{");
+    appendCount(buf, len, written, "tcp", usage->tcp);
+    appendf(buf, len, written, ",");
+    appendCount(buf, len, written, "udp", usage->udp);
+    appendf(buf, len, written, ",\"cloud\":{");
+    for (int i = 0; i < CELLULAR_DATA_CATEGORIES; i++) {
+        if (i)
+            appendf(buf, len, written, ",");
+        appendCount(buf, len, written, categories[i], usage->cloud[i]);
+    }
+    appendf(buf, len, written, "},\"total\":%u,\"user\":%u,\"overhead\":{\"headers\":%u,\"security\":%u",
+            (unsigned)total, (unsigned)(total - headers - cloud), (unsigned)headers, (unsigned)security);
+    for (int i = 0; i < CELLULAR_DATA_CATEGORIES; i++) {
+        if (isOverhead(i))
+            appendf(buf, len, written, ",\"%s\":%u", categories[i],
+                    (unsigned)(usage->cloud[i].tx_bytes + usage->cloud[i].rx_bytes));
+    }
+    appendf(buf, len, written, ",\"total\":%u,\"percent\":%u}}",
+            (unsigned)overhead, total ? (unsigned)(uint64_t(overhead) * 100 / total) : 0);
+    return written;
+}
+
 // ----------------------------------------------------------------
 
 int MDMParser::_cbCMGL(int type, const char* buf, int len, CMGLparam* param)
@@ -1902,135 +2254,9 @@ void MDMParser::dumpIp(MDM_IP ip)
 }
 
 // ----------------------------------------------------------------
-int MDMParser::_parseMatch(Pipe<char>* pipe, int len, const char* sta, const char* end)
-{
-    int o = 0;
-    if (sta) {
-        while (*sta) {
-            if (++o > len)                  return WAIT;
-            char ch = pipe->next();
-            if (*sta++ != ch)               return NOT_FOUND;
-        }
-    }
-    if (!end)                               return o; // no termination
-    // at least any char
-    if (++o > len)                      return WAIT;
-    pipe->next();
-    // check the end
-    int x = 0;
-    while (end[x]) {
-        if (++o > len)                      return WAIT;
-        char ch = pipe->next();
-        x = (end[x] == ch) ? x + 1 :
-            (end[0] == ch) ? 1 :
-                            0;
-    }
-    return o;
-}
-
-int MDMParser::_parseFormated(Pipe<char>* pipe, int len, const char* fmt)
-{
-    int o = 0;
-    int num = 0;
-    if (fmt) {
-        while (*fmt) {
-            if (++o > len)                  return WAIT;
-            char ch = pipe->next();
-            if (*fmt == '%') {
-                fmt++;
-                if (*fmt == 'd') { // numeric
-                    fmt ++;
-                    num = 0;
-                    while (ch >= '0' && ch <= '9') {
-                        num = num * 10 + (ch - '0');
-                        if (++o > len)      return WAIT;
-                        ch = pipe->next();
-                    }
-                }
-                else if (*fmt == 'c') { // char buffer (takes last numeric as length)
-                    fmt ++;
-                    while (num --) {
-                        if (++o > len)      return WAIT;
-                        ch = pipe->next();
-                    }
-                }
-                else if (*fmt == 's') {
-                    fmt ++;
-                    if (ch != '\"')         return NOT_FOUND;
-                    do {
-                        if (++o > len)      return WAIT;
-                        ch = pipe->next();
-                    } while (ch != '\"');
-                    if (++o > len)          return WAIT;
-                    ch = pipe->next();
-                }
-            }
-            if (*fmt++ != ch)               return NOT_FOUND;
-        }
-    }
-    return o;
-}
-
 int MDMParser::_getLine(Pipe<char>* pipe, char* buf, int len)
 {
-    int unkn = 0;
-    int sz = pipe->size();
-    int fr = pipe->free();
-    if (len > sz)
-        len = sz;
-    while (len > 0)
-    {
-        static struct {
-              const char* fmt;                              int type;
-        } lutF[] = {
-            { "\r\n+USORD: %d,%d,\"%c\"",                   TYPE_PLUS       },
-            { "\r\n+USORF: %d,\"" IPSTR "\",%d,%d,\"%c\"",  TYPE_PLUS       },
-            { "\r\n+URDFILE: %s,%d,\"%c\"",                 TYPE_PLUS       },
-        };
-        static struct {
-              const char* sta;          const char* end;    int type;
-        } lut[] = {
-            { "\r\nOK\r\n",             NULL,               TYPE_OK         },
-            { "\r\nERROR\r\n",          NULL,               TYPE_ERROR      },
-            { "\r\n+CME ERROR:",        "\r\n",             TYPE_ERROR      },
-            { "\r\n+CMS ERROR:",        "\r\n",             TYPE_ERROR      },
-            { "\r\nRING\r\n",           NULL,               TYPE_RING       },
-            { "\r\nCONNECT\r\n",        NULL,               TYPE_CONNECT    },
-            { "\r\nNO CARRIER\r\n",     NULL,               TYPE_NOCARRIER  },
-            { "\r\nNO DIALTONE\r\n",    NULL,               TYPE_NODIALTONE },
-            { "\r\nBUSY\r\n",           NULL,               TYPE_BUSY       },
-            { "\r\nNO ANSWER\r\n",      NULL,               TYPE_NOANSWER   },
-            { "\r\n+",                  "\r\n",             TYPE_PLUS       },
-            { "\r\n@",                  NULL,               TYPE_PROMPT     }, // Sockets
-            { "\r\n>",                  NULL,               TYPE_PROMPT     }, // SMS
-            { "\n>",                    NULL,               TYPE_PROMPT     }, // File
-            { "\r\nABORTED\r\n",        NULL,               TYPE_ABORTED    }, // Current command aborted
-        };
-        for (int i = 0; i < (int)(sizeof(lutF)/sizeof(*lutF)); i ++) {
-            pipe->set(unkn);
-            int ln = _parseFormated(pipe, len, lutF[i].fmt);
-            if (ln == WAIT && fr)
-                return WAIT;
-            if ((ln != NOT_FOUND) && (unkn > 0))
-                return TYPE_UNKNOWN | pipe->get(buf, unkn);
-            if (ln > 0)
-                return lutF[i].type  | pipe->get(buf, ln);
-        }
-        for (int i = 0; i < (int)(sizeof(lut)/sizeof(*lut)); i ++) {
-            pipe->set(unkn);
-            int ln = _parseMatch(pipe, len, lut[i].sta, lut[i].end);
-            if (ln == WAIT && fr)
-                return WAIT;
-            if ((ln != NOT_FOUND) && (unkn > 0))
-                return TYPE_UNKNOWN | pipe->get(buf, unkn);
-            if (ln > 0)
-                return lut[i].type | pipe->get(buf, ln);
-        }
-        // UNKNOWN
-        unkn ++;
-        len--;
-    }
-    return WAIT;
+    return _lexer.getLine(pipe, buf, len);
 }
 
 // ----------------------------------------------------------------
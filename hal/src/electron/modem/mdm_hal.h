@@ -29,6 +29,8 @@
 #include "pinmap_hal.h"
 #include "system_tick_hal.h"
 #include "enums_hal.h"
+#include "mdmlexer_hal.h"
+#include "cellular_hal.h"
 
 /* Include for debug capabilty */
 #define MDM_DEBUG
@@ -118,6 +120,51 @@ public:
     */
     bool pdp(const char* apn = "spark.telefonica.com");
 
+    /** the time a command line of the bring-up took, see #getStepTimes
+    */
+    typedef struct {
+        const char* stage;      //!< "powerOn", "init", "register" or "join"
+        char cmd[16];           //!< the first command on the line, truncated
+        int count;              //!< the number of commands on the line
+        system_tick_t ms;       //!< from sending the line until its final response
+        int resp;               //!< the final response, RESP_OK if successful
+    } StepTime;
+
+    /** get the time taken by each command line of the bring-up, from the
+        last #powerOn until #join. Registration is a single step, however
+        many times it was polled.
+        \param count set to the number of steps
+        \return the steps in the order they ran
+    */
+    const StepTime* getStepTimes(int* count) const { *count = _stepCount; return _stepTimes; }
+
+    // ----------------------------------------------------------------
+    // Data Usage
+    // ----------------------------------------------------------------
+
+    /** get the data sent and received on all sockets since the last
+        #resetDataUsage. The counters are kept in retained memory.
+        \param usage filled in up to usage->size
+    */
+    void getDataUsage(CellularDataUsage* usage);
+
+    /** set the data usage counters to zero
+    */
+    void resetDataUsage(void);
+
+    /** attribute data on the cloud connection, which was already counted
+        by its socket, to a category
+        \param category a cellular_data_category_t
+        \param sent true for data sent, false for data received
+        \param bytes the size of the datagram or block
+        \param security the bytes of security framing within it
+    */
+    void countCloudData(int category, bool sent, int bytes, int security);
+
+    /** format data usage as a JSON report, see cellular_data_usage_format
+    */
+    static int formatDataUsage(const CellularDataUsage* usage, char* buf, int len);
+
     // ----------------------------------------------------------------
     // Data Connection (GPRS)
     // ----------------------------------------------------------------
@@ -207,6 +254,16 @@ public:
     */
     int socketSendTo(int socket, MDM_IP ip, int port, const char * buf, int len);
 
+    /** Select how socket data is written. In binary mode (the default) each
+        block is sent after the "@" prompt and a pause the modem requires.
+        In hex mode the data is encoded in the command itself, which saves the
+        prompt round trip and pause but doubles the bytes sent, so suits
+        short writes.
+        \param hex true for hex mode, false for binary mode
+        \return true if successful, false otherwise
+    */
+    bool socketSetHexMode(bool hex);
+
     /** Get the number of bytes pending for reading for this socket
         \param socket the socket handle
         \return the number of bytes pending or SOCKET_ERROR on failure
@@ -243,6 +300,13 @@ public:
     */
     bool socketFree(int socket);
 
+    /** Get the data counted on a socket since it was created
+        \param socket the socket handle
+        \param count set to the bytes and packets sent and received
+        \return true if successfully, false otherwise
+    */
+    bool socketDataCount(int socket, CellularDataCount* count);
+
     // ----------------------------------------------------------------
     // SMS Short Message Service
     // ----------------------------------------------------------------
@@ -421,26 +485,11 @@ protected:
         \param len the size of the parsed line
         \return type and length if something was found,
                 WAIT if not enough data is available
-                NOT_FOUND if nothing was found
     */
-    static int _getLine(Pipe<char>* pipe, char* buffer, int length);
+    int _getLine(Pipe<char>* pipe, char* buffer, int length);
 
-    /** Helper: Parse a match from the pipe
-        \param pipe the buffered pipe
-        \param number of bytes to parse at maximum,
-        \param sta the starting string, NULL if none
-        \param end the terminating string, NULL if none
-        \return size of parsed match
-    */
-    static int _parseMatch(Pipe<char>* pipe, int len, const char* sta, const char* end);
-
-    /** Helper: Parse a match from the pipe
-        \param pipe the buffered pipe
-        \param number of bytes to parse at maximum,
-        \param fmt the formating string (%d any number, %c any char of last %d len)
-        \return size of parsed match
-    */
-    static int _parseFormated(Pipe<char>* pipe, int len, const char* fmt);
+    //! splits the receiving buffer pipe into responses
+    MDMLexer _lexer;
 
 protected:
     // for rtos over riding by useing Rtos<MDMxx>
@@ -461,6 +510,7 @@ protected:
     static int _cbCOPS(int type, const char* buf, int len, NetStatus* status);
     static int _cbCNUM(int type, const char* buf, int len, char* num);
     static int _cbUACTIND(int type, const char* buf, int len, int* i);
+    static int _cbRegistered(int type, const char* buf, int len, NetStatus* status);
     static int _cbUDOPN(int type, const char* buf, int len, char* mccmnc);
     // sockets
     static int _cbCMIP(int type, const char* buf, int len, MDM_IP* ip);
@@ -469,9 +519,9 @@ protected:
     static int _cbUDNSRN(int type, const char* buf, int len, MDM_IP* ip);
     static int _cbUSOCR(int type, const char* buf, int len, int* handle);
     static int _cbUSOCTL(int type, const char* buf, int len, int* handle);
-    typedef struct { char* buf; int len; } USORDparam;
+    typedef struct { char* buf; int len; const MDMLexer* lexer; } USORDparam;
     static int _cbUSORD(int type, const char* buf, int len, USORDparam* param);
-    typedef struct { char* buf; MDM_IP ip; int port; int len; } USORFparam;
+    typedef struct { char* buf; MDM_IP ip; int port; int len; const MDMLexer* lexer; } USORFparam;
     static int _cbUSORF(int type, const char* buf, int len, USORFparam* param);
     typedef struct { char* buf; char* num; } CMGRparam;
     static int _cbCUSD(int type, const char* buf, int len, char* resp);
@@ -483,6 +533,15 @@ protected:
     typedef struct { const char* filename; char* buf; int sz; int len; } URDFILEparam;
     static int _cbUDELFILE(int type, const char* buf, int len, void*);
     static int _cbURDFILE(int type, const char* buf, int len, URDFILEparam* param);
+    // unsolicited result codes, given the text after the colon
+    typedef void (MDMParser::*_URCPTR)(const char* args);
+    void _urcCMTI(const char* args);
+    void _urcUUSORD(const char* args);
+    void _urcUUSOCL(const char* args);
+    void _urcUUPSDD(const char* args);
+    void _urcCREG(const char* args);
+    void _urcCGREG(const char* args);
+    void _urcRegistration(const char* args, Reg* reg);
     // variables
     DevStatus   _dev; //!< collected device information
     NetStatus   _net; //!< collected network information
@@ -494,6 +553,8 @@ protected:
         volatile bool connected;
         volatile int pending;
         volatile bool open;
+        IpProtocol ipproto;
+        CellularDataCount data;
     } SockCtrl;
     // LISA-C has 6 TCP and 6 UDP sockets
     // LISA-U and SARA-G have 7 sockets
@@ -503,13 +564,37 @@ protected:
     int _socketCloseUnusedHandles(void);
     int _socketSocket(int socket, IpProtocol ipproto, int port);
     bool _socketFree(int socket);
+    bool _socketSendBlock(const char* cmd, const char* buf, int len);
+    void _countData(int socket, bool sent, int bytes);
     bool _powerOn(void);
+    // bring-up sequences
+    enum {
+        STEP_CONCAT   = 1,  //!< may share a command line with neighbouring STEP_CONCAT steps
+        STEP_OPTIONAL = 2,  //!< a failure doesn't fail the sequence
+    };
+    /** a command of a bring-up sequence, skipped when cmd is NULL. Only
+        commands without an information response can be concatenated,
+        since the responses on a line can't be told apart.
+    */
+    typedef struct {
+        const char* cmd;            //!< the command without "AT", e.g. "+CMEE=2"
+        _CALLBACKPTR cb;            //!< the response callback, or NULL
+        void* param;                //!< the callback parameter
+        int flags;                  //!< STEP_xxx
+        system_tick_t timeout_ms;   //!< 0 for the default
+    } AtStep;
+    bool _runSteps(const char* stage, const AtStep* steps, int count);
+    int _runStep(const char* stage, const AtStep& step);
+    void _recordStep(const char* stage, const char* cmd, int count, system_tick_t start, int resp);
+    StepTime _stepTimes[24];
+    int _stepCount;
     static MDMParser* inst;
     bool _init;
     bool _pwr;
     bool _activated;
     bool _attached;
     volatile bool _cancel_all_operations;
+    bool _hexMode;                  //!< socket data is written in hex
 #ifdef MDM_DEBUG
     int _debugLevel;
     system_tick_t _debugTime;
@@ -547,6 +632,7 @@ public:
     {
         while (readable())
             getc();
+        _lexer.reset();
     }
 protected:
     /** Write bytes to the physical interface.
@@ -0,0 +1,307 @@
+/*
+ ******************************************************************************
+ *  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "mdmlexer_hal.h"
+#include <string.h>
+
+namespace {
+
+enum Kind {
+    EXACT,      //!< the head is the whole response
+    LINE,       //!< the head, at least one character, then "\r\n"
+    FORMAT,     //!< the head is a format with a payload, see MDMLexer::_matchFormat
+    PAYLOAD     //!< a format whose payload can be copied, see MDMLexer::setPayload
+};
+
+struct Response {
+    const char* head;   //!< following "\r\n"
+    Kind kind;
+    int type;
+};
+
+/* Responses with the same first character, in order of precedence. Responses
+   with a binary payload come before the line they also begin, since the
+   payload may contain "\r\n".
+*/
+const Response plusResponses[] = {
+    { "+USORD: %d,%d,\"%c\"",                       PAYLOAD, TYPE_PLUS      },
+    { "+USORF: %d,\"%d.%d.%d.%d\",%d,%d,\"%c\"",    PAYLOAD, TYPE_PLUS      },
+    { "+URDFILE: %s,%d,\"%c\"",                     FORMAT, TYPE_PLUS       },
+    { "+CME ERROR:",                                LINE,   TYPE_ERROR      },
+    { "+CMS ERROR:",                                LINE,   TYPE_ERROR      },
+    { "+",                                          LINE,   TYPE_PLUS       },
+};
+const Response noResponses[] = {
+    { "NO CARRIER\r\n",                             EXACT,  TYPE_NOCARRIER  },
+    { "NO DIALTONE\r\n",                            EXACT,  TYPE_NODIALTONE },
+    { "NO ANSWER\r\n",                              EXACT,  TYPE_NOANSWER   },
+};
+const Response okResponse =      { "OK\r\n",        EXACT,  TYPE_OK         };
+const Response errorResponse =   { "ERROR\r\n",     EXACT,  TYPE_ERROR      };
+const Response ringResponse =    { "RING\r\n",      EXACT,  TYPE_RING       };
+const Response connectResponse = { "CONNECT\r\n",   EXACT,  TYPE_CONNECT    };
+const Response busyResponse =    { "BUSY\r\n",      EXACT,  TYPE_BUSY       };
+const Response abortedResponse = { "ABORTED\r\n",   EXACT,  TYPE_ABORTED    }; // Current command aborted
+const Response socketPrompt =    { "@",             EXACT,  TYPE_PROMPT     };
+const Response smsPrompt =       { ">",             EXACT,  TYPE_PROMPT     };
+
+const struct {
+    char first;
+    const Response* responses;
+    int count;
+} heads[] = {
+    { '+', plusResponses,       sizeof(plusResponses)/sizeof(*plusResponses) },
+    { 'O', &okResponse,         1 },
+    { 'E', &errorResponse,      1 },
+    { 'N', noResponses,         sizeof(noResponses)/sizeof(*noResponses) },
+    { '@', &socketPrompt,       1 },
+    { 'R', &ringResponse,       1 },
+    { 'C', &connectResponse,    1 },
+    { 'B', &busyResponse,       1 },
+    { 'A', &abortedResponse,    1 },
+    { '>', &smsPrompt,          1 },
+};
+
+/** Match literal characters
+    \return the offset following them, NOT_FOUND or WAIT
+*/
+int matchHead(Pipe<char>* pipe, int offset, int length, const char* head)
+{
+    pipe->set(offset);
+    for (; *head; head++, offset++) {
+        if (offset >= length)
+            return WAIT;
+        if (pipe->next() != *head)
+            return NOT_FOUND;
+    }
+    return offset;
+}
+
+inline int hexValue(char c)
+{
+    return (c <= '9') ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+} // namespace
+
+int MDMLexer::getLine(Pipe<char>* pipe, char* buffer, int length)
+{
+    if (_headerLength)
+        return _getPayload(pipe, buffer, length);
+    int size = pipe->size();
+    // when the pipe is full, incomplete responses are skipped since they can't complete
+    bool full = !pipe->free();
+    if (length > size)
+        length = size;
+    if (_scanned > length)
+        _rescan();
+    for (int offset = _scanned; offset < length; offset++) {
+        if (offset != _scanned) {
+            _scanned = offset;
+            _end = 0;
+        }
+        int type = TYPE_UNKNOWN;
+        int payload = -1;
+        int found = _match(pipe, offset, length, full && !offset, &type, &payload);
+        if (found == NOT_FOUND)
+            continue;
+        if (found == WAIT && !full)
+            return WAIT;
+        _rescan();
+        if (offset > 0)
+            return TYPE_UNKNOWN | pipe->get(buffer, offset);
+        if (payload >= 0) {
+            _headerLength = pipe->get(_header, found);
+            _payloadLength = payload;
+            _copied = 0;
+            _type = type;
+            return _getPayload(pipe, buffer, length);
+        }
+        return type | pipe->get(buffer, found);
+    }
+    if (full)
+        _rescan();
+    else {
+        _scanned = length;
+        _end = 0;
+    }
+    return WAIT;
+}
+
+int MDMLexer::_match(Pipe<char>* pipe, int offset, int length, bool skipWait, int* type, int* payload)
+{
+    const int wait = skipWait ? NOT_FOUND : WAIT;
+    pipe->set(offset);
+    char c = pipe->next();
+    if (c == '\n') {    // "\n>" File
+        if (offset + 1 >= length)
+            return wait;
+        if (pipe->next() != '>')
+            return NOT_FOUND;
+        *type = TYPE_PROMPT;
+        return 2;
+    }
+    if (c != '\r')
+        return NOT_FOUND;
+    if (offset + 1 >= length)
+        return wait;
+    if (pipe->next() != '\n')
+        return NOT_FOUND;
+    if (offset + 2 >= length)
+        return wait;
+    c = pipe->next();
+
+    for (const auto& head : heads) {
+        if (head.first != c)
+            continue;
+        for (int i = 0; i < head.count; i++) {
+            const Response& response = head.responses[i];
+            int found;
+            if (response.kind == FORMAT || response.kind == PAYLOAD) {
+                bool socket = (response.kind == PAYLOAD);
+                found = _matchFormat(pipe, offset + 2, length, response.head,
+                        socket && _hex, (socket && _payload) ? payload : NULL);
+                if (found > 0)
+                    found += 2;
+            }
+            else {
+                found = matchHead(pipe, offset + 3, length, response.head + 1);
+                if (found > 0) {
+                    if (response.kind == EXACT)
+                        found -= offset;
+                    else if (found >= length)
+                        found = WAIT;
+                    else
+                        found = _matchLine(pipe, offset, found + 1, length, !skipWait);
+                }
+            }
+            if (found == NOT_FOUND || (found == WAIT && skipWait))
+                continue;
+            *type = response.type;
+            return found;
+        }
+        break;
+    }
+    return NOT_FOUND;
+}
+
+int MDMLexer::_matchLine(Pipe<char>* pipe, int offset, int from, int length, bool resume)
+{
+    int i = (resume && _end > from + 1) ? _end - 1 : from;
+    if (i + 1 < length) {
+        pipe->set(i);
+        char previous = pipe->next();
+        for (i++; i < length; i++) {
+            char c = pipe->next();
+            if (previous == '\r' && c == '\n')
+                return i + 1 - offset;
+            previous = c;
+        }
+    }
+    if (resume)
+        _end = length;
+    return WAIT;
+}
+
+int MDMLexer::_getPayload(Pipe<char>* pipe, char* buffer, int length)
+{
+    if (_hex) {
+        char pair[2];
+        while ((_copied < _payloadLength) && (pipe->size() >= 2)) {
+            pipe->get(pair, 2);
+            _payload[_copied++] = (hexValue(pair[0]) << 4) | hexValue(pair[1]);
+        }
+    }
+    else if (_copied < _payloadLength) {
+        _copied += pipe->get(_payload + _copied, _payloadLength - _copied);
+    }
+    if ((_copied < _payloadLength) || !pipe->readable())
+        return WAIT;
+    // the closing quote ends the response
+    pipe->set(0);
+    if (pipe->next() == '\"')
+        _header[_headerLength++] = pipe->getc();
+    int n = (_headerLength < length) ? _headerLength : length;
+    memcpy(buffer, _header, n);
+    _headerLength = 0;
+    _payload = NULL;
+    return _type | n;
+}
+
+int MDMLexer::_matchFormat(Pipe<char>* pipe, int offset, int length, const char* format, bool hex, int* payload)
+{
+    int i = offset;
+    int num = 0;
+    pipe->set(i);
+    while (*format) {
+        if (i >= length)
+            return WAIT;
+        char c = pipe->next();
+        i++;
+        if (*format == '%') {
+            format++;
+            if (*format == 'd') { // numeric
+                format++;
+                num = 0;
+                while (c >= '0' && c <= '9') {
+                    num = num * 10 + (c - '0');
+                    if (i >= length)
+                        return WAIT;
+                    c = pipe->next();
+                    i++;
+                }
+            }
+            else if (*format == 'c') { // the payload, its length is the last number
+                format++;
+                if (payload && (num <= _payloadSize) && (i - offset + 3 <= (int)sizeof(_header))) {
+                    // the header up to and including the opening quote
+                    *payload = num;
+                    return i - 1 - offset;
+                }
+                if (hex)
+                    num *= 2;
+                if (num > 0) {
+                    i += num;
+                    if (i > length)
+                        return WAIT;
+                    pipe->set(i - 1);
+                    c = pipe->next();
+                }
+            }
+            else if (*format == 's') { // quoted string
+                format++;
+                if (c != '\"')
+                    return NOT_FOUND;
+                do {
+                    if (i >= length)
+                        return WAIT;
+                    c = pipe->next();
+                    i++;
+                } while (c != '\"');
+                if (i >= length)
+                    return WAIT;
+                c = pipe->next();
+                i++;
+            }
+        }
+        if (*format++ != c)
+            return NOT_FOUND;
+    }
+    return i - offset;
+}
@@ -0,0 +1,136 @@
+/*
+ ******************************************************************************
+ *  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "pipe_hal.h"
+#include "enums_hal.h"
+
+/** Splits the data received from the modem into responses.
+
+    Responses start with "\r\n" followed by a head such as "OK", "+" or "@",
+    which are looked up by their first character. The data is scanned once:
+    bytes that can't start a response are skipped on later calls, and a response
+    that hasn't been received in full is resumed where the last call stopped.
+*/
+class MDMLexer
+{
+public:
+    MDMLexer(void)
+    {
+        reset();
+        setPayload(NULL, 0);
+        setHex(false);
+    }
+
+    /** Forget the progress through the pipe. This must be called when data
+        is taken from the pipe other than by #getLine.
+    */
+    void reset(void)
+    {
+        _rescan();
+        _headerLength = 0;
+    }
+
+    /** Copy the payload of the next +USORD or +USORF response to a buffer
+        as it arrives, rather than returning it with the response, which
+        then ends with an empty payload "". The payload may be larger than
+        the pipe.
+        \param buffer where to copy the payload, NULL to return it with the response
+        \param size the size of the buffer
+    */
+    void setPayload(char* buffer, int size)
+    {
+        _payload = buffer;
+        _payloadSize = size;
+        _copied = -1;
+        _headerLength = 0;  // abandon a payload that didn't arrive in time
+    }
+
+    /** The number of bytes copied by #setPayload, or -1 if no payload was
+        copied since.
+    */
+    int payloadLength(void) const
+    {
+        return _headerLength ? -1 : _copied;
+    }
+
+    /** Payloads are hex encoded, as after AT+UDCONF=1,1. Copied payloads
+        are decoded.
+    */
+    void setHex(bool hex)
+    {
+        _hex = hex;
+    }
+
+    /** Take the next response from the pipe. Data that comes before a
+        response is returned first as TYPE_UNKNOWN.
+        \param pipe the receiving buffer pipe
+        \param buffer the buffer to store the response
+        \param length the size of the buffer
+        \return type and length if something was found,
+                WAIT if not enough data is available
+    */
+    int getLine(Pipe<char>* pipe, char* buffer, int length);
+
+private:
+    /** Match a response starting at an offset in the pipe
+        \param skipWait try the next head rather than wait for one that is incomplete
+        \return the length of the response, NOT_FOUND, or WAIT if it is incomplete
+    */
+    int _match(Pipe<char>* pipe, int offset, int length, bool skipWait, int* type, int* payload);
+
+    /** Find the "\r\n" that ends a line, searching from `from`
+        \param resume continue from where the last search of this line stopped
+        \return the length of the line from `offset`, or WAIT
+    */
+    int _matchLine(Pipe<char>* pipe, int offset, int from, int length, bool resume);
+
+    /** Match a response with a payload, given by a format of literal
+        characters, %d for a number, %s for a quoted string and %c for
+        as many characters as the last number.
+        \param hex the payload is hex encoded, so twice the length
+        \param payload if not NULL, stop at the payload and set this to its length
+        \return the length of the response, NOT_FOUND, or WAIT
+    */
+    int _matchFormat(Pipe<char>* pipe, int offset, int length, const char* format, bool hex, int* payload);
+
+    /** Copy the payload of the response whose header was taken from the pipe
+        \return the type and length of the response once complete, or WAIT
+    */
+    int _getPayload(Pipe<char>* pipe, char* buffer, int length);
+
+    void _rescan(void)
+    {
+        _scanned = 0;
+        _end = 0;
+    }
+
+    int _scanned;   //!< offset before which no response starts
+    int _end;       //!< offset up to which the line at #_scanned has no "\r\n"
+    bool _hex;      //!< payloads are hex encoded
+
+    char* _payload;         //!< where to copy payloads, see #setPayload
+    int _payloadSize;
+    int _payloadLength;     //!< the length of the payload being copied
+    int _copied;            //!< the bytes of it copied so far
+    int _type;              //!< the type of the response being copied
+    char _header[64];       //!< the response up to the payload, and the closing quote
+    int _headerLength;      //!< non zero while a payload is copied
+};
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stddef.h>
 
+#include "spsc_ring.h"
 #include "service_debug.h"
 
 #ifdef putc
@@ -32,7 +33,9 @@
 
 /** Pipe: this class implements a buffered pipe that can be safely
     written and read between two context. I.e., Written from a task
-    and read from a interrupt.
+    and read from a interrupt. The indices are kept in a lock-free
+    SPSCRing, so the elements written are visible to the reader before
+    the write index that covers them.
 */
 template <class T>
 class Pipe
@@ -46,10 +49,9 @@ public:
     Pipe(int n, T* b = NULL)
     {
         _a = b ? NULL : n ? new T[n] : NULL;
-        _r = 0;
-        _w = 0;
-        _b = b ? b : _a;
-        _s = n;
+        _ring.init(b ? b : _a, n);
+        _o = 0;
+        _n = 0;
     }
     /** Destructor
         frees a allocated buffer.
@@ -65,16 +67,16 @@ public:
     */
     void dump(void)
     {
-        int o = _r;
         int MAX = size();
-        char temp1[MAX*3];
-        char temp2[4];
-        sprintf(temp1,"pipe: %d/%d ", size(), _s);
-        while (o != _w) {
-            T t = _b[o];
-            sprintf(temp2, "%0*X", sizeof(T)*2, t);
+        char temp1[MAX*3 + 32];
+        char temp2[sizeof(T)*2 + 1];
+        sprintf(temp1,"pipe: %d/%d ", MAX, (int)_ring.size());
+        const T* p;
+        int n = _ring.readable(p);
+        for (int i = 0; i < MAX; i++) {
+            T t = (i < n) ? p[i] : _ring.buffer()[i - n];
+            sprintf(temp2, "%0*X", (int)sizeof(T)*2, (unsigned)t);
             strcat(temp1, temp2);
-            o = _inc(o);
         }
         strcat(temp1,"\n");
         DEBUG_D(temp1);
@@ -88,7 +90,7 @@ public:
     */
     bool writeable(void)
     {
-        return free() > 0;
+        return !_ring.full();
     }
 
     /** Return the number of free elements in the buffer
@@ -96,10 +98,7 @@ public:
     */
     int free(void)
     {
-        int s = _r - _w;
-        if (s <= 0)
-            s += _s;
-        return s - 1;
+        return _ring.space();
     }
 
     /* Add a single element to the buffer. (blocking)
@@ -108,13 +107,8 @@ public:
     */
     T putc(T c)
     {
-        int i = _w;
-        int j = i;
-        i = _inc(i);
-        while (i == _r) // = !writeable()
+        while (!_ring.put(c)) // = !writeable()
             /* nothing / just wait */;
-        _b[j] = c;
-        _w = i;
         return c;
     }
 
@@ -129,28 +123,43 @@ public:
         int c = n;
         while (c)
         {
+            T* w;
             int f;
             for (;;) // wait for space
             {
-                f = free();
+                f = writeSpan(w);
                 if (f > 0) break;     // data avail
                 if (!t) return n - c; // no more space and not blocking
                 /* nothing / just wait */;
             }
             // check free space
             if (c < f) f = c;
-            int w = _w;
-            int m = _s - w;
-            // check wrap
-            if (f > m) f = m;
-            memcpy(&_b[w], p, f);
-            _w = _inc(w, f);
+            memcpy(w, p, f * sizeof(T));
+            produce(f);
             c -= f;
             p += f;
         }
         return n - c;
     }
 
+    /** get the free elements that can be written without wrapping, so that
+        they can be filled in place, e.g. by a DMA transfer.
+        \param p set to the first free element
+        \return the number of free elements at p, see #produce
+    */
+    int writeSpan(T*& p)
+    {
+        return _ring.writable(p);
+    }
+
+    /** make elements filled in place through #writeSpan readable.
+        \param n the number of elements filled
+    */
+    void produce(int n)
+    {
+        _ring.produce(n);
+    }
+
     // reading thread/context API
     // --------------------------------------------------------
 
@@ -159,7 +168,7 @@ public:
     */
     bool readable(void)
     {
-        return (_r != _w);
+        return !_ring.empty();
     }
 
     /** Get the number of values available in the buffer
@@ -167,10 +176,7 @@ public:
     */
     int size(void)
     {
-        int s = _w - _r;
-        if (s < 0)
-            s += _s;
-        return s;
+        return _ring.available();
     }
 
     /** get a single value from buffered pipe (this function will block if no values available)
@@ -178,11 +184,9 @@ public:
     */
     T getc(void)
     {
-        int r = _r;
-        while (r == _w) // = !readable()
+        T t;
+        while (!_ring.get(t)) // = !readable()
             /* nothing / just wait */;
-        T t = _b[r];
-        _r = _inc(r);
         return t;
     }
 
@@ -197,28 +201,43 @@ public:
         int c = n;
         while (c)
         {
+            const T* r;
             int f;
             for (;;) // wait for data
             {
-                f = size();
+                f = readSpan(r);
                 if (f)  break;        // free space
                 if (!t) return n - c; // no space and not blocking
                 /* nothing / just wait */;
             }
             // check available data
             if (c < f) f = c;
-            int r = _r;
-            int m = _s - r;
-            // check wrap
-            if (f > m) f = m;
-            memcpy(p, &_b[r], f);
-            _r = _inc(r, f);
+            memcpy(p, r, f * sizeof(T));
+            consume(f);
             c -= f;
             p += f;
         }
         return n - c;
     }
 
+    /** get the elements that can be read without wrapping, so that they
+        can be parsed or copied in place.
+        \param p set to the first element
+        \return the number of elements at p, see #consume
+    */
+    int readSpan(const T*& p)
+    {
+        return _ring.readable(p);
+    }
+
+    /** remove elements used in place through #readSpan.
+        \param n the number of elements used
+    */
+    void consume(int n)
+    {
+        _ring.consume(n);
+    }
+
     // the following functions are useful if you like to inspect
     // or parse the buffer in the reading thread/context
     // --------------------------------------------------------
@@ -230,9 +249,12 @@ public:
     */
     int set(int ix)
     {
+        const T* r;
+        _ring.readable(r);
         int sz = size();
         ix = (ix > sz) ? sz : ix;
-        _o = _inc(_r, ix);
+        _o = _inc(r - _ring.buffer(), ix);
+        _n = ix;
         return sz - ix;
     }
 
@@ -242,8 +264,9 @@ public:
     T next(void)
     {
         int o = _o;
-        T t = _b[o];
+        T t = _ring.buffer()[o];
         _o = _inc(o);
+        _n++;
         return t;
     }
 
@@ -251,7 +274,8 @@ public:
     */
     void done(void)
     {
-        _r = _o;
+        consume(_n);
+        _n = 0;
     }
 
 private:
@@ -263,15 +287,13 @@ private:
     inline int _inc(int i, int n = 1)
     {
         i += n;
-        if (i >= _s)
-            i -= _s;
+        if (i >= (int)_ring.size())
+            i -= _ring.size();
         return i;
     }
 
-    T*            _b; //!< buffer
+    SPSCRing<T>   _ring; //!< the buffer and the read and write indices, (size - 1) elements can be stored
     T*            _a; //!< allocated buffer
-    int           _s; //!< size of buffer (s - 1) elements can be stored
-    volatile int  _w; //!< write index
-    volatile int  _r; //!< read index
     int           _o; //!< offest index used by parsing functions
+    int           _n; //!< elements from the read index to the parsing index
 };
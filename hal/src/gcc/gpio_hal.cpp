@@ -1,5 +1,6 @@
 
 #include "gpio_hal.h"
+#include "interrupts_gcc.h"
 #include <string>
 #include <utility>
 #include <boost/signals2.hpp>
@@ -155,6 +156,10 @@ class GpioPinMap
 
     void assignPin(pin_t id, StdPin* pin) {
         pins[id] = pin;
+        // a change of level raises the interrupt attached to the pin
+        pin->notify.connect([id](StdPin& changed) {
+            gcc_interrupts_pin_changed(id, changed.getValue());
+        });
     }
 
 public:
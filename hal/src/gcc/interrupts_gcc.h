@@ -0,0 +1,41 @@
+/**
+ ******************************************************************************
+ * @file    interrupts_gcc.h
+ * @brief   Interrupts from the emulated GPIO pins
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef INTERRUPTS_GCC_H
+#define INTERRUPTS_GCC_H
+
+#include "pinmap_hal.h"
+
+/**
+ * Called by the GPIO emulation when a pin changes level. Calls the handler
+ * attached to the pin when the edge matches its mode.
+ */
+void gcc_interrupts_pin_changed(pin_t pin, uint8_t level);
+
+/**
+ * Drives an emulated pin through `count` level changes, as a signal generator
+ * would, to time the interrupt dispatch.
+ * @return the mean time in nanoseconds from setting the level to the handler returning.
+ */
+uint32_t gcc_interrupts_generate_edges(pin_t pin, unsigned count);
+
+#endif  /* INTERRUPTS_GCC_H */
@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ * @file    interrupts_hal.cpp
+ * @brief   Interrupts from the emulated GPIO pins
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "interrupts_hal.h"
+#include "interrupts_gcc.h"
+#include "gpio_hal.h"
+#include <chrono>
+
+struct InterruptPin
+{
+    HAL_InterruptHandler handler;
+    void* data;
+    InterruptMode mode;
+    uint8_t level;
+};
+
+static InterruptPin interrupt_pins[TOTAL_PINS];
+static bool interrupts_enabled = true;
+
+void HAL_Interrupts_Attach(uint16_t pin, HAL_InterruptHandler handler, void* data, InterruptMode mode, void* reserved)
+{
+    if (pin>=TOTAL_PINS)
+        return;
+    InterruptPin& p = interrupt_pins[pin];
+    p.handler = nullptr;
+    p.data = data;
+    p.mode = mode;
+    p.level = HAL_GPIO_Read(pin) ? 1 : 0;
+    p.handler = handler;
+}
+
+void HAL_Interrupts_Detach(uint16_t pin)
+{
+    if (pin<TOTAL_PINS)
+        interrupt_pins[pin].handler = nullptr;
+}
+
+void HAL_Interrupts_Enable_All(void)
+{
+    interrupts_enabled = true;
+}
+
+void HAL_Interrupts_Disable_All(void)
+{
+    interrupts_enabled = false;
+}
+
+void HAL_Interrupts_Trigger(uint16_t pin, void* reserved)
+{
+    if (pin>=TOTAL_PINS)
+        return;
+    const InterruptPin& p = interrupt_pins[pin];
+    if (p.handler && interrupts_enabled)
+        p.handler(p.data);
+}
+
+void gcc_interrupts_pin_changed(pin_t pin, uint8_t level)
+{
+    if (pin>=TOTAL_PINS)
+        return;
+    InterruptPin& p = interrupt_pins[pin];
+    level = level ? 1 : 0;
+    if (level==p.level)
+        return;
+    p.level = level;
+    if (p.mode==CHANGE || (p.mode==RISING && level) || (p.mode==FALLING && !level))
+        HAL_Interrupts_Trigger(pin, nullptr);
+}
+
+uint32_t gcc_interrupts_generate_edges(pin_t pin, unsigned count)
+{
+    using namespace std::chrono;
+    if (!count)
+        return 0;
+    auto start = high_resolution_clock::now();
+    for (unsigned i=0; i<count; i++)
+        HAL_GPIO_Write(pin, !interrupt_pins[pin].level);
+    auto elapsed = duration_cast<nanoseconds>(high_resolution_clock::now()-start).count();
+    return elapsed/count;
+}
+
+int HAL_disable_irq()
+{
+    return 0;
+}
+
+void HAL_enable_irq(int is)
+{
+}
@@ -52,6 +52,11 @@ int HAL_FLASH_Update(const uint8_t *pBuffer, uint32_t address, uint32_t length,
      return HAL_UPDATE_APPLIED;
 }
 
+int HAL_FLASH_ApplyPatch(uint32_t address, uint32_t length, void* reserved)
+{
+    return -1;
+}
+
 
 
 /**
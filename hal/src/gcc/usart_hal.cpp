@@ -1,9 +1,13 @@
 /* Includes ------------------------------------------------------------------*/
 #include "usart_hal.h"
 #include "socket_hal.h"
+#include "timer_hal.h"
+#include "delay_hal.h"
+#include "spsc_ring.h"
 
 struct Usart {
     virtual void init(Ring_Buffer *rx_buffer, Ring_Buffer *tx_buffer)=0;
+    virtual void setBuffers(uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size)=0;
     virtual void begin(uint32_t baud)=0;
     virtual void end()=0;
     virtual int32_t available()=0;
@@ -20,48 +24,26 @@ const sock_handle_t SOCKET_INVALID = sock_handle_t(-1);
 class SocketUsartBase : public Usart
 {
     private:
-        Ring_Buffer* rx;
-        Ring_Buffer* tx;
+        SPSCRing<uint8_t> rx;
+        SPSCRing<uint8_t> tx;
+        Ring_Buffer* default_rx;
+        Ring_Buffer* default_tx;
 
     protected:
         sock_handle_t socket;
 
 
-        SocketUsartBase() : socket(SOCKET_INVALID) {}
+        SocketUsartBase() : default_rx(nullptr), default_tx(nullptr), socket(SOCKET_INVALID) {}
 
         virtual bool initSocket()=0;
 
-        inline int32_t read_char(bool peek=false)
-        {
-            if (rx->tail==rx->head)
-                return -1;
-
-            int32_t c = rx->buffer[rx->tail];
-            if (!peek)
-                rx->tail = (rx->tail+1) % SERIAL_BUFFER_SIZE;
-            return c;
-        }
-
-        inline void write_char(unsigned char c)
-        {
-            unsigned i = (unsigned int)(tx->head + 1) % SERIAL_BUFFER_SIZE;
-            if (i != tx->tail)
-            {
-                tx->buffer[tx->head] = c;
-                tx->head = i;
-            }
-        }
-
         void fillFromSocketIfNeeded() {
-            int space;
-            if (rx->head>rx->tail) {    // head after tail, so can fill up to end of buffer
-                space = SERIAL_BUFFER_SIZE-rx->tail;
-            }
-            else {
-                space = rx->tail-rx->head;  // may be 0
-            }
-            if (socket!=SOCKET_INVALID && space>0) {
-                socket_receive(socket, rx->buffer+rx->head, space, 0);
+            uint8_t* space;
+            size_t length = rx.writable(space);
+            if (socket!=SOCKET_INVALID && length>0) {
+                sock_result_t received = socket_receive(socket, space, length, 0);
+                if (received>0)
+                    rx.produce(received);
             }
         }
 
@@ -69,8 +51,23 @@ class SocketUsartBase : public Usart
     public:
         virtual void init(Ring_Buffer *rx_buffer, Ring_Buffer *tx_buffer) override
         {
-            this->rx = rx_buffer;
-            this->tx = tx_buffer;
+            default_rx = rx_buffer;
+            default_tx = tx_buffer;
+            setBuffers(nullptr, 0, nullptr, 0);
+        }
+
+        virtual void setBuffers(uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size) override
+        {
+            if (!rx_buffer && default_rx) {
+                rx_buffer = default_rx->buffer;
+                rx_size = SERIAL_BUFFER_SIZE;
+            }
+            if (!tx_buffer && default_tx) {
+                tx_buffer = default_tx->buffer;
+                tx_size = SERIAL_BUFFER_SIZE;
+            }
+            rx.init(rx_buffer, rx_size);
+            tx.init(tx_buffer, tx_size);
         }
 
         virtual void end() override {
@@ -82,15 +79,17 @@ class SocketUsartBase : public Usart
 
         virtual int32_t available() override {
             fillFromSocketIfNeeded();
-            return (rx->head-rx->tail) % SERIAL_BUFFER_SIZE;
+            return rx.available();
         }
         virtual int32_t read() override {
             fillFromSocketIfNeeded();
-            return read_char();
+            uint8_t c;
+            return rx.get(c) ? c : -1;
         }
         virtual int32_t peek() override {
             fillFromSocketIfNeeded();
-            return read_char(true);
+            uint8_t c;
+            return rx.peek(c) ? c : -1;
         }
         virtual uint32_t write(uint8_t byte) override {
             if (!initSocket())
@@ -159,11 +158,11 @@ class SocketUsartServer : public SocketUsartBase {
 
 Usart& usartMap(unsigned index) {
 #if SPARK_TEST_DRIVER==1
-static SocketUsartServer usart1 = SocketUsartServer();
-static SocketUsartServer usart2 = SocketUsartServer();
+static SocketUsartServer usart1;
+static SocketUsartServer usart2;
 #else
-static SocketUsartClient usart1 = SocketUsartClient();
-static SocketUsartClient usart2 = SocketUsartClient();
+static SocketUsartClient usart1;
+static SocketUsartClient usart2;
 #endif
 
     switch (index) {
@@ -179,6 +178,11 @@ void HAL_USART_Init(HAL_USART_Serial serial, Ring_Buffer *rx_buffer, Ring_Buffer
     usartMap(serial).init(rx_buffer, tx_buffer);
 }
 
+void HAL_USART_Set_Buffers(HAL_USART_Serial serial, uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size)
+{
+    usartMap(serial).setBuffers(rx_buffer, rx_size, tx_buffer, tx_size);
+}
+
 void HAL_USART_Begin(HAL_USART_Serial serial, uint32_t baud)
 {
     //usartMap(serial).begin(baud);
@@ -187,6 +191,7 @@ void HAL_USART_Begin(HAL_USART_Serial serial, uint32_t baud)
 void HAL_USART_End(HAL_USART_Serial serial)
 {
     //usartMap(serial).end();
+    usartMap(serial).setBuffers(nullptr, 0, nullptr, 0);
 }
 
 uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
@@ -223,4 +228,13 @@ void HAL_USART_Half_Duplex(HAL_USART_Serial serial, bool Enable)
 {
 }
 
+int32_t HAL_USART_Wait_Available(HAL_USART_Serial serial, system_tick_t timeout)
+{
+    system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+    int32_t available;
+    while (!(available = HAL_USART_Available_Data(serial)) && HAL_Timer_Get_Milli_Seconds()-start<timeout)
+        HAL_Delay_Milliseconds(1);
+    return available;
+}
+
 
@@ -90,6 +90,42 @@ void USB_USART_Send_Data(uint8_t Data)
     std::cout.write((const char*)&Data, 1);
 }
 
+int32_t USB_USART_Send_Data_Bulk(const uint8_t* data, size_t length, system_tick_t timeout)
+{
+    std::cout.write((const char*)data, length);
+    return length;
+}
+
+int32_t USB_USART_Receive_Data_Bulk(uint8_t* data, size_t length)
+{
+    size_t count = 0;
+    if (last>=0 && length) {
+        data[count++] = last;
+        last = -1;
+    }
+    if (count<length && USB_USART_Available_Data()) {
+        ssize_t n = read(0, data+count, length-count);
+        if (n>0)
+            count += n;
+    }
+    return count;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Wait_Available.
+ * Description    : Wait for data on stdin.
+ * Input          : timeout in milliseconds.
+ * Return         : Length available, 0 if the timeout elapsed.
+ *******************************************************************************/
+int32_t USB_USART_Wait_Available(system_tick_t timeout)
+{
+    if (last>=0)
+        return 1;
+    struct pollfd stdin_poll = { .fd = STDIN_FILENO
+            , .events = POLLIN | POLLRDBAND | POLLRDNORM | POLLPRI };
+    return poll(&stdin_poll, 1, timeout)>0;
+}
+
 #ifdef USB_HID_ENABLE
 /*******************************************************************************
  * Function Name : USB_HID_Send_Report.
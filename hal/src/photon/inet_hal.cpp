@@ -24,17 +24,37 @@
  */
 
 #include "inet_hal.h"
+#include "timer_hal.h"
+#include "interrupts_hal.h"
+#include "dns_cache.h"
 #include "wiced_tcpip.h"
 
+struct DNSCacheLock
+{
+    int is;
+    DNSCacheLock() : is(HAL_disable_irq()) {}
+    ~DNSCacheLock() { HAL_enable_irq(is); }
+};
+
+static DNSCache<HAL_IPAddress, DNSCacheLock> dns_cache;
+
 int inet_gethostbyname(const char* hostname, uint16_t hostnameLen, HAL_IPAddress* out_ip_addr, network_interface_t nif, void* reserved)
 {
-    wiced_ip_address_t address;
-    address.version = WICED_IPV4;
-    wiced_result_t result = wiced_hostname_lookup (hostname, &address, 5000);
-    if (result == WICED_SUCCESS) {
-        out_ip_addr->ipv4 = GET_IPV4_ADDRESS(address);
-    }
-    return -result;
+    return dns_cache.resolve(hostname, *out_ip_addr, HAL_Timer_Get_Milli_Seconds(), [](const char* hostname, HAL_IPAddress& ip_addr) {
+        wiced_ip_address_t address;
+        address.version = WICED_IPV4;
+        wiced_result_t result = wiced_hostname_lookup (hostname, &address, 5000);
+        if (result == WICED_SUCCESS) {
+            ip_addr.ipv4 = GET_IPV4_ADDRESS(address);
+        }
+        return -int(result);
+    });
+}
+
+int inet_dns_cache_invalidate(const char* hostname, network_interface_t nif, void* reserved)
+{
+    dns_cache.invalidate(hostname);
+    return 0;
 }
 
 int inet_ping(const HAL_IPAddress* address, network_interface_t nif, uint8_t nTries, void* reserved) {
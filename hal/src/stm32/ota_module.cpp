@@ -47,6 +47,19 @@ const module_info_t* locate_module(const module_bounds_t* bounds) {
 }
 
 
+/**
+ * Verifies the CRC of the module at the given location. The CRCs of installed
+ * modules that haven't changed since they were last verified aren't computed
+ * again.
+ */
+static bool verify_crc32(const module_bounds_t* bounds, uint32_t length)
+{
+    if (bounds->store==MODULE_STORE_SCRATCHPAD)
+        return FLASH_VerifyCRC32(FLASH_INTERNAL, bounds->start_address, length);
+    return FLASH_VerifyCRC32Cached(FLASH_INTERNAL, bounds->start_address, length);
+}
+
+
 /**
  * Fetches and validates the module info found at a given location.
  * @param target        Receives the module into
@@ -73,7 +86,7 @@ bool fetch_module(hal_module_t* target, const module_bounds_t* bounds, bool user
             target->suffix = (module_info_suffix_t*)(module_end-sizeof(module_info_suffix_t));
             if (validate_module_dependencies(bounds, userDepsOptional))
                 target->validity_result |= MODULE_VALIDATION_DEPENDENCIES;
-            if ((target->validity_checked & MODULE_VALIDATION_INTEGRITY) && FLASH_VerifyCRC32(FLASH_INTERNAL, bounds->start_address, module_length(target->info)))
+            if ((target->validity_checked & MODULE_VALIDATION_INTEGRITY) && verify_crc32(bounds, module_length(target->info)))
                 target->validity_result |= MODULE_VALIDATION_INTEGRITY;
         }
         else
@@ -281,8 +281,9 @@ bool HAL_Core_Validate_User_Module(void)
         //CRC verification Enabled by default
         if (FLASH_isUserModuleInfoValid(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION, USER_FIRMWARE_IMAGE_LOCATION))
         {
-            //CRC check the user module and set to module_user_part_validated
-            valid = FLASH_VerifyCRC32(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION,
+            //CRC check the user module, unless it hasn't changed since it was last checked,
+            //and set to module_user_part_validated
+            valid = FLASH_VerifyCRC32Cached(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION,
                                          FLASH_ModuleLength(FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION))
                     && HAL_Verify_User_Dependencies();
         }
@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file    eeprom_hal.cpp
+ * @author  Satish Nair
+ * @version V1.0.0
+ * @date    18-Nov-2014
+ * @brief
+ ******************************************************************************
+  Copyright (c) 2013-2015 Particle Industries, Inc.  All rights reserved.
+
+  Copyright 2012 STMicroelectronics
+  http://www.st.com/software_license_agreement_liberty_v2
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "eeprom_hal.h"
+#include "eeprom_emulation.h"
+#include "hw_config.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PAGE_SIZE               ((uint32_t)0x4000)  /* Page size = 16KByte */
+/* EEPROM emulation start address in Flash (just after the DCT space) */
+#define EEPROM_START_ADDRESS    ((uint32_t)0x0800C000)
+
+/* Device voltage range supposed to be [2.7V to 3.6V] */
+#define VOLTAGE_RANGE           (uint8_t)VoltageRange_3
+
+/* Pages 0 and 1 base addresses */
+#define PAGE0_BASE_ADDRESS      ((uint32_t)(EEPROM_START_ADDRESS + 0x0000))
+#define PAGE0_ID                FLASH_Sector_3
+
+#define PAGE1_BASE_ADDRESS      ((uint32_t)(EEPROM_START_ADDRESS + PAGE_SIZE))
+#define PAGE1_ID                FLASH_Sector_4
+
+#define EEPROM_SIZE             2048
+
+/**
+ * Provides the internal flash pages to the EEPROM emulation.
+ * The flash must be unlocked around erase and write calls.
+ */
+class InternalFlashStore
+{
+public:
+
+    int eraseSector(unsigned address)
+    {
+        uint16_t sector = address==PAGE0_BASE_ADDRESS ? PAGE0_ID : PAGE1_ID;
+        return FLASH_EraseSector(sector, VOLTAGE_RANGE)!=FLASH_COMPLETE;
+    }
+
+    int write(unsigned address, const void* data, unsigned size)
+    {
+        const uint16_t* halfWords = (const uint16_t*)data;
+        for (unsigned i=0; i<size/2; i++)
+        {
+            if (FLASH_ProgramHalfWord(address+i*2, halfWords[i])!=FLASH_COMPLETE)
+                return -1;
+        }
+        return 0;
+    }
+
+    const uint8_t* dataAt(unsigned address)
+    {
+        return (const uint8_t*)address;
+    }
+};
+
+static EEPROMEmulation<InternalFlashStore, PAGE_SIZE, PAGE0_BASE_ADDRESS, PAGE1_BASE_ADDRESS, EEPROM_SIZE> eeprom;
+
+void HAL_EEPROM_Init(void)
+{
+    /* Unlock the Flash Program Erase controller so the pages can be
+     * repaired or formatted in case they are invalid */
+    FLASH_Unlock();
+    /* Calling this is here is critical on STM32F2 Devices Else Flash Operation Fails */
+    FLASH_ClearFlags();
+    eeprom.init();
+    FLASH_Lock();
+}
+
+size_t HAL_EEPROM_Length()
+{
+    return EEPROM_SIZE;
+}
+
+uint8_t HAL_EEPROM_Read(uint32_t address)
+{
+    return eeprom.read(address);
+}
+
+void HAL_EEPROM_Write(uint32_t address, uint8_t data)
+{
+    HAL_EEPROM_Put(address, &data, 1);
+}
+
+void HAL_EEPROM_Get(uint32_t address, void* data, size_t length)
+{
+    if (eeprom.read(address, data, length))
+        memset(data, 0xFF, length);
+}
+
+void HAL_EEPROM_Put(uint32_t address, const void* data, size_t length)
+{
+    FLASH_Unlock();
+    eeprom.write(address, data, length);
+    FLASH_Lock();
+}
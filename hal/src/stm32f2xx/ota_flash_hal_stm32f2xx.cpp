@@ -36,6 +36,7 @@
 #include "spark_protocol_functions.h"
 #include "hal_platform.h"
 #include "service_debug.h"
+#include "delta_patch.h"
 
 #define OTA_CHUNK_SIZE          512
 
@@ -200,6 +201,75 @@ hal_update_complete_t HAL_FLASH_End(void* reserved)
     return result;
 }
 
+/**
+ * Writes the module rebuilt from a patch to the OTA region, up to where the
+ * patch is stored.
+ */
+struct OTARegionSink
+{
+    uint32_t address;
+    uint32_t length;
+
+    int operator()(uint32_t offset, const uint8_t* data, size_t size)
+    {
+        if (offset+size>length)
+            return -1;
+        return FLASH_Update(data, address+offset, size);
+    }
+};
+
+/**
+ * The module installed at the given address, when there is one.
+ */
+static const module_bounds_t* installed_module(uint32_t address)
+{
+    for (unsigned i=0; i<module_bounds_length; i++) {
+        if (module_bounds[i]->start_address==address && module_bounds[i]->store==MODULE_STORE_MAIN)
+            return module_bounds[i];
+    }
+    return NULL;
+}
+
+int HAL_FLASH_ApplyPatch(uint32_t address, uint32_t length, void* reserved)
+{
+#if !HAL_OTA_MEMORY_MAPPED
+    return -1;      // the patch is read in place, so must be in internal flash
+#else
+    const uint32_t ota_address = module_ota.start_address;
+    if (length<DeltaPatch::HEADER_SIZE || address<ota_address)
+        return DeltaPatch::ERROR_HEADER;
+
+    DeltaPatch::Header header;
+    header.read((const uint8_t*)address);
+    if (!header.is_valid())
+        return DeltaPatch::ERROR_HEADER;
+
+    // the patch is only for the exact module it was made from
+    const module_bounds_t* bounds = installed_module(header.source_address);
+    uint32_t source_address = header.source_address;
+    uint32_t source_length = bounds ? FLASH_ModuleLength(FLASH_INTERNAL, source_address) : 0;
+    if (!bounds || FLASH_ModuleAddress(FLASH_INTERNAL, source_address)!=source_address
+        || source_length+4>bounds->maximum_size
+        || !header.matches((const uint8_t*)source_address, source_length+4)
+        || !FLASH_VerifyCRC32Cached(FLASH_INTERNAL, source_address, source_length))
+    {
+        WARN("delta update is not for the installed module");
+        return DeltaPatch::ERROR_SOURCE;
+    }
+
+    OTARegionSink sink = { ota_address, address-ota_address };
+    DeltaPatch::Applier<OTARegionSink> applier(sink, (const uint8_t*)source_address, source_length+4);
+    int result = applier.feed((const uint8_t*)address, length);
+    if (!result)
+        result = applier.finish();
+    if (!result && (FLASH_ModuleLength(FLASH_INTERNAL, ota_address)+4!=header.target_length
+        || !FLASH_VerifyCRC32(FLASH_INTERNAL, ota_address, header.target_length-4)))
+        result = DeltaPatch::ERROR_CORRUPT;
+    DEBUG("delta update applied %d, module length %d", result, header.target_length);
+    return result;
+#endif
+}
+
 void copy_dct(void* target, uint16_t offset, uint16_t length) {
     const void* data = dct_read_app_data(offset);
     memcpy(target, data, length);
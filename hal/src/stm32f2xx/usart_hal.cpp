@@ -1,6 +1,6 @@
 /**
  ******************************************************************************
- * @file    usart_hal.c
+ * @file    usart_hal.cpp
  * @author  Satish Nair, Brett Walach
  * @version V1.0.0
  * @date    17-Dec-2014
@@ -28,7 +28,13 @@
 #include "pinmap_impl.h"
 #include "gpio_hal.h"
 #include "stm32f2xx.h"
+#include "timer_hal.h"
+#include "spsc_ring.h"
 #include <string.h>
+#if PLATFORM_THREADING
+#include "FreeRTOS.h"
+#include "semphr.h"
+#endif
 
 /* Private typedef -----------------------------------------------------------*/
 typedef enum USART_Num_Def {
@@ -61,12 +67,21 @@ typedef struct STM32_USART_Info {
 
 	uint8_t usart_af_map;
 
-	// Buffer pointers. These need to be global for IRQ handler access
-	Ring_Buffer* usart_tx_buffer;
-	Ring_Buffer* usart_rx_buffer;
+	// Circular receive DMA, or NULL when the stream is used by another peripheral
+	DMA_Stream_TypeDef* usart_rx_dma_stream;
+	uint32_t usart_rx_dma_channel;
 
 	bool usart_enabled;
+	bool usart_rx_dma;
+	// the time to half fill the receive buffer, which bounds a wait with DMA
+	system_tick_t usart_rx_dma_wait;
 	bool usart_transmitting;
+
+#if PLATFORM_THREADING
+	// Given by the IRQ handler when data arrives while a thread is waiting
+	xSemaphoreHandle usart_rx_ready;
+	volatile bool usart_rx_waiting;
+#endif
 } STM32_USART_Info;
 
 /*
@@ -84,17 +99,21 @@ STM32_USART_Info USART_MAP[TOTAL_USARTS] =
 		 * TX pin source
 		 * RX pin source
 		 * GPIO AF map (GPIO_AF_USARTx/GPIO_AF_UARTx)
-		 * <tx_buffer pointer> used internally and does not appear below
-		 * <rx_buffer pointer> used internally and does not appear below
+		 * RX DMA stream (DMAx_Streamy, or NULL)
+		 * RX DMA channel (DMA_Channel_x)
 		 * <usart enabled> used internally and does not appear below
+		 * <rx dma> used internally and does not appear below
+		 * <rx dma wait> used internally and does not appear below
 		 * <usart transmitting> used internally and does not appear below
+		 * <rx ready semaphore> used internally and does not appear below
+		 * <rx waiting> used internally and does not appear below
 		 */
-		{ USART1, &RCC->APB2ENR, RCC_APB2Periph_USART1, USART1_IRQn, TX, RX, GPIO_PinSource9, GPIO_PinSource10, GPIO_AF_USART1 }, // USART 1
-		{ USART2, &RCC->APB1ENR, RCC_APB1Periph_USART2, USART2_IRQn, RGBG, RGBB, GPIO_PinSource2, GPIO_PinSource3, GPIO_AF_USART2 } // USART 2
+		{ USART1, &RCC->APB2ENR, RCC_APB2Periph_USART1, USART1_IRQn, TX, RX, GPIO_PinSource9, GPIO_PinSource10, GPIO_AF_USART1, NULL, 0 }, // USART 1 (DMA2 streams 2 and 5 are used by SPI)
+		{ USART2, &RCC->APB1ENR, RCC_APB1Periph_USART2, USART2_IRQn, RGBG, RGBB, GPIO_PinSource2, GPIO_PinSource3, GPIO_AF_USART2, DMA1_Stream5, DMA_Channel_4 } // USART 2
 #if PLATFORM_ID == 10 // Electron
-		,{ USART3, &RCC->APB1ENR, RCC_APB1Periph_USART3, USART3_IRQn, TXD_UC, RXD_UC, GPIO_PinSource10, GPIO_PinSource11, GPIO_AF_USART3 } // USART 3
-        ,{ UART4, &RCC->APB1ENR, RCC_APB1Periph_UART4, UART4_IRQn, C3, C2, GPIO_PinSource10, GPIO_PinSource11, GPIO_AF_UART4 } // UART 4
-        ,{ UART5, &RCC->APB1ENR, RCC_APB1Periph_UART5, UART5_IRQn, C1, C0, GPIO_PinSource12, GPIO_PinSource2, GPIO_AF_UART5 } // UART 5
+		,{ USART3, &RCC->APB1ENR, RCC_APB1Periph_USART3, USART3_IRQn, TXD_UC, RXD_UC, GPIO_PinSource10, GPIO_PinSource11, GPIO_AF_USART3, NULL, 0 } // USART 3
+        ,{ UART4, &RCC->APB1ENR, RCC_APB1Periph_UART4, UART4_IRQn, C3, C2, GPIO_PinSource10, GPIO_PinSource11, GPIO_AF_UART4, NULL, 0 } // UART 4 (DMA1 stream 2 is used by SPI3)
+        ,{ UART5, &RCC->APB1ENR, RCC_APB1Periph_UART5, UART5_IRQn, C1, C0, GPIO_PinSource12, GPIO_PinSource2, GPIO_AF_UART5, DMA1_Stream0, DMA_Channel_4 } // UART 5
 #endif
 };
 
@@ -105,15 +124,72 @@ static STM32_USART_Info *usartMap[TOTAL_USARTS]; // pointer to USART_MAP[] conta
 
 /* Private function prototypes -----------------------------------------------*/
 
-inline void store_char(unsigned char c, Ring_Buffer *buffer) __attribute__((always_inline));
-inline void store_char(unsigned char c, Ring_Buffer *buffer)
+/*
+ * The ring buffers are kept apart from USART_MAP so they are constant
+ * initialized, since HAL_USART_Init() is called from global constructors.
+ */
+struct USART_Buffers
+{
+	SPSCRing<uint8_t> rx;
+	SPSCRing<uint8_t> tx;
+	// the default storage given to HAL_USART_Init()
+	Ring_Buffer* default_rx;
+	Ring_Buffer* default_tx;
+};
+
+static USART_Buffers usartBuffers[TOTAL_USARTS];
+
+// Moves the receive head to where the DMA transfer has written up to.
+static inline void update_rx_dma(HAL_USART_Serial serial)
 {
-	unsigned i = (unsigned int)(buffer->head + 1) % SERIAL_BUFFER_SIZE;
+	if (usartMap[serial]->usart_rx_dma)
+	{
+		SPSCRing<uint8_t>& rx = usartBuffers[serial].rx;
+		rx.setHead(rx.size()-DMA_GetCurrDataCounter(usartMap[serial]->usart_rx_dma_stream));
+	}
+}
 
-	if (i != buffer->tail)
+static void start_rx_dma(HAL_USART_Serial serial, uint32_t baud)
+{
+	STM32_USART_Info* usart = usartMap[serial];
+	SPSCRing<uint8_t>& rx = usartBuffers[serial].rx;
+
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+	DMA_Cmd(usart->usart_rx_dma_stream, DISABLE);
+	DMA_DeInit(usart->usart_rx_dma_stream);
+
+	DMA_InitTypeDef DMA_InitStructure;
+	DMA_StructInit(&DMA_InitStructure);
+	DMA_InitStructure.DMA_Channel = usart->usart_rx_dma_channel;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&usart->usart_peripheral->DR;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)rx.buffer();
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_BufferSize = rx.size();
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_Init(usart->usart_rx_dma_stream, &DMA_InitStructure);
+
+	USART_DMACmd(usart->usart_peripheral, USART_DMAReq_Rx, ENABLE);
+	DMA_Cmd(usart->usart_rx_dma_stream, ENABLE);
+
+	// 10 bits per byte, rounded up
+	usart->usart_rx_dma_wait = (rx.size()/2)*10000/baud + 1;
+	usart->usart_rx_dma = true;
+}
+
+static void stop_rx_dma(HAL_USART_Serial serial)
+{
+	STM32_USART_Info* usart = usartMap[serial];
+	if (usart->usart_rx_dma)
 	{
-		buffer->buffer[buffer->head] = c;
-		buffer->head = i;
+		USART_DMACmd(usart->usart_peripheral, USART_DMAReq_Rx, DISABLE);
+		DMA_Cmd(usart->usart_rx_dma_stream, DISABLE);
+		usart->usart_rx_dma = false;
 	}
 }
 
@@ -142,14 +218,33 @@ void HAL_USART_Init(HAL_USART_Serial serial, Ring_Buffer *rx_buffer, Ring_Buffer
     }
 #endif
 
-	usartMap[serial]->usart_rx_buffer = rx_buffer;
-	usartMap[serial]->usart_tx_buffer = tx_buffer;
-
-	memset(usartMap[serial]->usart_rx_buffer, 0, sizeof(Ring_Buffer));
-	memset(usartMap[serial]->usart_tx_buffer, 0, sizeof(Ring_Buffer));
+	usartBuffers[serial].default_rx = rx_buffer;
+	usartBuffers[serial].default_tx = tx_buffer;
+	HAL_USART_Set_Buffers(serial, NULL, 0, NULL, 0);
 
 	usartMap[serial]->usart_enabled = false;
 	usartMap[serial]->usart_transmitting = false;
+	usartMap[serial]->usart_rx_dma = false;
+}
+
+void HAL_USART_Set_Buffers(HAL_USART_Serial serial, uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size)
+{
+	USART_Buffers& buffers = usartBuffers[serial];
+	if (!rx_buffer && buffers.default_rx)
+	{
+		rx_buffer = buffers.default_rx->buffer;
+		rx_size = SERIAL_BUFFER_SIZE;
+	}
+	if (!tx_buffer && buffers.default_tx)
+	{
+		tx_buffer = buffers.default_tx->buffer;
+		tx_size = SERIAL_BUFFER_SIZE;
+	}
+	// the most a DMA transfer can count
+	if (rx_size > 0xFFFF)
+		rx_size = 0xFFFF;
+	buffers.rx.init(rx_buffer, rx_size);
+	buffers.tx.init(tx_buffer, tx_size);
 }
 
 void HAL_USART_Begin(HAL_USART_Serial serial, uint32_t baud)
@@ -223,15 +318,29 @@ void HAL_USART_Begin(HAL_USART_Serial serial, uint32_t baud)
 	usartMap[serial]->usart_enabled = true;
 	usartMap[serial]->usart_transmitting = false;
 
-	// Enable USART Receive and Transmit interrupts
+	usartBuffers[serial].rx.init(usartBuffers[serial].rx.buffer(), usartBuffers[serial].rx.size());
+	usartBuffers[serial].tx.init(usartBuffers[serial].tx.buffer(), usartBuffers[serial].tx.size());
+
+	// Enable USART Receive and Transmit interrupts. With DMA, received data is
+	// written straight to the buffer and the interrupt is only for an idle line.
 	USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
-	USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_RXNE, ENABLE);
+	if (usartMap[serial]->usart_rx_dma_stream && usartBuffers[serial].rx.size())
+	{
+		start_rx_dma(serial, baud);
+		USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_IDLE, ENABLE);
+	}
+	else
+	{
+		USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_RXNE, ENABLE);
+	}
 }
 
 void HAL_USART_End(HAL_USART_Serial serial)
 {
     // wait for transmission of outgoing data
-    while (usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail);
+    while (!usartBuffers[serial].tx.empty());
+
+    stop_rx_dma(serial);
 
     // Disable the USART
     USART_Cmd(usartMap[serial]->usart_peripheral, DISABLE);
@@ -241,6 +350,7 @@ void HAL_USART_End(HAL_USART_Serial serial)
 
     // Disable USART Receive and Transmit interrupts
     USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_RXNE, DISABLE);
+    USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_IDLE, DISABLE);
     USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
 
     NVIC_InitTypeDef NVIC_InitStructure;
@@ -254,14 +364,11 @@ void HAL_USART_End(HAL_USART_Serial serial)
     // Disable USART Clock
     *usartMap[serial]->usart_apbReg &= ~usartMap[serial]->usart_clock_en;
 
-    // clear any received data
-    usartMap[serial]->usart_rx_buffer->head = usartMap[serial]->usart_rx_buffer->tail;
-
     // Undo any pin re-mapping done for this USART
     // ...
 
-    memset(usartMap[serial]->usart_rx_buffer, 0, sizeof(Ring_Buffer));
-    memset(usartMap[serial]->usart_tx_buffer, 0, sizeof(Ring_Buffer));
+    // clear any received data, and stop using the application's buffers
+    HAL_USART_Set_Buffers(serial, NULL, 0, NULL, 0);
 
     usartMap[serial]->usart_enabled = false;
     usartMap[serial]->usart_transmitting = false;
@@ -269,20 +376,20 @@ void HAL_USART_End(HAL_USART_Serial serial)
 
 uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
 {
+	SPSCRing<uint8_t>& tx = usartBuffers[serial].tx;
+
 	// interrupts are off and data in queue;
 	if ((USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_TXE) == RESET)
-			&& usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail) {
+			&& !tx.empty()) {
 		// Get him busy
 		USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
 	}
 
-	unsigned i = (usartMap[serial]->usart_tx_buffer->head + 1) % SERIAL_BUFFER_SIZE;
-
 	// If the output buffer is full, there's nothing for it other than to
 	// wait for the interrupt handler to empty it a bit
 	//         no space so       or  Called Off Panic with interrupt off get the message out!
 	//         make space                     Enter Polled IO mode
-	while (i == usartMap[serial]->usart_tx_buffer->tail || ((__get_PRIMASK() & 1) && usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail) ) {
+	while (tx.full() || ((__get_PRIMASK() & 1) && !tx.empty()) ) {
 		// Interrupts are on but they are not being serviced because this was called from a higher
 		// Priority interrupt
 
@@ -291,15 +398,17 @@ uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
 			// protect for good measure
 			USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
 			// Write out a byte
-			USART_SendData(usartMap[serial]->usart_peripheral,  usartMap[serial]->usart_tx_buffer->buffer[usartMap[serial]->usart_tx_buffer->tail++]);
-			usartMap[serial]->usart_tx_buffer->tail %= SERIAL_BUFFER_SIZE;
+			uint8_t c;
+			if (tx.get(c))
+				USART_SendData(usartMap[serial]->usart_peripheral, c);
 			// unprotect
 			USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
 		}
+		if (!tx.size())
+			return 0;
 	}
 
-	usartMap[serial]->usart_tx_buffer->buffer[usartMap[serial]->usart_tx_buffer->head] = data;
-	usartMap[serial]->usart_tx_buffer->head = i;
+	tx.put(data);
 	usartMap[serial]->usart_transmitting = true;
 	USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, ENABLE);
 
@@ -308,40 +417,29 @@ uint32_t HAL_USART_Write_Data(HAL_USART_Serial serial, uint8_t data)
 
 int32_t HAL_USART_Available_Data(HAL_USART_Serial serial)
 {
-	return (unsigned int)(SERIAL_BUFFER_SIZE + usartMap[serial]->usart_rx_buffer->head - usartMap[serial]->usart_rx_buffer->tail) % SERIAL_BUFFER_SIZE;
+	update_rx_dma(serial);
+	return usartBuffers[serial].rx.available();
 }
 
 int32_t HAL_USART_Read_Data(HAL_USART_Serial serial)
 {
+	uint8_t c;
+	update_rx_dma(serial);
 	// if the head isn't ahead of the tail, we don't have any characters
-	if (usartMap[serial]->usart_rx_buffer->head == usartMap[serial]->usart_rx_buffer->tail)
-	{
-		return -1;
-	}
-	else
-	{
-		unsigned char c = usartMap[serial]->usart_rx_buffer->buffer[usartMap[serial]->usart_rx_buffer->tail];
-		usartMap[serial]->usart_rx_buffer->tail = (unsigned int)(usartMap[serial]->usart_rx_buffer->tail + 1) % SERIAL_BUFFER_SIZE;
-		return c;
-	}
+	return usartBuffers[serial].rx.get(c) ? c : -1;
 }
 
 int32_t HAL_USART_Peek_Data(HAL_USART_Serial serial)
 {
-	if (usartMap[serial]->usart_rx_buffer->head == usartMap[serial]->usart_rx_buffer->tail)
-	{
-		return -1;
-	}
-	else
-	{
-		return usartMap[serial]->usart_rx_buffer->buffer[usartMap[serial]->usart_rx_buffer->tail];
-	}
+	uint8_t c;
+	update_rx_dma(serial);
+	return usartBuffers[serial].rx.peek(c) ? c : -1;
 }
 
 void HAL_USART_Flush_Data(HAL_USART_Serial serial)
 {
 	// Loop until USART DR register is empty
-	while ( usartMap[serial]->usart_tx_buffer->head != usartMap[serial]->usart_tx_buffer->tail );
+	while (!usartBuffers[serial].tx.empty());
 	// Loop until last frame transmission complete
 	while (usartMap[serial]->usart_transmitting && (USART_GetFlagStatus(usartMap[serial]->usart_peripheral, USART_FLAG_TC) == RESET));
 	usartMap[serial]->usart_transmitting = false;
@@ -357,34 +455,90 @@ void HAL_USART_Half_Duplex(HAL_USART_Serial serial, bool Enable)
 	USART_HalfDuplexCmd(usartMap[serial]->usart_peripheral, Enable ? ENABLE : DISABLE);
 }
 
+int32_t HAL_USART_Wait_Available(HAL_USART_Serial serial, system_tick_t timeout)
+{
+	STM32_USART_Info* usart = usartMap[serial];
+	system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+	int32_t available;
+	while (!(available = HAL_USART_Available_Data(serial)))
+	{
+		system_tick_t elapsed = HAL_Timer_Get_Milli_Seconds()-start;
+		if (elapsed>=timeout)
+			break;
+#if PLATFORM_THREADING
+		if (!usart->usart_rx_ready)
+		{
+			usart->usart_rx_ready = xSemaphoreCreateCounting(1, 0);
+			if (!usart->usart_rx_ready)
+				continue;
+		}
+		// the flag is set before checking again so a byte received in between isn't missed
+		usart->usart_rx_waiting = true;
+		if (!HAL_USART_Available_Data(serial))
+		{
+			system_tick_t wait = timeout-elapsed;
+			// without an idle line a continuous stream is only seen by polling the DMA counter
+			if (usart->usart_rx_dma && wait > usart->usart_rx_dma_wait)
+				wait = usart->usart_rx_dma_wait;
+			xSemaphoreTake(usart->usart_rx_ready, wait);
+		}
+		usart->usart_rx_waiting = false;
+#endif
+	}
+	return available;
+}
+
 // Shared Interrupt Handler for USART2/Serial1 and USART1/Serial2
 // WARNING: This function MUST remain reentrance compliant -- no local static variables etc.
 static void HAL_USART_Handler(HAL_USART_Serial serial)
 {
-	if(USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_RXNE) != RESET)
+	bool received = false;
+	if(usartMap[serial]->usart_rx_dma)
+	{
+		if(USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_IDLE) != RESET)
+		{
+			// The line went idle after receiving. Reading SR then DR clears the flag.
+			(void)USART_ReceiveData(usartMap[serial]->usart_peripheral);
+			received = true;
+		}
+	}
+	else if(USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_RXNE) != RESET)
 	{
 		// Read byte from the receive data register
 		unsigned char c = USART_ReceiveData(usartMap[serial]->usart_peripheral);
-		store_char(c, usartMap[serial]->usart_rx_buffer);
+		usartBuffers[serial].rx.put(c);
+		received = true;
+	}
+	if (received)
+	{
+#if PLATFORM_THREADING
+		if (usartMap[serial]->usart_rx_waiting)
+		{
+			portBASE_TYPE woken = pdFALSE;
+			usartMap[serial]->usart_rx_waiting = false;
+			xSemaphoreGiveFromISR(usartMap[serial]->usart_rx_ready, &woken);
+			portEND_SWITCHING_ISR(woken);
+		}
+#endif
 	}
 
 	if(USART_GetITStatus(usartMap[serial]->usart_peripheral, USART_IT_TXE) != RESET)
 	{
 		// Write byte to the transmit data register
-		if (usartMap[serial]->usart_tx_buffer->head == usartMap[serial]->usart_tx_buffer->tail)
+		uint8_t c;
+		if (usartBuffers[serial].tx.get(c))
 		{
-			// Buffer empty, so disable the USART Transmit interrupt
-			USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
+			// There is more data in the output buffer. Send the next byte
+			USART_SendData(usartMap[serial]->usart_peripheral, c);
 		}
 		else
 		{
-			// There is more data in the output buffer. Send the next byte
-			USART_SendData(usartMap[serial]->usart_peripheral, usartMap[serial]->usart_tx_buffer->buffer[usartMap[serial]->usart_tx_buffer->tail++]);
-			usartMap[serial]->usart_tx_buffer->tail %= SERIAL_BUFFER_SIZE;
+			// Buffer empty, so disable the USART Transmit interrupt
+			USART_ITConfig(usartMap[serial]->usart_peripheral, USART_IT_TXE, DISABLE);
 		}
 	}
 
-    	if (USART_GetFlagStatus(usartMap[serial]->usart_peripheral, USART_FLAG_ORE) != RESET)
+    	if (!usartMap[serial]->usart_rx_dma && USART_GetFlagStatus(usartMap[serial]->usart_peripheral, USART_FLAG_ORE) != RESET)
     	{
     		// If Overrun flag is still set, clear it
         	(void)USART_ReceiveData(usartMap[serial]->usart_peripheral);
@@ -400,7 +554,7 @@ static void HAL_USART_Handler(HAL_USART_Serial serial)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART1_Handler(void)
+extern "C" void HAL_USART1_Handler(void)
 {
 	HAL_USART_Handler(HAL_USART_SERIAL1);
 }
@@ -413,7 +567,7 @@ void HAL_USART1_Handler(void)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART2_Handler(void)
+extern "C" void HAL_USART2_Handler(void)
 {
 	HAL_USART_Handler(HAL_USART_SERIAL2);
 }
@@ -428,7 +582,7 @@ void HAL_USART2_Handler(void)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART3_Handler(void)
+extern "C" void HAL_USART3_Handler(void)
 {
 	HAL_USART_Handler(HAL_USART_SERIAL3);
 }
@@ -442,7 +596,7 @@ void HAL_USART3_Handler(void)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART4_Handler(void)
+extern "C" void HAL_USART4_Handler(void)
 {
     HAL_USART_Handler(HAL_USART_SERIAL4);
 }
@@ -455,7 +609,7 @@ void HAL_USART4_Handler(void)
  * Output         : None.
  * Return         : None.
  *******************************************************************************/
-void HAL_USART5_Handler(void)
+extern "C" void HAL_USART5_Handler(void)
 {
     HAL_USART_Handler(HAL_USART_SERIAL5);
 }
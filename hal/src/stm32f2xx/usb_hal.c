@@ -33,6 +33,12 @@
 #include "usb_conf.h"
 #include "usbd_desc.h"
 #include "delay_hal.h"
+#include "timer_hal.h"
+#include <string.h>
+#if PLATFORM_THREADING
+#include "FreeRTOS.h"
+#include "semphr.h"
+#endif
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -56,10 +62,20 @@ extern volatile uint8_t USB_DEVICE_CONFIGURED;
 extern volatile uint8_t USB_Rx_Buffer[];
 extern volatile uint8_t APP_Rx_Buffer[];
 extern volatile uint32_t APP_Rx_ptr_in;
+extern volatile uint32_t APP_Rx_ptr_out;
 extern volatile uint16_t USB_Rx_length;
 extern volatile uint16_t USB_Rx_ptr;
 extern volatile uint8_t  USB_Tx_State;
 extern volatile uint8_t  USB_Rx_State;
+
+// Set when the host stopped taking data, so later writes don't wait
+static bool USB_Tx_Stalled;
+
+#if PLATFORM_THREADING
+// Given when data arrives from the host while a thread is waiting
+static xSemaphoreHandle USB_Rx_Ready;
+static volatile bool USB_Rx_Waiting;
+#endif
 #endif
 
 #if defined (USB_CDC_ENABLE) || defined (USB_HID_ENABLE)
@@ -204,6 +220,147 @@ void USB_USART_Send_Data(uint8_t Data)
     //Delay 100us to avoid losing the data
     HAL_Delay_Microseconds(100);
 }
+
+/*
+ * The space free in the transmit buffer. One byte is kept free so a full
+ * buffer isn't seen as empty, and the packet being sent is still read from
+ * the buffer by the USB core.
+ */
+static uint32_t USB_USART_Tx_Free(void)
+{
+    uint32_t out = APP_Rx_ptr_out;
+    uint32_t in = APP_Rx_ptr_in;
+    if (out == APP_RX_DATA_SIZE)
+        out = 0;
+    uint32_t used = (in >= out) ? in - out : in + APP_RX_DATA_SIZE - out;
+    uint32_t reserved = 1 + (USB_Tx_State ? CDC_DATA_IN_PACKET_SIZE : 0);
+    return (used + reserved < APP_RX_DATA_SIZE) ? APP_RX_DATA_SIZE - used - reserved : 0;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Send_Data_Bulk.
+ * Description    : Copy a block of data to the buffer sent to the USB Host,
+ *                  waiting up to timeout milliseconds for the host to make room.
+ * Input          : data, length and timeout.
+ * Return         : Length written.
+ *******************************************************************************/
+int32_t USB_USART_Send_Data_Bulk(const uint8_t* data, size_t length, system_tick_t timeout)
+{
+    system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+    size_t written = 0;
+    while (written < length)
+    {
+        uint32_t n = USB_USART_Tx_Free();
+        if (!n)
+        {
+            // once the host has stopped reading, don't wait on every write
+            if (USB_DEVICE_CONFIGURED != 1 || USB_Tx_Stalled || HAL_Timer_Get_Milli_Seconds()-start >= timeout)
+            {
+                if (timeout)
+                    USB_Tx_Stalled = true;
+                break;
+            }
+            HAL_Delay_Milliseconds(1);
+            continue;
+        }
+        USB_Tx_Stalled = false;
+        if (n > length - written)
+            n = length - written;
+
+        // at most two copies, either side of the end of the buffer
+        uint32_t in = APP_Rx_ptr_in;
+        uint32_t first = APP_RX_DATA_SIZE - in;
+        if (first > n)
+            first = n;
+        memcpy((uint8_t*)APP_Rx_Buffer + in, data + written, first);
+        memcpy((uint8_t*)APP_Rx_Buffer, data + written + first, n - first);
+        in += n;
+        if (in >= APP_RX_DATA_SIZE)
+            in -= APP_RX_DATA_SIZE;
+        // the data must be in the buffer before the USB interrupt sees it
+        __DMB();
+        APP_Rx_ptr_in = in;
+        written += n;
+    }
+    return written;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Receive_Data_Bulk.
+ * Description    : Copy the data received from the USB Host.
+ * Input          : data and length.
+ * Return         : Length read.
+ *******************************************************************************/
+int32_t USB_USART_Receive_Data_Bulk(uint8_t* data, size_t length)
+{
+    if (USB_Rx_State != 1)
+        return 0;
+
+    uint32_t n = USB_Rx_length - USB_Rx_ptr;
+    if (n > length)
+        n = length;
+    memcpy(data, (const uint8_t*)USB_Rx_Buffer + USB_Rx_ptr, n);
+    USB_Rx_ptr += n;
+    if (USB_Rx_ptr == USB_Rx_length)
+    {
+        USB_Rx_State = 0;
+
+        /* Prepare Out endpoint to receive next packet */
+        DCD_EP_PrepareRx(&USB_OTG_dev,
+                         CDC_OUT_EP,
+                         (uint8_t*)(USB_Rx_Buffer),
+                         CDC_DATA_OUT_PACKET_SIZE);
+    }
+    return n;
+}
+
+#if PLATFORM_THREADING
+/*
+ * Called from the USB interrupt when a packet has been received.
+ */
+static void USB_USART_Data_Received(void)
+{
+    if (USB_Rx_Waiting)
+    {
+        portBASE_TYPE woken = pdFALSE;
+        USB_Rx_Waiting = false;
+        xSemaphoreGiveFromISR(USB_Rx_Ready, &woken);
+        portEND_SWITCHING_ISR(woken);
+    }
+}
+#endif
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Wait_Available.
+ * Description    : Wait for data from the USB Host, blocking the calling thread.
+ * Input          : timeout in milliseconds.
+ * Return         : Length available, 0 if the timeout elapsed.
+ *******************************************************************************/
+int32_t USB_USART_Wait_Available(system_tick_t timeout)
+{
+    system_tick_t start = HAL_Timer_Get_Milli_Seconds();
+    int32_t available;
+    while (!(available = USB_USART_Available_Data()))
+    {
+        system_tick_t elapsed = HAL_Timer_Get_Milli_Seconds()-start;
+        if (elapsed>=timeout)
+            break;
+#if PLATFORM_THREADING
+        if (!USB_Rx_Ready)
+        {
+            USB_Rx_Ready = xSemaphoreCreateCounting(1, 0);
+            if (!USB_Rx_Ready)
+                continue;
+            SetDataRxHandler(USB_USART_Data_Received);
+        }
+        USB_Rx_Waiting = true;
+        if (!USB_USART_Available_Data())
+            xSemaphoreTake(USB_Rx_Ready, timeout-elapsed);
+        USB_Rx_Waiting = false;
+#endif
+    }
+    return available;
+}
 #endif
 
 #ifdef USB_HID_ENABLE
@@ -44,3 +44,11 @@ size_t HAL_EEPROM_Length()
 {
     return 0;
 }
+
+void HAL_EEPROM_Get(uint32_t address, void* data, size_t length)
+{
+}
+
+void HAL_EEPROM_Put(uint32_t address, const void* data, size_t length)
+{
+}
@@ -33,6 +33,11 @@ int inet_gethostbyname(const char* hostname, uint16_t hostnameLen, HAL_IPAddress
     return 1;
 }
 
+int inet_dns_cache_invalidate(const char* hostname, network_interface_t nif, void* reserved)
+{
+    return 0;
+}
+
 int inet_ping(const HAL_IPAddress* address, network_interface_t nif, uint8_t nTries,
         void* reserved)
 {
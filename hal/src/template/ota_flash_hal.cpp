@@ -63,6 +63,11 @@ hal_update_complete_t HAL_FLASH_End(void* reserved)
     return HAL_UPDATE_ERROR;
 }
 
+int HAL_FLASH_ApplyPatch(uint32_t address, uint32_t length, void* reserved)
+{
+    return -1;
+}
+
 void HAL_FLASH_Read_ServerAddress(ServerAddress* server_addr)
 {
 }
@@ -68,4 +68,13 @@ bool HAL_USART_Is_Enabled(HAL_USART_Serial serial)
 
 void HAL_USART_Half_Duplex(HAL_USART_Serial serial, bool Enable)
 {
-}
\ No newline at end of file
+}
+
+int32_t HAL_USART_Wait_Available(HAL_USART_Serial serial, system_tick_t timeout)
+{
+    return 0;
+}
+
+void HAL_USART_Set_Buffers(HAL_USART_Serial serial, uint8_t* rx_buffer, size_t rx_size, uint8_t* tx_buffer, size_t tx_size)
+{
+}
@@ -72,6 +72,27 @@ void USB_USART_Send_Data(uint8_t Data)
 {
 
 }
+
+int32_t USB_USART_Send_Data_Bulk(const uint8_t* data, size_t length, system_tick_t timeout)
+{
+  return 0;
+}
+
+int32_t USB_USART_Receive_Data_Bulk(uint8_t* data, size_t length)
+{
+  return 0;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Wait_Available.
+ * Description    : Wait for data from the USB Host.
+ * Input          : timeout in milliseconds.
+ * Return         : Length available, 0 if the timeout elapsed.
+ *******************************************************************************/
+int32_t USB_USART_Wait_Available(system_tick_t timeout)
+{
+  return 0;
+}
 #endif
 
 #ifdef USB_HID_ENABLE
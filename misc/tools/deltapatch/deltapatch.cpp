@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/**
+ * Makes a delta patch between two builds of a module, in the format of
+ * services/inc/delta_patch.h, to be sent as an OTA update with the delta flag.
+ *
+ * Build:
+ *   g++ -std=gnu++11 -O2 -I../../../services/inc deltapatch.cpp -o deltapatch
+ *
+ * Usage:
+ *   deltapatch installed.bin new.bin patch.bin
+ *
+ * Both modules are the .bin files from the build, with the CRC at the end.
+ * The installed module must be the exact build on the device; the device
+ * refuses a patch made from anything else. The patch is checked by applying
+ * it before it is written.
+ */
+
+#include "delta_patch.h"
+#include "delta_patch_diff.h"
+#include <stdio.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool read_file(const char* name, Bytes& data)
+{
+    FILE* f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f))>0)
+        data.insert(data.end(), buf, buf+n);
+    fclose(f);
+    return true;
+}
+
+/**
+ * Where the module is linked to run, from its module info. The info follows
+ * the vector table when the module starts with one.
+ */
+static uint32_t module_start_address(const Bytes& module)
+{
+    size_t info = 0;
+    if (module.size()>=4 && (DeltaPatch::read_le32(module.data()) & 0x2FF10000)==0x20000000)
+        info = 0x184;
+    return module.size()>=info+4 ? DeltaPatch::read_le32(module.data()+info) : 0;
+}
+
+struct Compare
+{
+    const Bytes& expected;
+    bool same = true;
+
+    Compare(const Bytes& expected_) : expected(expected_) {}
+
+    int operator()(uint32_t offset, const uint8_t* data, size_t length)
+    {
+        same = same && offset+length<=expected.size() && !memcmp(expected.data()+offset, data, length);
+        return 0;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc<4) {
+        fprintf(stderr, "usage: %s <installed module> <new module> <patch>\n", argv[0]);
+        return 2;
+    }
+
+    Bytes source, target;
+    if (!read_file(argv[1], source) || !read_file(argv[2], target))
+        return 1;
+    if (source.size()<4 || target.size()<4) {
+        fprintf(stderr, "The modules should end with their CRC.\n");
+        return 1;
+    }
+
+    Bytes patch = DeltaPatch::diff(source.data(), source.size(), target.data(), target.size(),
+        module_start_address(source));
+
+    Compare compare(target);
+    DeltaPatch::Applier<Compare> applier(compare, source.data(), source.size());
+    if (applier.feed(patch.data(), patch.size()) || applier.finish() || !compare.same) {
+        fprintf(stderr, "The patch doesn't rebuild the new module.\n");
+        return 1;
+    }
+
+    FILE* f = fopen(argv[3], "wb");
+    if (!f || fwrite(patch.data(), 1, patch.size(), f)!=patch.size()) {
+        perror(argv[3]);
+        return 1;
+    }
+    fclose(f);
+    fprintf(stderr, "%u byte patch for a %u byte module (%u%%)\n", (unsigned)patch.size(),
+        (unsigned)target.size(), (unsigned)(patch.size()*100/target.size()));
+    return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/**
+ * Sends a firmware binary to a device over USB serial using the fast transfer
+ * protocol in services/inc/fast_flash.h.
+ *
+ * Build:
+ *   g++ -std=gnu++11 -O2 -I../../../services/inc fastflash.cpp -o fastflash
+ *
+ * Usage:
+ *   fastflash /dev/ttyACM0 firmware.bin [block_size] [window]
+ *
+ * The port is first opened at START_YMODEM_FLASHER_SERIAL_SPEED (28800) to put
+ * the device into serial update mode, the same as for Ymodem. On systems where
+ * that rate can't be set through termios (e.g. Linux), run
+ * `stty -F /dev/ttyACM0 28800` first.
+ */
+
+#include "fast_flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <vector>
+
+static const speed_t FLASHER_SPEED = 28800;
+
+struct SerialChannel
+{
+    int fd;
+
+    int read()
+    {
+        uint8_t c;
+        return ::read(fd, &c, 1)==1 ? c : -1;
+    }
+
+    size_t write(const uint8_t* data, size_t length)
+    {
+        size_t written = 0;
+        while (written<length) {
+            ssize_t n = ::write(fd, data+written, length-written);
+            if (n<0)
+                break;
+            written += n;
+        }
+        return written;
+    }
+
+    uint32_t millis()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec*1000 + ts.tv_nsec/1000000;
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t length)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        while (length--) {
+            crc ^= *data++;
+            for (int i=0; i<8; i++)
+                crc = (crc>>1) ^ (0xEDB88320 & -(crc&1));
+        }
+        return ~crc;
+    }
+};
+
+static int open_port(const char* port)
+{
+    int fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd<0)
+        return fd;
+
+    struct termios tio;
+    if (!tcgetattr(fd, &tio)) {
+        cfmakeraw(&tio);
+        if (cfsetspeed(&tio, FLASHER_SPEED))
+            fprintf(stderr, "Couldn't set %u baud, assuming the device is already in serial update mode.\n", (unsigned)FLASHER_SPEED);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc<3) {
+        fprintf(stderr, "usage: %s <port> <file> [block_size] [window]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(argv[2], "rb");
+    if (!f) {
+        perror(argv[2]);
+        return 1;
+    }
+    std::vector<uint8_t> file;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f))>0)
+        file.insert(file.end(), buf, buf+n);
+    fclose(f);
+
+    SerialChannel channel;
+    channel.fd = open_port(argv[1]);
+    if (channel.fd<0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    uint16_t block_size = argc>3 ? atoi(argv[3]) : FAST_FLASH_BLOCK_SIZE;
+    uint8_t window = argc>4 ? atoi(argv[4]) : FAST_FLASH_WINDOW;
+    const char* name = strrchr(argv[2], '/') ? strrchr(argv[2], '/')+1 : argv[2];
+
+    using Sender = FastFlash::Sender<SerialChannel, 4096>;
+    Sender sender(channel, file.data(), file.size(), name, block_size, window);
+
+    uint32_t start = channel.millis();
+    uint32_t reported = 0;
+    Sender::State state;
+    while ((state = sender.poll())<Sender::COMPLETE) {
+        uint32_t done = sender.acknowledged()*sender.negotiated_block_size();
+        if (state==Sender::SENDING && done-reported>=64*1024) {
+            reported = done;
+            fprintf(stderr, "\r%u/%u bytes", (unsigned)done, (unsigned)file.size());
+        }
+        usleep(200);
+    }
+
+    int result = sender.send_file();
+    uint32_t elapsed = channel.millis()-start;
+    if (result) {
+        fprintf(stderr, "\nTransfer failed (%d). The device may only support Ymodem.\n", result);
+        return 1;
+    }
+    fprintf(stderr, "\r%u bytes sent in %u ms (%u bytes/s)\n", (unsigned)file.size(), (unsigned)elapsed,
+            elapsed ? (unsigned)(file.size()*1000/elapsed) : 0);
+
+    // echo the device's status messages
+    uint32_t wait = channel.millis();
+    while (channel.millis()-wait<2000) {
+        int c = channel.read();
+        if (c>=0)
+            fputc(c, stdout);
+        else
+            usleep(1000);
+    }
+    close(channel.fd);
+    return 0;
+}
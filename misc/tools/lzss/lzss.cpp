@@ -0,0 +1,101 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/**
+ * Compresses a module for a compressed OTA update, in the format of
+ * services/inc/lzss.h. `make lz` runs this on the module's .bin file.
+ *
+ * Build:
+ *   g++ -std=gnu++11 -O2 -I../../../services/inc lzss.cpp -o lzss
+ *
+ * Usage:
+ *   lzss module.bin module.lz [window_bits]
+ *
+ * The window defaults to the 2 KB the device expands with. The compressed
+ * file is checked by expanding it before it is written.
+ */
+
+#include "lzss.h"
+#include "lzss_compress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Compare
+{
+    const Bytes& expected;
+    bool same = true;
+
+    Compare(const Bytes& expected_) : expected(expected_) {}
+
+    int operator()(uint32_t offset, const uint8_t* data, size_t length)
+    {
+        same = same && offset+length<=expected.size() && !memcmp(expected.data()+offset, data, length);
+        return 0;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc<3) {
+        fprintf(stderr, "usage: %s <module> <compressed module> [window_bits]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    Bytes module;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f))>0)
+        module.insert(module.end(), buf, buf+n);
+    fclose(f);
+
+    unsigned window_bits = argc>3 ? atoi(argv[3]) : LZSS_WINDOW_BITS;
+    if (window_bits<LZSS::MIN_WINDOW_BITS || window_bits>LZSS::MAX_WINDOW_BITS) {
+        fprintf(stderr, "The window is from %u to %u bits.\n", LZSS::MIN_WINDOW_BITS, LZSS::MAX_WINDOW_BITS);
+        return 2;
+    }
+    if (window_bits>LZSS_WINDOW_BITS)
+        fprintf(stderr, "Devices expand with a %u bit window, so won't accept this.\n", LZSS_WINDOW_BITS);
+
+    Bytes compressed = LZSS::compress(module.data(), module.size(), window_bits);
+
+    Compare compare(module);
+    LZSS::Expander<Compare, LZSS::MAX_WINDOW_BITS> expander(compare);
+    if (expander.feed(compressed.data(), compressed.size()) || expander.finish() || !compare.same) {
+        fprintf(stderr, "The compressed module doesn't expand to the original.\n");
+        return 1;
+    }
+
+    f = fopen(argv[2], "wb");
+    if (!f || fwrite(compressed.data(), 1, compressed.size(), f)!=compressed.size()) {
+        perror(argv[2]);
+        return 1;
+    }
+    fclose(f);
+    fprintf(stderr, "%u bytes compressed to %u (%u%%)\n", (unsigned)module.size(),
+        (unsigned)compressed.size(), module.size() ? (unsigned)(compressed.size()*100/module.size()) : 0);
+    return 0;
+}
@@ -24,6 +24,11 @@ extern "C" {
 #endif
 
 const void* dct_read_app_data (uint32_t offset);
+/**
+ * Reads data that spans several DCT fields, such as a DFU upload.
+ * dct_read_app_data() is only valid to the end of the field at the offset.
+ */
+const void* dct_read_app_data_range(uint32_t offset, uint32_t length);
 int dct_write_app_data(const void* data, uint32_t offset, uint32_t size);
 void dcd_migrate_data();
 
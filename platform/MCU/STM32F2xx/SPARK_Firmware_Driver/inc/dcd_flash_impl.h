@@ -20,6 +20,7 @@
 #include "dcd_flash.h"
 #include "dcd.h"
 #include "flash_mal.h"
+#include "dct.h"
 #include "string.h"
 
 /**
@@ -71,19 +72,24 @@ public:
     }
 };
 
-template <typename Store, unsigned sectorSize, unsigned DCD1, unsigned DCD2>
-class UpdateDCD : public DCD<Store, sectorSize, DCD1, DCD2>
+template <typename Store, unsigned sectorSize, unsigned DCD1, unsigned DCD2, unsigned journalOffset=0>
+class UpdateDCD : public DCD<Store, sectorSize, DCD1, DCD2, journalOffset>
 {
 public:
     static const unsigned oldFormatOffset = 7548;
 
-    using base = DCD<Store, sectorSize, DCD1, DCD2>;
+    using base = DCD<Store, sectorSize, DCD1, DCD2, journalOffset>;
     using Sector = typename base::Sector;
+    using Range = typename base::Range;
 
     UpdateDCD()
     {
     }
 
+    UpdateDCD(const Range* unjournaled, unsigned count) : base(unjournaled, count)
+    {
+    }
+
     void migrate()
     {
         if (!this->isInitialized()) {
@@ -110,11 +116,82 @@ public:
     }
 };
 
-UpdateDCD<InternalFlashStore, 16*1024, 0x8004000, 0x8008000> dcd;
+using InternalDCD = UpdateDCD<InternalFlashStore, 16*1024, 0x8004000, 0x8008000, 12*1024>;
+
+/**
+ * The bootloader reads and writes the system flags and the module slots.
+ * Bootloaders from before the journal don't see journaled writes, and copy
+ * the whole sector, journal included, when they write, so these are never
+ * journaled.
+ */
+static const InternalDCD::Range bootloader_fields[] = {
+    { DCT_SYSTEM_FLAGS_OFFSET, DCT_SYSTEM_FLAGS_SIZE },
+    { DCT_FLASH_MODULES_OFFSET, DCT_FLASH_MODULES_SIZE },
+};
+
+/**
+ * The last 4K of each sector is used as the write journal, so that small
+ * writes, such as keys and the claim code, don't erase and copy the sector
+ * each time. The migrated data and the application DCT fit within the first 12K.
+ */
+InternalDCD dcd(bootloader_fields, sizeof(bootloader_fields)/sizeof(bootloader_fields[0]));
+
+/**
+ * Where each field of the application DCT starts, in order.
+ */
+static const uint16_t dct_fields[] = {
+    offsetof(application_dct_t, system_flags),
+    offsetof(application_dct_t, version),
+    offsetof(application_dct_t, device_private_key),
+    offsetof(application_dct_t, device_public_key),
+    offsetof(application_dct_t, ip_config),
+    offsetof(application_dct_t, claim_code),
+    offsetof(application_dct_t, claimed),
+    offsetof(application_dct_t, ssid_prefix),
+    offsetof(application_dct_t, device_id),
+    offsetof(application_dct_t, version_string),
+    offsetof(application_dct_t, dns_resolve),
+    offsetof(application_dct_t, reserved1),
+    offsetof(application_dct_t, server_public_key),
+    DCT_SERVER_ADDRESS_OFFSET,
+    offsetof(application_dct_t, padding),
+    offsetof(application_dct_t, flash_modules),
+    offsetof(application_dct_t, product_store),
+    offsetof(application_dct_t, antenna_selection),
+    offsetof(application_dct_t, cloud_transport),
+    offsetof(application_dct_t, alt_device_public_key),
+    offsetof(application_dct_t, alt_device_private_key),
+    offsetof(application_dct_t, alt_server_public_key),
+    offsetof(application_dct_t, alt_server_address),
+    offsetof(application_dct_t, validated_modules),
+    offsetof(application_dct_t, reserved2),
+    offsetof(application_dct_t, end),
+};
+
+/**
+ * The number of bytes from offset to the end of the DCT field containing it.
+ */
+static uint32_t dct_field_length(uint32_t offset)
+{
+    for (unsigned i=0; i<sizeof(dct_fields)/sizeof(dct_fields[0]); i++)
+    {
+        if (dct_fields[i]>offset)
+            return dct_fields[i]-offset;
+    }
+    return offset<dcd.Length ? dcd.Length-offset : 0;
+}
 
+/**
+ * Pointer reads only compact the journal when it has a write to the field read.
+ */
 const void* dct_read_app_data (uint32_t offset)
 {
-    return dcd.read(offset);
+    return dcd.read(offset, dct_field_length(offset));
+}
+
+const void* dct_read_app_data_range(uint32_t offset, uint32_t length)
+{
+    return dcd.read(offset, length);
 }
 
 int dct_write_app_data(const void* data, uint32_t offset, uint32_t size)
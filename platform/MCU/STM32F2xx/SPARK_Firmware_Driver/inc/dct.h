@@ -26,6 +26,7 @@ extern "C" {
 #include "platform_system_flags.h"
 #include "platform_flash_modules.h"
 #include "static_assert.h"
+#include "validated_modules.h"
 #include "stddef.h"     // for offsetof in C
 
 #define MAX_MODULES_SLOT    5 //Max modules
@@ -48,6 +49,8 @@ STATIC_ASSERT(static_ip_config_size, sizeof(static_ip_config_t)==24);
 
 #define DCT_SERVER_ADDRESS_SIZE  (128)
 
+#define MAX_VALIDATED_MODULES   8
+
 /**
  * Custom extensions to the DCT data.
  */
@@ -75,8 +78,9 @@ typedef struct __attribute__((packed)) application_dct {
     uint8_t alt_device_private_key[192];	// alternative device private key
     uint8_t alt_server_public_key[192];
     uint8_t alt_server_address[DCT_SERVER_ADDRESS_SIZE];		// server address info
+    validated_module_t validated_modules[MAX_VALIDATED_MODULES];   // modules whose CRC need not be checked again
 
-    uint8_t reserved2[640];
+    uint8_t reserved2[512];
     // safe to add more data here or use up some of the reserved space to keep the end where it is
     uint8_t end[0];
 } application_dct_t;
@@ -101,6 +105,7 @@ typedef struct __attribute__((packed)) application_dct {
 #define DCT_ALT_DEVICE_PRIVATE_KEY_OFFSET (offsetof(application_dct_t, alt_device_private_key))
 #define DCT_ALT_SERVER_PUBLIC_KEY_OFFSET (offsetof(application_dct_t, alt_server_public_key))
 #define DCT_ALT_SERVER_ADDRESS_OFFSET (offsetof(application_dct_t, alt_server_address))
+#define DCT_VALIDATED_MODULES_OFFSET (offsetof(application_dct_t, validated_modules))
 
 #define DCT_SYSTEM_FLAGS_SIZE  (sizeof(application_dct_t::system_flags))
 #define DCT_DEVICE_PRIVATE_KEY_SIZE  (sizeof(application_dct_t::device_private_key))
@@ -120,6 +125,7 @@ typedef struct __attribute__((packed)) application_dct {
 #define DCT_ALT_DEVICE_PRIVATE_KEY_SIZE  (sizeof(application_dct_t::alt_device_private_key))
 #define DCT_ALT_SERVER_PUBLIC_KEY_SIZE  (sizeof(application_dct_t::alt_server_public_key))
 #define DCT_ALT_SERVER_ADDRESS_SIZE  (sizeof(application_dct_t::alt_server_address))
+#define DCT_VALIDATED_MODULES_SIZE  (sizeof(application_dct_t::validated_modules))
 
 #define STATIC_ASSERT_DCT_OFFSET(field, expected) STATIC_ASSERT( dct_##field, offsetof(application_dct_t, field)==expected)
 #define STATIC_ASSERT_FLAGS_OFFSET(field, expected) STATIC_ASSERT( dct_sysflag_##field, offsetof(platform_system_flags_t, field)==expected)
@@ -149,8 +155,9 @@ STATIC_ASSERT_DCT_OFFSET(alt_device_public_key, 2978 /* 2977 + 1 */);
 STATIC_ASSERT_DCT_OFFSET(alt_device_private_key, 3106 /* 2978 + 128 */);
 STATIC_ASSERT_DCT_OFFSET(alt_server_public_key, 3298 /* 3106 + 192 */);
 STATIC_ASSERT_DCT_OFFSET(alt_server_address, 3490 /* 3298 + 192 */);
+STATIC_ASSERT_DCT_OFFSET(validated_modules, 3618 /* 3490 + 128 */);
 
-STATIC_ASSERT_DCT_OFFSET(reserved2, 3618 /* 3490 + 128 */);
+STATIC_ASSERT_DCT_OFFSET(reserved2, 3746 /* 3618 + 128 */);
 STATIC_ASSERT_DCT_OFFSET(end, 4258 /* 2952 + 1280 */);
 
 STATIC_ASSERT_FLAGS_OFFSET(Bootloader_Version_SysFlag, 4);
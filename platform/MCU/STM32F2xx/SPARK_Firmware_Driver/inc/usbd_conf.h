@@ -105,5 +105,8 @@ typedef struct
 typedef void (*linecoding_bitrate_handler)(uint32_t bitrate);
 void SetLineCodingBitRateHandler(linecoding_bitrate_handler handler);
 
+typedef void (*data_rx_handler)(void);
+void SetDataRxHandler(data_rx_handler handler);
+
 #endif //__USBD_CONF__H__
 
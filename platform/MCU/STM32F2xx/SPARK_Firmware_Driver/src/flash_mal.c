@@ -399,6 +399,13 @@ bool FLASH_CopyMemory(flash_device_t sourceDeviceID, uint32_t sourceAddress,
         return false;
     }
 
+    if (destinationDeviceID == FLASH_INTERNAL)
+    {
+        /* Whole sectors are erased. This isn't done in FLASH_EraseMemory(),
+           which also erases the DCT's own sectors. */
+        FLASH_InvalidateValidatedModules(destinationAddress, EndOfFlashSector(FLASH_INTERNAL, destinationAddress + length - 1) - destinationAddress);
+    }
+
     if (sourceDeviceID == FLASH_SERIAL)
     {
 #ifdef USE_SERIAL_FLASH
@@ -523,6 +530,12 @@ bool FLASH_AddToNextAvailableModulesSlot(flash_device_t sourceDeviceID, uint32_t
             flash_modules[flash_module_index].module_function = function;
             flash_modules[flash_module_index].flags = flags;
 
+            // the bootloader replaces the module at the destination
+            if (destinationDeviceID == FLASH_INTERNAL)
+            {
+                FLASH_InvalidateValidatedModules(destinationAddress, length);
+            }
+
             dct_write_app_data(&flash_modules[flash_module_index],
                                offsetof(application_dct_t, flash_modules[flash_module_index]),
                                sizeof(platform_flash_modules_t));
@@ -741,6 +754,65 @@ bool FLASH_VerifyCRC32(uint8_t flashDeviceID, uint32_t startAddress, uint32_t le
     return false;
 }
 
+static void FLASH_ReadValidatedModules(validated_module_t* modules)
+{
+    // the DCT entries aren't word aligned
+    memcpy(modules, dct_read_app_data(DCT_VALIDATED_MODULES_OFFSET), sizeof(validated_module_t) * MAX_VALIDATED_MODULES);
+}
+
+static void FLASH_WriteValidatedModule(const validated_module_t* module, uint8_t index)
+{
+    dct_write_app_data(module, DCT_VALIDATED_MODULES_OFFSET + index*sizeof(validated_module_t), sizeof(validated_module_t));
+}
+
+static bool FLASH_VerifyValidatedModule(const validated_module_t* module)
+{
+    return FLASH_VerifyCRC32(FLASH_INTERNAL, module->start_address, module->length);
+}
+
+bool FLASH_VerifyCRC32Cached(uint8_t flashDeviceID, uint32_t startAddress, uint32_t length)
+{
+    if (flashDeviceID != FLASH_INTERNAL || length == 0)
+    {
+        return false;
+    }
+
+    validated_module_t module;
+    module.start_address = startAddress;
+    module.length = length;
+    module.info_crc = Compute_CRC32((const uint8_t*)FLASH_ModuleInfo(flashDeviceID, startAddress), sizeof(module_info_t));
+    module.crc = *(__IO uint32_t*)(startAddress + length);
+
+    validated_module_t modules[MAX_VALIDATED_MODULES];
+    FLASH_ReadValidatedModules(modules);
+    int updated;
+    bool valid = validated_modules_check(modules, MAX_VALIDATED_MODULES, &module, FLASH_VerifyValidatedModule, &updated);
+    if (updated >= 0)
+    {
+        FLASH_WriteValidatedModule(&module, updated);
+    }
+    return valid;
+}
+
+void FLASH_InvalidateValidatedModules(uint32_t startAddress, uint32_t length)
+{
+    validated_module_t modules[MAX_VALIDATED_MODULES];
+    FLASH_ReadValidatedModules(modules);
+    uint8_t index;
+    for (index = 0; index < MAX_VALIDATED_MODULES; index++)
+    {
+        const validated_module_t* module = &modules[index];
+        // the module's CRC follows it
+        if (!validated_module_unused(module) && module->start_address < startAddress + length
+            && startAddress < module->start_address + module->length + 4)
+        {
+            validated_module_t unused;
+            memset(&unused, 0, sizeof(unused));
+            FLASH_WriteValidatedModule(&unused, index);
+        }
+    }
+}
+
 void FLASH_ClearFlags(void)
 {
     /* Clear All pending flags */
@@ -46,6 +46,7 @@ volatile LINE_CODING linecoding =
 };
 
 static linecoding_bitrate_handler APP_LineCodingBitRateHandler = NULL;
+static data_rx_handler APP_DataRxHandler = NULL;
 
 /* These are external variables imported from CDC core to be used for IN
    transfer management. */
@@ -74,6 +75,11 @@ CDC_IF_Prop_TypeDef APP_fops =
 
 /* Private functions ---------------------------------------------------------*/
 
+void SetDataRxHandler(data_rx_handler handler)
+{
+    APP_DataRxHandler = handler;
+}
+
 void SetLineCodingBitRateHandler(linecoding_bitrate_handler handler)
 {
     APP_LineCodingBitRateHandler = handler;
@@ -204,7 +210,11 @@ static uint16_t APP_DataTx (uint8_t* Buf, uint32_t Len)
  */
 static uint16_t APP_DataRx (uint8_t* Buf, uint32_t Len)
 {
-    //Do Nothing
+    //The data is read from USB_Rx_Buffer by usb_hal, which is told it has arrived
+    if (APP_DataRxHandler)
+    {
+        APP_DataRxHandler();
+    }
     return USBD_OK;
 }
 
@@ -11,6 +11,10 @@
 #include "usbd_dct_if.h"
 #include "usbd_dfu_mal.h"
 #include "dct.h"
+#include "platforms.h"
+#if PLATFORM_ID == PLATFORM_ELECTRON_PRODUCTION
+#include "dcd_flash.h"
+#endif
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -51,7 +55,11 @@ uint16_t DCT_If_Write (uint32_t Add, uint32_t Len) {
 }
 
 const uint8_t *DCT_If_Read  (uint32_t Add, uint32_t Len) {
+#if PLATFORM_ID == PLATFORM_ELECTRON_PRODUCTION
+    return dct_read_app_data_range(Add, Len);
+#else
     return dct_read_app_data(Add);
+#endif
 }
 
 uint16_t DCT_If_DeInit(void) {
@@ -91,6 +91,11 @@ uint16_t FLASH_If_DeInit(void)
 *******************************************************************************/
 uint16_t FLASH_If_Erase(uint32_t Add)
 {
+#if defined (STM32F2XX) || defined (STM32F4XX)
+  /* Forget the verified modules in the sector, which writes the DCT */
+  FLASH_InvalidateValidatedModules(Add, EndOfFlashSector(FLASH_INTERNAL, Add) - Add);
+#endif
+
   /* Unlock the internal flash */
   FLASH_Unlock();
 
@@ -12,6 +12,7 @@ extern "C" {
 //New routines specific for BM09/BM14 flash usage
 uint16_t FLASH_SectorToWriteProtect(uint8_t flashDeviceID, uint32_t startAddress);
 uint16_t FLASH_SectorToErase(flash_device_t flashDeviceID, uint32_t startAddress);
+uint32_t EndOfFlashSector(flash_device_t flashDeviceID, uint32_t address);
 bool FLASH_CheckValidAddressRange(flash_device_t flashDeviceID, uint32_t startAddress, uint32_t length);
 bool FLASH_WriteProtectMemory(flash_device_t flashDeviceID, uint32_t startAddress, uint32_t length, bool protect);
 bool FLASH_EraseMemory(flash_device_t flashDeviceID, uint32_t startAddress, uint32_t length);
@@ -58,6 +59,23 @@ uint32_t FLASH_ModuleLength(flash_device_t flashDeviceID, uint32_t startAddress)
 bool FLASH_isUserModuleInfoValid(uint8_t flashDeviceID, uint32_t startAddress, uint32_t expectedAddress);
 bool FLASH_VerifyCRC32(flash_device_t flashDeviceID, uint32_t startAddress, uint32_t length);
 
+/**
+ * Verifies the CRC of an installed module, unless the DCT records the same
+ * module (by address, length, module info and stored CRC) as verified since
+ * a module was last copied or scheduled to be copied there, or the sector was
+ * erased over DFU. A module that verifies is recorded.
+ * Only for installed modules: the OTA region is written by FLASH_Update()
+ * while a module is received, which doesn't forget what was verified there.
+ */
+bool FLASH_VerifyCRC32Cached(flash_device_t flashDeviceID, uint32_t startAddress, uint32_t length);
+
+/**
+ * Forgets the verified modules that overlap a range of internal flash that is
+ * about to be rewritten. This writes the DCT, so must not be called while
+ * erasing the DCT's own sectors.
+ */
+void FLASH_InvalidateValidatedModules(uint32_t startAddress, uint32_t length);
+
 //Old routines with same signature both for Core and Photon
 void FLASH_ClearFlags(void);
 void FLASH_Erase(void);
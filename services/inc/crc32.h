@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef CRC32_H
+#define	CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The CRC-32 used for modules and OTA chunks (polynomial 0x04C11DB7,
+ * reflected, initial value and final XOR 0xFFFFFFFF), computed in software
+ * 8 bytes at a time from 8 tables of 256 entries (slicing-by-8).
+ *
+ * The tables take 8 KB of flash, so the STM32 platforms, which have a CRC
+ * unit, use that instead and don't link this in.
+ *
+ * @param crc   0 to start, or the result of the previous call to continue it
+ * @return the CRC of all the data so far.
+ */
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* CRC32_H */
@@ -18,12 +18,26 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 
 /**
  * Emulates rewritable storage using two flash blocks.
+ *
+ * When journalOffset is non-zero, the bytes from journalOffset to the end of
+ * each sector are used as a write-ahead journal. Small writes are appended
+ * to the journal of the current sector as (offset, length, data) records and
+ * the sector is only copied to the alternate sector when the journal is full.
+ * The committed records are indexed in RAM and overlaid on the sector data
+ * when reading.
+ *
+ * Ranges given to the constructor are never journaled, for data that is also
+ * read by code that doesn't know about the journal. Code that doesn't know
+ * about the journal may also write the sector directly, copying the journal
+ * with it, so each record keeps a check of the sector data it replaces and
+ * is dropped when that data has changed.
  */
 
-template <typename Store, unsigned sectorSize, unsigned DCD1, unsigned DCD2>
+template <typename Store, unsigned sectorSize, unsigned DCD1, unsigned DCD2, unsigned journalOffset=0>
 class DCD
 {
 public:
@@ -75,12 +89,98 @@ public:
         }
     };
 
+    /**
+     * A write appended to the journal. The header is written with the state
+     * erased, followed by the data and then the committed state, so a record
+     * interrupted by a power failure is ignored.
+     */
+    struct JournalRecord
+    {
+        static const uint32_t STATE_PENDING = 0xFFFFFFFF;
+        static const uint32_t STATE_COMMITTED = 0x1E6C0DE0;
+
+        uint16_t offset;
+        uint16_t length;
+        uint16_t check;         // ~(offset^length), detects a partially written header
+        uint16_t replaced;      // CRC of the sector data under the record when it was written
+        uint32_t state;
+
+        void initialize(Address offset_, Address length_, uint16_t replaced_)
+        {
+            offset = offset_;
+            length = length_;
+            check = ~(offset^length);
+            replaced = replaced_;
+            state = STATE_PENDING;
+        }
+
+        bool isErased() const
+        {
+            return offset==0xFFFF && length==0xFFFF && check==0xFFFF;
+        }
+
+        bool isValid(Address maxLength) const
+        {
+            return check==uint16_t(~(offset^length)) && Address(offset)+length<=maxLength;
+        }
+
+        bool isCommitted() const
+        {
+            return state==STATE_COMMITTED;
+        }
+
+        static Address size(Address length)
+        {
+            return sizeof(JournalRecord)+((length+3)&~3);
+        }
+    };
+
     static const Sector Sector_0 = 0;
     static const Sector Sector_1 = 1;
 
-    const Address Length = sectorSize-sizeof(Header);
+    const Address Length = (journalOffset ? journalOffset : sectorSize)-sizeof(Header);
+
+    /**
+     * The maximum number of records in the journal before it is compacted.
+     */
+    static const unsigned JournalEntries = 16;
+
+    /**
+     * Writes larger than this are written directly to the alternate sector.
+     */
+    static const Address JournalWriteMax = journalOffset ? (sectorSize-journalOffset)/4 : 0;
+
+    /**
+     * A range of the data.
+     */
+    struct Range
+    {
+        Address offset;
+        Address length;
+
+        bool overlaps(Address offset_, size_t length_) const
+        {
+            return offset<offset_+length_ && offset_<offset+length;
+        }
+    };
 
 private:
+    static const Sector Sector_None = 0xFF;
+
+    struct JournalEntry
+    {
+        uint16_t offset;
+        uint16_t length;
+        Address data;           // the address of the record data in the store
+    };
+
+    JournalEntry journal[journalOffset ? JournalEntries : 1];
+    unsigned journalCount = 0;
+    Address journalEnd = 0;                 // offset in the sector of the next record
+    Sector journalSector = Sector_None;     // the sector the index was built from
+    const Range* unjournaled = nullptr;     // always written to the sector
+    unsigned unjournaledCount = 0;
+
     inline Address addressOf(Sector sector)
     {
         return sector==Sector_0 ? DCD1 : DCD2;
@@ -102,6 +202,8 @@ private:
     Result erase(Sector sector)
     {
         Result result = 0;
+        if (sector==journalSector)
+            journalSector = Sector_None;
         Address offset = addressOf(sector);
         if (requiresErase(offset)) {
             result = store.eraseSector(offset);
@@ -145,9 +247,207 @@ private:
         return sector==Sector_0 ? Sector_1 : Sector_0;
     }
 
+    bool isUnjournaled(Address offset, size_t length)
+    {
+        for (unsigned i=0; i<unjournaledCount; i++)
+        {
+            if (unjournaled[i].overlaps(offset, length))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * CRC-16-CCITT, which unlike a sum tells erased bytes from zeros.
+     */
+    static uint16_t crc16(const uint8_t* data, size_t length)
+    {
+        uint16_t crc = 0xFFFF;
+        while (length--)
+        {
+            crc ^= uint16_t(*data++)<<8;
+            for (int i=0; i<8; i++)
+                crc = (crc&0x8000) ? (crc<<1)^0x1021 : crc<<1;
+        }
+        return crc;
+    }
+
+    uint16_t sectorCheck(Sector sector, Address offset, size_t length)
+    {
+        return crc16(store.dataAt(addressOf(sector)+sizeof(Header)+offset), length);
+    }
+
+    /**
+     * Builds the index of committed journal records in the given sector.
+     * Records for an unjournaled range, or whose sector data has changed
+     * since they were written, are skipped. They can only be stale copies
+     * made by a write that didn't know about the journal, and would
+     * otherwise hide the data it wrote to the sector.
+     */
+    void scanJournal(Sector sector)
+    {
+        journalCount = 0;
+        Address position = journalOffset;
+        const Address base = addressOf(sector);
+        while (position+sizeof(JournalRecord)<=sectorSize)
+        {
+            JournalRecord record;
+            memcpy(&record, store.dataAt(base+position), sizeof(record));
+            if (record.isErased())
+                break;
+            if (!record.isValid(Length) || position+JournalRecord::size(record.length)>sectorSize) {
+                position = sectorSize;      // unusable, compacted by the next write
+                break;
+            }
+            if (record.isCommitted() && !isUnjournaled(record.offset, record.length) &&
+                    record.replaced==sectorCheck(sector, record.offset, record.length)) {
+                if (journalCount==JournalEntries) {
+                    position = sectorSize;
+                    break;
+                }
+                JournalEntry& entry = journal[journalCount++];
+                entry.offset = record.offset;
+                entry.length = record.length;
+                entry.data = base+position+sizeof(JournalRecord);
+            }
+            position += JournalRecord::size(record.length);
+        }
+        journalEnd = position;
+        journalSector = sector;
+    }
+
+    void loadJournal(Sector sector)
+    {
+        if (journalOffset && journalSector!=sector)
+            scanJournal(sector);
+    }
+
+    void resetJournal(Sector sector)
+    {
+        journalCount = 0;
+        journalEnd = journalOffset;
+        journalSector = sector;
+    }
+
+    bool journalOverlaps(Address offset, size_t length)
+    {
+        for (unsigned i=0; i<journalCount; i++)
+        {
+            const JournalEntry& entry = journal[i];
+            if (entry.offset<offset+length && offset<Address(entry.offset)+entry.length)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * Copies the bytes of a write that fall within [offset, offset+length) to dest.
+     */
+    static void overlay(uint8_t* dest, Address offset, size_t length, const uint8_t* data, Address dataOffset, size_t dataLength)
+    {
+        Address start = offset>dataOffset ? offset : dataOffset;
+        Address end = offset+length<dataOffset+dataLength ? offset+length : dataOffset+dataLength;
+        if (start<end)
+            memcpy(dest+(start-offset), data+(start-dataOffset), end-start);
+    }
+
+    /**
+     * Applies the journal records, oldest first, to data read from the sector.
+     */
+    void overlayJournal(uint8_t* dest, Address offset, size_t length)
+    {
+        for (unsigned i=0; i<journalCount; i++)
+        {
+            const JournalEntry& entry = journal[i];
+            overlay(dest, offset, length, store.dataAt(entry.data), entry.offset, entry.length);
+        }
+    }
+
+    /**
+     * Appends a write to the journal of the current sector.
+     * @return false if the write doesn't fit in the journal.
+     */
+    bool appendJournal(Sector current, Address offset, const void* data, size_t length, Result& error)
+    {
+        loadJournal(current);
+        const Address size = JournalRecord::size(length);
+        if (length>JournalWriteMax || journalCount==JournalEntries || journalEnd+size>sectorSize)
+            return false;
+
+        const Address location = addressOf(current)+journalEnd;
+        JournalRecord record;
+        record.initialize(offset, length, sectorCheck(current, offset, length));
+
+        journalSector = Sector_None;        // rescan if the record isn't completed
+        error = store.write(location, &record, sizeof(record));
+        if (!error)
+            error = store.write(location+sizeof(record), data, length);
+        if (!error) {
+            record.state = JournalRecord::STATE_COMMITTED;
+            error = store.write(location+offsetof(JournalRecord, state), &record.state, sizeof(record.state));
+        }
+        if (!error) {
+            journalSector = current;
+            JournalEntry& entry = journal[journalCount++];
+            entry.offset = offset;
+            entry.length = length;
+            entry.data = location+sizeof(record);
+            journalEnd += size;
+        }
+        return true;
+    }
+
+    /**
+     * Writes the current sector data with the journal and the given write applied
+     * to the alternate sector, leaving the alternate sector's journal empty.
+     */
+    Result compact(Sector current, const Address offset, const void* data, size_t length)
+    {
+        loadJournal(current);
+        const Sector newSector = alternateSectorTo(current);
+        Result error = erase(newSector);
+        if (error) return error;
+
+        const uint8_t* existing = store.dataAt(addressOf(current)+sizeof(Header));
+        const Address destination = addressOf(newSector)+sizeof(Header);
+        uint8_t buf[64];
+        for (Address position=0; position<Length; position+=sizeof(buf))
+        {
+            size_t chunk = Length-position<sizeof(buf) ? Length-position : sizeof(buf);
+            memcpy(buf, existing+position, chunk);
+            overlayJournal(buf, position, chunk);
+            overlay(buf, position, chunk, (const uint8_t*)data, offset, length);
+
+            size_t i = 0;
+            while (i<chunk && buf[i]==0xFF)
+                i++;
+            if (i==chunk)
+                continue;       // already erased
+            error = store.write(destination+position, buf, chunk);
+            if (error) return error;
+        }
+
+        Header header;
+        header.make_valid();
+        error = store.write(addressOf(newSector), &header, sizeof(header));
+        if (error) return error;
+
+        header.make_invalid();
+        error = store.write(addressOf(current), &header, sizeof(header));
+        resetJournal(newSector);
+        return error;
+    }
+
 public:
     DCD() = default;
 
+    /**
+     * @param unjournaled   ranges that are always written directly to the sector
+     * @param count         the number of ranges
+     */
+    DCD(const Range* unjournaled_, unsigned count) : unjournaled(unjournaled_), unjournaledCount(count)
+    {
+    }
 
     bool isInitialized()
     {
@@ -167,16 +467,55 @@ public:
     }
 
     /**
-     * Retrieve a pointer to the data in the DCD.
+     * Retrieve a pointer to the data in the DCD. In journal mode, this compacts
+     * any journal record from the offset to the end of the data, so prefer
+     * giving the length read.
      * @param offset
      * @return
      */
     const uint8_t* read(const Address offset)
     {
-        Address location = addressOf(currentSector())+sizeof(Header)+offset;
+        return read(offset, offset<Length ? Length-offset : 0);
+    }
+
+    /**
+     * Retrieve a pointer to a range of data in the DCD. In journal mode, pending
+     * journal records that overlap the range are compacted first so that the
+     * sector data is current.
+     */
+    const uint8_t* read(const Address offset, size_t length)
+    {
+        Sector current = currentSector();
+        if (journalOffset) {
+            loadJournal(current);
+            if (journalOverlaps(offset, length)) {
+                compact(current, 0, nullptr, 0);
+                current = currentSector();
+            }
+        }
+        Address location = addressOf(current)+sizeof(Header)+offset;
         return store.dataAt(location);
     }
 
+    /**
+     * Copy data from the DCD. In journal mode the journal is applied without compacting it.
+     */
+    Result read(const Address offset, void* data, size_t length)
+    {
+        if (offset >= Length)
+            return DCD_INVALID_OFFSET;
+        if (offset+length > Length)
+            return DCD_INVALID_LENGTH;
+
+        const Sector current = currentSector();
+        memcpy(data, store.dataAt(addressOf(current)+sizeof(Header)+offset), length);
+        if (journalOffset) {
+            loadJournal(current);
+            overlayJournal((uint8_t*)data, offset, length);
+        }
+        return DCD_SUCCESS;
+    }
+
     /**
      * Write data to the DCD.
      * @param data      The data to write
@@ -194,6 +533,13 @@ public:
             return DCD_SUCCESS;
 
         const Sector current = currentSector();
+        if (journalOffset) {
+            Result error = DCD_SUCCESS;
+            if (!isUnjournaled(offset, length) && appendJournal(current, offset, data, length, error))
+                return error;
+            return compact(current, offset, data, length);
+        }
+
         Sector newSector = alternateSectorTo(current);
         const uint8_t* existing = store.dataAt(addressOf(current));
         Result error = this->writeSector(offset, data, length, existing, newSector);
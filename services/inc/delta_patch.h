@@ -0,0 +1,346 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef DELTA_PATCH_H
+#define	DELTA_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * A binary patch that rebuilds a new module image from the one installed,
+ * so an update that changes a few functions sends little more than the change.
+ *
+ * The patch is a header followed by a stream of operations. Both images
+ * include the CRC stored after the module. Header fields are little-endian:
+ *   magic(4) version(1) reserved(3) source_address(4) source_length(4)
+ *   source_crc(4) target_length(4)
+ * source_crc is the CRC stored at the end of the source image, which
+ * identifies the module the patch was made from.
+ *
+ * Each operation starts with a varint (7 bits per byte, low bits first) of
+ * (count<<2)|op, where op is
+ *   COPY   - copy count bytes from the source at the read position
+ *   ADD    - count bytes follow, each added to the next byte of the source
+ *   INSERT - count bytes follow, which are output as they are
+ *   SEEK   - move the read position by count, zigzag encoded so it can go back
+ * COPY and ADD advance the read position. As in bsdiff, code that moved
+ * because something before it grew matches the source with only the
+ * addresses in it changed, so comes out as ADD bytes that are mostly zero.
+ *
+ * The patch is applied as it streams in, with a small fixed output buffer.
+ * Source reads are random access, so the source is given as memory, such as
+ * the module in internal flash.
+ */
+
+#ifndef DELTA_PATCH_BUFFER_SIZE
+#define DELTA_PATCH_BUFFER_SIZE 256
+#endif
+
+namespace DeltaPatch {
+
+const uint32_t MAGIC = 0x544C4450;     // "PDLT"
+const uint8_t VERSION = 1;
+const size_t HEADER_SIZE = 24;
+
+enum Op
+{
+    COPY = 0,
+    ADD = 1,
+    INSERT = 2,
+    SEEK = 3,
+};
+
+enum Errors
+{
+    ERROR_HEADER = -1,      // not a patch, or a version this code doesn't know
+    ERROR_SOURCE = -2,      // the source isn't the image the patch was made from
+    ERROR_CORRUPT = -3,     // an operation reads outside the source or writes past the target
+    ERROR_WRITE = -4,       // the sink failed to write
+    ERROR_INCOMPLETE = -5,  // the patch ended before the target was complete
+};
+
+inline uint32_t read_le32(const uint8_t* p)
+{
+    return p[0] | (p[1]<<8) | (p[2]<<16) | (uint32_t(p[3])<<24);
+}
+
+inline void write_le32(uint8_t* p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value>>8;
+    p[2] = value>>16;
+    p[3] = value>>24;
+}
+
+struct Header
+{
+    uint32_t magic;
+    uint8_t version;
+    uint32_t source_address;    // where the source module is installed
+    uint32_t source_length;     // including the CRC
+    uint32_t source_crc;
+    uint32_t target_length;     // including the CRC
+
+    void read(const uint8_t* p)
+    {
+        magic = read_le32(p);
+        version = p[4];
+        source_address = read_le32(p+8);
+        source_length = read_le32(p+12);
+        source_crc = read_le32(p+16);
+        target_length = read_le32(p+20);
+    }
+
+    void write(uint8_t* p) const
+    {
+        memset(p, 0, HEADER_SIZE);
+        write_le32(p, magic);
+        p[4] = version;
+        write_le32(p+8, source_address);
+        write_le32(p+12, source_length);
+        write_le32(p+16, source_crc);
+        write_le32(p+20, target_length);
+    }
+
+    bool is_valid() const
+    {
+        return magic==MAGIC && version==VERSION;
+    }
+
+    /**
+     * Checks the source is the right length and ends with the CRC the patch
+     * expects. This doesn't compute the CRC; that is left to the caller.
+     */
+    bool matches(const uint8_t* source, uint32_t length) const
+    {
+        return length==source_length && length>=4 && read_le32(source+length-4)==source_crc;
+    }
+};
+
+/**
+ * Applies a patch fed to it in pieces of any size.
+ * @param Sink  called as sink(offset, data, length) to write the next part of
+ *              the target, returning 0 on success. Writes are BUFFER_SIZE
+ *              bytes except for the last, and come in order.
+ */
+template <typename Sink, size_t BUFFER_SIZE=DELTA_PATCH_BUFFER_SIZE>
+class Applier
+{
+    enum State
+    {
+        READ_HEADER,
+        READ_OP,
+        READ_BYTES,     // the bytes of an ADD or INSERT
+        DONE,
+    };
+
+    Sink& sink;
+    const uint8_t* source;
+    uint32_t source_length;
+
+    Header header_;
+    State state;
+    int error;
+    uint32_t received;      // header bytes so far
+    uint32_t varint;
+    uint8_t shift;
+    uint8_t op;
+    uint32_t remaining;     // bytes left in the current operation
+    uint32_t position;      // read position in the source
+    uint32_t output;        // target bytes written and buffered
+    size_t buffered;
+    uint8_t header_data[HEADER_SIZE];
+    uint8_t buffer[BUFFER_SIZE];
+
+    int fail(int code)
+    {
+        error = code;
+        state = DONE;
+        return error;
+    }
+
+    int flush()
+    {
+        if (buffered) {
+            if (sink(output-buffered, buffer, buffered))
+                return fail(ERROR_WRITE);
+            buffered = 0;
+        }
+        return 0;
+    }
+
+    int emit(uint8_t b)
+    {
+        buffer[buffered++] = b;
+        output++;
+        return buffered==BUFFER_SIZE ? flush() : 0;
+    }
+
+    int start_op()
+    {
+        uint32_t count = varint>>2;
+        op = varint & 3;
+        if (op==SEEK) {
+            int32_t offset = int32_t(count>>1) ^ -int32_t(count&1);
+            int64_t to = int64_t(position) + offset;
+            if (to<0 || to>source_length)
+                return fail(ERROR_CORRUPT);
+            position = uint32_t(to);
+            return 0;
+        }
+        if (count>header_.target_length-output)
+            return fail(ERROR_CORRUPT);
+        if (op!=INSERT && count>source_length-position)
+            return fail(ERROR_CORRUPT);
+        if (op==COPY) {
+            while (count) {
+                size_t n = BUFFER_SIZE-buffered;
+                if (n>count)
+                    n = count;
+                memcpy(buffer+buffered, source+position, n);
+                buffered += n;
+                output += n;
+                position += n;
+                count -= n;
+                if (buffered==BUFFER_SIZE && flush())
+                    return error;
+            }
+        }
+        else if (count) {
+            remaining = count;
+            state = READ_BYTES;
+        }
+        return 0;
+    }
+
+    int complete()
+    {
+        if (output==header_.target_length && state!=READ_BYTES) {
+            if (flush())
+                return error;
+            state = DONE;
+        }
+        return 0;
+    }
+
+public:
+
+    Applier(Sink& sink_, const uint8_t* source_, uint32_t source_length_)
+        : sink(sink_), source(source_), source_length(source_length_),
+          state(READ_HEADER), error(0), received(0), varint(0), shift(0), op(0),
+          remaining(0), position(0), output(0), buffered(0)
+    {
+    }
+
+    /**
+     * Applies the next part of the patch. Data after the end of the patch is ignored.
+     * @return 0 on success, or one of the Errors.
+     */
+    int feed(const uint8_t* data, size_t length)
+    {
+        const uint8_t* end = data+length;
+        while (data<end && state!=DONE) {
+            switch (state) {
+            case READ_HEADER:
+                header_data[received++] = *data++;
+                if (received==HEADER_SIZE) {
+                    header_.read(header_data);
+                    if (!header_.is_valid())
+                        return fail(ERROR_HEADER);
+                    if (!header_.matches(source, source_length))
+                        return fail(ERROR_SOURCE);
+                    state = READ_OP;
+                    if (complete())
+                        return error;
+                }
+                break;
+
+            case READ_OP: {
+                uint8_t b = *data++;
+                if (shift>=32)
+                    return fail(ERROR_CORRUPT);
+                varint |= uint32_t(b & 0x7F)<<shift;
+                shift += 7;
+                if (!(b & 0x80)) {
+                    if (start_op())
+                        return error;
+                    varint = 0;
+                    shift = 0;
+                    if (complete())
+                        return error;
+                }
+                break;
+            }
+
+            case READ_BYTES: {
+                uint8_t b = *data++;
+                if (op==ADD)
+                    b += source[position++];
+                if (emit(b))
+                    return error;
+                if (!--remaining) {
+                    state = READ_OP;
+                    if (complete())
+                        return error;
+                }
+                break;
+            }
+
+            case DONE:
+                break;
+            }
+        }
+        return error;
+    }
+
+    /**
+     * Called when the patch has all been fed.
+     * @return 0 when the target is complete, or one of the Errors.
+     */
+    int finish()
+    {
+        if (!error && !done())
+            fail(ERROR_INCOMPLETE);
+        return error;
+    }
+
+    bool done() const
+    {
+        return state==DONE && !error;
+    }
+
+    /**
+     * The header, once the first HEADER_SIZE bytes have been fed.
+     */
+    const Header& header() const
+    {
+        return header_;
+    }
+
+    uint32_t written() const
+    {
+        return output-buffered;
+    }
+};
+
+}
+
+#endif	/* DELTA_PATCH_H */
@@ -0,0 +1,298 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef DELTA_PATCH_DIFF_H
+#define	DELTA_PATCH_DIFF_H
+
+/**
+ * Makes the patches applied by DeltaPatch::Applier. This runs on the host
+ * (the patch tool and the unit tests), not on the device.
+ *
+ * The matching is bsdiff's: a suffix array of the source finds the longest
+ * exact match for each position of the target, and each match is then
+ * extended forwards and backwards while at least half the bytes still agree.
+ * The extended regions become COPY where they agree and ADD where they don't,
+ * and what lies between them becomes INSERT.
+ */
+
+#include "delta_patch.h"
+#include <vector>
+#include <algorithm>
+
+namespace DeltaPatch {
+
+/**
+ * Sorts the suffixes of data by prefix doubling.
+ */
+inline std::vector<int32_t> suffix_array(const uint8_t* data, size_t length)
+{
+    std::vector<int32_t> sa(length), rank(length), next(length);
+    for (size_t i=0; i<length; i++) {
+        sa[i] = i;
+        rank[i] = data[i];
+    }
+    for (size_t k=1; length; k<<=1) {
+        auto less = [&](int32_t a, int32_t b) {
+            if (rank[a]!=rank[b])
+                return rank[a]<rank[b];
+            int32_t ra = a+k<length ? rank[a+k] : -1;
+            int32_t rb = b+k<length ? rank[b+k] : -1;
+            return ra<rb;
+        };
+        std::sort(sa.begin(), sa.end(), less);
+        next[sa[0]] = 0;
+        for (size_t i=1; i<length; i++)
+            next[sa[i]] = next[sa[i-1]] + (less(sa[i-1], sa[i]) ? 1 : 0);
+        rank.swap(next);
+        if (size_t(rank[sa[length-1]])==length-1)
+            break;
+    }
+    return sa;
+}
+
+class Diff
+{
+    const uint8_t* source;
+    ptrdiff_t source_length;
+    const uint8_t* target;
+    ptrdiff_t target_length;
+    std::vector<int32_t> sa;
+
+    std::vector<uint8_t> patch;
+    int pending_op;
+    int64_t pending_count;
+    std::vector<uint8_t> pending_bytes;
+
+    static ptrdiff_t match_length(const uint8_t* a, ptrdiff_t a_length, const uint8_t* b, ptrdiff_t b_length)
+    {
+        ptrdiff_t i = 0;
+        while (i<a_length && i<b_length && a[i]==b[i])
+            i++;
+        return i;
+    }
+
+    /**
+     * Finds the longest match in the source for the target from scan.
+     */
+    ptrdiff_t search(ptrdiff_t scan, ptrdiff_t& pos) const
+    {
+        const uint8_t* key = target+scan;
+        ptrdiff_t key_length = target_length-scan;
+        auto before = [&](int32_t suffix, int) {
+            ptrdiff_t n = std::min(source_length-suffix, key_length);
+            int c = memcmp(source+suffix, key, n);
+            return c<0 || (c==0 && source_length-suffix<key_length);
+        };
+        auto it = std::lower_bound(sa.begin(), sa.end(), 0, before);
+        ptrdiff_t best = 0;
+        pos = 0;
+        for (auto candidate = it==sa.begin() ? it : it-1; candidate!=sa.end() && candidate<=it; ++candidate) {
+            ptrdiff_t n = match_length(source+*candidate, source_length-*candidate, key, key_length);
+            if (n>best) {
+                best = n;
+                pos = *candidate;
+            }
+        }
+        return best;
+    }
+
+    void write_varint(uint64_t value)
+    {
+        while (value>=0x80) {
+            patch.push_back(uint8_t(value) | 0x80);
+            value >>= 7;
+        }
+        patch.push_back(uint8_t(value));
+    }
+
+    void flush()
+    {
+        if (pending_op<0)
+            return;
+        uint64_t count = pending_count;
+        if (pending_op==SEEK)
+            count = pending_count<0 ? (uint64_t(-pending_count)<<1)-1 : uint64_t(pending_count)<<1;
+        if (count || pending_op!=SEEK)
+            write_varint((count<<2) | pending_op);
+        patch.insert(patch.end(), pending_bytes.begin(), pending_bytes.end());
+        pending_op = -1;
+        pending_count = 0;
+        pending_bytes.clear();
+    }
+
+    /**
+     * Adds an operation, merging it with the last when they are the same.
+     */
+    void op(int kind, int64_t count, const uint8_t* bytes=nullptr)
+    {
+        if (!count)
+            return;
+        if (kind!=pending_op)
+            flush();
+        pending_op = kind;
+        pending_count += count;
+        if (bytes)
+            pending_bytes.insert(pending_bytes.end(), bytes, bytes+count);
+    }
+
+    /**
+     * Writes a region of the target that lines up with the source as COPY
+     * for runs that agree and ADD for the rest. Short runs that agree are
+     * left in the ADD, where they cost a byte each rather than an op.
+     */
+    void write_aligned(ptrdiff_t from, ptrdiff_t pos, ptrdiff_t length)
+    {
+        const ptrdiff_t MIN_COPY = 8;
+        std::vector<uint8_t> diff(length);
+        for (ptrdiff_t i=0; i<length; i++)
+            diff[i] = target[from+i]-source[pos+i];
+        ptrdiff_t i = 0;
+        while (i<length) {
+            ptrdiff_t zeros = 0;
+            while (i+zeros<length && !diff[i+zeros])
+                zeros++;
+            if (zeros>=MIN_COPY || (zeros && i+zeros==length && pending_op==COPY)) {
+                op(COPY, zeros);
+                i += zeros;
+                continue;
+            }
+            ptrdiff_t j = i+zeros;
+            while (j<length) {
+                ptrdiff_t run = 0;
+                while (j+run<length && !diff[j+run] && run<MIN_COPY)
+                    run++;
+                if (run>=MIN_COPY)
+                    break;
+                j += run ? run : 1;
+            }
+            op(ADD, j-i, diff.data()+i);
+            i = j;
+        }
+    }
+
+public:
+
+    Diff(const uint8_t* source_, size_t source_length_, const uint8_t* target_, size_t target_length_)
+        : source(source_), source_length(source_length_), target(target_), target_length(target_length_),
+          sa(suffix_array(source_, source_length_)), pending_op(-1), pending_count(0)
+    {
+    }
+
+    std::vector<uint8_t> make(uint32_t source_address)
+    {
+        patch.assign(HEADER_SIZE, 0);
+        Header header;
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.source_address = source_address;
+        header.source_length = source_length;
+        header.source_crc = source_length>=4 ? read_le32(source+source_length-4) : 0;
+        header.target_length = target_length;
+        header.write(patch.data());
+
+        ptrdiff_t scan = 0, len = 0, pos = 0;
+        ptrdiff_t lastscan = 0, lastpos = 0, lastoffset = 0;
+        while (scan<target_length) {
+            ptrdiff_t oldscore = 0;
+            ptrdiff_t scsc;
+            for (scsc = scan += len; scan<target_length; scan++) {
+                len = search(scan, pos);
+                for (; scsc<scan+len; scsc++)
+                    if (scsc+lastoffset<source_length && source[scsc+lastoffset]==target[scsc])
+                        oldscore++;
+                if ((len==oldscore && len) || len>oldscore+8)
+                    break;
+                if (scan+lastoffset<source_length && source[scan+lastoffset]==target[scan])
+                    oldscore--;
+            }
+
+            if (len==oldscore && scan!=target_length)
+                continue;
+
+            // extend the last match forwards and this one backwards
+            ptrdiff_t s = 0, best = 0, lenf = 0;
+            for (ptrdiff_t i=0; lastscan+i<scan && lastpos+i<source_length; ) {
+                if (source[lastpos+i]==target[lastscan+i])
+                    s++;
+                i++;
+                if (s*2-i>best*2-lenf) {
+                    best = s;
+                    lenf = i;
+                }
+            }
+
+            ptrdiff_t lenb = 0;
+            if (scan<target_length) {
+                s = 0; best = 0;
+                for (ptrdiff_t i=1; scan>=lastscan+i && pos>=i; i++) {
+                    if (source[pos-i]==target[scan-i])
+                        s++;
+                    if (s*2-i>best*2-lenb) {
+                        best = s;
+                        lenb = i;
+                    }
+                }
+            }
+
+            if (lastscan+lenf>scan-lenb) {
+                ptrdiff_t overlap = (lastscan+lenf)-(scan-lenb);
+                ptrdiff_t lens = 0;
+                s = 0; best = 0;
+                for (ptrdiff_t i=0; i<overlap; i++) {
+                    if (target[lastscan+lenf-overlap+i]==source[lastpos+lenf-overlap+i])
+                        s++;
+                    if (target[scan-lenb+i]==source[pos-lenb+i])
+                        s--;
+                    if (s>best) {
+                        best = s;
+                        lens = i+1;
+                    }
+                }
+                lenf += lens-overlap;
+                lenb -= lens;
+            }
+
+            write_aligned(lastscan, lastpos, lenf);
+            op(INSERT, (scan-lenb)-(lastscan+lenf), target+lastscan+lenf);
+            op(SEEK, (pos-lenb)-(lastpos+lenf));
+
+            lastscan = scan-lenb;
+            lastpos = pos-lenb;
+            lastoffset = pos-scan;
+        }
+        if (pending_op==SEEK)     // nothing follows it
+            pending_op = -1;
+        flush();
+        return patch;
+    }
+};
+
+/**
+ * Makes a patch that turns source into target.
+ * @param source_address    where the source module is installed
+ */
+inline std::vector<uint8_t> diff(const uint8_t* source, size_t source_length,
+    const uint8_t* target, size_t target_length, uint32_t source_address=0)
+{
+    return Diff(source, source_length, target, target_length).make(source_address);
+}
+
+}
+
+#endif	/* DELTA_PATCH_DIFF_H */
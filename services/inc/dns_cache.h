@@ -0,0 +1,270 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef DNS_CACHE_H
+#define	DNS_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef DNS_CACHE_ENTRIES
+#define DNS_CACHE_ENTRIES 4
+#endif
+
+#ifndef DNS_CACHE_HOSTNAME_MAX
+#define DNS_CACHE_HOSTNAME_MAX 63
+#endif
+
+/**
+ * Time a successful lookup is cached for when the resolver doesn't provide a TTL.
+ */
+#ifndef DNS_CACHE_TTL_DEFAULT
+#define DNS_CACHE_TTL_DEFAULT (5*60*1000)
+#endif
+
+/**
+ * Time before an expired address that couldn't be refreshed is looked up
+ * again. Its stale address is returned until then.
+ */
+#ifndef DNS_CACHE_TTL_NEGATIVE
+#define DNS_CACHE_TTL_NEGATIVE (10*1000)
+#endif
+
+/**
+ * How long after expiry an address is still returned when the resolver fails.
+ * Set to 0 to disable serving stale addresses.
+ */
+#ifndef DNS_CACHE_STALE_MAX
+#define DNS_CACHE_STALE_MAX (60*60*1000)
+#endif
+
+struct DNSCacheNoLock
+{
+    DNSCacheNoLock() {}
+};
+
+/**
+ * A small, bounded cache of hostname lookups. Entries are replaced
+ * least-recently-used first.
+ *
+ * Only resolved addresses are cached. A failed lookup with no stale address
+ * to fall back on isn't, so that the caller's retries reach the resolver.
+ *
+ * @param Address   The type of address stored for each host.
+ * @param Lock      An RAII type held while the cache table is accessed.
+ *                  The lock is not held while the resolver runs.
+ */
+template <typename Address, typename Lock=DNSCacheNoLock,
+    unsigned entries=DNS_CACHE_ENTRIES, unsigned hostnameMax=DNS_CACHE_HOSTNAME_MAX>
+class DNSCache
+{
+public:
+    using Tick = uint32_t;
+
+    enum Status
+    {
+        MISS,       // not in the cache
+        HIT,        // in the cache and not expired
+        STALE,      // a positive entry that has expired
+    };
+
+    struct Entry
+    {
+        char hostname[hostnameMax+1];
+        Address address;
+        int result;             // 0 for a resolved address, otherwise the resolver error
+        Tick stored;
+        Tick ttl;
+        Tick stale_limit;       // age beyond which the address is no longer used
+        Tick used;
+        bool valid;
+
+        bool expired(Tick now) const
+        {
+            return (now-stored) >= ttl;
+        }
+
+        bool usable_stale(Tick now) const
+        {
+            return !result && (now-stored) < stale_limit;
+        }
+    };
+
+private:
+    Entry table[entries];
+
+    static bool cacheable(const char* hostname)
+    {
+        return hostname && *hostname && strlen(hostname)<=hostnameMax;
+    }
+
+    Entry* find(const char* hostname)
+    {
+        for (Entry& entry : table) {
+            if (entry.valid && !strcmp(entry.hostname, hostname))
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    Entry& victim()
+    {
+        Entry* result = &table[0];
+        for (Entry& entry : table) {
+            if (!entry.valid)
+                return entry;
+            if (entry.used < result->used)
+                result = &entry;
+        }
+        return *result;
+    }
+
+    Tick usage = 0;
+
+public:
+
+    DNSCache()
+    {
+        clear();
+    }
+
+    /**
+     * Looks up a hostname in the cache.
+     * @param hostname  The hostname to find
+     * @param address   Receives the cached address for a HIT or STALE entry.
+     * @param result    Receives the cached resolver result for a HIT entry.
+     * @param now       The current time in milliseconds.
+     */
+    Status lookup(const char* hostname, Address& address, int& result, Tick now)
+    {
+        if (!cacheable(hostname))
+            return MISS;
+
+        Lock lock;
+        Entry* entry = find(hostname);
+        if (!entry)
+            return MISS;
+
+        if (!entry->expired(now)) {
+            entry->used = ++usage;
+            address = entry->address;
+            result = entry->result;
+            return HIT;
+        }
+        if (entry->usable_stale(now)) {
+            address = entry->address;
+            return STALE;
+        }
+        entry->valid = false;
+        return MISS;
+    }
+
+    /**
+     * Adds or replaces the cache entry for a hostname.
+     * @param result    0 if the address was resolved, the resolver error otherwise.
+     * @param ttl       How long the entry is valid for, in milliseconds.
+     */
+    void store(const char* hostname, const Address& address, int result, Tick ttl, Tick now)
+    {
+        if (!cacheable(hostname))
+            return;
+
+        Lock lock;
+        Entry* entry = find(hostname);
+        if (!entry) {
+            entry = &victim();
+            strcpy(entry->hostname, hostname);
+        }
+        entry->address = address;
+        entry->result = result;
+        entry->stored = now;
+        entry->ttl = ttl;
+        entry->stale_limit = result ? 0 : ttl+DNS_CACHE_STALE_MAX;
+        entry->used = ++usage;
+        entry->valid = true;
+    }
+
+    /**
+     * Keeps serving the stale address for a hostname until the next retry is due.
+     * The stale limit set when the address was resolved is not extended.
+     */
+    void retry_later(const char* hostname, Tick now)
+    {
+        Lock lock;
+        Entry* entry = find(hostname);
+        if (entry)
+            entry->ttl = (now-entry->stored)+DNS_CACHE_TTL_NEGATIVE;
+    }
+
+    /**
+     * Removes a hostname from the cache, e.g. when the cached address
+     * can no longer be connected to.
+     * @param hostname  The hostname to remove, or nullptr to remove all entries.
+     */
+    void invalidate(const char* hostname)
+    {
+        Lock lock;
+        for (Entry& entry : table) {
+            if (!hostname || (entry.valid && !strcmp(entry.hostname, hostname)))
+                entry.valid = false;
+        }
+    }
+
+    void clear()
+    {
+        invalidate(nullptr);
+    }
+
+    /**
+     * Resolves a hostname, using the cache where possible.
+     *
+     * When an expired entry cannot be refreshed because the resolver fails,
+     * the last known good address is returned for up to DNS_CACHE_STALE_MAX
+     * and the entry is retried after DNS_CACHE_TTL_NEGATIVE.
+     *
+     * @param resolver  Called as {@code int resolver(const char* hostname, Address& address)}
+     *  on a cache miss, returning 0 on success.
+     * @return 0 on success, or the resolver error.
+     */
+    template <typename Resolver>
+    int resolve(const char* hostname, Address& address, Tick now, Resolver resolver)
+    {
+        int result = 0;
+        Address cached;
+        Status status = lookup(hostname, cached, result, now);
+        if (status==HIT) {
+            if (!result)
+                address = cached;
+            return result;
+        }
+
+        result = resolver(hostname, address);
+        if (!result)
+            store(hostname, address, 0, DNS_CACHE_TTL_DEFAULT, now);
+        else if (status==STALE) {
+            address = cached;
+            retry_later(hostname, now);
+            result = 0;
+        }
+        return result;
+    }
+};
+
+#endif	/* DNS_CACHE_H */
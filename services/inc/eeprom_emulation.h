@@ -0,0 +1,302 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef EEPROM_EMULATION_H
+#define	EEPROM_EMULATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Emulates byte-addressable EEPROM using two flash pages, in the format of
+ * ST application note AN3969.
+ *
+ * Each page starts with a 16-bit status. Writes are appended to the valid page
+ * as 4-byte records (16-bit data, 16-bit virtual address); the data is written
+ * before the address so a record interrupted by power loss is ignored. When the
+ * valid page is full, the latest values are copied to the other page.
+ *
+ * The latest value of each address is held in RAM, built once when the pages are
+ * loaded, so reads don't scan the flash.
+ *
+ * The store provides the same interface used by DCD:
+ *   int eraseSector(unsigned address)
+ *   int write(unsigned address, const void* data, unsigned size)
+ *   const uint8_t* dataAt(unsigned address)
+ */
+template <typename Store, unsigned pageSize, unsigned Page0, unsigned Page1, unsigned capacity>
+class EEPROMEmulation
+{
+public:
+    using Address = unsigned;
+    using Result = int;
+    using Page = uint8_t;
+
+    enum PageStatus
+    {
+        ERASED = 0xFFFF,
+        RECEIVE_DATA = 0xEEEE,
+        VALID_PAGE = 0x0000,
+    };
+
+    enum Errors
+    {
+        EEPROM_SUCCESS,
+        EEPROM_INVALID_ADDRESS = -100,
+        EEPROM_NO_VALID_PAGE = -101,
+    };
+
+    static const Page Page_0 = 0;
+    static const Page Page_1 = 1;
+    static const Page No_Page = 0xFF;
+
+    static const unsigned RecordSize = 4;
+    static const unsigned RecordCount = pageSize/RecordSize;     // including the page status
+
+    Store store;
+
+private:
+    uint8_t values[capacity];
+    Page validPage;
+    unsigned nextRecord;        // index of the next free record in the valid page
+
+    static Address addressOf(Page page)
+    {
+        return page==Page_0 ? Page0 : Page1;
+    }
+
+    static Page otherPage(Page page)
+    {
+        return page==Page_0 ? Page_1 : Page_0;
+    }
+
+    uint16_t status(Page page)
+    {
+        uint16_t result;
+        memcpy(&result, store.dataAt(addressOf(page)), sizeof(result));
+        return result;
+    }
+
+    Result setStatus(Page page, uint16_t value)
+    {
+        return store.write(addressOf(page), &value, sizeof(value));
+    }
+
+    Result erase(Page page)
+    {
+        const uint8_t* data = store.dataAt(addressOf(page));
+        for (unsigned i=0; i<pageSize; i++)
+        {
+            if (data[i]!=0xFF)
+                return store.eraseSector(addressOf(page));
+        }
+        return 0;
+    }
+
+    /**
+     * Applies the records in a page to the values.
+     * @return the index of the first free record.
+     */
+    unsigned load(Page page)
+    {
+        const uint8_t* data = store.dataAt(addressOf(page));
+        unsigned record = 1;
+        for (; record<RecordCount; record++)
+        {
+            uint16_t value, address;
+            memcpy(&value, data+record*RecordSize, sizeof(value));
+            memcpy(&address, data+record*RecordSize+2, sizeof(address));
+            if (value==0xFFFF && address==0xFFFF)
+                break;
+            if (address<capacity)
+                values[address] = uint8_t(value);
+        }
+        return record;
+    }
+
+    Result append(Page page, unsigned record, Address address, uint8_t value)
+    {
+        const Address location = addressOf(page)+record*RecordSize;
+        uint16_t data = value;
+        Result error = store.write(location, &data, sizeof(data));
+        if (!error) {
+            uint16_t virtualAddress = address;
+            error = store.write(location+2, &virtualAddress, sizeof(virtualAddress));
+        }
+        return error;
+    }
+
+    /**
+     * Writes the current values, with the given data applied, to the other page
+     * and makes it the valid page.
+     */
+    Result transfer(Page from, Address offset, const uint8_t* data, size_t length)
+    {
+        const Page to = otherPage(from);
+        Result error = erase(to);
+        if (!error)
+            error = setStatus(to, RECEIVE_DATA);
+        if (error)
+            return error;
+
+        unsigned record = 1;
+        for (Address address=0; address<capacity; address++)
+        {
+            uint8_t value = (address>=offset && address<offset+length) ? data[address-offset] : values[address];
+            if (value==0xFF)
+                continue;       // the same as an unwritten address
+            error = append(to, record++, address, value);
+            if (error) return error;
+        }
+
+        error = erase(from);
+        if (!error)
+            error = setStatus(to, VALID_PAGE);
+        if (error)
+            return error;
+
+        if (length)
+            memcpy(values+offset, data, length);
+        validPage = to;
+        nextRecord = record;
+        return EEPROM_SUCCESS;
+    }
+
+    Result format()
+    {
+        Result error = erase(Page_0);
+        if (!error)
+            error = setStatus(Page_0, VALID_PAGE);
+        if (!error)
+            error = erase(Page_1);
+        validPage = error ? No_Page : Page_0;
+        nextRecord = 1;
+        return error;
+    }
+
+public:
+
+    EEPROMEmulation() : validPage(No_Page), nextRecord(0)
+    {
+        memset(values, 0xFF, sizeof(values));
+    }
+
+    /**
+     * Restores the pages to a known good state after a power loss and loads
+     * the latest values.
+     */
+    Result init()
+    {
+        memset(values, 0xFF, sizeof(values));
+        validPage = No_Page;
+
+        const uint16_t status0 = status(Page_0);
+        const uint16_t status1 = status(Page_1);
+
+        if (status0==VALID_PAGE && status1==ERASED) {
+            validPage = Page_0;
+        }
+        else if (status0==ERASED && status1==VALID_PAGE) {
+            validPage = Page_1;
+        }
+        else if (status0==VALID_PAGE && status1==VALID_PAGE) {
+            // harmless invalid state - keep page 1
+            Result error = erase(Page_0);
+            if (error) return error;
+            validPage = Page_1;
+        }
+        else if ((status0==RECEIVE_DATA && status1==ERASED) || (status0==ERASED && status1==RECEIVE_DATA)) {
+            // the transfer completed but the page wasn't marked valid
+            Page receiving = status0==RECEIVE_DATA ? Page_0 : Page_1;
+            Result error = erase(otherPage(receiving));
+            if (!error)
+                error = setStatus(receiving, VALID_PAGE);
+            if (error) return error;
+            validPage = receiving;
+        }
+        else if ((status0==RECEIVE_DATA && status1==VALID_PAGE) || (status0==VALID_PAGE && status1==RECEIVE_DATA)) {
+            // interrupted transfer - redo it from the valid page
+            Page valid = status0==VALID_PAGE ? Page_0 : Page_1;
+            load(valid);
+            load(otherPage(valid));
+            return transfer(valid, 0, nullptr, 0);
+        }
+        else {
+            return format();
+        }
+
+        nextRecord = load(validPage);
+        return EEPROM_SUCCESS;
+    }
+
+    size_t length() const
+    {
+        return capacity;
+    }
+
+    uint8_t read(Address address) const
+    {
+        return address<capacity ? values[address] : 0xFF;
+    }
+
+    /**
+     * Copies a range of values.
+     */
+    Result read(Address address, void* data, size_t length) const
+    {
+        if (address>capacity || length>capacity-address)
+            return EEPROM_INVALID_ADDRESS;
+        memcpy(data, values+address, length);
+        return EEPROM_SUCCESS;
+    }
+
+    Result write(Address address, uint8_t value)
+    {
+        return write(address, &value, 1);
+    }
+
+    /**
+     * Writes a range of values. Only values that differ from the current values
+     * are written to flash.
+     */
+    Result write(Address address, const void* data, size_t length)
+    {
+        if (address>capacity || length>capacity-address)
+            return EEPROM_INVALID_ADDRESS;
+        if (validPage==No_Page)
+            return EEPROM_NO_VALID_PAGE;
+
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i=0; i<length; i++)
+        {
+            if (values[address+i]==bytes[i])
+                continue;
+            if (nextRecord>=RecordCount)
+                return transfer(validPage, address+i, bytes+i, length-i);
+
+            Result error = append(validPage, nextRecord++, address+i, bytes[i]);
+            if (error) return error;
+            values[address+i] = bytes[i];
+        }
+        return EEPROM_SUCCESS;
+    }
+};
+
+#endif	/* EEPROM_EMULATION_H */
@@ -0,0 +1,590 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef FAST_FLASH_H
+#define	FAST_FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * A windowed serial transfer protocol used in place of Ymodem when the sender supports it.
+ *
+ * Every frame is
+ *   type(1) seq(4) length(2) payload(length) crc32(4)
+ * with little-endian fields and the CRC covering the seq, length and payload.
+ *
+ * The sender opens with a HELLO frame (seq=version, payload=file length(4),
+ * block size(2), file name). The receiver replies with a HELLO frame giving
+ * the block size and window it accepts. The sender then streams up to `window`
+ * DATA frames ahead of the last acknowledgement, so the following blocks arrive
+ * while the receiver writes one. The receiver acknowledges each in-order block
+ * with ACK(next expected seq) once it is written, and cancels if the write fails,
+ * so every acknowledged block is in flash. A missing or corrupt block is answered
+ * with NAK(next expected seq) and the sender goes back to that block.
+ * END(block count) closes the transfer and is answered with END.
+ * CANCEL(error) from either side aborts.
+ *
+ * The HELLO type byte is not a valid Ymodem packet header, so a Ymodem receiver
+ * can recognize it and hand over, while a receiver without support ignores it
+ * and keeps asking for Ymodem. ACK is not the Ymodem acknowledgement, so one
+ * left over from a Ymodem exchange isn't taken for the start of a frame.
+ */
+
+#ifndef FAST_FLASH_BLOCK_SIZE
+#define FAST_FLASH_BLOCK_SIZE 2048
+#endif
+
+#ifndef FAST_FLASH_WINDOW
+#define FAST_FLASH_WINDOW 4
+#endif
+
+namespace FastFlash {
+
+const uint8_t VERSION = 1;
+
+enum FrameType
+{
+    HELLO = 0x16,       // SYN
+    DATA = 0x12,        // DC2
+    END = 0x17,         // ETB
+    ACK = 0x14,         // DC4
+    NAK = 0x15,
+    CANCEL = 0x18,
+};
+
+/**
+ * Error codes. The first three match the codes returned by the Ymodem receiver.
+ */
+enum Errors
+{
+    ERROR_PREPARE = -1,     // the receiver could not accept the file
+    ERROR_SAVE = -2,        // writing a block failed
+    ERROR_CANCELLED = -3,   // the other end cancelled
+    ERROR_TIMEOUT = -4,     // too many timeouts without progress
+    ERROR_MEMORY = -5,      // the receiver could not be allocated
+};
+
+enum
+{
+    HEADER_SIZE = 7,
+    TRAILER_SIZE = 4,
+    HELLO_SIZE = 6,         // fixed part of the sender's hello payload
+    MAX_ERRORS = 10,
+};
+
+inline uint16_t get16(const uint8_t* p)
+{
+    return p[0] | (p[1]<<8);
+}
+
+inline uint32_t get32(const uint8_t* p)
+{
+    return p[0] | (p[1]<<8) | (p[2]<<16) | (uint32_t(p[3])<<24);
+}
+
+inline void put16(uint8_t* p, uint16_t value)
+{
+    p[0] = value;
+    p[1] = value>>8;
+}
+
+inline void put32(uint8_t* p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value>>8;
+    p[2] = value>>16;
+    p[3] = value>>24;
+}
+
+/**
+ * Frames and deframes data over a channel.
+ *
+ * The channel provides
+ *   int read()                                      - the next byte, or -1 if none is available
+ *   size_t write(const uint8_t* data, size_t length)
+ *   uint32_t millis()
+ *   uint32_t crc32(const uint8_t* data, size_t length)
+ *
+ * @param rxPayload The largest payload that can be received.
+ * @param txPayload The largest payload that can be sent.
+ */
+template <typename Channel, unsigned rxPayload, unsigned txPayload>
+class Endpoint
+{
+    uint8_t rx[HEADER_SIZE+rxPayload+TRAILER_SIZE];
+    uint8_t tx[HEADER_SIZE+txPayload+TRAILER_SIZE];
+    size_t received;
+
+protected:
+    Channel& channel;
+
+    enum ReadResult
+    {
+        FRAME_NONE,
+        FRAME_OK,
+        FRAME_CORRUPT,
+    };
+
+    struct Frame
+    {
+        uint8_t type;
+        uint32_t seq;
+        uint16_t length;
+        uint8_t* payload;
+    };
+
+    Endpoint(Channel& channel_) : received(0), channel(channel_) {}
+
+    static bool is_frame_type(uint8_t c)
+    {
+        return c==HELLO || c==DATA || c==END || c==ACK || c==NAK || c==CANCEL;
+    }
+
+    /**
+     * Adds a received byte to the frame being assembled.
+     */
+    ReadResult accept(uint8_t c, Frame& frame)
+    {
+        if (!received && !is_frame_type(c))
+            return FRAME_NONE;      // resynchronize on the next frame type
+
+        rx[received++] = c;
+        if (received<HEADER_SIZE)
+            return FRAME_NONE;
+
+        uint16_t length = get16(rx+5);
+        if (length>rxPayload) {
+            received = 0;
+            return FRAME_CORRUPT;
+        }
+        if (received<size_t(HEADER_SIZE+length+TRAILER_SIZE))
+            return FRAME_NONE;
+
+        received = 0;
+        if (channel.crc32(rx+1, HEADER_SIZE-1+length)!=get32(rx+HEADER_SIZE+length))
+            return FRAME_CORRUPT;
+
+        frame.type = rx[0];
+        frame.seq = get32(rx+1);
+        frame.length = length;
+        frame.payload = rx+HEADER_SIZE;
+        return FRAME_OK;
+    }
+
+    /**
+     * Reads bytes from the channel until a frame is complete or no more data is available.
+     */
+    ReadResult read_frame(Frame& frame)
+    {
+        int c;
+        while ((c = channel.read())>=0) {
+            ReadResult result = accept(uint8_t(c), frame);
+            if (result!=FRAME_NONE)
+                return result;
+        }
+        return FRAME_NONE;
+    }
+
+    void send(uint8_t type, uint32_t seq, const uint8_t* payload=nullptr, uint16_t length=0)
+    {
+        if (length>txPayload)
+            length = txPayload;
+        tx[0] = type;
+        put32(tx+1, seq);
+        put16(tx+5, length);
+        if (length)
+            memcpy(tx+HEADER_SIZE, payload, length);
+        put32(tx+HEADER_SIZE+length, channel.crc32(tx+1, HEADER_SIZE-1+length));
+        channel.write(tx, HEADER_SIZE+length+TRAILER_SIZE);
+    }
+};
+
+/**
+ * Receives a file and passes each block to a sink.
+ *
+ * The sink provides
+ *   int prepare(const char* name, uint32_t length)  - 0 if the file can be received
+ *   int save(uint32_t offset, const uint8_t* data, uint16_t length) - 0 on success
+ */
+template <typename Channel, typename Sink, unsigned blockSize=FAST_FLASH_BLOCK_SIZE>
+class Receiver : public Endpoint<Channel, blockSize, 4>
+{
+    using Base = Endpoint<Channel, blockSize, 4>;
+    using Frame = typename Base::Frame;
+
+public:
+    enum State
+    {
+        WAIT_HELLO,
+        RECEIVING,
+        COMPLETE,
+        FAILED,
+    };
+
+private:
+    Sink& sink;
+    uint32_t timeout;
+    uint32_t last_activity;
+    uint32_t next;
+    uint32_t offset;
+    uint32_t file_length;
+    unsigned errors;
+    int error;
+    State state;
+    bool nak_sent;
+
+    void fail(int code)
+    {
+        this->send(CANCEL, uint32_t(code));
+        error = code;
+        state = FAILED;
+    }
+
+    void send_hello()
+    {
+        uint8_t params[3];
+        put16(params, blockSize);
+        params[2] = FAST_FLASH_WINDOW;
+        this->send(HELLO, VERSION, params, sizeof(params));
+    }
+
+    void nak()
+    {
+        if (!nak_sent) {
+            this->send(NAK, next);
+            nak_sent = true;
+        }
+    }
+
+    void handle_hello(Frame& frame)
+    {
+        if (state!=WAIT_HELLO) {
+            if (!next)
+                send_hello();   // our reply was lost
+            return;
+        }
+        if (frame.length<HELLO_SIZE) {
+            fail(ERROR_PREPARE);
+            return;
+        }
+        file_length = get32(frame.payload);
+        frame.payload[frame.length] = 0;    // terminate the name (overwrites the CRC)
+        if (sink.prepare((const char*)frame.payload+HELLO_SIZE, file_length)) {
+            fail(ERROR_PREPARE);
+            return;
+        }
+        state = RECEIVING;
+        send_hello();
+    }
+
+    void handle_data(const Frame& frame)
+    {
+        if (state!=RECEIVING)
+            return;
+        if (frame.seq<next) {
+            this->send(ACK, next);      // duplicate after a go-back
+            return;
+        }
+        if (frame.seq>next || !frame.length) {
+            nak();
+            return;
+        }
+        if (offset+frame.length>file_length) {
+            fail(ERROR_PREPARE);
+            return;
+        }
+        if (sink.save(offset, frame.payload, frame.length)) {
+            fail(ERROR_SAVE);
+            return;
+        }
+        offset += frame.length;
+        next++;
+        nak_sent = false;
+        this->send(ACK, next);
+    }
+
+    void handle_end(const Frame& frame)
+    {
+        if (state!=RECEIVING)
+            return;
+        if (frame.seq==next && offset==file_length) {
+            this->send(END, next);
+            state = COMPLETE;
+        }
+        else
+            nak();
+    }
+
+public:
+
+    Receiver(Channel& channel, Sink& sink_, uint32_t timeout_=1000) :
+        Base(channel), sink(sink_), timeout(timeout_), next(0), offset(0),
+        file_length(0), errors(0), error(0), state(WAIT_HELLO), nak_sent(false)
+    {
+        last_activity = channel.millis();
+    }
+
+    /**
+     * Supplies a byte that was already read from the channel, e.g. the
+     * frame type that identified this protocol.
+     */
+    void resume(uint8_t c)
+    {
+        Frame frame;
+        this->accept(c, frame);
+    }
+
+    /**
+     * Processes the data available on the channel.
+     */
+    State poll()
+    {
+        if (state>=COMPLETE)
+            return state;
+
+        Frame frame;
+        auto result = this->read_frame(frame);
+        uint32_t now = this->channel.millis();
+        if (result==Base::FRAME_NONE) {
+            if (now-last_activity>=timeout) {
+                last_activity = now;
+                if (++errors>MAX_ERRORS)
+                    fail(ERROR_TIMEOUT);
+                else if (state==RECEIVING) {
+                    nak_sent = false;
+                    nak();
+                }
+            }
+            return state;
+        }
+
+        last_activity = now;
+        if (result==Base::FRAME_CORRUPT) {
+            if (state==RECEIVING)
+                nak();
+            return state;
+        }
+
+        errors = 0;
+        switch (frame.type) {
+            case HELLO: handle_hello(frame); break;
+            case DATA: handle_data(frame); break;
+            case END: handle_end(frame); break;
+            case CANCEL:
+                error = ERROR_CANCELLED;
+                state = FAILED;
+                break;
+        }
+        return state;
+    }
+
+    /**
+     * Receives the file.
+     * @return the file length on success, otherwise one of the {@code Errors} values.
+     */
+    int32_t receive()
+    {
+        while (poll()<COMPLETE);
+        return state==COMPLETE ? int32_t(file_length) : error;
+    }
+
+    uint32_t received() const { return offset; }
+};
+
+/**
+ * Sends a file held in memory.
+ */
+template <typename Channel, unsigned maxBlockSize=FAST_FLASH_BLOCK_SIZE>
+class Sender : public Endpoint<Channel, 4, maxBlockSize>
+{
+    using Base = Endpoint<Channel, 4, maxBlockSize>;
+    using Frame = typename Base::Frame;
+
+public:
+    enum State
+    {
+        CONNECTING,
+        SENDING,
+        ENDING,
+        COMPLETE,
+        FAILED,
+    };
+
+private:
+    const uint8_t* data;
+    uint32_t length;
+    const char* name;
+    uint32_t timeout;
+    uint32_t last_progress;
+    uint32_t base;          // the first unacknowledged block
+    uint32_t next_send;
+    uint32_t count;
+    uint16_t block_size;
+    uint8_t window;
+    unsigned retries;
+    int error;
+    State state;
+
+    void send_hello()
+    {
+        uint8_t payload[maxBlockSize];
+        size_t name_length = strnlen(name, maxBlockSize-HELLO_SIZE);
+        put32(payload, length);
+        put16(payload+4, block_size);
+        memcpy(payload+HELLO_SIZE, name, name_length);
+        this->send(HELLO, VERSION, payload, HELLO_SIZE+name_length);
+    }
+
+    void send_block(uint32_t seq)
+    {
+        uint32_t offset = seq*block_size;
+        uint32_t size = length-offset<block_size ? length-offset : block_size;
+        this->send(DATA, seq, data+offset, size);
+    }
+
+    bool timed_out(uint32_t now)
+    {
+        if (now-last_progress<timeout)
+            return false;
+        last_progress = now;
+        if (++retries>MAX_ERRORS) {
+            error = ERROR_TIMEOUT;
+            state = FAILED;
+        }
+        return true;
+    }
+
+    void handle(const Frame& frame, uint32_t now)
+    {
+        switch (frame.type) {
+            case HELLO:
+                if (state==CONNECTING && frame.length>=3) {
+                    uint16_t accepted = get16(frame.payload);
+                    if (accepted && accepted<block_size)
+                        block_size = accepted;
+                    if (frame.payload[2] && frame.payload[2]<window)
+                        window = frame.payload[2];
+                    count = (length+block_size-1)/block_size;
+                    state = SENDING;
+                    last_progress = now;
+                    retries = 0;
+                }
+                break;
+            case ACK:
+                if (state==SENDING && frame.seq>base && frame.seq<=count) {
+                    base = frame.seq;
+                    if (next_send<base)
+                        next_send = base;
+                    last_progress = now;
+                    retries = 0;
+                }
+                break;
+            case NAK:
+                if ((state==SENDING || state==ENDING) && frame.seq>=base && frame.seq<=count) {
+                    base = next_send = frame.seq;
+                    state = SENDING;
+                }
+                break;
+            case END:
+                if (state==ENDING && frame.seq==count)
+                    state = COMPLETE;
+                break;
+            case CANCEL:
+                error = int(frame.seq);
+                state = FAILED;
+                break;
+        }
+    }
+
+public:
+
+    Sender(Channel& channel, const uint8_t* data_, uint32_t length_, const char* name_,
+            uint16_t block_size_=maxBlockSize, uint8_t window_=FAST_FLASH_WINDOW, uint32_t timeout_=2000) :
+        Base(channel), data(data_), length(length_), name(name_), timeout(timeout_),
+        base(0), next_send(0), count(0), block_size(block_size_ && block_size_<maxBlockSize ? block_size_ : maxBlockSize),
+        window(window_ ? window_ : 1), retries(0), error(0), state(CONNECTING)
+    {
+        last_progress = channel.millis()-timeout;
+    }
+
+    State poll()
+    {
+        if (state>=COMPLETE)
+            return state;
+
+        uint32_t now = this->channel.millis();
+        Frame frame;
+        typename Base::ReadResult result;
+        while ((result = this->read_frame(frame))!=Base::FRAME_NONE) {
+            if (result==Base::FRAME_OK)
+                handle(frame, now);
+            if (state>=COMPLETE)
+                return state;
+        }
+
+        switch (state) {
+            case CONNECTING:
+                if (timed_out(now) && state==CONNECTING)
+                    send_hello();
+                break;
+
+            case SENDING:
+                while (next_send<count && next_send<base+window)
+                    send_block(next_send++);
+                if (base==count) {
+                    state = ENDING;
+                    retries = 0;
+                    last_progress = now;
+                    this->send(END, count);
+                }
+                else if (timed_out(now))
+                    next_send = base;
+                break;
+
+            case ENDING:
+                if (timed_out(now) && state==ENDING)
+                    this->send(END, count);
+                break;
+
+            default:
+                break;
+        }
+        return state;
+    }
+
+    /**
+     * Sends the file.
+     * @return 0 on success, otherwise the error reported by the receiver or {@code ERROR_TIMEOUT}.
+     */
+    int send_file()
+    {
+        while (poll()<COMPLETE);
+        return state==COMPLETE ? 0 : error;
+    }
+
+    State current_state() const { return state; }
+    uint32_t acknowledged() const { return base; }
+    uint16_t negotiated_block_size() const { return block_size; }
+};
+
+}
+
+#endif	/* FAST_FLASH_H */
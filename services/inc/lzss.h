@@ -0,0 +1,290 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef LZSS_H
+#define	LZSS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * A compressed stream that can be expanded as it arrives with a small,
+ * fixed amount of RAM, used to send firmware images compressed.
+ *
+ * The stream is a header followed by groups of up to 8 items. Header fields
+ * are little-endian:
+ *   magic(4) version(1) window_bits(1) reserved(2) length(4)
+ * where length is the size of the expanded data.
+ *
+ * Each group starts with a byte of flags, one per item from the lowest bit.
+ * A clear flag is a literal byte. A set flag is a match of two bytes, read as
+ * a little-endian value of ((length-MIN_MATCH)<<window_bits) | (distance-1),
+ * which repeats length bytes starting distance bytes back. A match can
+ * overlap the bytes it produces.
+ *
+ * Expanding keeps the last 2^window_bits bytes in RAM; the window used by the
+ * compressor must be no larger than the expander's.
+ */
+
+#ifndef LZSS_WINDOW_BITS
+#define LZSS_WINDOW_BITS 11
+#endif
+
+#ifndef LZSS_BUFFER_SIZE
+#define LZSS_BUFFER_SIZE 256
+#endif
+
+namespace LZSS {
+
+const uint32_t MAGIC = 0x535A4C50;     // "PLZS"
+const uint8_t VERSION = 1;
+const size_t HEADER_SIZE = 12;
+const unsigned MIN_MATCH = 3;
+const unsigned MIN_WINDOW_BITS = 8;
+const unsigned MAX_WINDOW_BITS = 12;
+
+enum Errors
+{
+    ERROR_HEADER = -1,      // not a compressed stream, or a window larger than supported
+    ERROR_CORRUPT = -2,     // a match reaches back before the start, or the data is longer than the header says
+    ERROR_WRITE = -3,       // the sink failed to write
+    ERROR_INCOMPLETE = -4,  // the stream ended before all the data
+};
+
+inline uint32_t read_le32(const uint8_t* p)
+{
+    return p[0] | (p[1]<<8) | (p[2]<<16) | (uint32_t(p[3])<<24);
+}
+
+inline void write_le32(uint8_t* p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value>>8;
+    p[2] = value>>16;
+    p[3] = value>>24;
+}
+
+struct Header
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t window_bits;
+    uint32_t length;
+
+    void read(const uint8_t* p)
+    {
+        magic = read_le32(p);
+        version = p[4];
+        window_bits = p[5];
+        length = read_le32(p+8);
+    }
+
+    void write(uint8_t* p) const
+    {
+        memset(p, 0, HEADER_SIZE);
+        write_le32(p, magic);
+        p[4] = version;
+        p[5] = window_bits;
+        write_le32(p+8, length);
+    }
+
+    bool is_valid(unsigned max_window_bits=LZSS_WINDOW_BITS) const
+    {
+        return magic==MAGIC && version==VERSION && window_bits>=MIN_WINDOW_BITS && window_bits<=max_window_bits;
+    }
+};
+
+/**
+ * Expands a stream fed to it in pieces of any size.
+ * @param Sink  called as sink(offset, data, length) to write the next part of
+ *              the expanded data, returning 0 on success. Writes are
+ *              BUFFER_SIZE bytes except for the last, and come in order.
+ */
+template <typename Sink, unsigned WINDOW_BITS=LZSS_WINDOW_BITS, size_t BUFFER_SIZE=LZSS_BUFFER_SIZE>
+class Expander
+{
+    enum State
+    {
+        READ_HEADER,
+        READ_FLAGS,
+        READ_ITEM,
+        READ_MATCH,     // the second byte of a match
+        DONE,
+    };
+
+    static const uint32_t WINDOW_SIZE = 1<<WINDOW_BITS;
+
+    Sink& sink;
+    Header header_;
+    State state;
+    int error;
+    uint32_t received;      // header bytes so far
+    uint8_t flags;
+    uint8_t items;          // items left in the group
+    uint8_t low;            // the first byte of a match
+    uint32_t output;        // bytes written and buffered
+    size_t buffered;
+    uint8_t header_data[HEADER_SIZE];
+    uint8_t buffer[BUFFER_SIZE];
+    uint8_t window[WINDOW_SIZE];
+
+    int fail(int code)
+    {
+        error = code;
+        state = DONE;
+        return error;
+    }
+
+    int flush()
+    {
+        if (buffered) {
+            if (sink(output-buffered, buffer, buffered))
+                return fail(ERROR_WRITE);
+            buffered = 0;
+        }
+        return 0;
+    }
+
+    int emit(uint8_t b)
+    {
+        window[output & (WINDOW_SIZE-1)] = b;
+        buffer[buffered++] = b;
+        output++;
+        return buffered==BUFFER_SIZE ? flush() : 0;
+    }
+
+    int copy(uint16_t match)
+    {
+        uint32_t distance = (match & ((1<<header_.window_bits)-1)) + 1;
+        uint32_t length = (match >> header_.window_bits) + MIN_MATCH;
+        if (distance>output || length>header_.length-output)
+            return fail(ERROR_CORRUPT);
+        while (length--) {
+            if (emit(window[(output-distance) & (WINDOW_SIZE-1)]))
+                return error;
+        }
+        return 0;
+    }
+
+    /**
+     * Moves on to the next item, and finishes at the end of the data.
+     */
+    int next()
+    {
+        items--;
+        state = items ? READ_ITEM : READ_FLAGS;
+        if (output==header_.length) {
+            if (flush())
+                return error;
+            state = DONE;
+        }
+        return 0;
+    }
+
+public:
+
+    Expander(Sink& sink_)
+        : sink(sink_), state(READ_HEADER), error(0), received(0), flags(0),
+          items(0), low(0), output(0), buffered(0)
+    {
+    }
+
+    /**
+     * Expands the next part of the stream. Data after the end of the stream is ignored.
+     * @return 0 on success, or one of the Errors.
+     */
+    int feed(const uint8_t* data, size_t length)
+    {
+        const uint8_t* end = data+length;
+        while (data<end && state!=DONE) {
+            switch (state) {
+            case READ_HEADER:
+                header_data[received++] = *data++;
+                if (received==HEADER_SIZE) {
+                    header_.read(header_data);
+                    if (!header_.is_valid(WINDOW_BITS))
+                        return fail(ERROR_HEADER);
+                    items = 1;
+                    if (next())
+                        return error;
+                }
+                break;
+
+            case READ_FLAGS:
+                flags = *data++;
+                items = 8;
+                state = READ_ITEM;
+                break;
+
+            case READ_ITEM:
+                if (flags & 1) {
+                    low = *data++;
+                    state = READ_MATCH;
+                }
+                else if (emit(*data++) || next())
+                    return error;
+                flags >>= 1;
+                break;
+
+            case READ_MATCH:
+                if (copy(low | (*data++<<8)) || next())
+                    return error;
+                break;
+
+            case DONE:
+                break;
+            }
+        }
+        return error;
+    }
+
+    /**
+     * Called when the stream has all been fed.
+     * @return 0 when all the data has been expanded, or one of the Errors.
+     */
+    int finish()
+    {
+        if (!error && !done())
+            fail(ERROR_INCOMPLETE);
+        return error;
+    }
+
+    bool done() const
+    {
+        return state==DONE && !error;
+    }
+
+    /**
+     * The header, once the first HEADER_SIZE bytes have been fed.
+     */
+    const Header& header() const
+    {
+        return header_;
+    }
+
+    uint32_t written() const
+    {
+        return output-buffered;
+    }
+};
+
+}
+
+#endif	/* LZSS_H */
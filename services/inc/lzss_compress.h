@@ -0,0 +1,170 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef LZSS_COMPRESS_H
+#define	LZSS_COMPRESS_H
+
+/**
+ * Makes the streams expanded by LZSS::Expander. This runs on the host (the
+ * compression tool and the unit tests), not on the device.
+ *
+ * Matches are found through hash chains of the positions where each 3 byte
+ * sequence occurs in the window. A match is put off by a byte when a longer
+ * one starts at the next position.
+ */
+
+#include "lzss.h"
+#include <vector>
+
+namespace LZSS {
+
+class Compressor
+{
+    static const unsigned HASH_BITS = 16;
+    static const unsigned MAX_CHAIN = 256;
+
+    const uint8_t* data;
+    size_t length;
+    unsigned window_bits;
+    size_t window;
+    size_t max_match;
+
+    std::vector<int32_t> head;
+    std::vector<int32_t> prev;
+    size_t inserted;
+
+    std::vector<uint8_t> out;
+    size_t flags_at;
+    unsigned item;
+
+    unsigned hash(size_t i) const
+    {
+        uint32_t v = data[i] | (data[i+1]<<8) | (data[i+2]<<16);
+        return (v*2654435761u) >> (32-HASH_BITS);
+    }
+
+    void insert_until(size_t end)
+    {
+        for (; inserted<end; inserted++) {
+            if (inserted+MIN_MATCH<=length) {
+                unsigned h = hash(inserted);
+                prev[inserted] = head[h];
+                head[h] = inserted;
+            }
+        }
+    }
+
+    /**
+     * The longest match for the data at i, or 0 when there's none.
+     */
+    size_t find(size_t i, size_t& distance)
+    {
+        insert_until(i);
+        if (i+MIN_MATCH>length)
+            return 0;
+        size_t limit = std::min(max_match, length-i);
+        size_t best = 0;
+        unsigned chain = MAX_CHAIN;
+        for (int32_t c = head[hash(i)]; c>=0 && i-c<=window && chain--; c = prev[c]) {
+            size_t n = 0;
+            while (n<limit && data[c+n]==data[i+n])
+                n++;
+            if (n>best) {
+                best = n;
+                distance = i-c;
+                if (n==limit)
+                    break;
+            }
+        }
+        return best>=MIN_MATCH ? best : 0;
+    }
+
+    void start_item()
+    {
+        if (item==8) {
+            flags_at = out.size();
+            out.push_back(0);
+            item = 0;
+        }
+    }
+
+    void literal(uint8_t b)
+    {
+        start_item();
+        out.push_back(b);
+        item++;
+    }
+
+    void match(size_t n, size_t distance)
+    {
+        start_item();
+        out[flags_at] |= 1<<item;
+        uint16_t value = ((n-MIN_MATCH)<<window_bits) | (distance-1);
+        out.push_back(value);
+        out.push_back(value>>8);
+        item++;
+    }
+
+public:
+
+    Compressor(const uint8_t* data_, size_t length_, unsigned window_bits_=LZSS_WINDOW_BITS)
+        : data(data_), length(length_), window_bits(window_bits_), window(size_t(1)<<window_bits_),
+          max_match(MIN_MATCH+(1<<(16-window_bits_))-1), head(1<<HASH_BITS, -1), prev(length_, -1),
+          inserted(0), flags_at(0), item(8)
+    {
+    }
+
+    std::vector<uint8_t> make()
+    {
+        out.assign(HEADER_SIZE, 0);
+        Header header;
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.window_bits = window_bits;
+        header.length = length;
+        header.write(out.data());
+
+        size_t i = 0;
+        while (i<length) {
+            size_t distance = 0, next_distance = 0;
+            size_t n = find(i, distance);
+            if (n && n<max_match && find(i+1, next_distance)>n)
+                n = 0;
+            if (n) {
+                match(n, distance);
+                i += n;
+            }
+            else
+                literal(data[i++]);
+        }
+        return out;
+    }
+};
+
+/**
+ * Compresses data with a window of 2^window_bits bytes.
+ */
+inline std::vector<uint8_t> compress(const uint8_t* data, size_t length, unsigned window_bits=LZSS_WINDOW_BITS)
+{
+    return Compressor(data, length, window_bits).make();
+}
+
+}
+
+#endif	/* LZSS_COMPRESS_H */
@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef VALIDATED_MODULES_H
+#define	VALIDATED_MODULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "static_assert.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/**
+ * A module whose CRC has been verified, identified by where it is, its length,
+ * the CRC of its module_info header and the CRC stored after it.
+ */
+typedef struct validated_module {
+    uint32_t start_address;         // 0 or 0xFFFFFFFF when unused
+    uint32_t length;
+    uint32_t info_crc;
+    uint32_t crc;
+} validated_module_t;
+
+STATIC_ASSERT(validated_module_size, sizeof(validated_module_t)==16);
+
+static inline bool validated_module_unused(const validated_module_t* module)
+{
+    return module->start_address == 0 || module->start_address == 0xFFFFFFFF;
+}
+
+/**
+ * Checks a module, computing its CRC only when it isn't among the records of
+ * modules already validated.
+ *
+ * @param modules   the records. A newly validated module replaces the record
+ *  for the module previously at its address, else an unused record, else the last.
+ * @param count     the number of records
+ * @param module    the module to check
+ * @param verify    computes the module's CRC, returning true if it matches
+ * @param updated   set to the index of the record replaced, or -1 when the
+ *  records are unchanged
+ * @return true if the module is valid.
+ */
+static inline bool validated_modules_check(validated_module_t* modules, unsigned count,
+        const validated_module_t* module, bool (*verify)(const validated_module_t* module), int* updated)
+{
+    *updated = -1;
+    unsigned index;
+    for (index = 0; index < count; index++)
+    {
+        if (memcmp(&modules[index], module, sizeof(*module)) == 0)
+        {
+            return true;
+        }
+    }
+
+    if (!verify(module))
+    {
+        return false;
+    }
+
+    unsigned slot = count - 1;
+    for (index = count; index-- > 0; )
+    {
+        if (modules[index].start_address == module->start_address)
+        {
+            slot = index;
+            break;
+        }
+        if (validated_module_unused(&modules[index]))
+        {
+            slot = index;
+        }
+    }
+    modules[slot] = *module;
+    *updated = slot;
+    return true;
+}
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* VALIDATED_MODULES_H */
@@ -0,0 +1,129 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef SYSTEM_COMPRESSED_UPDATE_H
+#define	SYSTEM_COMPRESSED_UPDATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lzss.h"
+
+/**
+ * Expands a compressed firmware image (services/inc/lzss.h) into the OTA
+ * region as its chunks arrive.
+ *
+ * The compressed file has a place at the end of the region, but a chunk is
+ * only written there when it arrives after a gap, as happens when a chunk is
+ * lost during a fast OTA update. Chunks that arrive in order are expanded
+ * directly. What was stored is expanded when the transfer is complete, so
+ * lost chunks don't mean sending those after them again. The image must not
+ * grow into a stored chunk, as flash can't be rewritten without an erase.
+ *
+ * @param Flash provides
+ *  int write(uint32_t address, const uint8_t* data, uint32_t length), returning 0 on success
+ *  const uint8_t* read(uint32_t address), for the data written to the region
+ */
+template <typename Flash>
+class CompressedUpdate
+{
+    struct Sink
+    {
+        Flash& flash;
+        uint32_t address;
+        uint32_t limit;     // the lowest chunk stored
+
+        Sink(Flash& flash_, uint32_t address_, uint32_t limit_)
+            : flash(flash_), address(address_), limit(limit_) {}
+
+        int operator()(uint32_t offset, const uint8_t* data, size_t length)
+        {
+            if (address+offset+length>limit)
+                return -1;
+            return flash.write(address+offset, data, length);
+        }
+    };
+
+    Flash& flash;
+    Sink sink;
+    LZSS::Expander<Sink> expander;
+    uint32_t file_address;
+    uint32_t file_length;
+    uint32_t expanded;      // compressed bytes expanded, from the start of the file
+
+public:
+
+    /**
+     * @param image_address where to write the image
+     * @param region_end    the end of the region the image is written to
+     * @param file_address  where chunks that arrive after a gap are stored
+     * @param file_length   the length of the compressed file
+     */
+    CompressedUpdate(Flash& flash_, uint32_t image_address, uint32_t region_end,
+            uint32_t file_address_, uint32_t file_length_)
+        : flash(flash_), sink(flash_, image_address, region_end), expander(sink),
+          file_address(file_address_), file_length(file_length_), expanded(0)
+    {
+    }
+
+    /**
+     * Saves a chunk of the compressed file.
+     * @param address   where the chunk is in the file, as file_address plus its offset
+     * @return 0 on success, or one of the LZSS::Errors when the image can't be expanded.
+     */
+    int save(uint32_t address, const uint8_t* data, uint32_t length)
+    {
+        uint32_t offset = address-file_address;
+        if (offset==expanded) {
+            expanded += length;
+            return expander.feed(data, length);
+        }
+        if (offset>expanded && offset<file_length) {
+            if (address<sink.address+expander.written())
+                return LZSS::ERROR_WRITE;
+            if (address<sink.limit)
+                sink.limit = address;
+            return flash.write(address, data, length);
+        }
+        return 0;   // sent again after it was expanded
+    }
+
+    /**
+     * Expands the rest of the file when all the chunks have been saved.
+     * @return 0 when the whole image has been written, or one of the LZSS::Errors.
+     */
+    int finish()
+    {
+        int result = 0;
+        if (expanded<file_length)
+            result = expander.feed(flash.read(file_address+expanded), file_length-expanded);
+        if (!result)
+            result = expander.finish();
+        return result;
+    }
+
+    /**
+     * The length of the image, from the header of the compressed file.
+     */
+    uint32_t image_length() const
+    {
+        return expander.header().length;
+    }
+};
+
+#endif	/* SYSTEM_COMPRESSED_UPDATE_H */
@@ -33,6 +33,7 @@
 #include "system_update.h"
 #include "system_event.h"
 #include "system_version.h"
+#include "system_timeline.h"
 #endif
 
 DYNALIB_BEGIN(system)
@@ -54,6 +55,8 @@ DYNALIB_FN(system, system_version_info)
 DYNALIB_FN(system, system_internal)
 DYNALIB_FN(system, system_set_flag)
 DYNALIB_FN(system, system_get_flag)
+DYNALIB_FN(system, system_timeline_get)
+DYNALIB_FN(system, system_timeline_format)
 DYNALIB_END(system)
 
 
@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef SYSTEM_TIMELINE_H
+#define	SYSTEM_TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "system_tick_hal.h"
+#include "static_assert.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/**
+ * The milestones passed between reset and the cloud connection being established.
+ * New values must be added before SYSTEM_MILESTONE_MAX.
+ */
+typedef enum
+{
+    SYSTEM_MILESTONE_SYSTEM_START = 0,      // app_setup_and_loop() entered
+    SYSTEM_MILESTONE_NETWORK_SETUP = 1,     // Network_Setup() complete
+    SYSTEM_MILESTONE_NETWORK_CONNECT = 2,   // connecting to the network
+    SYSTEM_MILESTONE_NETWORK_CONNECTED = 3, // joined the network (WiFi associated or PDP context active)
+    SYSTEM_MILESTONE_NETWORK_READY = 4,     // IP address assigned
+    SYSTEM_MILESTONE_CLOUD_CONNECT = 5,     // starting the cloud connection
+    SYSTEM_MILESTONE_CLOUD_SOCKET = 6,      // cloud socket created/connected
+    SYSTEM_MILESTONE_CLOUD_SECURED = 7,     // secure channel established (DTLS handshake or session restored)
+    SYSTEM_MILESTONE_CLOUD_HELLO = 8,       // hello exchange complete
+    SYSTEM_MILESTONE_CLOUD_CONNECTED = 9,   // system handshake events sent - breathing cyan
+    SYSTEM_MILESTONE_MAX = 10
+} system_milestone_t;
+
+typedef struct
+{
+    uint16_t size;
+    /**
+     * Set when the secure channel was established by restoring a saved session.
+     */
+    uint8_t session_resumed;
+    uint8_t reserved;
+
+    /**
+     * The time each milestone was first reached, in milliseconds since reset.
+     * 0 if the milestone has not been reached.
+     */
+    system_tick_t milestone[SYSTEM_MILESTONE_MAX];
+} system_timeline_t;
+
+STATIC_ASSERT(system_timeline_size, sizeof(system_timeline_t)==4+(SYSTEM_MILESTONE_MAX*sizeof(system_tick_t)));
+
+/**
+ * Records the time a milestone was reached. Only the first time each milestone
+ * is reached after reset is recorded.
+ */
+void system_timeline_mark(system_milestone_t milestone, void* reserved);
+
+/**
+ * Retrieves the timeline.
+ * @param timeline  Receives the timeline. The size field must be set by the caller.
+ * @param previous  When true, retrieves the timeline from before the last reset.
+ *  This is only available on devices with retained memory.
+ * @return 0 on success.
+ */
+int system_timeline_get(system_timeline_t* timeline, bool previous, void* reserved);
+
+/**
+ * Writes the timeline as a JSON object to the given buffer, e.g.
+ * {@code {"start":12,"net_setup":15,...}}. Milestones that were not reached are omitted.
+ * Nothing is written when the timeline's size doesn't cover the header.
+ * @return The length of the formatted text, excluding the null terminator.
+ */
+size_t system_timeline_format(const system_timeline_t* timeline, char* buf, size_t length);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SYSTEM_TIMELINE_H */
@@ -38,6 +38,7 @@
 #include "system_threading.h"
 #include "system_user.h"
 #include "system_update.h"
+#include "system_timeline_internal.h"
 #include "core_hal.h"
 #include "syshealth_hal.h"
 #include "watchdog_hal.h"
@@ -502,6 +503,7 @@ void system_part2_post_init()
  *******************************************************************************/
 void app_setup_and_loop(void)
 {
+    system_timeline_begin();
     system_part2_post_init();
     HAL_Core_Init();
     // We have running firmware, otherwise we wouldn't have gotten here
@@ -525,6 +527,7 @@ void app_setup_and_loop(void)
       (system_mode()!=SAFE_MODE);
 
     Network_Setup(threaded);
+    system_timeline_mark(SYSTEM_MILESTONE_NETWORK_SETUP, nullptr);
 
 #if PLATFORM_THREADING
     if (threaded)
@@ -43,6 +43,11 @@
 #include "hal_platform.h"
 #include "system_string_interpolate.h"
 #include "dtls_session_persist.h"
+#include "system_timeline_internal.h"
+#include "spark_wiring_platform.h"
+#if Wiring_Cellular
+#include "cellular_hal.h"
+#endif
 
 #define IPNUM(ip)       ((ip)>>24)&0xff,((ip)>>16)&0xff,((ip)>> 8)&0xff,((ip)>> 0)&0xff
 
@@ -432,6 +437,35 @@ int Spark_Restore(void* buffer, size_t max_length, uint8_t type, void* reserved)
 }
 #endif
 
+void Spark_Notify_Handshake(uint8_t event, void* reserved)
+{
+	switch (event)
+	{
+	case SparkCallbacks::HANDSHAKE_SESSION_RESUMED:
+		system_timeline_session_resumed();
+		// fall through
+	case SparkCallbacks::HANDSHAKE_SECURED:
+		system_timeline_mark(SYSTEM_MILESTONE_CLOUD_SECURED, nullptr);
+		break;
+	case SparkCallbacks::HANDSHAKE_HELLO_COMPLETE:
+		system_timeline_mark(SYSTEM_MILESTONE_CLOUD_HELLO, nullptr);
+		break;
+	}
+}
+
+#if Wiring_Cellular
+STATIC_ASSERT(data_categories_match, int(SparkCallbacks::DATA_RETRANSMIT)==CELLULAR_DATA_RETRANSMIT &&
+		int(SparkCallbacks::DATA_OTHER)==CELLULAR_DATA_OTHER);
+
+/**
+ * Attributes the cloud connection's share of the data counted by the modem.
+ */
+void Spark_Notify_Data(uint8_t category, bool sent, size_t bytes, size_t security, void* reserved)
+{
+	cellular_data_usage_cloud(category, sent, bytes, security, nullptr);
+}
+#endif
+
 void Spark_Protocol_Init(void)
 {
 	system_cloud_protocol_instance();
@@ -486,6 +520,10 @@ void Spark_Protocol_Init(void)
         callbacks.signal = Spark_Signal;
         callbacks.millis = HAL_Timer_Get_Milli_Seconds;
         callbacks.set_time = system_set_time;
+        callbacks.notify_handshake = Spark_Notify_Handshake;
+#if Wiring_Cellular
+        callbacks.notify_data = Spark_Notify_Data;
+#endif
 
         SparkDescriptor descriptor;
         memset(&descriptor, 0, sizeof(descriptor));
@@ -734,6 +772,14 @@ int determine_session_connection_address(IPAddress& ip_addr, uint16_t& port, Ser
 }
 #endif
 
+/**
+ * Expands the device ID and other variables in the server domain name.
+ */
+static void cloud_server_hostname(const ServerAddress& server_addr, char* buf, size_t length)
+{
+    system_string_interpolate(server_addr.domain, buf, length, system_interpolate);
+}
+
 /**
  */
 int determine_connection_address(IPAddress& ip_addr, uint16_t& port, ServerAddress& server_addr, bool udp)
@@ -780,7 +826,7 @@ int determine_connection_address(IPAddress& ip_addr, uint16_t& port, ServerAddre
             		port = server_addr.port;
 
             char buf[96];
-            system_string_interpolate(server_addr.domain, buf, sizeof(buf), system_interpolate);
+            cloud_server_hostname(server_addr, buf, sizeof(buf));
             int attempts = 3;
             int rv = 0;
             while (!ip_addr && attempts-->0)
@@ -887,7 +933,16 @@ int Spark_Connect()
         }
     }
     if (rv)     // error - prevent socket leaks
+    {
         Spark_Disconnect();
+        if (!ip_address_error && server_addr.addr_type!=IP_ADDRESS)
+        {
+            // the resolved address may be out of date - look it up again next time
+            char buf[96];
+            cloud_server_hostname(server_addr, buf, sizeof(buf));
+            inet_dns_cache_invalidate(buf, NIF_DEFAULT, NULL);
+        }
+    }
     return rv;
 }
 
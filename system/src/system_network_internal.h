@@ -26,6 +26,7 @@
 #include "system_event.h"
 #include "system_cloud_internal.h"
 #include "system_network.h"
+#include "system_timeline.h"
 
 
 enum eWanTimings
@@ -305,6 +306,7 @@ public:
                 WLAN_CONNECTING = 1;
                 LED_SetRGBColor(RGB_COLOR_GREEN);
                 ARM_WLAN_WD(CONNECT_TO_ADDRESS_MAX);    // reset the network if it doesn't connect within the timeout
+                system_timeline_mark(SYSTEM_MILESTONE_NETWORK_CONNECT, nullptr);
                 connect_finalize();
             }
         }
@@ -384,6 +386,7 @@ public:
 
     void notify_connected()
     {
+        system_timeline_mark(SYSTEM_MILESTONE_NETWORK_CONNECTED, nullptr);
         WLAN_CONNECTED = 1;
         WLAN_CONNECTING = 0;
         if (!WLAN_DISCONNECT)
@@ -432,6 +435,7 @@ public:
         }
         if (dhcp)
         {
+            system_timeline_mark(SYSTEM_MILESTONE_NETWORK_READY, nullptr);
             LED_On(LED_RGB);
             CLR_WLAN_WD();
             WLAN_DHCP = 1;
@@ -25,6 +25,7 @@
 #include "system_network.h"
 #include "system_network_internal.h"
 #include "system_update.h"
+#include "system_timeline.h"
 #include "spark_macros.h"
 #include "string.h"
 #include "system_tick_hal.h"
@@ -211,9 +212,11 @@ void establish_cloud_connection()
 
         INFO("Cloud: connecting");
         LED_On(LED_RGB);
+        system_timeline_mark(SYSTEM_MILESTONE_CLOUD_CONNECT, nullptr);
         int connect_result = Spark_Connect();
         if (connect_result >= 0)
         {
+            system_timeline_mark(SYSTEM_MILESTONE_CLOUD_SOCKET, nullptr);
             cfod_count = 0;
             SPARK_CLOUD_SOCKETED = 1;
             INFO("Cloud socket connected");
@@ -232,6 +235,20 @@ void establish_cloud_connection()
     }
 }
 
+void log_timeline()
+{
+#if defined(DEBUG_BUILD)
+    system_timeline_t timeline;
+    timeline.size = sizeof(timeline);
+    if (!system_timeline_get(&timeline, false, nullptr))
+    {
+        char buf[256];
+        system_timeline_format(&timeline, buf, sizeof(buf));
+        INFO("Timeline: %s", buf);
+    }
+#endif
+}
+
 int cloud_handshake()
 {
 	bool udp = HAL_Feature_Get(FEATURE_CLOUD_UDP);
@@ -273,6 +290,8 @@ void handle_cloud_connection(bool force_events)
             else
             {
                 INFO("Cloud connected");
+                system_timeline_mark(SYSTEM_MILESTONE_CLOUD_CONNECTED, nullptr);
+                log_timeline();
                 SPARK_CLOUD_CONNECTED = 1;
                 cloud_failed_connection_attempts = 0;
             }
@@ -0,0 +1,106 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "system_timeline.h"
+#include "system_timeline_internal.h"
+#include "timer_hal.h"
+#include "retained_block.h"
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * The timeline for the current boot is kept in retained memory so that it
+ * can be inspected after a reset, e.g. when the watchdog fires before the
+ * cloud connection completes.
+ */
+static retained_system RetainedBlock<system_timeline_t, 0x7E1A1EB0> current;
+static system_timeline_t previous;
+
+static const char* const milestone_names[SYSTEM_MILESTONE_MAX] = {
+    "start", "net_setup", "net_connect", "net_connected", "net_ready",
+    "cloud_connect", "cloud_socket", "cloud_secured", "cloud_hello", "cloud_connected"
+};
+
+void system_timeline_begin()
+{
+    memset(&previous, 0, sizeof(previous));
+    if (current.is_valid())
+        previous = current.data;
+
+    current.clear();
+    system_timeline_mark(SYSTEM_MILESTONE_SYSTEM_START, nullptr);
+}
+
+void system_timeline_session_resumed()
+{
+    current.data.session_resumed = true;
+}
+
+void system_timeline_mark(system_milestone_t milestone, void* reserved)
+{
+    if (milestone<SYSTEM_MILESTONE_MAX && !current.data.milestone[milestone])
+    {
+        system_tick_t now = HAL_Timer_Get_Milli_Seconds();
+        current.data.milestone[milestone] = now ? now : 1;
+    }
+}
+
+int system_timeline_get(system_timeline_t* timeline, bool previous_boot, void* reserved)
+{
+    const system_timeline_t& source = previous_boot ? previous : current.data;
+    if (!timeline || !source.size)
+        return -1;
+
+    size_t size = timeline->size<sizeof(source) ? timeline->size : sizeof(source);
+    memcpy(timeline, &source, size);
+    timeline->size = size;
+    return 0;
+}
+
+size_t system_timeline_format(const system_timeline_t* timeline, char* buf, size_t length)
+{
+    if (timeline->size<offsetof(system_timeline_t, milestone))
+    {
+        if (length)
+            *buf = 0;
+        return 0;
+    }
+    size_t count = (timeline->size-offsetof(system_timeline_t, milestone))/sizeof(system_tick_t);
+    if (count>SYSTEM_MILESTONE_MAX)
+        count = SYSTEM_MILESTONE_MAX;
+
+    size_t written = 0;
+    auto append = [&](const char* name, unsigned value) {
+        int n = snprintf(written<length ? buf+written : nullptr, written<length ? length-written : 0,
+                "%s\"%s\":%u", written ? "," : "{", name, value);
+        if (n>0)
+            written += n;
+    };
+
+    for (size_t i=0; i<count; i++)
+    {
+        if (timeline->milestone[i])
+            append(milestone_names[i], timeline->milestone[i]);
+    }
+    append("resumed", timeline->session_resumed);
+    int n = snprintf(written<length ? buf+written : nullptr, written<length ? length-written : 0, "}");
+    if (n>0)
+        written += n;
+    return written;
+}
@@ -39,6 +39,7 @@
 #include "system_version.h"
 #include "spark_macros.h"
 #include "system_network_internal.h"
+#include "system_compressed_update.h"
 
 #ifdef START_DFU_FLASHER_SERIAL_SPEED
 static uint32_t start_dfu_flasher_serial_speed = START_DFU_FLASHER_SERIAL_SPEED;
@@ -180,9 +181,45 @@ uint32_t timeRemaining(uint32_t start, uint32_t duration)
     return (elapsed>=duration) ? 0 : duration-elapsed;
 }
 
+/**
+ * Compressed chunks that arrive out of order and delta patches are read back
+ * from the OTA region, so need it memory mapped.
+ */
+#define COMPRESSED_UPDATES_SUPPORTED HAL_OTA_MEMORY_MAPPED
+#define DELTA_UPDATES_SUPPORTED HAL_OTA_MEMORY_MAPPED
+
+struct OTAFlash
+{
+    int write(uint32_t address, const uint8_t* data, uint32_t length)
+    {
+        return HAL_FLASH_Update(data, address, length, NULL);
+    }
+
+    const uint8_t* read(uint32_t address)
+    {
+        return (const uint8_t*)address;
+    }
+};
+
+static OTAFlash ota_flash;
+static CompressedUpdate<OTAFlash>* compressed_update;
+
+static bool is_firmware(const FileTransfer::Descriptor& file)
+{
+    return file.store==FileTransfer::Store::FIRMWARE || file.store==FileTransfer::Store::FIRMWARE_COMPRESSED;
+}
+
+/**
+ * Patches and compressed images are stored apart from the module they make.
+ */
+static bool is_stored_at_end(const FileTransfer::Descriptor& file)
+{
+    return is_firmware(file) && ((file.flags & FileTransfer::Flags::DELTA) || file.store==FileTransfer::Store::FIRMWARE_COMPRESSED);
+}
+
 int Spark_Prepare_For_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags, void* reserved)
 {
-    if (file.store==FileTransfer::Store::FIRMWARE)
+    if (is_firmware(file))
     {
         // address is relative to the OTA region. Normally will be 0.
         file.file_address = HAL_OTA_FlashAddress() + file.chunk_address;
@@ -192,6 +229,19 @@ int Spark_Prepare_For_Firmware_Update(FileTransfer::Descriptor& file, uint32_t f
             file.chunk_size = HAL_OTA_ChunkSize();
             file.file_length = HAL_OTA_FlashLength();
         }
+
+        // a patch or compressed image is stored at the end of the OTA region,
+        // and the module it makes is written to the start.
+        if (is_stored_at_end(file)) {
+            if (file.file_length>HAL_OTA_FlashLength())
+                return 1;
+            if ((file.flags & FileTransfer::Flags::DELTA) && !DELTA_UPDATES_SUPPORTED)
+                return 1;
+            if (file.store==FileTransfer::Store::FIRMWARE_COMPRESSED &&
+                    (!COMPRESSED_UPDATES_SUPPORTED || (file.flags & FileTransfer::Flags::DELTA)))
+                return 1;
+            file.file_address = HAL_OTA_FlashAddress() + ((HAL_OTA_FlashLength()-file.file_length) & ~3);
+        }
     }
     int result = 0;
     if (flags & 1) {
@@ -209,7 +259,19 @@ int Spark_Prepare_For_Firmware_Update(FileTransfer::Descriptor& file, uint32_t f
             SPARK_FLASH_UPDATE = 1;
             TimingFlashUpdateTimeout = 0;
             system_notify_event(firmware_update, firmware_update_begin, &file);
-            HAL_FLASH_Begin(file.file_address, file.file_length, NULL);
+            if (is_stored_at_end(file))
+                HAL_FLASH_Begin(HAL_OTA_FlashAddress(), HAL_OTA_FlashLength(), NULL);
+            else
+                HAL_FLASH_Begin(file.file_address, file.file_length, NULL);
+
+            delete compressed_update;
+            compressed_update = NULL;
+            if (file.store==FileTransfer::Store::FIRMWARE_COMPRESSED) {
+                compressed_update = new CompressedUpdate<OTAFlash>(ota_flash, HAL_OTA_FlashAddress(),
+                    HAL_OTA_FlashAddress()+HAL_OTA_FlashLength(), file.file_address, file.file_length);
+                if (!compressed_update)
+                    result = 1;
+            }
         }
         else
             result = 1;     // updates disabled
@@ -260,9 +322,16 @@ int Spark_Finish_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags,
 
 
     if (flags & 1) {    // update successful
-        if (file.store==FileTransfer::Store::FIRMWARE)
+        if (is_firmware(file))
         {
-            hal_update_complete_t result = HAL_FLASH_End(NULL);
+            hal_update_complete_t result = HAL_UPDATE_ERROR;
+            bool complete = true;
+            if (file.store==FileTransfer::Store::FIRMWARE_COMPRESSED)
+                complete = compressed_update && !compressed_update->finish();
+            else if (file.flags & FileTransfer::Flags::DELTA)
+                complete = !HAL_FLASH_ApplyPatch(file.file_address, file.file_length, NULL);
+            if (complete)
+                result = HAL_FLASH_End(NULL);
             system_notify_event(firmware_update, result!=HAL_UPDATE_ERROR ? firmware_update_complete : firmware_update_failed, &file);
 
 
@@ -276,6 +345,8 @@ int Spark_Finish_Firmware_Update(FileTransfer::Descriptor& file, uint32_t flags,
     {
         system_notify_event(firmware_update, firmware_update_failed, &file);
     }
+    delete compressed_update;
+    compressed_update = NULL;
     RGB.control(false);
     return 0;
 }
@@ -290,6 +361,11 @@ int Spark_Save_Firmware_Chunk(FileTransfer::Descriptor& file, const uint8_t* chu
         result = HAL_FLASH_Update(chunk, file.chunk_address, file.chunk_size, NULL);
         LED_Toggle(LED_RGB);
     }
+    else if (file.store==FileTransfer::Store::FIRMWARE_COMPRESSED && compressed_update)
+    {
+        result = compressed_update->save(file.chunk_address, chunk, file.chunk_size);
+        LED_Toggle(LED_RGB);
+    }
     return result;
 }
 
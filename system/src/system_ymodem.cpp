@@ -36,6 +36,9 @@
 #include "ota_flash_hal.h"
 #include "rgbled.h"
 #include "file_transfer.h"
+#include "fast_flash.h"
+#include "core_hal.h"
+#include <new>
 
 /**
  * @brief  Test to see if a key has been pressed on the HyperTerminal
@@ -153,6 +156,7 @@ private:
     //#define CMD_STRING_SIZE         128
 
     int32_t receive_packet(uint8_t* data, int32_t& length, uint32_t timeout);
+    int32_t receive_fast(FileTransfer::Descriptor& tx, file_desc_t& desc);
     int32_t handle_packet(uint8_t* packet_data, int32_t packet_length, FileTransfer::Descriptor& tx, file_desc_t& desc);
     void parse_file_packet(FileTransfer::Descriptor& tx, file_desc_t& desc, uint8_t* packet_data);
 
@@ -169,6 +173,7 @@ private:
  * @retval 0: normally return
  *        -1: timeout or packet error
  *         1: abort by user
+ *         3: the sender is starting a fast transfer
  */
 int32_t YModem::receive_packet(uint8_t *data, int32_t& length, uint32_t timeout)
 {
@@ -204,6 +209,8 @@ int32_t YModem::receive_packet(uint8_t *data, int32_t& length, uint32_t timeout)
         return 1;
     case ' ':
     		return 2;
+    case FastFlash::HELLO:
+        return 3;
     default:
         return -1;
     }
@@ -342,6 +349,11 @@ int32_t YModem::receive_file(FileTransfer::Descriptor& tx, YModem::file_desc_t&
                 send_byte(ACK);
             		break;
 
+            case 3:
+                if (!session_begin)
+                    return receive_fast(tx, file_info);
+                break;
+
             default:
                 if (session_begin >= 0)
                 {
@@ -361,6 +373,68 @@ int32_t YModem::receive_file(FileTransfer::Descriptor& tx, YModem::file_desc_t&
     return tx.file_length;
 }
 
+/**
+ * Adapts a Stream to the channel used by the fast transfer protocol.
+ */
+struct FastFlashChannel
+{
+    Stream& stream;
+
+    FastFlashChannel(Stream& stream_) : stream(stream_) {}
+
+    int read() { return stream.read(); }
+    size_t write(const uint8_t* data, size_t length) { return stream.write(data, length); }
+    uint32_t millis() { return HAL_Timer_Get_Milli_Seconds(); }
+    uint32_t crc32(const uint8_t* data, size_t length) { return HAL_Core_Compute_CRC32(data, length); }
+};
+
+/**
+ * Writes the blocks received by the fast transfer protocol to the firmware update.
+ */
+struct FastFlashSink
+{
+    FileTransfer::Descriptor& tx;
+    YModem::file_desc_t& desc;
+
+    FastFlashSink(FileTransfer::Descriptor& tx_, YModem::file_desc_t& desc_) : tx(tx_), desc(desc_) {}
+
+    int prepare(const char* name, uint32_t length)
+    {
+        strncpy(desc.file_name, name, sizeof(desc.file_name)-1);
+        snprintf(desc.file_size, sizeof(desc.file_size), "%u", (unsigned)length);
+        tx.file_length = length;
+        tx.chunk_size = FAST_FLASH_BLOCK_SIZE;
+        if (Spark_Prepare_For_Firmware_Update(tx, 0, NULL))
+            return -1;
+        tx.chunk_address = tx.file_address;
+        return 0;
+    }
+
+    int save(uint32_t offset, const uint8_t* data, uint16_t length)
+    {
+        tx.chunk_address = tx.file_address + offset;
+        tx.chunk_size = length;
+        return Spark_Save_Firmware_Chunk(tx, data, NULL);
+    }
+};
+
+/**
+ * Receives the file using the fast transfer protocol. The hello frame type has
+ * already been read by receive_packet().
+ */
+int32_t YModem::receive_fast(FileTransfer::Descriptor& tx, YModem::file_desc_t& desc)
+{
+    FastFlashChannel channel(stream);
+    FastFlashSink sink(tx, desc);
+    auto receiver = new (std::nothrow) FastFlash::Receiver<FastFlashChannel, FastFlashSink>(channel, sink);
+    if (!receiver)
+        return FastFlash::ERROR_MEMORY;
+    receiver->resume(FastFlash::HELLO);
+    int32_t result = receiver->receive();
+    delete receiver;
+    return result;
+}
+
 /**
  * @brief  Flash update via serial port using ymodem protocol
  * @param  serialObj (Possible values : &Serial, &Serial1 or &Serial2)
@@ -0,0 +1,115 @@
+
+#include "catch.hpp"
+#include "crc32.h"
+#include <vector>
+#include <random>
+#include <chrono>
+
+static uint32_t crc32_bitwise(const uint8_t* data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (int i=0; i<8; i++)
+            crc = (crc>>1) ^ (0xEDB88320 & -(crc&1));
+    }
+    return ~crc;
+}
+
+/**
+ * A byte at a time from one table, as most CRC-32 code does.
+ */
+static uint32_t crc32_bytewise(const uint8_t* data, size_t length)
+{
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t i=0; i<256; i++) {
+            uint32_t crc = i;
+            for (int j=0; j<8; j++)
+                crc = (crc>>1) ^ (0xEDB88320 & -(crc&1));
+            table[i] = crc;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--)
+        crc = (crc>>8) ^ table[(crc ^ *data++) & 0xFF];
+    return ~crc;
+}
+
+static std::vector<uint8_t> random_data(size_t length, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(length);
+    for (auto& b : data)
+        b = rng();
+    return data;
+}
+
+SCENARIO("crc32_update computes the CRC-32 of a buffer", "[crc32]")
+{
+    SECTION("the check value") {
+        const char* check = "123456789";
+        uint32_t crc = crc32_update(0, check, 9);
+        REQUIRE(crc==0xCBF43926);
+    }
+
+    SECTION("no data") {
+        REQUIRE(crc32_update(0, nullptr, 0)==0);
+        REQUIRE(crc32_update(0x12345678, nullptr, 0)==0x12345678);
+    }
+
+    SECTION("every length and alignment up to a few blocks") {
+        std::vector<uint8_t> data = random_data(64, 1);
+        for (size_t start=0; start<8; start++) {
+            for (size_t length=0; start+length<=data.size(); length++) {
+                uint32_t expected = crc32_bitwise(data.data()+start, length);
+                uint32_t actual = crc32_update(0, data.data()+start, length);
+                REQUIRE(actual==expected);
+            }
+        }
+    }
+
+    SECTION("a module sized buffer") {
+        std::vector<uint8_t> data = random_data(128*1024+3, 2);
+        uint32_t expected = crc32_bitwise(data.data(), data.size());
+        uint32_t actual = crc32_update(0, data.data(), data.size());
+        REQUIRE(actual==expected);
+    }
+}
+
+SCENARIO("crc32_update continues a CRC across pieces", "[crc32]")
+{
+    std::vector<uint8_t> data = random_data(5000, 3);
+    uint32_t expected = crc32_bitwise(data.data(), data.size());
+    const size_t pieces[] = { 1, 3, 8, 13, 512, 4999 };
+    for (size_t piece : pieces) {
+        uint32_t crc = 0;
+        for (size_t i=0; i<data.size(); i += piece)
+            crc = crc32_update(crc, data.data()+i, std::min(piece, data.size()-i));
+        REQUIRE(crc==expected);
+    }
+}
+
+template <typename F> double megabytes_per_second(F crc, const std::vector<uint8_t>& data, uint32_t& result)
+{
+    using namespace std::chrono;
+    const int iterations = 20;
+    auto start = high_resolution_clock::now();
+    result = 0;
+    for (int i=0; i<iterations; i++)
+        result ^= crc(data.data(), data.size());
+    auto elapsed = duration_cast<nanoseconds>(high_resolution_clock::now()-start).count();
+    return double(data.size())*iterations/(1024*1024)*1e9/elapsed;
+}
+
+SCENARIO("crc32_update is faster than a bitwise or bytewise CRC", "[.][crc32][benchmark]")
+{
+    std::vector<uint8_t> data = random_data(1024*1024, 4);
+    uint32_t bitwise, bytewise, sliced;
+    double bitwise_rate = megabytes_per_second(crc32_bitwise, data, bitwise);
+    double bytewise_rate = megabytes_per_second(crc32_bytewise, data, bytewise);
+    double sliced_rate = megabytes_per_second([](const uint8_t* p, size_t n) { return crc32_update(0, p, n); }, data, sliced);
+    REQUIRE(bytewise==bitwise);
+    REQUIRE(sliced==bitwise);
+    WARN("bitwise: " << bitwise_rate << " MB/s, bytewise: " << bytewise_rate << " MB/s, slicing-by-8: " << sliced_rate << " MB/s");
+}
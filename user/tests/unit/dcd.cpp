@@ -210,4 +210,232 @@ SCENARIO("DCD write is atomic if partial failure", "[dcd]")
         // last write is unsuccessful
         assertMemoryEqual(dcd.read(23), (const uint8_t*)"batman", 6);
     }
-}
\ No newline at end of file
+}
+
+// Journal mode
+
+const int TestJournalOffset = 12000;
+
+using JournalDCD = DCD<TestStore, TestSectorSize, TestBase, TestBase+TestSectorSize, TestJournalOffset>;
+
+bool isSectorValid(TestStore& store, unsigned sector)
+{
+    const JournalDCD::Header& header = *(const JournalDCD::Header*)store.dataAt(TestBase+sector*TestSectorSize);
+    return header.isValid();
+}
+
+string readString(JournalDCD& dcd, unsigned offset, unsigned length)
+{
+    char buf[length];
+    REQUIRE_FALSE(dcd.read(offset, buf, length));
+    return string(buf, length);
+}
+
+SCENARIO("DCD journal Length excludes the journal", "[dcd]")
+{
+    JournalDCD dcd;
+    REQUIRE(dcd.Length == TestJournalOffset-8);
+    REQUIRE(dcd.write(dcd.Length-2, "abc", 3) == JournalDCD::DCD_INVALID_LENGTH);
+}
+
+SCENARIO("DCD journal appends small writes without changing sector", "[dcd]")
+{
+    JournalDCD dcd;
+    REQUIRE_FALSE(dcd.write(23, "batman", 6));
+    bool sector1 = isSectorValid(dcd.store, 1);
+    bool sector0 = isSectorValid(dcd.store, 0);
+    REQUIRE(sector0 != sector1);
+
+    REQUIRE_FALSE(dcd.write(24, "obin", 4));
+    REQUIRE_FALSE(dcd.write(0, "\x01", 1));
+    REQUIRE_FALSE(dcd.write(100, "joker", 5));
+
+    REQUIRE(isSectorValid(dcd.store, 0) == sector0);
+    REQUIRE(isSectorValid(dcd.store, 1) == sector1);
+
+    REQUIRE(readString(dcd, 22, 8) == "\xFF" "bobinn\xFF");
+    REQUIRE(readString(dcd, 0, 1) == "\x01");
+    REQUIRE(readString(dcd, 100, 5) == "joker");
+}
+
+SCENARIO("DCD journal is compacted when pointer reads overlap it", "[dcd]")
+{
+    JournalDCD dcd;
+    REQUIRE_FALSE(dcd.write(23, "batman", 6));
+    REQUIRE_FALSE(dcd.write(1000, "joker", 5));
+    bool sector0 = isSectorValid(dcd.store, 0);
+
+    // doesn't overlap the journal
+    assertMemoryEqual(dcd.read(200, 10), (const uint8_t*)"\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 10);
+    REQUIRE(isSectorValid(dcd.store, 0) == sector0);
+
+    assertMemoryEqual(dcd.read(23), (const uint8_t*)"batman", 6);
+    REQUIRE(isSectorValid(dcd.store, 0) != sector0);
+    assertMemoryEqual(dcd.read(1000), (const uint8_t*)"joker", 5);
+}
+
+SCENARIO("DCD journal is compacted when full", "[dcd]")
+{
+    JournalDCD dcd;
+    uint8_t expected[256];
+    for (unsigned i=0; i<sizeof(expected); i++)
+    {
+        expected[i] = rand();
+        REQUIRE_FALSE(dcd.write(i*40, &expected[i], 1));
+    }
+    for (unsigned i=0; i<sizeof(expected); i++)
+    {
+        CAPTURE(i);
+        uint8_t actual;
+        REQUIRE_FALSE(dcd.read(i*40, &actual, 1));
+        REQUIRE(actual == expected[i]);
+        REQUIRE(*dcd.read(i*40, 1) == expected[i]);
+    }
+}
+
+SCENARIO("DCD journal writes larger than the journal limit go to the alternate sector", "[dcd]")
+{
+    JournalDCD dcd;
+    uint8_t expected[JournalDCD::JournalWriteMax+1];
+    for (unsigned i=0; i<sizeof(expected); i++)
+        expected[i] = rand();
+
+    REQUIRE_FALSE(dcd.write(10, "a", 1));
+    bool sector0 = isSectorValid(dcd.store, 0);
+    REQUIRE_FALSE(dcd.write(100, expected, sizeof(expected)));
+    REQUIRE(isSectorValid(dcd.store, 0) != sector0);
+    assertMemoryEqual(dcd.read(100), expected, sizeof(expected));
+    assertMemoryEqual(dcd.read(10), (const uint8_t*)"a", 1);
+}
+
+SCENARIO("DCD journal is recovered from flash", "[dcd]")
+{
+    JournalDCD dcd;
+    REQUIRE_FALSE(dcd.write(23, "batman", 6));
+    REQUIRE_FALSE(dcd.write(26, "MAN", 3));
+
+    JournalDCD reopened;
+    reopened.store = dcd.store;
+    REQUIRE(readString(reopened, 23, 6) == "batMAN");
+    REQUIRE_FALSE(reopened.write(23, "c", 1));
+    REQUIRE(readString(reopened, 23, 6) == "catMAN");
+}
+
+SCENARIO("DCD journal write is atomic if partial failure", "[dcd]")
+{
+    for (int write_count=0; write_count<4; write_count++)
+    {
+        CAPTURE(write_count);
+        JournalDCD dcd;
+        REQUIRE_FALSE(dcd.write(23, "abcdef", 6));
+        REQUIRE_FALSE(dcd.write(23, "batman", 6));
+
+        dcd.store.setWriteCount(write_count);
+        if (write_count<3)
+            REQUIRE(dcd.write(23, "7890-!", 6));
+        else
+            REQUIRE_FALSE(dcd.write(23, "7890-!", 6));
+
+        const char* expected = write_count<3 ? "batman" : "7890-!";
+        REQUIRE(readString(dcd, 23, 6) == expected);
+
+        // after a reset
+        JournalDCD reopened;
+        reopened.store = dcd.store;
+        REQUIRE(readString(reopened, 23, 6) == expected);
+
+        // subsequent writes succeed
+        reopened.store.setWriteCount(INT_MAX);
+        REQUIRE_FALSE(reopened.write(24, "ob", 2));
+        REQUIRE(readString(reopened, 23, 3) == string(expected,1)+"ob");
+        assertMemoryEqual(reopened.read(23), (const uint8_t*)(string(expected,1)+"ob").c_str(), 3);
+    }
+}
+
+SCENARIO("DCD journal compaction is atomic if partial failure", "[dcd]")
+{
+    for (int write_count=0; write_count<8; write_count++)
+    {
+        CAPTURE(write_count);
+        JournalDCD dcd;
+        REQUIRE_FALSE(dcd.write(23, "batman", 6));
+        REQUIRE_FALSE(dcd.write(5000, "robin", 5));
+
+        // a pointer read of an overlapping range compacts the journal
+        dcd.store.setWriteCount(write_count);
+        dcd.read(0);
+
+        JournalDCD reopened;
+        reopened.store = dcd.store;
+        reopened.store.setWriteCount(INT_MAX);
+        REQUIRE(readString(reopened, 23, 6) == "batman");
+        REQUIRE(readString(reopened, 5000, 5) == "robin");
+        assertMemoryEqual(reopened.read(23), (const uint8_t*)"batman", 6);
+        assertMemoryEqual(reopened.read(5000), (const uint8_t*)"robin", 5);
+    }
+}
+
+const JournalDCD::Range TestUnjournaled[] = { { 0, 32 }, { 100, 10 } };
+
+SCENARIO("DCD journal writes unjournaled ranges to the sector", "[dcd]")
+{
+    JournalDCD dcd(TestUnjournaled, 2);
+    REQUIRE_FALSE(dcd.write(200, "joker", 5));
+    bool sector0 = isSectorValid(dcd.store, 0);
+
+    REQUIRE_FALSE(dcd.write(30, "batman", 6));
+    REQUIRE(isSectorValid(dcd.store, 0) != sector0);
+    sector0 = isSectorValid(dcd.store, 0);
+
+    // what's in the sector is current
+    const uint8_t* data = dcd.store.dataAt(TestBase+(sector0 ? 0 : TestSectorSize)+8);
+    assertMemoryEqual(data+30, (const uint8_t*)"batman", 6);
+    assertMemoryEqual(data+200, (const uint8_t*)"joker", 5);
+
+    REQUIRE_FALSE(dcd.write(40, "robin", 5));
+    REQUIRE(isSectorValid(dcd.store, 0) == sector0);
+    REQUIRE_FALSE(dcd.write(109, "!", 1));
+    REQUIRE(isSectorValid(dcd.store, 0) != sector0);
+    REQUIRE(readString(dcd, 40, 5) == "robin");
+    REQUIRE(readString(dcd, 109, 1) == "!");
+}
+
+SCENARIO("DCD journal records for unjournaled ranges don't hide writes without the journal", "[dcd]")
+{
+    JournalDCD dcd;
+    REQUIRE_FALSE(dcd.write(10, "stale", 5));
+    REQUIRE_FALSE(dcd.write(200, "joker", 5));
+
+    // a writer that doesn't know about the journal copies the whole sector, records included
+    TestDCD old;
+    old.store = dcd.store;
+    REQUIRE_FALSE(old.write(10, "fresh", 5));
+
+    JournalDCD reopened(TestUnjournaled, 2);
+    reopened.store = old.store;
+    REQUIRE(readString(reopened, 10, 5) == "fresh");
+    REQUIRE(readString(reopened, 200, 5) == "joker");
+    assertMemoryEqual(reopened.read(10, 5), (const uint8_t*)"fresh", 5);
+}
+
+SCENARIO("DCD journal records are dropped when the sector is written without the journal", "[dcd]")
+{
+    JournalDCD dcd;
+    REQUIRE_FALSE(dcd.write(500, "robin", 5));
+    REQUIRE_FALSE(dcd.write(2000, "joker", 5));
+
+    // e.g. a key written by an older bootloader's DFU
+    TestDCD old;
+    old.store = dcd.store;
+    REQUIRE_FALSE(old.write(500, "alfred", 6));
+
+    JournalDCD reopened;
+    reopened.store = old.store;
+    REQUIRE(readString(reopened, 500, 6) == "alfred");
+    REQUIRE(readString(reopened, 2000, 5) == "joker");
+
+    // the sector data is compacted without the stale record
+    assertMemoryEqual(reopened.read(500, 6), (const uint8_t*)"alfred", 6);
+    REQUIRE_FALSE(reopened.write(501, "A", 1));
+    REQUIRE(readString(reopened, 500, 6) == "aAfred");
+}
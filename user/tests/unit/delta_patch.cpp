@@ -0,0 +1,288 @@
+
+#include "catch.hpp"
+#include "delta_patch.h"
+#include "delta_patch_diff.h"
+#include <vector>
+#include <random>
+
+using namespace DeltaPatch;
+
+typedef std::vector<uint8_t> Bytes;
+
+static uint32_t crc32(const uint8_t* data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (int i=0; i<8; i++)
+            crc = (crc>>1) ^ (0xEDB88320 & -(crc&1));
+    }
+    return ~crc;
+}
+
+/**
+ * Appends the CRC, as the build does to a module.
+ */
+static Bytes with_crc(Bytes image)
+{
+    uint32_t crc = crc32(image.data(), image.size());
+    image.resize(image.size()+4);
+    write_le32(image.data()+image.size()-4, crc);
+    return image;
+}
+
+/**
+ * Stands in for a module built from a list of functions: each function is
+ * some instructions with calls to other functions by absolute address, so
+ * growing one function moves everything after it and changes every call to it.
+ */
+struct Firmware
+{
+    static const uint32_t BASE = 0x080A0000;
+    std::vector<Bytes> functions;
+    std::vector<std::vector<std::pair<size_t, size_t>>> calls;    // offset in the function, function called
+
+    Firmware(unsigned count, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        for (unsigned f=0; f<count; f++) {
+            Bytes code((rng()%60+10)*4);
+            for (auto& b : code)
+                b = rng();
+            functions.push_back(code);
+            std::vector<std::pair<size_t, size_t>> c;
+            for (size_t offset=8; offset+4<=code.size(); offset += (rng()%6+3)*4)
+                c.push_back(std::make_pair(offset, rng()%count));
+            calls.push_back(c);
+        }
+    }
+
+    Bytes link() const
+    {
+        std::vector<uint32_t> address;
+        uint32_t next = BASE;
+        for (auto& f : functions) {
+            address.push_back(next);
+            next += f.size();
+        }
+        Bytes image;
+        for (size_t f=0; f<functions.size(); f++) {
+            Bytes code = functions[f];
+            for (auto& call : calls[f])
+                write_le32(code.data()+call.first, address[call.second]);
+            image.insert(image.end(), code.begin(), code.end());
+        }
+        return with_crc(image);
+    }
+};
+
+struct BufferSink
+{
+    Bytes data;
+    std::vector<size_t> lengths;
+    bool in_order = true;
+    int fail_at = -1;
+
+    int operator()(uint32_t offset, const uint8_t* buf, size_t length)
+    {
+        if (int(lengths.size())==fail_at)
+            return -1;
+        in_order = in_order && offset==data.size();
+        data.insert(data.end(), buf, buf+length);
+        lengths.push_back(length);
+        return 0;
+    }
+};
+
+/**
+ * Applies the patch fed in pieces of the given size.
+ */
+static int apply(const Bytes& source, const Bytes& patch, size_t piece, BufferSink& sink)
+{
+    Applier<BufferSink, 64> applier(sink, source.data(), source.size());
+    for (size_t i=0; i<patch.size(); i += piece) {
+        int result = applier.feed(patch.data()+i, std::min(piece, patch.size()-i));
+        if (result)
+            return result;
+    }
+    return applier.finish();
+}
+
+static bool round_trip(const Bytes& source, const Bytes& target)
+{
+    Bytes patch = diff(source.data(), source.size(), target.data(), target.size(), Firmware::BASE);
+    const size_t pieces[] = { 1, 7, 512, patch.size() };
+    for (size_t piece : pieces) {
+        BufferSink sink;
+        if (apply(source, patch, piece, sink) || sink.data!=target || !sink.in_order)
+            return false;
+    }
+    return true;
+}
+
+static void append_op(Bytes& patch, Op op, uint32_t count)
+{
+    uint32_t value = count<<2 | op;
+    for (; value>=0x80; value >>= 7)
+        patch.push_back(uint8_t(value) | 0x80);
+    patch.push_back(value);
+}
+
+static size_t patch_size(const Bytes& source, const Bytes& target)
+{
+    return diff(source.data(), source.size(), target.data(), target.size()).size();
+}
+
+SCENARIO("A delta patch rebuilds the target from the source", "[delta]")
+{
+    Firmware firmware(200, 1);
+    Bytes source = firmware.link();
+
+    SECTION("unchanged") {
+        REQUIRE(round_trip(source, source));
+        size_t size = patch_size(source, source);
+        REQUIRE(size<=HEADER_SIZE+4);
+    }
+
+    SECTION("a function changed in place") {
+        Firmware changed = firmware;
+        changed.functions[100][20] ^= 0xFF;
+        changed.functions[100][21] ^= 0x0F;
+        Bytes target = changed.link();
+        REQUIRE(round_trip(source, target));
+        size_t size = patch_size(source, target);
+        REQUIRE(size<HEADER_SIZE+40);
+    }
+
+    SECTION("a function that grew, moving those after it") {
+        Firmware changed = firmware;
+        Bytes& f = changed.functions[50];
+        f.insert(f.begin()+f.size()/2, 36, 0xA5);
+        Bytes target = changed.link();
+        REQUIRE(round_trip(source, target));
+        size_t size = patch_size(source, target);
+        size_t limit = target.size()/6;
+        REQUIRE(size<limit);
+    }
+
+    SECTION("functions added, removed and reordered") {
+        Firmware changed = firmware;
+        std::swap(changed.functions[10], changed.functions[150]);
+        std::swap(changed.calls[10], changed.calls[150]);
+        changed.functions.erase(changed.functions.begin()+70);
+        changed.calls.erase(changed.calls.begin()+70);
+        changed.functions.push_back(Firmware(1, 9).functions[0]);
+        changed.calls.push_back({});
+        for (auto& c : changed.calls)
+            for (auto& call : c)
+                call.second %= changed.functions.size();
+        Bytes target = changed.link();
+        REQUIRE(round_trip(source, target));
+    }
+
+    SECTION("unrelated images") {
+        Bytes target = Firmware(120, 2).link();
+        REQUIRE(round_trip(source, target));
+    }
+
+    SECTION("a smaller and a larger target") {
+        Bytes smaller(source.begin(), source.begin()+source.size()/3);
+        REQUIRE(round_trip(source, with_crc(smaller)));
+        Bytes larger(source.begin(), source.end()-4);
+        larger.insert(larger.end(), source.begin(), source.end()-4);
+        REQUIRE(round_trip(source, with_crc(larger)));
+    }
+
+    SECTION("runs of padding") {
+        Bytes padded(4096, 0xFF);
+        Bytes target = padded;
+        target[2000] = 0;
+        REQUIRE(round_trip(with_crc(padded), with_crc(target)));
+    }
+}
+
+SCENARIO("The delta patch header describes the source and target", "[delta]")
+{
+    Bytes source = Firmware(20, 3).link();
+    Bytes target = Firmware(20, 4).link();
+    Bytes patch = diff(source.data(), source.size(), target.data(), target.size(), 0x08060000);
+    Header header;
+    header.read(patch.data());
+    REQUIRE(header.is_valid());
+    REQUIRE(header.source_address==0x08060000);
+    REQUIRE(header.source_length==source.size());
+    REQUIRE(header.source_crc==crc32(source.data(), source.size()-4));
+    REQUIRE(header.target_length==target.size());
+    REQUIRE(header.matches(source.data(), source.size()));
+    REQUIRE_FALSE(header.matches(target.data(), target.size()));
+}
+
+SCENARIO("A delta patch writes the target in buffer sized blocks", "[delta]")
+{
+    Bytes source = Firmware(50, 5).link();
+    Bytes target = Firmware(50, 6).link();
+    Bytes patch = diff(source.data(), source.size(), target.data(), target.size());
+    BufferSink sink;
+    REQUIRE(apply(source, patch, 100, sink)==0);
+    size_t count = sink.lengths.size();
+    REQUIRE(count==(target.size()+63)/64);
+    for (size_t i=0; i+1<count; i++)
+        REQUIRE(sink.lengths[i]==64);
+}
+
+SCENARIO("A delta patch is refused when it doesn't fit", "[delta]")
+{
+    Firmware firmware(40, 7);
+    Bytes source = firmware.link();
+    firmware.functions[3][5]++;
+    Bytes target = firmware.link();
+    Bytes patch = diff(source.data(), source.size(), target.data(), target.size());
+    BufferSink sink;
+
+    SECTION("not a patch") {
+        patch[0]++;
+        REQUIRE(apply(source, patch, 16, sink)==ERROR_HEADER);
+    }
+
+    SECTION("another version") {
+        patch[4] = VERSION+1;
+        REQUIRE(apply(source, patch, 16, sink)==ERROR_HEADER);
+    }
+
+    SECTION("made from another module") {
+        Bytes other = Firmware(40, 8).link();
+        other.resize(source.size());
+        REQUIRE(apply(other, patch, 16, sink)==ERROR_SOURCE);
+    }
+
+    SECTION("made from a module of another size") {
+        Bytes longer = source;
+        longer.insert(longer.begin(), 4, 0);
+        REQUIRE(apply(longer, patch, 16, sink)==ERROR_SOURCE);
+    }
+
+    SECTION("cut short") {
+        patch.resize(patch.size()-1);
+        REQUIRE(apply(source, patch, 16, sink)==ERROR_INCOMPLETE);
+    }
+
+    SECTION("reading past the end of the source") {
+        Bytes bad(patch.begin(), patch.begin()+HEADER_SIZE);
+        append_op(bad, SEEK, 200);      // forwards 100
+        append_op(bad, COPY, source.size());
+        REQUIRE(apply(source, bad, 16, sink)==ERROR_CORRUPT);
+    }
+
+    SECTION("writing past the end of the target") {
+        Bytes bad(patch.begin(), patch.begin()+HEADER_SIZE);
+        write_le32(bad.data()+20, 2);
+        append_op(bad, INSERT, 3);
+        bad.insert(bad.end(), 3, 0);
+        REQUIRE(apply(source, bad, 16, sink)==ERROR_CORRUPT);
+    }
+
+    SECTION("the write fails") {
+        sink.fail_at = 2;
+        REQUIRE(apply(source, patch, 16, sink)==ERROR_WRITE);
+    }
+}
@@ -0,0 +1,177 @@
+
+#include "catch.hpp"
+#include "dns_cache.h"
+
+using TestDNSCache = DNSCache<uint32_t, DNSCacheNoLock, 2, 16>;
+
+struct TestResolver
+{
+    uint32_t address = 0;
+    int result = 0;
+    int calls = 0;
+
+    int operator()(const char* hostname, uint32_t& out)
+    {
+        calls++;
+        if (!result)
+            out = address;
+        return result;
+    }
+};
+
+template <typename Cache> int resolve(Cache& cache, const char* hostname, uint32_t& address, uint32_t now, TestResolver& resolver)
+{
+    return cache.resolve(hostname, address, now, [&resolver](const char* hostname, uint32_t& out) {
+        return resolver(hostname, out);
+    });
+}
+
+SCENARIO("DNSCache is initially empty", "[dns_cache]")
+{
+    TestDNSCache cache;
+    uint32_t address = 0;
+    int result = 0;
+    REQUIRE(cache.lookup("particle.io", address, result, 0)==TestDNSCache::MISS);
+}
+
+SCENARIO("DNSCache returns a resolved address without calling the resolver", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.address = 0x01020304;
+    uint32_t address = 0;
+
+    REQUIRE(resolve(cache, "particle.io", address, 1000, resolver)==0);
+    REQUIRE(address==0x01020304);
+    REQUIRE(resolver.calls==1);
+
+    address = 0;
+    REQUIRE(resolve(cache, "particle.io", address, 2000, resolver)==0);
+    REQUIRE(address==0x01020304);
+    REQUIRE(resolver.calls==1);
+}
+
+SCENARIO("DNSCache resolves again after the TTL expires", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.address = 0x01020304;
+    uint32_t address = 0;
+
+    REQUIRE(resolve(cache, "particle.io", address, 1000, resolver)==0);
+    resolver.address = 0x05060708;
+    REQUIRE(resolve(cache, "particle.io", address, 1000+DNS_CACHE_TTL_DEFAULT, resolver)==0);
+    REQUIRE(address==0x05060708);
+    REQUIRE(resolver.calls==2);
+}
+
+SCENARIO("DNSCache handles the millisecond counter wrapping", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.address = 0x01020304;
+    uint32_t address = 0;
+
+    REQUIRE(resolve(cache, "particle.io", address, 0xFFFFFF00, resolver)==0);
+    REQUIRE(resolve(cache, "particle.io", address, 0x100, resolver)==0);
+    REQUIRE(resolver.calls==1);
+}
+
+SCENARIO("DNSCache retries failed lookups straight away", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.result = 5;
+    uint32_t address = 0;
+
+    REQUIRE(resolve(cache, "nowhere", address, 1000, resolver)==5);
+    REQUIRE(resolve(cache, "nowhere", address, 1001, resolver)==5);
+    REQUIRE(resolver.calls==2);
+
+    resolver.result = 0;
+    resolver.address = 42;
+    REQUIRE(resolve(cache, "nowhere", address, 1002, resolver)==0);
+    REQUIRE(address==42);
+    REQUIRE(resolver.calls==3);
+}
+
+SCENARIO("DNSCache returns the last known good address when the resolver fails", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.address = 0x01020304;
+    uint32_t address = 0;
+
+    REQUIRE(resolve(cache, "particle.io", address, 0, resolver)==0);
+
+    resolver.result = -1;
+    address = 0;
+    uint32_t now = DNS_CACHE_TTL_DEFAULT;
+    REQUIRE(resolve(cache, "particle.io", address, now, resolver)==0);
+    REQUIRE(address==0x01020304);
+    REQUIRE(resolver.calls==2);
+
+    // the resolver isn't retried until the negative TTL has elapsed
+    REQUIRE(resolve(cache, "particle.io", address, now+1, resolver)==0);
+    REQUIRE(resolver.calls==2);
+    REQUIRE(resolve(cache, "particle.io", address, now+DNS_CACHE_TTL_NEGATIVE, resolver)==0);
+    REQUIRE(resolver.calls==3);
+
+    // the stale address is not used indefinitely
+    address = 0;
+    REQUIRE(resolve(cache, "particle.io", address, DNS_CACHE_TTL_DEFAULT+DNS_CACHE_STALE_MAX, resolver)==-1);
+    REQUIRE(address==0);
+}
+
+SCENARIO("DNSCache replaces the least recently used entry", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    uint32_t address = 0;
+    int result = 0;
+
+    resolver.address = 1;
+    resolve(cache, "one", address, 0, resolver);
+    resolver.address = 2;
+    resolve(cache, "two", address, 0, resolver);
+    REQUIRE(cache.lookup("one", address, result, 1)==TestDNSCache::HIT);
+    resolver.address = 3;
+    resolve(cache, "three", address, 2, resolver);
+
+    REQUIRE(cache.lookup("one", address, result, 3)==TestDNSCache::HIT);
+    REQUIRE(address==1);
+    REQUIRE(cache.lookup("two", address, result, 3)==TestDNSCache::MISS);
+    REQUIRE(cache.lookup("three", address, result, 3)==TestDNSCache::HIT);
+    REQUIRE(address==3);
+}
+
+SCENARIO("DNSCache does not cache hostnames longer than the maximum", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.address = 7;
+    uint32_t address = 0;
+
+    const char* hostname = "a.very.long.hostname.example.com";
+    REQUIRE(resolve(cache, hostname, address, 0, resolver)==0);
+    REQUIRE(resolve(cache, hostname, address, 0, resolver)==0);
+    REQUIRE(address==7);
+    REQUIRE(resolver.calls==2);
+}
+
+SCENARIO("DNSCache entries can be invalidated", "[dns_cache]")
+{
+    TestDNSCache cache;
+    TestResolver resolver;
+    resolver.address = 7;
+    uint32_t address = 0;
+    int result = 0;
+
+    resolve(cache, "one", address, 0, resolver);
+    resolve(cache, "two", address, 0, resolver);
+    cache.invalidate("one");
+    REQUIRE(cache.lookup("one", address, result, 0)==TestDNSCache::MISS);
+    REQUIRE(cache.lookup("two", address, result, 0)==TestDNSCache::HIT);
+    cache.clear();
+    REQUIRE(cache.lookup("two", address, result, 0)==TestDNSCache::MISS);
+}
@@ -0,0 +1,254 @@
+
+#include "catch.hpp"
+#include "flash_storage.h"
+#include "eeprom_emulation.h"
+#include <string.h>
+#include <chrono>
+
+const int EEPROMPageSize = 1024;
+const int EEPROMBase = 0x8000;
+const int EEPROMCapacity = 200;
+
+using EEPROMStore = RAMFlashStorage<EEPROMBase, 2, EEPROMPageSize>;
+using TestEEPROM = EEPROMEmulation<EEPROMStore, EEPROMPageSize, EEPROMBase, EEPROMBase+EEPROMPageSize, EEPROMCapacity>;
+
+const unsigned Page0Address = EEPROMBase;
+const unsigned Page1Address = EEPROMBase+EEPROMPageSize;
+
+static uint16_t pageStatus(EEPROMStore& store, unsigned page)
+{
+    uint16_t status;
+    memcpy(&status, store.dataAt(page), sizeof(status));
+    return status;
+}
+
+static void writeRecord(EEPROMStore& store, unsigned page, unsigned record, uint16_t address, uint16_t value)
+{
+    store.write(page+record*4, &value, 2);
+    store.write(page+record*4+2, &address, 2);
+}
+
+static void formatPage(EEPROMStore& store, unsigned page, uint16_t status)
+{
+    store.eraseSector(page);
+    if (status!=TestEEPROM::ERASED)
+        store.write(page, &status, 2);
+}
+
+struct Settings
+{
+    uint32_t magic;
+    char name[20];
+    float threshold;
+    uint8_t flags;
+};
+
+SCENARIO("EEPROM emulation formats uninitialized flash", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    REQUIRE(eeprom.init()==0);
+    REQUIRE(pageStatus(eeprom.store, Page0Address)==TestEEPROM::VALID_PAGE);
+    REQUIRE(pageStatus(eeprom.store, Page1Address)==TestEEPROM::ERASED);
+    for (unsigned i=0; i<EEPROMCapacity; i++)
+        REQUIRE(eeprom.read(i)==0xFF);
+}
+
+SCENARIO("EEPROM emulation reads back written values", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    eeprom.init();
+    REQUIRE(eeprom.write(10, 0x42)==0);
+    REQUIRE(eeprom.read(10)==0x42);
+
+    Settings settings = { 0xC0FFEE, "photon", 1.5f, 3 };
+    REQUIRE(eeprom.write(20, &settings, sizeof(settings))==0);
+    Settings copy;
+    REQUIRE(eeprom.read(20, &copy, sizeof(copy))==0);
+    REQUIRE(memcmp(&copy, &settings, sizeof(settings))==0);
+
+    GIVEN("the flash is loaded again")
+    {
+        TestEEPROM reopened;
+        reopened.store = eeprom.store;
+        REQUIRE(reopened.init()==0);
+        REQUIRE(reopened.read(10)==0x42);
+        memset(&copy, 0, sizeof(copy));
+        reopened.read(20, &copy, sizeof(copy));
+        REQUIRE(memcmp(&copy, &settings, sizeof(settings))==0);
+    }
+}
+
+SCENARIO("EEPROM emulation rejects out of range addresses", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    eeprom.init();
+    uint8_t data[4] = {};
+    REQUIRE(eeprom.write(EEPROMCapacity-2, data, 4)==TestEEPROM::EEPROM_INVALID_ADDRESS);
+    REQUIRE(eeprom.read(EEPROMCapacity-2, data, 4)==TestEEPROM::EEPROM_INVALID_ADDRESS);
+    REQUIRE(eeprom.write(EEPROMCapacity-4, data, 4)==0);
+    REQUIRE(eeprom.read(EEPROMCapacity)==0xFF);
+}
+
+SCENARIO("EEPROM emulation only writes changed values", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    eeprom.init();
+    uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    eeprom.write(0, data, sizeof(data));
+
+    data[3] = 40;
+    eeprom.store.setWriteCount(2);        // one record
+    REQUIRE(eeprom.write(0, data, sizeof(data))==0);
+    REQUIRE(eeprom.read(3)==40);
+}
+
+SCENARIO("EEPROM emulation transfers the values when the page is full", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    eeprom.init();
+    const unsigned records = EEPROMPageSize/4-1;
+    for (unsigned i=0; i<records+10; i++)
+    {
+        REQUIRE(eeprom.write(i % EEPROMCapacity, uint8_t(i))==0);
+    }
+
+    REQUIRE(pageStatus(eeprom.store, Page0Address)==TestEEPROM::ERASED);
+    REQUIRE(pageStatus(eeprom.store, Page1Address)==TestEEPROM::VALID_PAGE);
+
+    TestEEPROM reopened;
+    reopened.store = eeprom.store;
+    reopened.init();
+    for (unsigned i=0; i<EEPROMCapacity; i++)
+    {
+        CAPTURE(i);
+        REQUIRE(reopened.read(i)==eeprom.read(i));
+    }
+    REQUIRE(reopened.read(5)==uint8_t(EEPROMCapacity+5));
+}
+
+SCENARIO("EEPROM emulation applies a bulk write that spans a page transfer", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    eeprom.init();
+    const unsigned records = EEPROMPageSize/4-1;
+    for (unsigned i=0; i<records-3; i++)
+        eeprom.write(100, uint8_t(i));
+
+    uint8_t data[16];
+    for (unsigned i=0; i<sizeof(data); i++)
+        data[i] = uint8_t(i+1);
+    REQUIRE(eeprom.write(0, data, sizeof(data))==0);
+
+    TestEEPROM reopened;
+    reopened.store = eeprom.store;
+    reopened.init();
+    uint8_t copy[16];
+    reopened.read(0, copy, sizeof(copy));
+    REQUIRE(memcmp(copy, data, sizeof(data))==0);
+    REQUIRE(reopened.read(100)==uint8_t(records-4));
+}
+
+SCENARIO("EEPROM emulation reads pages written in the ST format", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    formatPage(eeprom.store, Page0Address, TestEEPROM::ERASED);
+    formatPage(eeprom.store, Page1Address, TestEEPROM::VALID_PAGE);
+    writeRecord(eeprom.store, Page1Address, 1, 7, 0x11);
+    writeRecord(eeprom.store, Page1Address, 2, 8, 0x22);
+    writeRecord(eeprom.store, Page1Address, 3, 7, 0x33);
+
+    REQUIRE(eeprom.init()==0);
+    REQUIRE(eeprom.read(7)==0x33);
+    REQUIRE(eeprom.read(8)==0x22);
+
+    // the next record follows the existing ones
+    eeprom.write(9, 0x44);
+    const uint8_t* record = eeprom.store.dataAt(Page1Address+4*4);
+    REQUIRE(record[0]==0x44);
+    REQUIRE(record[2]==9);
+}
+
+SCENARIO("EEPROM emulation ignores a record interrupted by power loss", "[eeprom]")
+{
+    TestEEPROM eeprom;
+    eeprom.init();
+    eeprom.write(3, 0x10);
+    eeprom.store.setWriteCount(1);        // the data is written but not the address
+    REQUIRE(eeprom.write(3, 0x20)!=0);
+
+    TestEEPROM reopened;
+    reopened.store = eeprom.store;
+    reopened.store.setWriteCount(INT_MAX);
+    REQUIRE(reopened.init()==0);
+    REQUIRE(reopened.read(3)==0x10);
+    REQUIRE(reopened.write(3, 0x30)==0);
+
+    TestEEPROM again;
+    again.store = reopened.store;
+    again.init();
+    REQUIRE(again.read(3)==0x30);
+}
+
+SCENARIO("EEPROM emulation recovers from power loss during a page transfer", "[eeprom]")
+{
+    const unsigned records = EEPROMPageSize/4-1;
+    uint8_t expected[EEPROMCapacity];
+
+    // fail at each step of the transfer in turn
+    for (int writes=0; writes<40; writes++)
+    {
+        CAPTURE(writes);
+        TestEEPROM eeprom;
+        eeprom.init();
+        for (unsigned i=0; i<records; i++)
+            eeprom.write(i % 20, uint8_t(i));
+        eeprom.read(0, expected, sizeof(expected));
+
+        eeprom.store.setWriteCount(writes);
+        bool completed = eeprom.write(50, 0x55)==0;
+
+        TestEEPROM reopened;
+        reopened.store = eeprom.store;
+        reopened.store.setWriteCount(INT_MAX);
+        REQUIRE(reopened.init()==0);
+        REQUIRE(pageStatus(reopened.store, Page0Address)!=pageStatus(reopened.store, Page1Address));
+        for (unsigned i=0; i<20; i++)
+        {
+            CAPTURE(i);
+            REQUIRE(reopened.read(i)==expected[i]);
+        }
+        if (completed)
+            REQUIRE(reopened.read(50)==0x55);
+        else
+            REQUIRE((reopened.read(50)==0x55 || reopened.read(50)==0xFF));
+
+        REQUIRE(reopened.write(60, 0x66)==0);
+        TestEEPROM again;
+        again.store = reopened.store;
+        again.init();
+        REQUIRE(again.read(60)==0x66);
+        REQUIRE(again.read(19)==expected[19]);
+    }
+}
+
+SCENARIO("EEPROM emulation struct reads are independent of the number of records", "[.][eeprom][benchmark]")
+{
+    using namespace std::chrono;
+    TestEEPROM eeprom;
+    eeprom.init();
+    const unsigned records = EEPROMPageSize/4-1;
+    for (unsigned i=0; i<records-1; i++)
+        eeprom.write(i % EEPROMCapacity, uint8_t(i));
+
+    const int iterations = 1000000;
+    Settings settings;
+    unsigned sum = 0;
+    auto start = high_resolution_clock::now();
+    for (int i=0; i<iterations; i++)
+    {
+        eeprom.read(i % 64, &settings, sizeof(settings));
+        sum += settings.flags;
+    }
+    auto elapsed = duration_cast<nanoseconds>(high_resolution_clock::now()-start).count();
+    WARN("get(" << sizeof(Settings) << " bytes): " << elapsed/iterations << " ns (" << sum << ")");
+}
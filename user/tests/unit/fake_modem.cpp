@@ -0,0 +1,841 @@
+
+#include "fake_modem.h"
+#include "fake_timer_hal.h"
+#include "mdm_hal.h"
+#include "gpio_hal.h"
+#include "modem_stubs/pinmap_impl.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+const uint64_t NEVER = UINT64_MAX;
+
+// the transmit buffer of MDMElectronSerial, a blocking put waits for room in it
+const int TX_BUFFER = 1024;
+
+const char hexDigits[] = "0123456789ABCDEF";
+
+std::string format(const char* fmt, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return buf;
+}
+
+std::string toHex(const std::string& data)
+{
+    std::string hex;
+    for (unsigned char c : data) {
+        hex += hexDigits[c >> 4];
+        hex += hexDigits[c & 0xF];
+    }
+    return hex;
+}
+
+std::string fromHex(const char* hex, size_t length)
+{
+    std::string data;
+    for (size_t i = 0; i+1 < length; i += 2) {
+        char pair[3] = { hex[i], hex[i+1], 0 };
+        data += char(strtol(pair, NULL, 16));
+    }
+    return data;
+}
+
+/**
+ * Removes the spaces outside quotes, which the modem ignores.
+ */
+std::string normalize(const std::string& command)
+{
+    std::string normal;
+    bool quoted = false;
+    for (char c : command) {
+        if (c == '\"')
+            quoted = !quoted;
+        if (quoted || c != ' ')
+            normal += c;
+    }
+    return normal;
+}
+
+bool startsWith(const std::string& s, const std::string& prefix)
+{
+    return !s.compare(0, prefix.size(), prefix);
+}
+
+/**
+ * Commands with a fixed response.
+ */
+const struct {
+    const char* command;
+    const char* response;
+} fixedResponses[] = {
+    { "AT+CGSN",    "352253060000000" },
+    { "AT+CGMI",    "u-blox" },
+    { "AT+CGMM",    "SARA-U260" },
+    { "AT+CGMR",    "23.20" },
+    { "AT+CCID",    "+CCID: 8934076500002587657" },
+    { "AT+CIMI",    "214070000000000" },
+    { "AT+COPS?",   "+COPS: 0,0,\"Fake Operator\",2" },
+    { "AT+CNUM",    "+CNUM: \"My Number\",\"+15555550100\",145" },
+    { "AT+CSQ",     "+CSQ: 20,2" },
+};
+
+} // namespace
+
+FakeModem fakeModem;
+
+FakeModem::FakeModem()
+    : serial(nullptr)
+{
+    reset();
+    fakeClock.reset();
+}
+
+void FakeModem::reset()
+{
+    baudRate = 115200;
+    commandLatency = 1000;
+    networkLatency = 100000;
+    networkRate = 0;
+    promptGuard = 50;
+    registrationDelay = 0;
+    registration = 1;
+    echoServer = true;
+    sim = "READY";
+    address = "10.0.0.2";
+    dnsAddress = "93.184.216.34";
+
+    powered = false;
+    echo = true;
+    hex = false;
+    activated = false;
+    cregUrc = 0;
+    cgregUrc = 0;
+    for (Socket& s : sockets)
+        s = Socket();
+
+    commands.clear();
+    lines = 0;
+    promptViolations = 0;
+    injectedErrors = 0;
+    bytesToModem = 0;
+    bytesFromModem = 0;
+
+    line.clear();
+    lineFeed = false;
+    fromHost.clear();
+    toHost.clear();
+    fromHostFree = 0;
+    toHostFree = 0;
+    poweredAt = 0;
+    sequence = 0;
+    promptSequence = NEVER;
+    promptTime = NEVER;
+    lineStart = 0;
+    commandTime = 0;
+    powerKey = false;
+    powerCycles = 0;
+    concatenated = false;
+    failed = false;
+    dataLength = 0;
+    events.clear();
+    failures.clear();
+    errorRate = 0;
+    random.seed(1);
+
+    fakeClock.reset();
+    fakeClock.readStep = 1;
+    fakeClock.advanced = &FakeModem::advanced;
+    fakeClock.context = this;
+}
+
+void FakeModem::failCommand(const char* prefix, int count, const char* response)
+{
+    failures.push_back({ prefix, count, response });
+}
+
+void FakeModem::setErrorRate(double rate, unsigned seed)
+{
+    errorRate = rate;
+    random.seed(seed);
+}
+
+void FakeModem::receive(int handle, const std::string& data, uint32_t delay, const char* ip, int port)
+{
+    Datagram datagram = { data, ip, port };
+    uint64_t time = fakeClock.now()+uint64_t(delay)*1000;
+    schedule(time, [=]() { arrive(handle, datagram, time); });
+}
+
+void FakeModem::closeRemote(int handle, uint32_t delay)
+{
+    uint64_t time = fakeClock.now()+uint64_t(delay)*1000;
+    schedule(time, [=]() {
+        if (isOpen(handle))
+            output(format("\r\n+UUSOCL: %d\r\n", handle), time);
+    });
+}
+
+unsigned FakeModem::count(const char* prefix) const
+{
+    return std::count_if(commands.begin(), commands.end(),
+            [=](const std::string& command) { return startsWith(command, prefix); });
+}
+
+void FakeModem::attach(ElectronSerialPipe* serial)
+{
+    this->serial = serial;
+}
+
+void FakeModem::input(const char* data, int length)
+{
+    uint64_t now = fakeClock.now();
+    uint64_t start = std::max(now, fromHostFree);
+    for (int i = 0; i < length; i++)
+        fromHost.push_back({ start+lineTime(i+1), data[i] });
+    fromHostFree = start+lineTime(length);
+    bytesToModem += length;
+    // wait for room in the transmit buffer
+    uint64_t buffered = lineTime(TX_BUFFER);
+    if (fromHostFree > now+buffered)
+        fakeClock.advance(fromHostFree-buffered-now);
+}
+
+void FakeModem::deliver(Pipe<char>& pipe)
+{
+    uint64_t now = fakeClock.now();
+    while (!toHost.empty() && toHost.front().time <= now && pipe.writeable()) {
+        if (sequence-toHost.size() == promptSequence)
+            promptTime = now;
+        pipe.putc(toHost.front().c);
+        toHost.pop_front();
+    }
+}
+
+void FakeModem::gpio(int pin, uint8_t value)
+{
+    if (pin == PWR_UC) {
+        if (!value)
+            powerKey = true;
+        else if (powerKey) {
+            powerKey = false;
+            if (!powered)
+                powerOn();
+        }
+    }
+    else if (pin == RESET_UC && !value && powered) {
+        powerOn();
+    }
+}
+
+void FakeModem::advanced(void* context)
+{
+    static_cast<FakeModem*>(context)->run();
+}
+
+/**
+ * Handles what became due by the time on the clock, in the order it happened.
+ */
+void FakeModem::run()
+{
+    uint64_t now = fakeClock.now();
+    for (;;) {
+        uint64_t next = events.empty() ? NEVER : events.begin()->first;
+        if (!fromHost.empty() && fromHost.front().time <= now && fromHost.front().time <= next) {
+            Byte byte = fromHost.front();
+            fromHost.pop_front();
+            receiveByte(byte.c, byte.time);
+        }
+        else if (next <= now) {
+            auto event = std::move(events.begin()->second);
+            events.erase(events.begin());
+            event();
+        }
+        else
+            break;
+    }
+    if (serial)
+        serial->rxIrqBuf();
+}
+
+void FakeModem::schedule(uint64_t time, std::function<void()> event)
+{
+    events.insert(std::make_pair(time, std::move(event)));
+}
+
+void FakeModem::receiveByte(char c, uint64_t time)
+{
+    if (!powered)
+        return;
+    if (lineFeed) {
+        lineFeed = false;
+        if (c == '\n')
+            return;
+    }
+    if (dataLength) {
+        // after the prompt, and in whole milliseconds from the command, as
+        // the host measures the guard time
+        if (data.data.empty() && (promptTime == NEVER || time/1000 < commandTime/1000+promptGuard))
+            dataTooSoon = true;
+        data.data += c;
+        if (!--dataLength) {
+            if (dataTooSoon) {
+                promptViolations++;
+                error(time+commandLatency);
+            }
+            else
+                sent(dataHandle, data, time+commandLatency);
+        }
+        return;
+    }
+    if (echo)
+        output(std::string(1, c), time);
+    if (c == '\r') {
+        lineFeed = true;
+        std::string command;
+        command.swap(line);
+        if (!command.empty())
+            execute(normalize(command), time);
+    }
+    else {
+        if (line.empty())
+            lineStart = time-lineTime(1);
+        line += c;
+    }
+}
+
+/**
+ * Runs the commands on a line. Commands concatenated with ";", such as
+ * "AT+CMEE=2;+CMGF=1", run in turn until one fails, with one final result
+ * code after the last.
+ */
+void FakeModem::execute(const std::string& line, uint64_t time)
+{
+    lines++;
+    std::vector<std::string> parts;
+    std::string part;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '\"')
+            quoted = !quoted;
+        if (c == ';' && !quoted) {
+            parts.push_back(part);
+            part = "AT";
+        }
+        else
+            part += c;
+    }
+    parts.push_back(part);
+    if (parts.size() == 1) {
+        perform(line, time+commandLatency);
+        return;
+    }
+    concatenated = true;
+    failed = false;
+    for (const std::string& command : parts) {
+        time += commandLatency;
+        perform(command, time);
+        if (failed)
+            break;
+    }
+    concatenated = false;
+    if (!failed)
+        output("\r\nOK\r\n", time);
+}
+
+void FakeModem::perform(const std::string& command, uint64_t time)
+{
+    commands.push_back(command);
+
+    for (Failure& failure : failures) {
+        if (failure.count && startsWith(command, failure.prefix)) {
+            failure.count--;
+            injectedErrors++;
+            if (!failure.response.empty())
+                error(time, failure.response.c_str());
+            else
+                failed = true;
+            return;
+        }
+    }
+    if (errorRate > 0 && std::uniform_real_distribution<double>()(random) < errorRate) {
+        injectedErrors++;
+        error(time);
+        return;
+    }
+
+    for (const auto& fixed : fixedResponses) {
+        if (command == fixed.command) {
+            reply(time, fixed.response);
+            return;
+        }
+    }
+
+    static const struct {
+        const char* prefix;
+        Handler handler;
+    } handlers[] = {
+        { "ATE0",           &FakeModem::echoOff },
+        { "AT+CPIN?",       &FakeModem::cpin    },
+        { "AT+CREG?",       &FakeModem::creg    },
+        { "AT+CGREG?",      &FakeModem::cgreg   },
+        { "AT+CREG=",       &FakeModem::cregMode  },
+        { "AT+CGREG=",      &FakeModem::cgregMode },
+        { "AT+UPSND=",      &FakeModem::upsnd   },
+        { "AT+UPSDA=",      &FakeModem::upsda   },
+        { "AT+UDNSRN=",     &FakeModem::udnsrn  },
+        { "AT+UDCONF=",     &FakeModem::udconf  },
+        { "AT+USOCR=",      &FakeModem::usocr   },
+        { "AT+USOCTL=",     &FakeModem::usoctl  },
+        { "AT+USOCO=",      &FakeModem::usoco   },
+        { "AT+USOWR=",      &FakeModem::usowr   },
+        { "AT+USOST=",      &FakeModem::usost   },
+        { "AT+USORD=",      &FakeModem::usord   },
+        { "AT+USORF=",      &FakeModem::usorf   },
+        { "AT+USOCL=",      &FakeModem::usocl   },
+        { "AT+CPWROFF",     &FakeModem::cpwroff },
+    };
+    for (const auto& h : handlers) {
+        if (startsWith(command, h.prefix)) {
+            (this->*h.handler)(command.substr(strlen(h.prefix)), time);
+            return;
+        }
+    }
+    // settings such as AT+CMEE=2 and AT+CGATT=1 are accepted
+    ok(time);
+}
+
+/**
+ * Queues bytes on the line to the host, after what is already queued.
+ */
+void FakeModem::output(const std::string& text, uint64_t time)
+{
+    uint64_t start = std::max(time, toHostFree);
+    for (size_t i = 0; i < text.size(); i++)
+        toHost.push_back({ start+lineTime(i+1), text[i] });
+    toHostFree = start+lineTime(text.size());
+    sequence += text.size();
+    bytesFromModem += text.size();
+}
+
+void FakeModem::reply(uint64_t time, const std::string& response)
+{
+    std::string text;
+    if (!response.empty())
+        text = "\r\n"+response+"\r\n";
+    if (!concatenated)
+        text += "\r\nOK\r\n";
+    output(text, time);
+}
+
+void FakeModem::error(uint64_t time, const char* text)
+{
+    output(std::string("\r\n")+text+"\r\n", time);
+    failed = true;
+}
+
+void FakeModem::powerOn()
+{
+    powered = true;
+    poweredAt = fakeClock.now();
+    echo = true;
+    hex = false;
+    activated = false;
+    cregUrc = 0;
+    cgregUrc = 0;
+    for (Socket& s : sockets)
+        s = Socket();
+    line.clear();
+    lineFeed = false;
+    dataLength = 0;
+    unsigned cycle = ++powerCycles;
+    if (registrationDelay) {
+        uint64_t time = poweredAt+uint64_t(registrationDelay)*1000;
+        schedule(time, [=]() {
+            if (powered && cycle == powerCycles)
+                registrationUrcs(time);
+        });
+    }
+}
+
+bool FakeModem::registered() const
+{
+    return fakeClock.now()-poweredAt >= uint64_t(registrationDelay)*1000;
+}
+
+uint64_t FakeModem::networkTime(size_t bytes) const
+{
+    return networkLatency+(networkRate ? bytes*1000000ULL/networkRate : 0);
+}
+
+void FakeModem::arrive(int handle, const Datagram& datagram, uint64_t time)
+{
+    if (!isOpen(handle))
+        return;
+    Socket& s = sockets[handle];
+    if (s.protocol == 17) {
+        s.datagrams.push_back(datagram);
+        size_t total = 0;
+        for (const Datagram& d : s.datagrams)
+            total += d.data.size();
+        output(format("\r\n+UUSORF: %d,%d\r\n", handle, int(total)), time);
+    }
+    else {
+        s.received += datagram.data;
+        output(format("\r\n+UUSORD: %d,%d\r\n", handle, int(s.received.size())), time);
+    }
+}
+
+void FakeModem::sent(int handle, const Datagram& datagram, uint64_t time)
+{
+    sockets[handle].sent += datagram.data;
+    const char* command = sockets[handle].protocol == 17 ? "+USOST" : "+USOWR";
+    reply(time, format("%s: %d,%d", command, handle, int(datagram.data.size())));
+    if (echoServer) {
+        uint64_t arrival = time+2*networkTime(datagram.data.size());
+        schedule(arrival, [=]() { arrive(handle, datagram, arrival); });
+    }
+}
+
+void FakeModem::echoOff(const std::string& args, uint64_t time)
+{
+    echo = false;
+    ok(time);
+}
+
+void FakeModem::cpin(const std::string& args, uint64_t time)
+{
+    if (sim.empty())
+        error(time, "+CME ERROR: SIM not inserted");
+    else
+        reply(time, "+CPIN: "+sim);
+}
+
+void FakeModem::creg(const std::string& args, uint64_t time)
+{
+    reply(time, format("+CREG: 2,%d,\"4E54\",\"44A5\"", registered() ? registration : 2));
+}
+
+void FakeModem::cgreg(const std::string& args, uint64_t time)
+{
+    reply(time, format("+CGREG: 2,%d,\"4E54\",\"44A5\",2", registered() ? registration : 2));
+}
+
+void FakeModem::cregMode(const std::string& args, uint64_t time)
+{
+    cregUrc = atoi(args.c_str());
+    ok(time);
+}
+
+void FakeModem::cgregMode(const std::string& args, uint64_t time)
+{
+    cgregUrc = atoi(args.c_str());
+    ok(time);
+}
+
+/**
+ * Announces the registration, when the URCs are enabled.
+ */
+void FakeModem::registrationUrcs(uint64_t time)
+{
+    if (cregUrc == 1)
+        output(format("\r\n+CREG: %d\r\n", registration), time);
+    else if (cregUrc == 2)
+        output(format("\r\n+CREG: %d,\"4E54\",\"44A5\"\r\n", registration), time);
+    if (cgregUrc == 1)
+        output(format("\r\n+CGREG: %d\r\n", registration), time);
+    else if (cgregUrc == 2)
+        output(format("\r\n+CGREG: %d,\"4E54\",\"44A5\",2\r\n", registration), time);
+}
+
+void FakeModem::upsnd(const std::string& args, uint64_t time)
+{
+    int profile, tag;
+    if (sscanf(args.c_str(), "%d,%d", &profile, &tag) != 2)
+        error(time);
+    else if (tag == 8)
+        reply(time, format("+UPSND: %d,8,%d", profile, activated ? 1 : 0));
+    else if (tag == 0 && activated)
+        reply(time, format("+UPSND: %d,0,\"%s\"", profile, address.c_str()));
+    else
+        error(time);
+}
+
+void FakeModem::upsda(const std::string& args, uint64_t time)
+{
+    int profile, action;
+    if (sscanf(args.c_str(), "%d,%d", &profile, &action) != 2)
+        error(time);
+    else if (action == 3) {
+        if (!registered() || (registration != 1 && registration != 5))
+            error(time);
+        else {
+            activated = true;
+            ok(time+2*networkLatency);
+        }
+    }
+    else {
+        if (action == 4)
+            activated = false;
+        ok(time);
+    }
+}
+
+void FakeModem::udnsrn(const std::string& args, uint64_t time)
+{
+    if (!activated)
+        error(time);
+    else
+        reply(time+2*networkLatency, "+UDNSRN: \""+dnsAddress+"\"");
+}
+
+void FakeModem::udconf(const std::string& args, uint64_t time)
+{
+    int op, value;
+    if (sscanf(args.c_str(), "%d,%d", &op, &value) == 2 && op == 1)
+        hex = value;
+    ok(time);
+}
+
+void FakeModem::usocr(const std::string& args, uint64_t time)
+{
+    int protocol;
+    if (sscanf(args.c_str(), "%d", &protocol) != 1 || (protocol != 6 && protocol != 17)) {
+        error(time);
+        return;
+    }
+    for (int handle = 0; handle < SOCKETS; handle++) {
+        if (!sockets[handle].open) {
+            sockets[handle] = Socket();
+            sockets[handle].open = true;
+            sockets[handle].protocol = protocol;
+            reply(time, format("+USOCR: %d", handle));
+            return;
+        }
+    }
+    error(time, "+CME ERROR: Operation not allowed");
+}
+
+void FakeModem::usoctl(const std::string& args, uint64_t time)
+{
+    int handle, param;
+    if (sscanf(args.c_str(), "%d,%d", &handle, &param) != 2 || !isOpen(handle))
+        error(time, "+CME ERROR: Operation not allowed");
+    else
+        reply(time, format("+USOCTL: %d,%d,%d", handle, param, sockets[handle].protocol));
+}
+
+void FakeModem::usoco(const std::string& args, uint64_t time)
+{
+    int handle, port;
+    char ip[16];
+    if (sscanf(args.c_str(), "%d,\"%15[^\"]\",%d", &handle, ip, &port) != 3 || !isOpen(handle)) {
+        error(time);
+        return;
+    }
+    sockets[handle].ip = ip;
+    sockets[handle].port = port;
+    // the TCP handshake takes a round trip
+    ok(sockets[handle].protocol == 6 ? time+2*networkLatency : time);
+}
+
+/**
+ * Sends the data given in hex with the command, or else prompts for it.
+ */
+void FakeModem::write(int handle, const Datagram& datagram, int length, const std::string& hexData, uint64_t time)
+{
+    if (hexData.size() >= 2 && hexData[0] == ',' && hexData[1] == '\"') {
+        Datagram decoded = datagram;
+        decoded.data = fromHex(hexData.c_str()+2, hexData.size()-3);
+        sent(handle, decoded, time);
+        return;
+    }
+    dataLength = length;
+    dataHandle = handle;
+    data = datagram;
+    dataTooSoon = false;
+    promptSequence = sequence+2;
+    promptTime = NEVER;
+    commandTime = lineStart;
+    output("\r\n@", time);
+}
+
+void FakeModem::usowr(const std::string& args, uint64_t time)
+{
+    int handle, length, n = 0;
+    if (sscanf(args.c_str(), "%d,%d%n", &handle, &length, &n) != 2 || !isOpen(handle) || length <= 0)
+        error(time);
+    else
+        write(handle, { "", sockets[handle].ip, sockets[handle].port }, length, args.substr(n), time);
+}
+
+void FakeModem::usost(const std::string& args, uint64_t time)
+{
+    int handle, port, length, n = 0;
+    char ip[16];
+    if (sscanf(args.c_str(), "%d,\"%15[^\"]\",%d,%d%n", &handle, ip, &port, &length, &n) != 4
+            || !isOpen(handle) || length <= 0)
+        error(time);
+    else
+        write(handle, { "", ip, port }, length, args.substr(n), time);
+}
+
+void FakeModem::usord(const std::string& args, uint64_t time)
+{
+    int handle, length;
+    if (sscanf(args.c_str(), "%d,%d", &handle, &length) != 2 || !isOpen(handle)) {
+        error(time);
+        return;
+    }
+    std::string& received = sockets[handle].received;
+    if (!length) {
+        reply(time, format("+USORD: %d,%d", handle, int(received.size())));
+        return;
+    }
+    std::string payload = received.substr(0, length);
+    received.erase(0, payload.size());
+    reply(time, format("+USORD: %d,%d,\"", handle, int(payload.size()))
+            +(hex ? toHex(payload) : payload)+"\"");
+}
+
+void FakeModem::usorf(const std::string& args, uint64_t time)
+{
+    int handle, length;
+    if (sscanf(args.c_str(), "%d,%d", &handle, &length) != 2 || !isOpen(handle)) {
+        error(time);
+        return;
+    }
+    std::deque<Datagram>& datagrams = sockets[handle].datagrams;
+    if (datagrams.empty()) {
+        reply(time, format("+USORF: %d,\"0.0.0.0\",0,0,\"\"", handle));
+        return;
+    }
+    // the rest of a datagram larger than the read is lost
+    Datagram datagram = datagrams.front();
+    datagrams.pop_front();
+    std::string payload = datagram.data.substr(0, length);
+    reply(time, format("+USORF: %d,\"%s\",%d,%d,\"", handle, datagram.ip.c_str(), datagram.port, int(payload.size()))
+            +(hex ? toHex(payload) : payload)+"\"");
+}
+
+void FakeModem::usocl(const std::string& args, uint64_t time)
+{
+    int handle;
+    if (sscanf(args.c_str(), "%d", &handle) != 1 || !isOpen(handle)) {
+        error(time);
+        return;
+    }
+    sockets[handle].open = false;
+    ok(time);
+}
+
+void FakeModem::cpwroff(const std::string& args, uint64_t time)
+{
+    ok(time);
+    powered = false;
+}
+
+// The host side of the serial port, which moves bytes to and from the fake
+// modem rather than USART3. The receive pipe fills up to its size, as with
+// RTS/CTS flow control.
+
+ElectronSerialPipe::ElectronSerialPipe(int rxSize, int txSize) :
+    _pipeRx(rxSize), _pipeTx(txSize)
+{
+}
+
+ElectronSerialPipe::~ElectronSerialPipe(void)
+{
+}
+
+void ElectronSerialPipe::begin(unsigned int baudrate)
+{
+    fakeModem.attach(this);
+}
+
+int ElectronSerialPipe::writeable(void)
+{
+    return TX_BUFFER;
+}
+
+int ElectronSerialPipe::putc(int c)
+{
+    char ch = c;
+    put(&ch, 1, true);
+    return c;
+}
+
+int ElectronSerialPipe::put(const void* buffer, int length, bool blocking)
+{
+    fakeModem.input((const char*)buffer, length);
+    return length;
+}
+
+int ElectronSerialPipe::readable(void)
+{
+    return _pipeRx.readable();
+}
+
+int ElectronSerialPipe::getc(void)
+{
+    return _pipeRx.getc();
+}
+
+int ElectronSerialPipe::get(void* buffer, int length, bool blocking)
+{
+    return _pipeRx.get((char*)buffer, length, blocking);
+}
+
+void ElectronSerialPipe::rxIrqBuf(void)
+{
+    fakeModem.deliver(_pipeRx);
+}
+
+void ElectronSerialPipe::txIrqBuf(void)
+{
+}
+
+void ElectronSerialPipe::txStart(void)
+{
+}
+
+void ElectronSerialPipe::txCopy(void)
+{
+}
+
+// constructed after fakeModem, so destroyed before it
+MDMElectronSerial electronMDM;
+
+extern "C" {
+
+STM32_Pin_Info* HAL_Pin_Map(void)
+{
+    static GPIO_TypeDef gpio;
+    static STM32_Pin_Info pins[TOTAL_PINS];
+    for (STM32_Pin_Info& pin : pins)
+        pin.gpio_peripheral = &gpio;
+    return pins;
+}
+
+void HAL_Pin_Mode(pin_t pin, PinMode mode)
+{
+}
+
+void HAL_GPIO_Write(pin_t pin, uint8_t value)
+{
+    fakeModem.gpio(pin, value);
+}
+
+void log_print_direct_(const char *msg, ...)
+{
+}
+
+}
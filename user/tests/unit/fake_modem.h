@@ -0,0 +1,223 @@
+#ifndef FAKE_MODEM_H
+#define FAKE_MODEM_H
+
+#include "pipe_hal.h"
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+class ElectronSerialPipe;
+
+/**
+ * A u-blox SARA modem on the other end of the Electron's serial port, so that
+ * MDMParser runs unmodified on the host. It answers the AT commands the parser
+ * sends with the modem's responses and unsolicited result codes, and moves
+ * the bytes over a virtual serial line at the baud rate, on the virtual clock
+ * in fake_timer_hal.h. Latency, bandwidth and failures can be configured.
+ *
+ * Sockets send to an echo server by default: data sent on a socket comes
+ * back after the network round trip, announced by +UUSORD or +UUSORF.
+ */
+struct FakeModem
+{
+    static const int SOCKETS = 7;
+
+    struct Datagram
+    {
+        std::string data;
+        std::string ip;
+        int port;
+    };
+
+    struct Socket
+    {
+        bool open;
+        int protocol;               // 6 TCP, 17 UDP
+        std::string ip;             // the peer, from +USOCO
+        int port;
+        std::string received;       // TCP data not yet read
+        std::deque<Datagram> datagrams;     // UDP data not yet read
+        std::string sent;           // everything sent on the socket
+    };
+
+    // configuration, set to defaults by reset()
+    uint32_t baudRate;              // on the serial line, 10 bits per byte
+    uint32_t commandLatency;        // microseconds from a command to its response
+    uint32_t networkLatency;        // microseconds one way to the peer
+    uint32_t networkRate;           // bytes per second to and from the peer, 0 for no limit
+    uint32_t promptGuard;           // milliseconds the data must follow the socket write command by
+    uint32_t registrationDelay;     // milliseconds from power on until registered
+    int registration;               // the +CREG and +CGREG status once registered
+    bool echoServer;                // data sent comes back from the peer
+    std::string sim;                // the +CPIN status, empty when no SIM is inserted
+    std::string address;            // the IP address given by the network
+    std::string dnsAddress;         // the answer to +UDNSRN
+
+    // state
+    bool powered;
+    bool echo;                      // commands are echoed, until ATE0
+    bool hex;                       // socket data is hex encoded, after AT+UDCONF=1,1
+    bool activated;                 // the PSD profile is active
+    int cregUrc;                    // the +CREG=<n> URC mode, 0 for none
+    int cgregUrc;                   // the +CGREG=<n> URC mode
+    Socket sockets[SOCKETS];
+
+    // what happened, cleared by reset()
+    std::vector<std::string> commands;  // every command received, without spaces
+    unsigned lines;                 // command lines received, which may hold several commands
+    unsigned promptViolations;      // socket data sent before the prompt guard passed
+    unsigned injectedErrors;
+    uint64_t bytesToModem;
+    uint64_t bytesFromModem;
+
+    FakeModem();
+
+    /**
+     * Restores the defaults, powers the modem off and takes over the virtual
+     * clock, which is reset to 0.
+     */
+    void reset();
+
+    /**
+     * The next `count` commands starting with `prefix`, such as "AT+USOWR",
+     * are answered with `response` rather than executed. An empty response
+     * leaves the command unanswered.
+     */
+    void failCommand(const char* prefix, int count=1, const char* response="ERROR");
+
+    /**
+     * Fail commands at random with ERROR.
+     * @param rate the probability a command fails, 0 to 1
+     */
+    void setErrorRate(double rate, unsigned seed=1);
+
+    /**
+     * Data from the peer arrives on a socket after a delay in milliseconds.
+     */
+    void receive(int handle, const std::string& data, uint32_t delay=0,
+            const char* ip="10.1.2.3", int port=5683);
+
+    /**
+     * The peer closes a TCP socket after a delay in milliseconds.
+     */
+    void closeRemote(int handle, uint32_t delay=0);
+
+    /**
+     * The number of commands received that start with a prefix.
+     */
+    unsigned count(const char* prefix) const;
+
+    /**
+     * The microseconds to move a number of bytes over the serial line.
+     */
+    uint64_t lineTime(size_t bytes) const
+    {
+        return bytes*10*1000000ULL/baudRate;
+    }
+
+    // the serial port on the host side, see ElectronSerialPipe in fake_modem.cpp
+    void attach(ElectronSerialPipe* serial);
+    void input(const char* data, int length);
+    void deliver(Pipe<char>& pipe);
+
+    // the power and reset lines
+    void gpio(int pin, uint8_t value);
+
+private:
+    typedef void (FakeModem::*Handler)(const std::string& args, uint64_t time);
+
+    struct Failure
+    {
+        std::string prefix;
+        int count;
+        std::string response;
+    };
+
+    struct Byte
+    {
+        uint64_t time;
+        char c;
+    };
+
+    static void advanced(void* context);
+    void run();
+    void schedule(uint64_t time, std::function<void()> event);
+    void receiveByte(char c, uint64_t time);
+    void execute(const std::string& line, uint64_t time);
+    void perform(const std::string& command, uint64_t time);
+    void output(const std::string& text, uint64_t time);
+    void reply(uint64_t time, const std::string& response);
+    void ok(uint64_t time) { reply(time, ""); }
+    void error(uint64_t time, const char* text="ERROR");
+    void powerOn();
+    void arrive(int handle, const Datagram& datagram, uint64_t time);
+    void sent(int handle, const Datagram& datagram, uint64_t time);
+    void write(int handle, const Datagram& datagram, int length, const std::string& hexData, uint64_t time);
+    bool isOpen(int handle) const
+    {
+        return handle>=0 && handle<SOCKETS && sockets[handle].open;
+    }
+    bool registered() const;
+    uint64_t networkTime(size_t bytes) const;
+
+    void echoOff(const std::string& args, uint64_t time);
+    void cpin(const std::string& args, uint64_t time);
+    void creg(const std::string& args, uint64_t time);
+    void cgreg(const std::string& args, uint64_t time);
+    void cregMode(const std::string& args, uint64_t time);
+    void cgregMode(const std::string& args, uint64_t time);
+    void registrationUrcs(uint64_t time);
+    void upsnd(const std::string& args, uint64_t time);
+    void upsda(const std::string& args, uint64_t time);
+    void udnsrn(const std::string& args, uint64_t time);
+    void udconf(const std::string& args, uint64_t time);
+    void usocr(const std::string& args, uint64_t time);
+    void usoctl(const std::string& args, uint64_t time);
+    void usoco(const std::string& args, uint64_t time);
+    void usowr(const std::string& args, uint64_t time);
+    void usost(const std::string& args, uint64_t time);
+    void usord(const std::string& args, uint64_t time);
+    void usorf(const std::string& args, uint64_t time);
+    void usocl(const std::string& args, uint64_t time);
+    void cpwroff(const std::string& args, uint64_t time);
+
+    ElectronSerialPipe* serial;
+    std::string line;               // the command being received
+    bool lineFeed;                  // a "\n" after the "\r" ending a command is ignored
+    std::deque<Byte> fromHost;      // bytes on the line to the modem
+    std::deque<Byte> toHost;        // bytes on the line to the host
+    uint64_t fromHostFree;          // when the line to the modem is next free
+    uint64_t toHostFree;
+    uint64_t poweredAt;
+    uint64_t sequence;              // bytes put in toHost so far
+    uint64_t promptSequence;        // the sequence number of the "@" prompt
+    uint64_t promptTime;            // when the prompt reached the host
+    uint64_t lineStart;             // when the host began writing the current command line
+    uint64_t commandTime;           // when the host began writing the socket write command
+    bool powerKey;                  // the power line was pulled low
+    unsigned powerCycles;           // so events from before a power cycle are dropped
+
+    // while running the commands on a concatenated line, whose final result
+    // code comes after the last
+    bool concatenated;
+    bool failed;
+
+    // raw socket data after the "@" prompt
+    int dataLength;                 // still to come, 0 when not waiting for data
+    int dataHandle;
+    Datagram data;
+    bool dataTooSoon;
+
+    std::multimap<uint64_t, std::function<void()>> events;
+    std::vector<Failure> failures;
+    double errorRate;
+    std::mt19937 random;
+};
+
+extern FakeModem fakeModem;
+
+#endif
@@ -0,0 +1,141 @@
+
+#include "fake_socket_hal.h"
+#include "inet_hal.h"
+#include "net_hal.h"
+#include "spark_wiring_network.h"
+#include <string.h>
+
+FakeSocket fakeSocket;
+
+namespace spark {
+
+class FakeNetwork : public NetworkClass
+{
+public:
+    bool ready() override
+    {
+        return fakeSocket.networkReady;
+    }
+};
+
+static FakeNetwork fakeNetwork;
+NetworkClass& Network = fakeNetwork;
+
+}
+
+extern "C" {
+
+void log_print_(int level, int line, const char *func, const char *file, const char *msg, ...)
+{
+}
+
+uint32_t HAL_WLAN_SetNetWatchDog(uint32_t timeOutInuS)
+{
+    return 0;
+}
+
+int inet_gethostbyname(const char* hostname, uint16_t hostnameLen, HAL_IPAddress* out_ip_addr,
+        network_interface_t nif, void* reserved)
+{
+    return -1;
+}
+
+sock_handle_t socket_handle_invalid()
+{
+    return sock_handle_t(-1);
+}
+
+uint8_t socket_handle_valid(sock_handle_t handle)
+{
+    return handle==FakeSocket::HANDLE;
+}
+
+uint8_t socket_active_status(sock_handle_t socket)
+{
+    fakeSocket.statusCalls++;
+    return (fakeSocket.open && fakeSocket.active) ? SOCKET_STATUS_ACTIVE : SOCKET_STATUS_INACTIVE;
+}
+
+sock_handle_t socket_create(uint8_t family, uint8_t type, uint8_t protocol, uint16_t port, network_interface_t nif)
+{
+    fakeSocket.open = true;
+    return FakeSocket::HANDLE;
+}
+
+sock_result_t socket_connect(sock_handle_t sd, const sockaddr_t *addr, long addrlen)
+{
+    fakeSocket.active = true;
+    return 0;
+}
+
+sock_result_t socket_receive(sock_handle_t sd, void* buffer, socklen_t len, system_tick_t _timeout)
+{
+    fakeSocket.receiveCalls++;
+    if (!fakeSocket.open)
+        return -1;
+    size_t count = fakeSocket.incoming.length();
+    if (count>len)
+        count = len;
+    if (count>fakeSocket.maxReceive)
+        count = fakeSocket.maxReceive;
+    memcpy(buffer, fakeSocket.incoming.data(), count);
+    fakeSocket.incoming.erase(0, count);
+    return count;
+}
+
+sock_result_t socket_send(sock_handle_t sd, const void* buffer, socklen_t len)
+{
+    fakeSocket.sendCalls++;
+    if (!fakeSocket.open || !fakeSocket.active)
+        return -1;
+    size_t count = len<fakeSocket.maxSend ? len : fakeSocket.maxSend;
+    fakeSocket.sent.append((const char*)buffer, count);
+    return count;
+}
+
+sock_result_t socket_receivefrom(sock_handle_t sd, void* buffer, socklen_t len, uint32_t flags, sockaddr_t* address, socklen_t* addr_size)
+{
+    fakeSocket.receiveCalls++;
+    if (!fakeSocket.open)
+        return -1;
+    if (fakeSocket.datagrams.empty())
+        return 0;
+    const FakeDatagram& datagram = fakeSocket.datagrams.front();
+    size_t count = datagram.data.length()<len ? datagram.data.length() : len;
+    memcpy(buffer, datagram.data.data(), count);
+    address->sa_family = AF_INET;
+    address->sa_data[0] = datagram.port >> 8;
+    address->sa_data[1] = datagram.port & 0xFF;
+    memcpy(address->sa_data+2, datagram.ip, 4);
+    fakeSocket.datagrams.pop_front();
+    return count;
+}
+
+sock_result_t socket_sendto(sock_handle_t sd, const void* buffer, socklen_t len, uint32_t flags, sockaddr_t* addr, socklen_t addr_size)
+{
+    fakeSocket.sendCalls++;
+    if (!fakeSocket.open)
+        return -1;
+    fakeSocket.sentDatagrams.push_back(FakeDatagram(std::string((const char*)buffer, len),
+        addr->sa_data[2], addr->sa_data[3], addr->sa_data[4], addr->sa_data[5], (addr->sa_data[0]<<8) | addr->sa_data[1]));
+    return len;
+}
+
+sock_result_t socket_join_multicast(const HAL_IPAddress* address, network_interface_t nif, void* reserved)
+{
+    return 0;
+}
+
+sock_result_t socket_leave_multicast(const HAL_IPAddress* address, network_interface_t nif, void* reserved)
+{
+    return 0;
+}
+
+sock_result_t socket_close(sock_handle_t sd)
+{
+    fakeSocket.open = false;
+    fakeSocket.active = false;
+    return 0;
+}
+
+}
@@ -0,0 +1,69 @@
+
+#ifndef FAKE_SOCKET_HAL_H
+#define FAKE_SOCKET_HAL_H
+
+#include "socket_hal.h"
+#include <string>
+#include <deque>
+#include <vector>
+
+struct FakeDatagram
+{
+    std::string data;
+    uint8_t ip[4];
+    uint16_t port;
+
+    FakeDatagram(const std::string& data_="", uint8_t a=0, uint8_t b=0, uint8_t c=0, uint8_t d=0, uint16_t port_=0)
+        : data(data_), port(port_)
+    {
+        ip[0] = a; ip[1] = b; ip[2] = c; ip[3] = d;
+    }
+};
+
+/**
+ * An in-memory implementation of the socket HAL for a single socket, so the
+ * wiring network classes can be tested on the host. It counts the HAL calls
+ * made, which is what matters for throughput on the devices.
+ */
+struct FakeSocket
+{
+    static const sock_handle_t HANDLE = 3;
+
+    bool networkReady;
+    bool open;
+    bool active;
+    std::string incoming;           // received from the peer and not yet read
+    std::string sent;               // everything sent to the peer
+    std::deque<FakeDatagram> datagrams;         // received and not yet read
+    std::vector<FakeDatagram> sentDatagrams;
+    size_t maxReceive;              // the most returned by one socket_receive
+    size_t maxSend;                 // the most accepted by one socket_send
+    unsigned receiveCalls;
+    unsigned sendCalls;
+    unsigned statusCalls;
+
+    FakeSocket() { reset(); }
+
+    void reset()
+    {
+        networkReady = true;
+        open = false;
+        active = false;
+        incoming.clear();
+        sent.clear();
+        datagrams.clear();
+        sentDatagrams.clear();
+        maxReceive = 1460;
+        maxSend = 1460;
+        receiveCalls = sendCalls = statusCalls = 0;
+    }
+
+    void resetCounts()
+    {
+        receiveCalls = sendCalls = statusCalls = 0;
+    }
+};
+
+extern FakeSocket fakeSocket;
+
+#endif
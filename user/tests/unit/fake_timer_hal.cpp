@@ -0,0 +1,32 @@
+
+#include "fake_timer_hal.h"
+#include "timer_hal.h"
+#include "delay_hal.h"
+
+FakeClock fakeClock;
+
+extern "C" {
+
+system_tick_t HAL_Timer_Get_Milli_Seconds(void)
+{
+    if (fakeClock.readStep)
+        fakeClock.advance(fakeClock.readStep);
+    return fakeClock.millis;
+}
+
+system_tick_t HAL_Timer_Get_Micro_Seconds(void)
+{
+    return system_tick_t(fakeClock.now());
+}
+
+void HAL_Delay_Milliseconds(uint32_t millis)
+{
+    fakeClock.advance(uint64_t(millis)*1000);
+}
+
+void HAL_Delay_Microseconds(uint32_t micros)
+{
+    fakeClock.advance(micros);
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef FAKE_TIMER_HAL_H
+#define FAKE_TIMER_HAL_H
+
+#include "system_tick_hal.h"
+#include <stdint.h>
+
+/**
+ * A virtual clock behind the timer and delay HAL, so code that waits on the
+ * clock runs instantly and deterministically on the host. Delays move the
+ * clock on; nothing else does unless readStep is set.
+ */
+struct FakeClock
+{
+    system_tick_t millis;
+    uint32_t micros;            // 0-999, the microseconds past millis
+
+    // microseconds the clock moves on each time it is read, so that code
+    // which spins on the clock rather than delaying still sees time pass
+    uint32_t readStep;
+
+    // called each time the clock moves on, to deliver whatever became due
+    void (*advanced)(void* context);
+    void* context;
+
+    FakeClock() { reset(); }
+
+    void reset()
+    {
+        millis = 0;
+        micros = 0;
+        readStep = 0;
+        advanced = nullptr;
+        context = nullptr;
+    }
+
+    /**
+     * The time in microseconds. This wraps like the millisecond clock.
+     */
+    uint64_t now() const
+    {
+        return uint64_t(millis)*1000+micros;
+    }
+
+    void advance(uint64_t us)
+    {
+        us += micros;
+        millis += system_tick_t(us/1000);
+        micros = uint32_t(us%1000);
+        if (advanced)
+            advanced(context);
+    }
+};
+
+extern FakeClock fakeClock;
+
+#endif
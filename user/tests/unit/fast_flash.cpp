@@ -0,0 +1,313 @@
+
+#include "catch.hpp"
+#include "fast_flash.h"
+#include <deque>
+#include <vector>
+#include <string>
+
+using namespace FastFlash;
+
+static uint32_t crc32(const uint8_t* data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (int i=0; i<8; i++)
+            crc = (crc>>1) ^ (0xEDB88320 & -(crc&1));
+    }
+    return ~crc;
+}
+
+/**
+ * One end of an in-memory serial link. Writes are delivered to the peer,
+ * optionally dropping or corrupting selected bytes.
+ */
+struct LoopbackChannel
+{
+    std::deque<uint8_t> input;
+    LoopbackChannel* peer = nullptr;
+    uint32_t& now;
+    size_t written = 0;
+    size_t drop_from = size_t(-1), drop_count = 0;
+    size_t corrupt_at = size_t(-1);
+
+    LoopbackChannel(uint32_t& clock) : now(clock) {}
+
+    int read()
+    {
+        if (input.empty())
+            return -1;
+        int c = input.front();
+        input.pop_front();
+        return c;
+    }
+
+    size_t write(const uint8_t* data, size_t length)
+    {
+        for (size_t i=0; i<length; i++, written++) {
+            if (written>=drop_from && written<drop_from+drop_count)
+                continue;
+            uint8_t c = data[i];
+            if (written==corrupt_at)
+                c ^= 0x55;
+            peer->input.push_back(c);
+        }
+        return length;
+    }
+
+    uint32_t millis() { return now; }
+
+    uint32_t crc32(const uint8_t* data, size_t length) { return ::crc32(data, length); }
+};
+
+struct TestSink
+{
+    std::string name;
+    uint32_t length = 0;
+    std::vector<uint8_t> data;
+    int prepare_result = 0;
+    int fail_save_at = -1;
+    int saves = 0;
+
+    int prepare(const char* name, uint32_t length)
+    {
+        this->name = name;
+        this->length = length;
+        data.assign(length, 0);
+        return prepare_result;
+    }
+
+    int save(uint32_t offset, const uint8_t* block, uint16_t size)
+    {
+        if (saves++==fail_save_at)
+            return -1;
+        memcpy(&data[offset], block, size);
+        return 0;
+    }
+};
+
+struct Link
+{
+    uint32_t now = 1000;
+    LoopbackChannel to_device, to_host;
+
+    Link() : to_device(now), to_host(now)
+    {
+        // each channel's writes are read by the other end
+        to_device.peer = &to_host;
+        to_host.peer = &to_device;
+    }
+};
+
+using TestReceiver = Receiver<LoopbackChannel, TestSink, 256>;
+using TestSender = Sender<LoopbackChannel, 256>;
+
+static std::vector<uint8_t> make_file(size_t length)
+{
+    std::vector<uint8_t> file(length);
+    for (size_t i=0; i<length; i++)
+        file[i] = uint8_t(i*7+(i>>8));
+    return file;
+}
+
+/**
+ * Runs both ends until they finish, advancing the clock a little each round.
+ */
+static void run(TestSender& sender, TestReceiver& receiver, Link& link, unsigned max_rounds=100000)
+{
+    for (unsigned i=0; i<max_rounds; i++) {
+        bool sending = sender.poll()<TestSender::COMPLETE;
+        bool receiving = receiver.poll()<TestReceiver::COMPLETE;
+        if (!sending && !receiving)
+            break;
+        link.now += 10;
+    }
+}
+
+SCENARIO("FastFlash transfers a file over a clean link", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(1000);
+    // the host writes to_device, whose bytes arrive in to_host.input, read by the device (and vice versa)
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "tinker.bin", 128);
+
+    run(sender, receiver, link);
+
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(receiver.poll()==TestReceiver::COMPLETE);
+    REQUIRE(sink.name=="tinker.bin");
+    REQUIRE(sink.length==1000);
+    REQUIRE(sink.data==file);
+    REQUIRE(sink.saves==8);
+    REQUIRE(receiver.received()==1000);
+}
+
+SCENARIO("FastFlash block size is limited by the receiver", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(600);
+    Receiver<LoopbackChannel, TestSink, 128> receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+
+    for (int i=0; i<1000 && sender.poll()<TestSender::COMPLETE; i++) {
+        receiver.poll();
+        link.now += 10;
+    }
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(sender.negotiated_block_size()==128);
+    REQUIRE(sink.data==file);
+}
+
+SCENARIO("FastFlash keeps several blocks in flight", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(2048);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256, 4);
+
+    // connect
+    sender.poll();
+    receiver.poll();
+    sender.poll();
+    REQUIRE(sender.current_state()==TestSender::SENDING);
+
+    // the first window is sent before any acknowledgement
+    size_t frame = HEADER_SIZE+256+TRAILER_SIZE;
+    REQUIRE(link.to_host.input.size()==4*frame);
+}
+
+SCENARIO("FastFlash recovers from a corrupt block", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(3000);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+    link.to_device.corrupt_at = 1000;     // within the 4th block
+
+    run(sender, receiver, link);
+
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(sink.data==file);
+}
+
+SCENARIO("FastFlash recovers from dropped data", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(3000);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+    link.to_device.drop_from = 600;
+    link.to_device.drop_count = 300;
+
+    run(sender, receiver, link);
+
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(sink.data==file);
+}
+
+SCENARIO("FastFlash recovers from a lost acknowledgement", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(3000);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+    // the hello reply is 14 bytes, drop the next few frames from the device
+    link.to_host.drop_from = 14;
+    link.to_host.drop_count = 3*(HEADER_SIZE+TRAILER_SIZE);
+
+    run(sender, receiver, link);
+
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(sink.data==file);
+}
+
+SCENARIO("FastFlash receiver cancels when the file is rejected", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    sink.prepare_result = 1;
+    auto file = make_file(100);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+
+    run(sender, receiver, link);
+
+    REQUIRE(receiver.receive()==ERROR_PREPARE);
+    REQUIRE(sender.send_file()==ERROR_PREPARE);
+}
+
+SCENARIO("FastFlash receiver cancels when a block cannot be saved", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    sink.fail_save_at = 2;
+    auto file = make_file(1000);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+
+    run(sender, receiver, link);
+
+    REQUIRE(receiver.receive()==ERROR_SAVE);
+    REQUIRE(sender.send_file()==ERROR_SAVE);
+    // only the blocks that were written were acknowledged
+    REQUIRE(sender.acknowledged()==2);
+    REQUIRE(receiver.received()==512);
+}
+
+SCENARIO("FastFlash sender ignores a Ymodem acknowledgement", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(1000);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "a", 256);
+
+    // sent by the Ymodem receiver before it saw the hello
+    const uint8_t ymodem_ack = 0x06;
+    link.to_host.write(&ymodem_ack, 1);
+    run(sender, receiver, link);
+
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(sink.data==file);
+    // without waiting for the hello to be sent again
+    uint32_t elapsed = link.now-1000;
+    REQUIRE(elapsed<2000);
+}
+
+SCENARIO("FastFlash receiver gives up when the sender goes away", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    TestReceiver receiver(link.to_host, sink);
+
+    for (int i=0; i<MAX_ERRORS+1; i++) {
+        receiver.poll();
+        link.now += 1000;
+    }
+    REQUIRE(receiver.poll()==TestReceiver::FAILED);
+    REQUIRE(receiver.receive()==ERROR_TIMEOUT);
+}
+
+SCENARIO("FastFlash receiver can resume after the hello type byte was consumed", "[fast_flash]")
+{
+    Link link;
+    TestSink sink;
+    auto file = make_file(500);
+    TestReceiver receiver(link.to_host, sink);
+    TestSender sender(link.to_device, file.data(), file.size(), "b", 256);
+
+    sender.poll();
+    REQUIRE(link.to_host.read()==HELLO);
+    receiver.resume(HELLO);
+
+    run(sender, receiver, link);
+    REQUIRE(sender.current_state()==TestSender::COMPLETE);
+    REQUIRE(sink.data==file);
+}
@@ -0,0 +1,242 @@
+
+#include "catch.hpp"
+#include "float_convert.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <random>
+#include <chrono>
+#include <functional>
+
+static std::string fixed(double value, int precision)
+{
+    char buf[400];
+    size_t length = dtoa_fixed(value, precision, buf, sizeof(buf));
+    REQUIRE(length==strlen(buf));
+    return buf;
+}
+
+static std::string c_fixed(double value, int precision)
+{
+    char buf[400];
+    snprintf(buf, sizeof(buf), "%.*f", precision, value);
+    return buf;
+}
+
+static std::string shortest(double value)
+{
+    char buf[32];
+    size_t length = dtoa_shortest(value, buf, sizeof(buf));
+    REQUIRE(length==strlen(buf));
+    return buf;
+}
+
+static int significant_digits(const std::string& text)
+{
+    std::string digits;
+    for (char c : text.substr(0, text.find('e')))
+        if (isdigit(c))
+            digits += c;
+    size_t first = digits.find_first_not_of('0');
+    if (first==std::string::npos)
+        return 0;
+    return int(digits.find_last_not_of('0')-first+1);
+}
+
+static double random_double(std::mt19937_64& rng)
+{
+    double value;
+    do {
+        uint64_t bits = rng();
+        memcpy(&value, &bits, sizeof(value));
+    } while (!isfinite(value));
+    return value;
+}
+
+static float random_float(std::mt19937_64& rng)
+{
+    float value;
+    do {
+        uint32_t bits = uint32_t(rng());
+        memcpy(&value, &bits, sizeof(value));
+    } while (!isfinite(value));
+    return value;
+}
+
+SCENARIO("dtoa_fixed formats simple values", "[float_convert]")
+{
+    REQUIRE(fixed(0, 0)=="0");
+    REQUIRE(fixed(0, 2)=="0.00");
+    REQUIRE(fixed(-0.0, 1)=="-0.0");
+    REQUIRE(fixed(1.5, 2)=="1.50");
+    REQUIRE(fixed(-123.456, 2)=="-123.46");
+    REQUIRE(fixed(0.001, 2)=="0.00");
+    REQUIRE(fixed(1e20, 1)=="100000000000000000000.0");
+    REQUIRE(fixed(3.14159, -1)=="3.141590");
+}
+
+SCENARIO("dtoa_fixed rounds ties to even", "[float_convert]")
+{
+    REQUIRE(fixed(0.5, 0)=="0");
+    REQUIRE(fixed(1.5, 0)=="2");
+    REQUIRE(fixed(2.5, 0)=="2");
+    REQUIRE(fixed(0.125, 2)=="0.12");
+    REQUIRE(fixed(0.375, 2)=="0.38");
+    // not exactly representable, so not a tie
+    REQUIRE(fixed(0.15, 1)=="0.1");
+    REQUIRE(fixed(0.35, 1)=="0.3");
+    REQUIRE(fixed(1.005, 2)=="1.00");
+}
+
+SCENARIO("dtoa_fixed writes NaN and infinity", "[float_convert]")
+{
+    REQUIRE(fixed(NAN, 2)=="nan");
+    REQUIRE(fixed(INFINITY, 2)=="inf");
+    REQUIRE(fixed(-INFINITY, 2)=="-inf");
+}
+
+SCENARIO("dtoa_fixed truncates like snprintf", "[float_convert]")
+{
+    char buf[6];
+    memset(buf, 'x', sizeof(buf));
+    REQUIRE(dtoa_fixed(-1234.5678, 3, buf, sizeof(buf))==9);
+    REQUIRE(std::string(buf)=="-1234");
+    REQUIRE(dtoa_fixed(1.0, 2, nullptr, 0)==4);
+}
+
+SCENARIO("dtoa_fixed matches the C library for extreme values", "[float_convert]")
+{
+    const double values[] = { 1.7976931348623157e308, 4.9406564584124654e-324, 2.2250738585072014e-308,
+        1e300, 1e-300, 123456789012345678901234567890.0, 9007199254740993.0, 0.1, 1e-20, 5e-21 };
+    for (double value : values) {
+        for (int precision=0; precision<=FLOAT_CONVERT_MAX_PRECISION; precision++) {
+            CAPTURE(value);
+            CAPTURE(precision);
+            REQUIRE(fixed(value, precision)==c_fixed(value, precision));
+            REQUIRE(fixed(-value, precision)==c_fixed(-value, precision));
+        }
+    }
+}
+
+SCENARIO("dtoa_fixed writes zeros beyond the maximum precision", "[float_convert]")
+{
+    const int precision = FLOAT_CONVERT_MAX_PRECISION+5;
+    std::string expected = c_fixed(0.1, FLOAT_CONVERT_MAX_PRECISION)+"00000";
+    REQUIRE(fixed(0.1, precision)==expected);
+    REQUIRE(fixed(1e300, precision)==c_fixed(1e300, precision));
+}
+
+SCENARIO("dtoa_fixed matches the C library for random values", "[float_convert]")
+{
+    std::mt19937_64 rng(1234);
+    for (int i=0; i<20000; i++) {
+        double value = random_double(rng);
+        int precision = i%21;
+        CAPTURE(value);
+        CAPTURE(precision);
+        REQUIRE(fixed(value, precision)==c_fixed(value, precision));
+    }
+
+    // values in the usual range for sensor readings
+    std::uniform_real_distribution<double> range(-1e6, 1e6);
+    for (int i=0; i<100000; i++) {
+        double value = range(rng);
+        int precision = i%11;
+        CAPTURE(value);
+        CAPTURE(precision);
+        REQUIRE(fixed(value, precision)==c_fixed(value, precision));
+    }
+}
+
+SCENARIO("dtoa_fixed matches the C library for all thousandths up to 100", "[float_convert]")
+{
+    for (int i=0; i<=100000; i++) {
+        double value = i/1000.0;
+        CAPTURE(value);
+        REQUIRE(fixed(value, 2)==c_fixed(value, 2));
+        REQUIRE(fixed(value, 3)==c_fixed(value, 3));
+    }
+}
+
+SCENARIO("dtoa_shortest formats simple values", "[float_convert]")
+{
+    REQUIRE(shortest(0)=="0");
+    REQUIRE(shortest(-0.0)=="-0");
+    REQUIRE(shortest(1)=="1");
+    REQUIRE(shortest(0.1)=="0.1");
+    REQUIRE(shortest(-2.5)=="-2.5");
+    REQUIRE(shortest(0.1+0.2)=="0.30000000000000004");
+    REQUIRE(shortest(123456.789)=="123456.789");
+    REQUIRE(shortest(1e20)=="100000000000000000000");
+    REQUIRE(shortest(1e21)=="1e+21");
+    REQUIRE(shortest(0.000001)=="0.000001");
+    REQUIRE(shortest(1.5e-7)=="1.5e-07");
+    REQUIRE(shortest(5e-324)=="5e-324");
+    REQUIRE(shortest(1.7976931348623157e308)=="1.7976931348623157e+308");
+    REQUIRE(shortest(NAN)=="nan");
+    REQUIRE(shortest(-INFINITY)=="-inf");
+}
+
+SCENARIO("dtoa_shortest converts back to the same value", "[float_convert]")
+{
+    std::mt19937_64 rng(5678);
+    for (int i=0; i<200000; i++) {
+        double value = random_double(rng);
+        std::string text = shortest(value);
+        CAPTURE(text);
+        REQUIRE(strtod(text.c_str(), nullptr)==value);
+        REQUIRE(text.length()<=25);
+        REQUIRE(significant_digits(text)<=17);
+    }
+}
+
+SCENARIO("ftoa_shortest uses the digits of a float", "[float_convert]")
+{
+    char buf[32];
+    ftoa_shortest(0.1f, buf, sizeof(buf));
+    REQUIRE(std::string(buf)=="0.1");
+    ftoa_shortest(3.4028235e38f, buf, sizeof(buf));
+    REQUIRE(std::string(buf)=="3.4028235e+38");
+    ftoa_shortest(1e-45f, buf, sizeof(buf));
+    REQUIRE(std::string(buf)=="1e-45");
+
+    std::mt19937_64 rng(91011);
+    for (int i=0; i<200000; i++) {
+        float value = random_float(rng);
+        ftoa_shortest(value, buf, sizeof(buf));
+        CAPTURE(buf);
+        REQUIRE(strtof(buf, nullptr)==value);
+        REQUIRE(significant_digits(buf)<=9);
+    }
+}
+
+SCENARIO("float conversion is faster than the C library", "[.][float_convert][benchmark]")
+{
+    using namespace std::chrono;
+    const int count = 1000;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> range(-1e5, 1e5);
+    double values[count];
+    for (int i=0; i<count; i++)
+        values[i] = range(rng);
+
+    const int iterations = 500;
+    char buf[64];
+    unsigned sum = 0;
+    auto time = [&](std::function<size_t(double)> convert) {
+        auto start = high_resolution_clock::now();
+        for (int j=0; j<iterations; j++)
+            for (int i=0; i<count; i++)
+                sum += convert(values[i]);
+        return duration_cast<nanoseconds>(high_resolution_clock::now()-start).count()/(iterations*count);
+    };
+
+    auto fixed_ns = time([&](double v) { return dtoa_fixed(v, 2, buf, sizeof(buf)); });
+    auto c_fixed_ns = time([&](double v) { return size_t(snprintf(buf, sizeof(buf), "%.2f", v)); });
+    auto shortest_ns = time([&](double v) { return dtoa_shortest(v, buf, sizeof(buf)); });
+    auto c_shortest_ns = time([&](double v) { return size_t(snprintf(buf, sizeof(buf), "%.17g", v)); });
+    WARN("dtoa_fixed: " << fixed_ns << " ns, snprintf(\"%.2f\"): " << c_fixed_ns << " ns");
+    WARN("dtoa_shortest: " << shortest_ns << " ns, snprintf(\"%.17g\"): " << c_shortest_ns << " ns (" << sum << ")");
+}
@@ -0,0 +1,175 @@
+
+#include "spark_wiring_interrupts.h"
+#undef WARN     // the logging macro from service_debug.h
+#include "catch.hpp"
+#include <chrono>
+
+/**
+ * The interrupts HAL for one pin at a time. trigger() raises the interrupt
+ * as an edge on the pin would.
+ */
+static struct FakeInterrupt
+{
+    uint16_t pin;
+    HAL_InterruptHandler handler;
+    void* data;
+    InterruptMode mode;
+
+    void trigger()
+    {
+        if (handler)
+            handler(data);
+    }
+} fakeInterrupt;
+
+extern "C" {
+
+void HAL_Interrupts_Attach(uint16_t pin, HAL_InterruptHandler handler, void* data, InterruptMode mode, void* reserved)
+{
+    fakeInterrupt.pin = pin;
+    fakeInterrupt.handler = handler;
+    fakeInterrupt.data = data;
+    fakeInterrupt.mode = mode;
+}
+
+void HAL_Interrupts_Detach(uint16_t pin)
+{
+    if (pin==fakeInterrupt.pin)
+        fakeInterrupt.handler = NULL;
+}
+
+void HAL_Interrupts_Enable_All(void)
+{
+}
+
+void HAL_Interrupts_Disable_All(void)
+{
+}
+
+uint8_t HAL_Set_System_Interrupt_Handler(hal_irq_t irq, const HAL_InterruptCallback* callback, HAL_InterruptCallback* previous, void* reserved)
+{
+    return false;
+}
+
+}
+
+static unsigned edges;
+
+static void countEdge()
+{
+    edges++;
+}
+
+struct Meter
+{
+    unsigned pulses = 0;
+    void pulse() { pulses++; }
+};
+
+// a class whose members are called through an adjusted this pointer
+struct Named
+{
+    const char* name = "named";
+    virtual ~Named() {}
+};
+
+struct NamedMeter : Named, Meter
+{
+};
+
+SCENARIO("attachInterrupt calls a function", "[interrupts]")
+{
+    edges = 0;
+    REQUIRE(attachInterrupt(D2, countEdge, RISING));
+    REQUIRE(fakeInterrupt.pin==D2);
+    REQUIRE(fakeInterrupt.mode==RISING);
+    fakeInterrupt.trigger();
+    fakeInterrupt.trigger();
+    REQUIRE(edges==2);
+    detachInterrupt(D2);
+    fakeInterrupt.trigger();
+    REQUIRE(edges==2);
+}
+
+SCENARIO("attachInterrupt calls a member function on its instance", "[interrupts]")
+{
+    Meter meter;
+    REQUIRE(attachInterrupt(D3, &Meter::pulse, &meter, FALLING));
+    fakeInterrupt.trigger();
+    REQUIRE(meter.pulses==1);
+
+    NamedMeter named;
+    void (NamedMeter::*pulse)() = &NamedMeter::pulse;
+    REQUIRE(attachInterrupt(D3, pulse, &named, FALLING));
+    fakeInterrupt.trigger();
+    fakeInterrupt.trigger();
+    REQUIRE(named.pulses==2);
+    REQUIRE(meter.pulses==1);
+    detachInterrupt(D3);
+}
+
+SCENARIO("attachInterrupt calls handlers chosen at compile time", "[interrupts]")
+{
+    edges = 0;
+    REQUIRE(attachInterrupt<countEdge>(D4, CHANGE));
+    fakeInterrupt.trigger();
+    REQUIRE(edges==1);
+
+    Meter meter;
+    REQUIRE((attachInterrupt<Meter, &Meter::pulse>(D4, &meter, CHANGE)));
+    fakeInterrupt.trigger();
+    REQUIRE(meter.pulses==1);
+    REQUIRE(edges==1);
+    detachInterrupt(D4);
+}
+
+SCENARIO("attachInterrupt replaces the handler on a pin", "[interrupts]")
+{
+    edges = 0;
+    int calls = 0;
+    REQUIRE(attachInterrupt(D5, [&calls]() { calls++; }, RISING));
+    fakeInterrupt.trigger();
+    REQUIRE(calls==1);
+
+    REQUIRE(attachInterrupt(D5, countEdge, RISING));
+    fakeInterrupt.trigger();
+    REQUIRE(calls==1);
+    REQUIRE(edges==1);
+    detachInterrupt(D5);
+}
+
+SCENARIO("attachInterrupt rejects pins that don't exist", "[interrupts]")
+{
+    Meter meter;
+    REQUIRE_FALSE(attachInterrupt(TOTAL_PINS, countEdge, RISING));
+    REQUIRE_FALSE(attachInterrupt(TOTAL_PINS, &Meter::pulse, &meter, RISING));
+    REQUIRE_FALSE(attachInterrupt<countEdge>(TOTAL_PINS, RISING));
+}
+
+template <typename F>
+static long picosecondsPerEdge(F attach)
+{
+    using namespace std::chrono;
+    const unsigned count = 10000000;
+    attach();
+    auto start = high_resolution_clock::now();
+    for (unsigned i=0; i<count; i++)
+        fakeInterrupt.trigger();
+    long elapsed = duration_cast<nanoseconds>(high_resolution_clock::now()-start).count();
+    detachInterrupt(D6);
+    return elapsed/(count/1000);
+}
+
+SCENARIO("Interrupt dispatch time by kind of handler", "[.][interrupts][benchmark]")
+{
+    Meter meter;
+    long function = picosecondsPerEdge([&]() { attachInterrupt(D6, wiring_interrupt_handler_t(countEdge), RISING); });
+    long pointer = picosecondsPerEdge([&]() { attachInterrupt(D6, countEdge, RISING); });
+    long member = picosecondsPerEdge([&]() { attachInterrupt(D6, &Meter::pulse, &meter, RISING); });
+    long fixed = picosecondsPerEdge([&]() { attachInterrupt<Meter, &Meter::pulse>(D6, &meter, RISING); });
+
+    WARN("std::function: " << function << " ps per edge");
+    WARN("function pointer: " << pointer << " ps per edge");
+    WARN("member function: " << member << " ps per edge");
+    WARN("compile-time member function: " << fixed << " ps per edge");
+}
@@ -0,0 +1,305 @@
+
+#include "catch.hpp"
+#include "lzss.h"
+#include "lzss_compress.h"
+#include "system_compressed_update.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace LZSS;
+
+typedef std::vector<uint8_t> Bytes;
+
+/**
+ * Something like firmware: instructions from a small vocabulary, with
+ * constants, strings and padding.
+ */
+static Bytes firmware(size_t length, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint16_t> instructions(300);
+    for (auto& i : instructions)
+        i = rng();
+    Bytes image;
+    while (image.size()<length) {
+        switch (rng()%10) {
+        case 0: {
+            const char* text = "connection lost, retrying in %d seconds";
+            image.insert(image.end(), text, text+strlen(text)+1);
+            break;
+        }
+        case 1:
+            image.insert(image.end(), rng()%64, 0xFF);
+            break;
+        case 2:
+            for (int i=0; i<4; i++)
+                image.push_back(rng());
+            break;
+        default: {
+            uint16_t i = instructions[rng()%instructions.size()];
+            image.push_back(i);
+            image.push_back(i>>8);
+        }
+        }
+    }
+    image.resize(length);
+    return image;
+}
+
+struct BufferSink
+{
+    Bytes data;
+    std::vector<size_t> lengths;
+    bool in_order = true;
+    int fail_at = -1;
+
+    int operator()(uint32_t offset, const uint8_t* buf, size_t length)
+    {
+        if (int(lengths.size())==fail_at)
+            return -1;
+        in_order = in_order && offset==data.size();
+        data.insert(data.end(), buf, buf+length);
+        lengths.push_back(length);
+        return 0;
+    }
+};
+
+static int expand(const Bytes& compressed, size_t piece, BufferSink& sink)
+{
+    Expander<BufferSink, 12> expander(sink);
+    for (size_t i=0; i<compressed.size(); i += piece) {
+        int result = expander.feed(compressed.data()+i, std::min(piece, compressed.size()-i));
+        if (result)
+            return result;
+    }
+    return expander.finish();
+}
+
+static bool round_trip(const Bytes& data, unsigned window_bits=LZSS_WINDOW_BITS)
+{
+    Bytes compressed = compress(data.data(), data.size(), window_bits);
+    const size_t pieces[] = { 1, 5, 512, compressed.size()+1 };
+    for (size_t piece : pieces) {
+        BufferSink sink;
+        if (expand(compressed, piece, sink) || sink.data!=data || !sink.in_order)
+            return false;
+    }
+    return true;
+}
+
+SCENARIO("LZSS expands what it compresses", "[lzss]")
+{
+    SECTION("firmware") {
+        Bytes data = firmware(100000, 1);
+        REQUIRE(round_trip(data));
+        size_t size = compress(data.data(), data.size()).size();
+        REQUIRE(size<data.size()*3/4);
+    }
+
+    SECTION("each window size") {
+        Bytes data = firmware(20000, 2);
+        for (unsigned bits=MIN_WINDOW_BITS; bits<=MAX_WINDOW_BITS; bits++)
+            REQUIRE(round_trip(data, bits));
+    }
+
+    SECTION("data that doesn't compress") {
+        std::mt19937 rng(3);
+        Bytes data(5000);
+        for (auto& b : data)
+            b = rng();
+        REQUIRE(round_trip(data));
+        size_t size = compress(data.data(), data.size()).size();
+        REQUIRE(size<=HEADER_SIZE+data.size()*9/8+1);
+    }
+
+    SECTION("a run longer than a match") {
+        Bytes data(10000, 0xFF);
+        data[5000] = 0;
+        REQUIRE(round_trip(data));
+        size_t size = compress(data.data(), data.size()).size();
+        REQUIRE(size<data.size()/10);
+    }
+
+    SECTION("short and empty data") {
+        REQUIRE(round_trip(Bytes()));
+        REQUIRE(round_trip(Bytes(1, 7)));
+        REQUIRE(round_trip(Bytes(3, 7)));
+        REQUIRE(round_trip(Bytes(4, 7)));
+    }
+}
+
+SCENARIO("LZSS writes in buffer sized blocks", "[lzss]")
+{
+    Bytes data = firmware(3000, 4);
+    Bytes compressed = compress(data.data(), data.size());
+    BufferSink sink;
+    Expander<BufferSink, 11, 64> expander(sink);
+    REQUIRE(expander.feed(compressed.data(), compressed.size())==0);
+    REQUIRE(expander.finish()==0);
+    size_t count = sink.lengths.size();
+    REQUIRE(count==(data.size()+63)/64);
+    for (size_t i=0; i+1<count; i++)
+        REQUIRE(sink.lengths[i]==64);
+    REQUIRE(expander.written()==data.size());
+}
+
+SCENARIO("LZSS refuses streams it can't expand", "[lzss]")
+{
+    Bytes data = firmware(4000, 5);
+    Bytes compressed = compress(data.data(), data.size());
+    BufferSink sink;
+
+    SECTION("not compressed") {
+        compressed[1]++;
+        REQUIRE(expand(compressed, 16, sink)==ERROR_HEADER);
+    }
+
+    SECTION("a larger window than the expander's") {
+        compressed = compress(data.data(), data.size(), 12);
+        Expander<BufferSink> expander(sink);
+        REQUIRE(expander.feed(compressed.data(), compressed.size())==ERROR_HEADER);
+    }
+
+    SECTION("a match before the start") {
+        Bytes bad(compressed.begin(), compressed.begin()+HEADER_SIZE);
+        bad.push_back(0x02);    // a literal, then a match
+        bad.push_back('a');
+        bad.push_back(0x01);    // 2 back
+        bad.push_back(0x00);
+        REQUIRE(expand(bad, 16, sink)==ERROR_CORRUPT);
+    }
+
+    SECTION("longer than the header says") {
+        write_le32(compressed.data()+8, 2);
+        Bytes bad(compressed.begin(), compressed.begin()+HEADER_SIZE);
+        bad.push_back(0x02);
+        bad.push_back('a');
+        bad.push_back(0x00);    // 3 bytes 1 back
+        bad.push_back(0x00);
+        REQUIRE(expand(bad, 16, sink)==ERROR_CORRUPT);
+    }
+
+    SECTION("cut short") {
+        compressed.resize(compressed.size()-1);
+        REQUIRE(expand(compressed, 16, sink)==ERROR_INCOMPLETE);
+    }
+
+    SECTION("the write fails") {
+        sink.fail_at = 3;
+        REQUIRE(expand(compressed, 16, sink)==ERROR_WRITE);
+    }
+}
+
+/**
+ * Flash that can only be written once without an erase.
+ */
+struct FakeFlash
+{
+    static const uint32_t BASE = 0x080C0000;
+    Bytes memory;
+    std::vector<bool> written;
+    bool rewritten = false;
+
+    FakeFlash(size_t size) : memory(size, 0xFF), written(size) {}
+
+    int write(uint32_t address, const uint8_t* data, uint32_t length)
+    {
+        if (address<BASE || address+length>BASE+memory.size())
+            return -1;
+        for (uint32_t i=0; i<length; i++) {
+            size_t at = address-BASE+i;
+            rewritten = rewritten || (written[at] && memory[at]!=data[i]);
+            memory[at] = data[i];
+            written[at] = true;
+        }
+        return 0;
+    }
+
+    const uint8_t* read(uint32_t address)
+    {
+        return memory.data()+address-BASE;
+    }
+};
+
+/**
+ * Sends a compressed image in chunks, in the order given, to the OTA region
+ * as Spark_Save_Firmware_Chunk() does.
+ */
+static int update(FakeFlash& flash, const Bytes& compressed, const std::vector<size_t>& order, size_t chunk_size=512)
+{
+    uint32_t region_end = FakeFlash::BASE+flash.memory.size();
+    uint32_t file_address = (region_end-compressed.size()) & ~3;
+    CompressedUpdate<FakeFlash> update(flash, FakeFlash::BASE, region_end, file_address, compressed.size());
+    for (size_t chunk : order) {
+        size_t offset = chunk*chunk_size;
+        size_t length = std::min(chunk_size, compressed.size()-offset);
+        int result = update.save(file_address+offset, compressed.data()+offset, length);
+        if (result)
+            return result;
+    }
+    return update.finish();
+}
+
+static std::vector<size_t> in_order(const Bytes& compressed, size_t chunk_size=512)
+{
+    std::vector<size_t> order((compressed.size()+chunk_size-1)/chunk_size);
+    for (size_t i=0; i<order.size(); i++)
+        order[i] = i;
+    return order;
+}
+
+SCENARIO("A compressed update expands into the OTA region", "[lzss]")
+{
+    Bytes image = firmware(60000, 6);
+    Bytes compressed = compress(image.data(), image.size());
+    std::vector<size_t> order = in_order(compressed);
+
+    SECTION("chunks in order need no room for the compressed image") {
+        FakeFlash flash(image.size());
+        REQUIRE(update(flash, compressed, order)==0);
+        REQUIRE(flash.memory==image);
+        REQUIRE_FALSE(flash.rewritten);
+    }
+
+    SECTION("lost chunks are sent again at the end") {
+        FakeFlash flash(image.size()+compressed.size());
+        std::vector<size_t> lossy;
+        for (size_t chunk : order)
+            if (chunk%7!=3)
+                lossy.push_back(chunk);
+        for (size_t chunk : order)
+            if (chunk%7==3)
+                lossy.push_back(chunk);
+        REQUIRE(update(flash, compressed, lossy)==0);
+        Bytes expanded(flash.memory.begin(), flash.memory.begin()+image.size());
+        REQUIRE(expanded==image);
+        REQUIRE_FALSE(flash.rewritten);
+    }
+
+    SECTION("chunks in any order, some twice") {
+        FakeFlash flash(image.size()+compressed.size());
+        std::mt19937 rng(7);
+        std::vector<size_t> shuffled = order;
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+        shuffled.insert(shuffled.begin()+5, shuffled[10]);
+        shuffled.push_back(shuffled[0]);
+        REQUIRE(update(flash, compressed, shuffled)==0);
+        Bytes expanded(flash.memory.begin(), flash.memory.begin()+image.size());
+        REQUIRE(expanded==image);
+        REQUIRE_FALSE(flash.rewritten);
+    }
+
+    SECTION("a chunk stored where the image is to go fails the update") {
+        FakeFlash flash(image.size()+512);
+        std::swap(order[2], order[order.size()-5]);
+        REQUIRE(update(flash, compressed, order)!=0);
+        REQUIRE_FALSE(flash.rewritten);
+    }
+
+    SECTION("a missing chunk fails the update") {
+        FakeFlash flash(image.size()+compressed.size());
+        order.erase(order.begin()+order.size()/2);
+        REQUIRE(update(flash, compressed, order)!=0);
+    }
+}
@@ -0,0 +1,504 @@
+
+#include "mdmlexer_hal.h"
+#undef WARN     // the logging macros from service_debug.h
+#undef INFO
+#include "catch.hpp"
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * The matcher MDMParser used before MDMLexer, which tries every response at
+ * each offset. The lexer must give the same responses.
+ */
+namespace legacy {
+
+int parseMatch(Pipe<char>* pipe, int len, const char* sta, const char* end)
+{
+    int o = 0;
+    if (sta) {
+        while (*sta) {
+            if (++o > len)                  return WAIT;
+            char ch = pipe->next();
+            if (*sta++ != ch)               return NOT_FOUND;
+        }
+    }
+    if (!end)                               return o; // no termination
+    // at least any char
+    if (++o > len)                      return WAIT;
+    pipe->next();
+    // check the end
+    int x = 0;
+    while (end[x]) {
+        if (++o > len)                      return WAIT;
+        char ch = pipe->next();
+        x = (end[x] == ch) ? x + 1 :
+            (end[0] == ch) ? 1 :
+                            0;
+    }
+    return o;
+}
+
+int parseFormated(Pipe<char>* pipe, int len, const char* fmt)
+{
+    int o = 0;
+    int num = 0;
+    if (fmt) {
+        while (*fmt) {
+            if (++o > len)                  return WAIT;
+            char ch = pipe->next();
+            if (*fmt == '%') {
+                fmt++;
+                if (*fmt == 'd') { // numeric
+                    fmt ++;
+                    num = 0;
+                    while (ch >= '0' && ch <= '9') {
+                        num = num * 10 + (ch - '0');
+                        if (++o > len)      return WAIT;
+                        ch = pipe->next();
+                    }
+                }
+                else if (*fmt == 'c') { // char buffer (takes last numeric as length)
+                    fmt ++;
+                    while (num --) {
+                        if (++o > len)      return WAIT;
+                        ch = pipe->next();
+                    }
+                }
+                else if (*fmt == 's') {
+                    fmt ++;
+                    if (ch != '\"')         return NOT_FOUND;
+                    do {
+                        if (++o > len)      return WAIT;
+                        ch = pipe->next();
+                    } while (ch != '\"');
+                    if (++o > len)          return WAIT;
+                    ch = pipe->next();
+                }
+            }
+            if (*fmt++ != ch)               return NOT_FOUND;
+        }
+    }
+    return o;
+}
+
+int getLine(Pipe<char>* pipe, char* buf, int len)
+{
+    int unkn = 0;
+    int sz = pipe->size();
+    int fr = pipe->free();
+    if (len > sz)
+        len = sz;
+    while (len > 0)
+    {
+        static struct {
+              const char* fmt;                              int type;
+        } lutF[] = {
+            { "\r\n+USORD: %d,%d,\"%c\"",                   TYPE_PLUS       },
+            { "\r\n+USORF: %d,\"" IPSTR "\",%d,%d,\"%c\"",  TYPE_PLUS       },
+            { "\r\n+URDFILE: %s,%d,\"%c\"",                 TYPE_PLUS       },
+        };
+        static struct {
+              const char* sta;          const char* end;    int type;
+        } lut[] = {
+            { "\r\nOK\r\n",             NULL,               TYPE_OK         },
+            { "\r\nERROR\r\n",          NULL,               TYPE_ERROR      },
+            { "\r\n+CME ERROR:",        "\r\n",             TYPE_ERROR      },
+            { "\r\n+CMS ERROR:",        "\r\n",             TYPE_ERROR      },
+            { "\r\nRING\r\n",           NULL,               TYPE_RING       },
+            { "\r\nCONNECT\r\n",        NULL,               TYPE_CONNECT    },
+            { "\r\nNO CARRIER\r\n",     NULL,               TYPE_NOCARRIER  },
+            { "\r\nNO DIALTONE\r\n",    NULL,               TYPE_NODIALTONE },
+            { "\r\nBUSY\r\n",           NULL,               TYPE_BUSY       },
+            { "\r\nNO ANSWER\r\n",      NULL,               TYPE_NOANSWER   },
+            { "\r\n+",                  "\r\n",             TYPE_PLUS       },
+            { "\r\n@",                  NULL,               TYPE_PROMPT     }, // Sockets
+            { "\r\n>",                  NULL,               TYPE_PROMPT     }, // SMS
+            { "\n>",                    NULL,               TYPE_PROMPT     }, // File
+            { "\r\nABORTED\r\n",        NULL,               TYPE_ABORTED    }, // Current command aborted
+        };
+        for (int i = 0; i < (int)(sizeof(lutF)/sizeof(*lutF)); i ++) {
+            pipe->set(unkn);
+            int ln = parseFormated(pipe, len, lutF[i].fmt);
+            if (ln == WAIT && fr)
+                return WAIT;
+            if ((ln != NOT_FOUND) && (unkn > 0))
+                return TYPE_UNKNOWN | pipe->get(buf, unkn);
+            if (ln > 0)
+                return lutF[i].type  | pipe->get(buf, ln);
+        }
+        for (int i = 0; i < (int)(sizeof(lut)/sizeof(*lut)); i ++) {
+            pipe->set(unkn);
+            int ln = parseMatch(pipe, len, lut[i].sta, lut[i].end);
+            if (ln == WAIT && fr)
+                return WAIT;
+            if ((ln != NOT_FOUND) && (unkn > 0))
+                return TYPE_UNKNOWN | pipe->get(buf, unkn);
+            if (ln > 0)
+                return lut[i].type | pipe->get(buf, ln);
+        }
+        // UNKNOWN
+        unkn ++;
+        len--;
+    }
+    return WAIT;
+}
+
+} // namespace legacy
+
+struct Line
+{
+    int type;
+    std::string text;
+
+    bool operator==(const Line& other) const
+    {
+        return type==other.type && text==other.text;
+    }
+};
+
+static std::ostream& operator<<(std::ostream& out, const Line& line)
+{
+    return out << std::hex << line.type << std::dec << " \"" << line.text << "\"";
+}
+
+struct LegacyLexer
+{
+    int getLine(Pipe<char>* pipe, char* buf, int len) { return legacy::getLine(pipe, buf, len); }
+    void reset() {}
+};
+
+/**
+ * Feeds data to a pipe in chunks, taking the responses after each chunk as
+ * the modem parser would. When the pipe is full and holds no response, it is
+ * purged, as the modem parser does on a timeout.
+ */
+template <typename L>
+static std::vector<Line> lex(const std::string& data, const std::vector<size_t>& chunks,
+    int pipeSize=1024, int bufferSize=1024)
+{
+    L lexer;
+    Pipe<char> pipe(pipeSize);
+    std::vector<Line> lines;
+    std::vector<char> buffer(bufferSize);
+    size_t sent = 0, chunk = 0;
+    while (sent<data.size()) {
+        size_t n = std::min(chunks[chunk++%chunks.size()], data.size()-sent);
+        int put = pipe.put(data.data()+sent, n, false);
+        sent += put;
+        int ret;
+        size_t before = lines.size();
+        while ((ret = lexer.getLine(&pipe, buffer.data(), bufferSize))!=WAIT)
+            lines.push_back(Line{ TYPE(ret), std::string(buffer.data(), LENGTH(ret)) });
+        if (!put && lines.size()==before) {
+            while (pipe.readable())
+                pipe.getc();
+            lexer.reset();
+        }
+    }
+    return lines;
+}
+
+static std::vector<Line> lexNew(const std::string& data, const std::vector<size_t>& chunks,
+    int pipeSize=1024, int bufferSize=1024)
+{
+    return lex<MDMLexer>(data, chunks, pipeSize, bufferSize);
+}
+
+static std::vector<Line> lexLegacy(const std::string& data, const std::vector<size_t>& chunks,
+    int pipeSize=1024, int bufferSize=1024)
+{
+    return lex<LegacyLexer>(data, chunks, pipeSize, bufferSize);
+}
+
+static std::string payload(size_t length)
+{
+    // binary data that contains what looks like responses
+    static const char text[] = "\r\nOK\r\n\"\r\n+UUSORD: 0,12\r\n@\0\xff";
+    std::string s;
+    for (size_t i=0; i<length; i++)
+        s += text[i*5%(sizeof(text)-1)];
+    return s;
+}
+
+/**
+ * A recording of a SARA-U260 powering on, registering, opening a socket and
+ * exchanging data.
+ */
+static std::string transcript()
+{
+    std::string s;
+    s += "\r\nOK\r\n";
+    s += "\r\nSARA-U260\r\n\r\nOK\r\n";
+    s += "\r\n352753090001234\r\n\r\nOK\r\n";
+    s += "\r\n+CPIN: READY\r\n\r\nOK\r\n";
+    s += "\r\n+CCID: 8934076500002589174\r\n\r\nOK\r\n";
+    s += "\r\n+CREG: 2,5,\"2B67\",\"5A23C1\",2\r\n\r\nOK\r\n";
+    s += "\r\n+CGREG: 2,1,\"2B67\",\"5A23C1\",2,\"01\"\r\n\r\nOK\r\n";
+    s += "\r\n+COPS: 0,0,\"T-Mobile\",2\r\n\r\nOK\r\n";
+    s += "\r\n+CSQ: 18,99\r\n\r\nOK\r\n";
+    s += "\r\n+UPSND: 0,0,\"10.52.3.7\"\r\n\r\nOK\r\n";
+    s += "\r\n+USOCR: 0\r\n\r\nOK\r\n";
+    s += "\r\nOK\r\n";
+    s += "\r\n@";
+    s += "\r\nOK\r\n";
+    s += "\r\n+UUSORD: 0,40\r\n";
+    s += "\r\n+USORD: 0,40,\"" + payload(40) + "\"\r\n\r\nOK\r\n";
+    s += "\r\n+UUSORF: 1,12\r\n";
+    s += "\r\n+USORF: 1,\"54.210.11.4\",5684,12,\"" + payload(12) + "\"\r\n\r\nOK\r\n";
+    s += "\r\n+CME ERROR: operation not allowed\r\n";
+    s += "\r\nERROR\r\n";
+    s += "\r\n+UUSOCL: 0\r\n";
+    s += "\r\n+CMTI: \"SM\",3\r\n";
+    s += "\r\n>";
+    s += "\r\n+CMS ERROR: 500\r\n";
+    s += "\r\n+URDFILE: \"cfg\",5,\"ab\r\nc\"\r\n\r\nOK\r\n";
+    s += "\r\nRING\r\n\r\nNO CARRIER\r\n\r\nBUSY\r\n\r\nNO ANSWER\r\n\r\nNO DIALTONE\r\n\r\nCONNECT\r\n";
+    s += "\r\nABORTED\r\n";
+    s += "\r\n+UUPSDD: 0\r\n";
+    s += "\n>";
+    return s;
+}
+
+SCENARIO("MDMLexer splits a modem transcript into responses", "[mdm_lexer]")
+{
+    std::vector<Line> lines = lexNew(transcript(), { 4096 });
+    REQUIRE(lines.size()==50);
+    REQUIRE(lines[0]==(Line{ TYPE_OK, "\r\nOK\r\n" }));
+    REQUIRE(lines[1]==(Line{ TYPE_UNKNOWN, "\r\nSARA-U260\r\n" }));
+    REQUIRE(lines[2]==(Line{ TYPE_OK, "\r\nOK\r\n" }));
+    REQUIRE(lines[5]==(Line{ TYPE_PLUS, "\r\n+CPIN: READY\r\n" }));
+    REQUIRE(lines[22]==(Line{ TYPE_PROMPT, "\r\n@" }));
+    REQUIRE(lines[25]==(Line{ TYPE_PLUS, "\r\n+USORD: 0,40,\"" + payload(40) + "\"" }));
+    REQUIRE(lines[26]==(Line{ TYPE_UNKNOWN, "\r\n" }));
+    REQUIRE(lines[32]==(Line{ TYPE_ERROR, "\r\n+CME ERROR: operation not allowed\r\n" }));
+    REQUIRE(lines[36]==(Line{ TYPE_PROMPT, "\r\n>" }));
+    REQUIRE(lines[38]==(Line{ TYPE_PLUS, "\r\n+URDFILE: \"cfg\",5,\"ab\r\nc\"" }));
+    REQUIRE(lines[48]==(Line{ TYPE_PLUS, "\r\n+UUPSDD: 0\r\n" }));
+    REQUIRE(lines[49]==(Line{ TYPE_PROMPT, "\n>" }));
+}
+
+SCENARIO("MDMLexer gives the same responses as the previous parser however the data arrives", "[mdm_lexer]")
+{
+    const std::string data = transcript();
+    std::vector<Line> expected = lexLegacy(data, { 4096 });
+    REQUIRE(lexNew(data, { 4096 })==expected);
+    for (size_t size=1; size<20; size++) {
+        INFO("chunks of " << size);
+        REQUIRE(lexNew(data, { size })==expected);
+        REQUIRE(lexLegacy(data, { size })==expected);
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> sizes(1, 64);
+    for (int i=0; i<100; i++) {
+        std::vector<size_t> chunks;
+        for (int j=0; j<50; j++)
+            chunks.push_back(sizes(rng));
+        REQUIRE(lexNew(data, chunks)==expected);
+    }
+}
+
+SCENARIO("MDMLexer matches the previous parser on random data", "[mdm_lexer]")
+{
+    static const char* const pieces[] = {
+        "\r", "\n", "\r\n", "+", "OK", "ERROR", "@", ">", "\"", "0", "12", ",", ":", " ", "x",
+        "+USORD: ", "+USORF: ", "+URDFILE: ", "+CME ERROR:", "NO ", "CARRIER", "1.2.3.4", "ABORTED",
+    };
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<size_t> piece(0, sizeof(pieces)/sizeof(*pieces)-1);
+    std::uniform_int_distribution<size_t> sizes(1, 16);
+    for (int i=0; i<2000; i++) {
+        std::string data;
+        while (data.size()<200)
+            data += pieces[piece(rng)];
+        std::vector<size_t> chunks;
+        for (int j=0; j<20; j++)
+            chunks.push_back(sizes(rng));
+        INFO(data);
+        // a small pipe is sometimes full, and a small buffer truncates
+        REQUIRE(lexNew(data, chunks)==lexLegacy(data, chunks));
+        REQUIRE(lexNew(data, chunks, 32)==lexLegacy(data, chunks, 32));
+        REQUIRE(lexNew(data, chunks, 1024, 24)==lexLegacy(data, chunks, 1024, 24));
+    }
+}
+
+SCENARIO("MDMLexer scans again after the pipe is purged", "[mdm_lexer]")
+{
+    Pipe<char> pipe(64);
+    MDMLexer lexer;
+    char buf[64];
+    const char junk[] = "garbage with no response";
+    pipe.put(junk, sizeof(junk)-1);
+    REQUIRE(lexer.getLine(&pipe, buf, sizeof(buf))==WAIT);
+    while (pipe.readable())
+        pipe.getc();
+    lexer.reset();
+    pipe.put("\r\nOK\r\n", 6);
+    REQUIRE(lexer.getLine(&pipe, buf, sizeof(buf))==(TYPE_OK|6));
+}
+
+/**
+ * Feeds a response to the lexer in chunks with its payload copied to a buffer.
+ */
+static std::vector<Line> lexPayload(MDMLexer& lexer, const std::string& data, size_t chunk,
+    char* payload, int size, int pipeSize=256)
+{
+    Pipe<char> pipe(pipeSize);
+    std::vector<Line> lines;
+    char buffer[128];
+    lexer.setPayload(payload, size);
+    size_t sent = 0;
+    while (sent<data.size()) {
+        sent += pipe.put(data.data()+sent, std::min(chunk, data.size()-sent));
+        int ret;
+        while ((ret = lexer.getLine(&pipe, buffer, sizeof(buffer)))!=WAIT)
+            lines.push_back(Line{ TYPE(ret), std::string(buffer, LENGTH(ret)) });
+    }
+    REQUIRE(pipe.size()==0);
+    return lines;
+}
+
+SCENARIO("MDMLexer copies a socket payload larger than the pipe to a buffer", "[mdm_lexer]")
+{
+    const std::string data = payload(1024);
+    const std::string response = "\r\n+USORD: 3,1024,\"" + data + "\"\r\n\r\nOK\r\n";
+    for (size_t chunk : { 1, 7, 64, 255 }) {
+        INFO("chunks of " << chunk);
+        MDMLexer lexer;
+        std::vector<char> buf(1024);
+        std::vector<Line> lines = lexPayload(lexer, response, chunk, buf.data(), buf.size());
+        REQUIRE(lines.size()==3);
+        REQUIRE(lines[0]==(Line{ TYPE_PLUS, "\r\n+USORD: 3,1024,\"\"" }));
+        REQUIRE(lines[1]==(Line{ TYPE_UNKNOWN, "\r\n" }));
+        REQUIRE(lines[2]==(Line{ TYPE_OK, "\r\nOK\r\n" }));
+        REQUIRE(lexer.payloadLength()==1024);
+        REQUIRE(std::string(buf.data(), buf.size())==data);
+    }
+}
+
+SCENARIO("MDMLexer copies the payload of +USORF and not of other responses", "[mdm_lexer]")
+{
+    MDMLexer lexer;
+    char buf[16];
+    std::vector<Line> lines = lexPayload(lexer,
+        "\r\n+UUSORF: 0,5\r\n\r\n+URDFILE: \"f\",2,\"ab\"\r\n"
+        "\r\n+USORF: 0,\"10.0.0.1\",5684,5,\"\r\n@\"\"\"\r\n\r\nOK\r\n", 3, buf, sizeof(buf));
+    REQUIRE(lines.size()==6);
+    REQUIRE(lines[0]==(Line{ TYPE_PLUS, "\r\n+UUSORF: 0,5\r\n" }));
+    REQUIRE(lines[1]==(Line{ TYPE_PLUS, "\r\n+URDFILE: \"f\",2,\"ab\"" }));
+    REQUIRE(lines[2]==(Line{ TYPE_UNKNOWN, "\r\n" }));
+    REQUIRE(lines[3]==(Line{ TYPE_PLUS, "\r\n+USORF: 0,\"10.0.0.1\",5684,5,\"\"" }));
+    REQUIRE(lexer.payloadLength()==5);
+    REQUIRE(std::string(buf, 5)=="\r\n@\"\"");
+}
+
+SCENARIO("MDMLexer decodes hex payloads", "[mdm_lexer]")
+{
+    MDMLexer lexer;
+    lexer.setHex(true);
+    char buf[8];
+    std::vector<Line> lines = lexPayload(lexer, "\r\n+USORD: 0,4,\"0d0A22ff\"\r\n\r\nOK\r\n", 3, buf, sizeof(buf));
+    REQUIRE(lines.size()==3);
+    REQUIRE(lines[0]==(Line{ TYPE_PLUS, "\r\n+USORD: 0,4,\"\"" }));
+    REQUIRE(lexer.payloadLength()==4);
+    REQUIRE(std::string(buf, 4)=="\r\n\"\xff");
+
+    // without a buffer the hex payload is returned with the response
+    lines = lexPayload(lexer, "\r\n+USORD: 0,2,\"0D0A\"\r\n\r\nOK\r\n", 3, NULL, 0);
+    REQUIRE(lines.size()==3);
+    REQUIRE(lines[0]==(Line{ TYPE_PLUS, "\r\n+USORD: 0,2,\"0D0A\"" }));
+}
+
+template <typename L>
+static double megabytesPerSecond(const std::string& data)
+{
+    using namespace std::chrono;
+    const int rounds = 200;
+    // the modem's output arrives a few bytes at a time
+    std::vector<size_t> chunks = { 7, 3, 16, 1, 9, 32, 5 };
+    auto start = high_resolution_clock::now();
+    size_t lines = 0;
+    for (int i=0; i<rounds; i++)
+        lines += lex<L>(data, chunks).size();
+    double elapsed = duration_cast<microseconds>(high_resolution_clock::now()-start).count();
+    REQUIRE(lines>0);
+    return data.size()*rounds/elapsed;
+}
+
+/**
+ * Receives a socket read as socketRecv() did before, into a line buffer
+ * that is then parsed and copied.
+ */
+static int receiveByLine(MDMLexer& lexer, Pipe<char>& pipe, char* dest)
+{
+    char buf[1024 + 64];
+    int ret, received = -1;
+    while ((ret = lexer.getLine(&pipe, buf, sizeof(buf) - 1))!=WAIT) {
+        int len = LENGTH(ret);
+        buf[len] = 0;
+        int sz, sk;
+        if (TYPE(ret)==TYPE_PLUS && sscanf(buf, "\r\n+USORD: %d,%d,", &sk, &sz)==2 &&
+                buf[len-sz-2]=='\"' && buf[len-1]=='\"') {
+            memcpy(dest, &buf[len-1-sz], sz);
+            received = sz;
+        }
+    }
+    return received;
+}
+
+static int receiveByPayload(MDMLexer& lexer, Pipe<char>& pipe)
+{
+    char buf[1024 + 64];
+    while (lexer.getLine(&pipe, buf, sizeof(buf) - 1)!=WAIT)
+        ;
+    return lexer.payloadLength();
+}
+
+SCENARIO("Socket reads copied directly compared with a line buffer", "[.][mdm_lexer][benchmark]")
+{
+    using namespace std::chrono;
+    for (int size : { 100, 512, 1024 }) {   // DTLS records of the cloud protocol are around 100 bytes
+        const std::string response = "\r\n+USORD: 0," + std::to_string(size) + ",\"" + payload(size) + "\"\r\n\r\nOK\r\n";
+        const int rounds = 20000;
+        Pipe<char> pipe(2048);
+        std::vector<char> dest(size);
+        MDMLexer lexer, lineLexer;
+        long elapsed[2];
+        for (int method=0; method<2; method++) {
+            auto start = high_resolution_clock::now();
+            for (int i=0; i<rounds; i++) {
+                // the modem's output arrives 64 bytes at a time
+                int received = -1;
+                lexer.setPayload(dest.data(), size);
+                for (size_t sent=0; sent<response.size(); sent+=64) {
+                    pipe.put(response.data()+sent, std::min<size_t>(64, response.size()-sent));
+                    int r = method ? receiveByPayload(lexer, pipe) : receiveByLine(lineLexer, pipe, dest.data());
+                    if (r>=0)
+                        received = r;
+                }
+                REQUIRE(received==size);
+            }
+            elapsed[method] = duration_cast<nanoseconds>(high_resolution_clock::now()-start).count()/rounds;
+        }
+        WARN(size << " byte read: line buffer " << elapsed[0] << " ns, direct " << elapsed[1] << " ns");
+    }
+}
+
+SCENARIO("MDMLexer throughput compared with the previous parser", "[.][mdm_lexer][benchmark]")
+{
+    std::string data;
+    for (int i=0; i<20; i++)
+        data += transcript();
+    // a large read of a socket
+    data += "\r\n+USORD: 0,512,\"" + payload(512) + "\"\r\n\r\nOK\r\n";
+    // text that isn't a response, such as the reply to ATI9
+    data += "\r\n" + std::string(200, 'x') + "\r\n\r\nOK\r\n";
+
+    double lexed = megabytesPerSecond<MDMLexer>(data);
+    double previous = megabytesPerSecond<LegacyLexer>(data);
+    WARN("MDMLexer: " << lexed << " MB/s, previous parser: " << previous << " MB/s");
+}
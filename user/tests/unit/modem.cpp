@@ -0,0 +1,426 @@
+
+#include "mdm_hal.h"
+#include "fake_modem.h"
+#include "fake_timer_hal.h"
+#include "delay_hal.h"
+#undef WARN     // the logging macros from service_debug.h
+#undef INFO
+#include "catch.hpp"
+#include <string>
+#include <chrono>
+
+/**
+ * Powers the simulated modem on and joins the network, and frees the sockets
+ * and the clock when done, since electronMDM outlives each test.
+ */
+struct SimulatedModem
+{
+    SimulatedModem()
+    {
+        fakeModem.reset();
+    }
+
+    ~SimulatedModem()
+    {
+        for (int socket = 0; socket < FakeModem::SOCKETS; socket++)
+            electronMDM.socketFree(socket);
+        fakeClock.reset();
+    }
+
+    bool connect(bool hex=false)
+    {
+        return electronMDM.powerOn() && electronMDM.init() &&
+            electronMDM.socketSetHexMode(hex) && electronMDM.registerNet() &&
+            electronMDM.join("apn")==IPADR(10,0,0,2);
+    }
+
+    /**
+     * Waits up to a timeout for a number of bytes to be readable on a socket.
+     */
+    int waitReadable(int socket, int length, system_tick_t timeout=5000)
+    {
+        system_tick_t start = fakeClock.millis;
+        int readable;
+        while ((readable = electronMDM.socketReadable(socket))<length && fakeClock.millis-start<timeout)
+            HAL_Delay_Milliseconds(10);
+        return readable;
+    }
+
+    std::string receive(int socket, int length)
+    {
+        std::string data(length, 0);
+        data.resize(electronMDM.socketRecv(socket, &data[0], length));
+        return data;
+    }
+};
+
+static std::string sample(size_t length)
+{
+    std::string data;
+    for (size_t i=0; i<length; i++)
+        data += char(i*7+(i>>8));      // all byte values, including "\r\n" and quotes
+    return data;
+}
+
+SCENARIO("MDMParser connects through the simulated modem", "[modem]")
+{
+    SimulatedModem modem;
+    REQUIRE(electronMDM.connect(NULL, "apn"));
+    REQUIRE(fakeModem.powered);
+    REQUIRE_FALSE(fakeModem.echo);
+    REQUIRE(fakeModem.activated);
+    REQUIRE(fakeModem.count("AT+UPSDA=0,3")==1);
+    REQUIRE(fakeModem.count("AT+CREG?")==1);
+    REQUIRE(fakeModem.injectedErrors==0);
+    REQUIRE(electronMDM.gethostbyname("example.com")==IPADR(93,184,216,34));
+
+    NetStatus status;
+    REQUIRE(electronMDM.getSignalStrength(status));
+    REQUIRE(status.rssi==-73);
+}
+
+SCENARIO("MDMParser waits for the modem to register", "[modem]")
+{
+    SimulatedModem modem;
+    fakeModem.registrationDelay = 10000;
+    REQUIRE(electronMDM.powerOn());
+    REQUIRE(electronMDM.init());
+    REQUIRE(electronMDM.registerNet());
+    // polled after 0, 1, 3 and 7 s, and as soon as the URCs came 10 s after power on
+    REQUIRE(fakeModem.count("AT+CREG?")==5);
+    REQUIRE(fakeClock.millis>=10000);
+    REQUIRE(fakeClock.millis<10500);
+
+    fakeModem.reset();
+    fakeModem.registration = 3;     // denied
+    REQUIRE(electronMDM.powerOn());
+    REQUIRE(electronMDM.init());
+    REQUIRE_FALSE(electronMDM.registerNet());
+}
+
+SCENARIO("MDMParser concatenates the bring-up commands", "[modem]")
+{
+    SimulatedModem modem;
+    bool hex = false;
+    SECTION("binary data") {}
+    SECTION("hex encoded data") { hex = true; }
+    REQUIRE(modem.connect(hex));
+    REQUIRE(fakeModem.hex==hex);
+    REQUIRE(fakeModem.cregUrc==2);
+    REQUIRE(fakeModem.cgregUrc==2);
+    REQUIRE(fakeModem.count("AT+CMGF=1")==1);
+    size_t saved = fakeModem.commands.size()-fakeModem.lines;
+    REQUIRE(saved>=7);
+
+    int count;
+    const MDMParser::StepTime* steps = electronMDM.getStepTimes(&count);
+    REQUIRE(count>0);
+    REQUIRE(std::string(steps[0].stage)=="powerOn");
+    bool registered = false;
+    int concatenated = 0;
+    for (int i=0; i<count; i++) {
+        REQUIRE(steps[i].resp==RESP_OK);
+        if (std::string(steps[i].stage)=="register")
+            registered = true;
+        if (steps[i].count>1)
+            concatenated++;
+    }
+    REQUIRE(registered);
+    REQUIRE(concatenated==3);
+    REQUIRE(std::string(steps[count-1].stage)=="join");
+}
+
+SCENARIO("MDMParser sends concatenated commands one at a time after an error", "[modem]")
+{
+    SimulatedModem modem;
+    REQUIRE(electronMDM.powerOn());
+    fakeModem.failCommand("AT+CREG=2");
+    REQUIRE(electronMDM.init());
+    REQUIRE(fakeModem.injectedErrors==1);
+    REQUIRE(fakeModem.count("AT+CGREG=2")==2);
+    REQUIRE(fakeModem.count("AT+CREG=2")==2);
+    REQUIRE(fakeModem.count("AT+CNMI=2,1")==1);     // not reached on the line
+    REQUIRE(fakeModem.cregUrc==2);
+
+    fakeModem.failCommand("AT+CMGF=1", 2);
+    REQUIRE_FALSE(electronMDM.init());
+    REQUIRE(fakeModem.count("AT+CIMI")==1);
+}
+
+SCENARIO("TCP data goes through the simulated modem and back", "[modem]")
+{
+    SimulatedModem modem;
+    bool hex = false;
+    SECTION("binary data") {}
+    SECTION("hex encoded data") { hex = true; }
+    REQUIRE(modem.connect(hex));
+    REQUIRE(fakeModem.hex==hex);
+
+    int socket = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+    REQUIRE(socket>=0);
+    REQUIRE(electronMDM.socketConnect(socket, "example.com", 5683));
+    REQUIRE(electronMDM.socketIsConnected(socket));
+
+    std::string data = sample(1500);
+    REQUIRE(electronMDM.socketSend(socket, data.data(), data.size())==int(data.size()));
+    REQUIRE(fakeModem.sockets[socket].sent==data);
+    REQUIRE(fakeModem.promptViolations==0);
+
+    REQUIRE(modem.waitReadable(socket, data.size())==int(data.size()));
+    REQUIRE(modem.receive(socket, data.size())==data);
+    REQUIRE(electronMDM.socketReadable(socket)==0);
+
+    fakeModem.closeRemote(socket, 100);
+    modem.waitReadable(socket, 1, 500);
+    REQUIRE_FALSE(electronMDM.socketIsConnected(socket));
+    REQUIRE(electronMDM.socketFree(socket));
+}
+
+SCENARIO("UDP datagrams go through the simulated modem and back", "[modem]")
+{
+    SimulatedModem modem;
+    bool hex = false;
+    SECTION("binary data") {}
+    SECTION("hex encoded data") { hex = true; }
+    REQUIRE(modem.connect(hex));
+
+    int socket = electronMDM.socketSocket(MDM_IPPROTO_UDP, 5684);
+    REQUIRE(socket>=0);
+    REQUIRE(fakeModem.count("AT+USOCR=17,5684")==1);
+
+    std::string data = sample(400);
+    MDM_IP ip = IPADR(10,1,2,3);
+    REQUIRE(electronMDM.socketSendTo(socket, ip, 5683, data.data(), data.size())==int(data.size()));
+    REQUIRE(modem.waitReadable(socket, data.size())==int(data.size()));
+
+    char buf[512];
+    MDM_IP from = NOIP;
+    int port = 0;
+    REQUIRE(electronMDM.socketRecvFrom(socket, &from, &port, buf, sizeof(buf))==int(data.size()));
+    REQUIRE(std::string(buf, data.size())==data);
+    REQUIRE(from==ip);
+    REQUIRE(port==5683);
+
+    // the parser and the modem both number sockets from the lowest free
+    fakeModem.receive(socket, "pushed", 200, "10.9.8.7", 1234);
+    REQUIRE(modem.waitReadable(socket, 6)==6);
+    REQUIRE(electronMDM.socketRecvFrom(socket, &from, &port, buf, sizeof(buf))==6);
+    REQUIRE(from==IPADR(10,9,8,7));
+    REQUIRE(port==1234);
+}
+
+SCENARIO("MDMParser counts the data sent and received on each socket", "[modem]")
+{
+    SimulatedModem modem;
+    REQUIRE(modem.connect());
+    electronMDM.resetDataUsage();
+
+    int tcp = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+    REQUIRE(electronMDM.socketConnect(tcp, IPADR(10,1,2,3), 80));
+    std::string data = sample(1500);     // written in two blocks
+    REQUIRE(electronMDM.socketSend(tcp, data.data(), data.size())==int(data.size()));
+    REQUIRE(modem.waitReadable(tcp, data.size())==int(data.size()));
+    REQUIRE(modem.receive(tcp, data.size())==data);
+
+    int udp = electronMDM.socketSocket(MDM_IPPROTO_UDP, 5684);
+    REQUIRE(electronMDM.socketSendTo(udp, IPADR(10,1,2,3), 5683, "ping", 4)==4);
+    REQUIRE(modem.waitReadable(udp, 4)==4);
+    char buf[16];
+    MDM_IP from;
+    int port;
+    REQUIRE(electronMDM.socketRecvFrom(udp, &from, &port, buf, sizeof(buf))==4);
+
+    CellularDataCount count;
+    REQUIRE(electronMDM.socketDataCount(tcp, &count));
+    REQUIRE(count.tx_bytes==1500);
+    REQUIRE(count.tx_packets==2);
+    REQUIRE(count.rx_bytes==1500);
+    REQUIRE(count.rx_packets==2);
+    REQUIRE(electronMDM.socketDataCount(udp, &count));
+    REQUIRE(count.tx_bytes==4);
+    REQUIRE(count.rx_packets==1);
+    REQUIRE_FALSE(electronMDM.socketDataCount(6, &count));
+
+    CellularDataUsage usage;
+    electronMDM.getDataUsage(&usage);
+    REQUIRE(usage.size==sizeof(usage));
+    REQUIRE(usage.tcp.tx_bytes==1500);
+    REQUIRE(usage.tcp.rx_bytes==1500);
+    REQUIRE(usage.udp.tx_bytes==4);
+    REQUIRE(usage.udp.rx_bytes==4);
+    REQUIRE(usage.tx_headers==2*40+28);
+    REQUIRE(usage.rx_headers==2*40+28);
+
+    GIVEN("the cloud connection's share of the data")
+    {
+        electronMDM.countCloudData(CELLULAR_DATA_PING, true, 33, 29);
+        electronMDM.countCloudData(CELLULAR_DATA_EVENT, true, 100, 29);
+        electronMDM.countCloudData(CELLULAR_DATA_EVENT, false, 50, 29);
+        electronMDM.countCloudData(CELLULAR_DATA_CATEGORIES, true, 10, 0);
+        electronMDM.getDataUsage(&usage);
+        REQUIRE(usage.cloud[CELLULAR_DATA_PING].tx_packets==1);
+        REQUIRE(usage.cloud[CELLULAR_DATA_EVENT].tx_bytes==100);
+        REQUIRE(usage.cloud[CELLULAR_DATA_EVENT].rx_bytes==50);
+        // pings are overhead in full, so their framing isn't counted again
+        REQUIRE(usage.tx_security==29);
+        REQUIRE(usage.rx_security==29);
+
+        char report[768];
+        int length = MDMParser::formatDataUsage(&usage, report, sizeof(report));
+        REQUIRE(length==int(strlen(report)));
+        std::string json(report);
+        REQUIRE(json.find("{\"tcp\":[1500,1500,2,2],\"udp\":[4,4,1,1],\"cloud\":{\"handshake\":[0,0,0,0],\"ping\":[33,0,1,0],")==0);
+        // 3008 payload bytes and 216 of headers, with the headers, the event framing and the ping as overhead
+        REQUIRE(json.find("\"total\":3224,\"user\":2825,\"overhead\":{\"headers\":216,\"security\":58,\"handshake\":0,\"ping\":33,\"ack\":0,\"retransmit\":0,\"total\":307,\"percent\":9}}")!=std::string::npos);
+
+        char small[16];
+        REQUIRE(MDMParser::formatDataUsage(&usage, small, sizeof(small))==length);
+        REQUIRE(std::string(small)==json.substr(0, sizeof(small)-1));
+    }
+
+    electronMDM.resetDataUsage();
+    electronMDM.getDataUsage(&usage);
+    REQUIRE(usage.tcp.tx_bytes==0);
+    REQUIRE(usage.tx_headers==0);
+    REQUIRE(usage.size==sizeof(usage));
+}
+
+SCENARIO("MDMParser recovers from errors injected by the simulated modem", "[modem]")
+{
+    SimulatedModem modem;
+
+    GIVEN("a failed PDP context activation")
+    {
+        fakeModem.failCommand("AT+UPSDA=0,3");
+        REQUIRE(modem.connect());
+        // the next authentication protocol is tried
+        REQUIRE(fakeModem.count("AT+UPSDA=0,3")==2);
+        REQUIRE(fakeModem.injectedErrors==1);
+    }
+
+    GIVEN("a command that is not answered")
+    {
+        REQUIRE(electronMDM.powerOn());
+        fakeModem.failCommand("AT+CGSN", 1, "");
+        system_tick_t start = fakeClock.millis;
+        REQUIRE_FALSE(electronMDM.init());
+        system_tick_t elapsed = fakeClock.millis-start;
+        REQUIRE(elapsed>=5000);
+        REQUIRE(electronMDM.init());
+    }
+
+    GIVEN("a failed socket write")
+    {
+        REQUIRE(modem.connect());
+        int socket = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+        REQUIRE(electronMDM.socketConnect(socket, IPADR(10,1,2,3), 80));
+        fakeModem.failCommand("AT+USOWR", 1, "+CME ERROR: Operation not allowed");
+        REQUIRE(electronMDM.socketSend(socket, "hello", 5)==MDM_SOCKET_ERROR);
+        REQUIRE(electronMDM.socketSend(socket, "hello", 5)==5);
+        REQUIRE(fakeModem.sockets[socket].sent=="hello");
+    }
+
+    GIVEN("commands that fail at random")
+    {
+        REQUIRE(modem.connect());
+        int socket = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+        REQUIRE(electronMDM.socketConnect(socket, IPADR(10,1,2,3), 80));
+        fakeModem.setErrorRate(0.2);
+        int sent = 0;
+        for (int i=0; i<100; i++) {
+            if (electronMDM.socketSend(socket, "0123456789", 10)==10)
+                sent++;
+        }
+        REQUIRE(fakeModem.injectedErrors==unsigned(100-sent));
+        REQUIRE(sent>60);
+        REQUIRE(sent<95);
+        REQUIRE(fakeModem.sockets[socket].sent.size()==size_t(sent*10));
+        REQUIRE(fakeModem.promptViolations==0);
+    }
+}
+
+SCENARIO("The wait for the socket write prompt counts towards the guard time", "[modem]")
+{
+    SimulatedModem modem;
+    REQUIRE(modem.connect());
+    int socket = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+    REQUIRE(electronMDM.socketConnect(socket, IPADR(10,1,2,3), 80));
+
+    // the prompt and the final result each take 30ms. Only the rest of the
+    // 50ms guard is waited out after the prompt, rather than all of it.
+    fakeModem.commandLatency = 30000;
+    system_tick_t start = fakeClock.millis;
+    REQUIRE(electronMDM.socketSend(socket, "hello", 5)==5);
+    system_tick_t elapsed = fakeClock.millis-start;
+    REQUIRE(fakeModem.promptViolations==0);
+    REQUIRE(fakeModem.sockets[socket].sent=="hello");
+    REQUIRE(elapsed>=80);
+    REQUIRE(elapsed<110);
+}
+
+SCENARIO("The simulated modem rejects socket data sent too soon after the prompt", "[modem]")
+{
+    SimulatedModem modem;
+    REQUIRE(modem.connect());
+    int socket = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+    REQUIRE(electronMDM.socketConnect(socket, IPADR(10,1,2,3), 80));
+
+    // write the command and the data without waiting for the prompt
+    const char command[] = "AT+USOWR=0,5\r\nhello";
+    electronMDM.send(command, sizeof(command)-1);
+    REQUIRE(electronMDM.waitFinalResp()==RESP_PROMPT);
+    REQUIRE(electronMDM.waitFinalResp()==RESP_ERROR);
+    REQUIRE(fakeModem.promptViolations==1);
+    REQUIRE(fakeModem.sockets[socket].sent.empty());
+}
+
+/**
+ * Virtual and CPU time for a packet to go to the echo server and back.
+ */
+static void benchmarkEcho(SimulatedModem& modem, int socket, size_t length, bool hex)
+{
+    using namespace std::chrono;
+    const int count = 20;
+    std::string data = sample(length);
+    uint64_t virtualTime = 0;
+    auto start = high_resolution_clock::now();
+    for (int i=0; i<count; i++) {
+        uint64_t begin = fakeClock.now();
+        REQUIRE(electronMDM.socketSend(socket, data.data(), data.size())==int(data.size()));
+        REQUIRE(modem.waitReadable(socket, data.size())==int(data.size()));
+        REQUIRE(modem.receive(socket, data.size())==data);
+        virtualTime += fakeClock.now()-begin;
+    }
+    long cpu = duration_cast<microseconds>(high_resolution_clock::now()-start).count()/count;
+    WARN((hex ? "hex " : "binary ") << length << " bytes: " << virtualTime/count/1000
+            << " ms on the modem, " << cpu << " us of CPU on the host");
+}
+
+SCENARIO("Socket round trip through the simulated modem", "[.][modem][benchmark]")
+{
+    SimulatedModem modem;
+    bool hex = false;
+    SECTION("binary data") {}
+    SECTION("hex encoded data") { hex = true; }
+    REQUIRE(modem.connect(hex));
+    electronMDM.setDebug(-1);
+    int socket = electronMDM.socketSocket(MDM_IPPROTO_TCP);
+    REQUIRE(electronMDM.socketConnect(socket, IPADR(10,1,2,3), 5684));
+    for (size_t length : { 100, 512, 1024 })
+        benchmarkEcho(modem, socket, length, hex);
+    electronMDM.setDebug(3);
+}
+
+SCENARIO("Bring-up through the simulated modem", "[.][modem][benchmark]")
+{
+    SimulatedModem modem;
+    fakeModem.registrationDelay = 3000;
+    REQUIRE(modem.connect());
+    WARN("connected after " << fakeClock.millis << " ms and " << fakeModem.lines
+            << " command lines (" << fakeModem.commands.size() << " commands)");
+    int count;
+    const MDMParser::StepTime* steps = electronMDM.getStepTimes(&count);
+    for (int i=0; i<count; i++)
+        WARN(steps[i].stage << " AT" << steps[i].cmd << " (" << steps[i].count
+                << " commands): " << steps[i].ms << " ms");
+}
@@ -0,0 +1,5 @@
+/**
+ * mdm_hal.cpp includes the RTOS concurrency HAL but only locks with
+ * std::recursive_mutex, which the host provides.
+ */
+#pragma once
@@ -0,0 +1,22 @@
+/**
+ * The STM32 pin map with the fields the modem parser uses.
+ */
+#pragma once
+
+#include "pinmap_hal.h"
+#include "stm32f2xx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct STM32_Pin_Info {
+  GPIO_TypeDef* gpio_peripheral;
+  pin_t gpio_pin;
+} STM32_Pin_Info;
+
+STM32_Pin_Info* HAL_Pin_Map(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,24 @@
+/**
+ * The few STM32 peripheral definitions the modem parser touches, so that
+ * mdm_hal.cpp builds on the host. The pin registers are plain memory.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef struct
+{
+    volatile uint32_t MODER;
+    volatile uint32_t OTYPER;
+    volatile uint32_t OSPEEDR;
+    volatile uint32_t PUPDR;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint16_t BSRRL;
+    volatile uint16_t BSRRH;
+} GPIO_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR1;
+} TIM_TypeDef;
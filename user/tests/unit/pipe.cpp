@@ -0,0 +1,158 @@
+
+#include "pipe_hal.h"
+#undef WARN     // the logging macros from service_debug.h
+#undef INFO
+#include "catch.hpp"
+#include <thread>
+#include <algorithm>
+#include <string>
+#include <stdint.h>
+
+SCENARIO("Pipe puts and gets blocks that wrap around the end", "[pipe]")
+{
+    Pipe<char> pipe(8);
+    char buf[16];
+    REQUIRE(pipe.free()==7);
+    REQUIRE(pipe.put("01234", 5)==5);
+    REQUIRE(pipe.get(buf, 5)==5);
+    REQUIRE_FALSE(pipe.readable());
+
+    REQUIRE(pipe.put("abcdefghij", 10)==7);
+    REQUIRE_FALSE(pipe.writeable());
+    REQUIRE(pipe.size()==7);
+    REQUIRE(pipe.getc()=='a');
+    REQUIRE(pipe.putc('h')=='h');
+    REQUIRE(pipe.get(buf, sizeof(buf))==7);
+    REQUIRE(std::string(buf, 7)=="bcdefgh");
+    REQUIRE(pipe.free()==7);
+}
+
+SCENARIO("Pipe uses a buffer given to it", "[pipe]")
+{
+    char storage[4];
+    Pipe<char> pipe(sizeof(storage), storage);
+    REQUIRE(pipe.put("xyz", 3)==3);
+    REQUIRE(std::string(storage, 3)=="xyz");
+}
+
+SCENARIO("Pipe moves elements larger than a byte", "[pipe]")
+{
+    Pipe<uint32_t> pipe(5);
+    const uint32_t values[] = { 0x01020304, 0xA0B0C0D0, 7 };
+    uint32_t buf[3] = {};
+    for (int round=0; round<3; round++) {
+        REQUIRE(pipe.put(values, 3)==3);
+        REQUIRE(pipe.get(buf, 3)==3);
+        REQUIRE(buf[0]==values[0]);
+        REQUIRE(buf[1]==values[1]);
+        REQUIRE(buf[2]==values[2]);
+    }
+}
+
+SCENARIO("Pipe parses ahead of the read position until done", "[pipe]")
+{
+    Pipe<char> pipe(8);
+    pipe.put("xxxxx", 5);
+    pipe.get(nullptr, 0);
+    char buf[8];
+    pipe.get(buf, 5);
+    pipe.put("+CSQ: 9", 7);     // wraps after "+CS"
+
+    REQUIRE(pipe.set(6)==1);
+    REQUIRE(pipe.next()=='9');
+    REQUIRE(pipe.set(10)==0);
+    REQUIRE(pipe.set(0)==7);
+    std::string head;
+    for (int i=0; i<5; i++)
+        head += pipe.next();
+    REQUIRE(head=="+CSQ:");
+    REQUIRE(pipe.size()==7);
+    pipe.done();
+    REQUIRE(pipe.size()==2);
+    REQUIRE(pipe.get(buf, sizeof(buf))==2);
+    REQUIRE(std::string(buf, 2)==" 9");
+}
+
+SCENARIO("Pipe gives contiguous spans to fill and read in place", "[pipe]")
+{
+    Pipe<char> pipe(8);
+    char buf[8];
+    pipe.put("xxxxxx", 6);
+    pipe.get(buf, 6);
+
+    char* space;
+    REQUIRE(pipe.writeSpan(space)==2);
+    memcpy(space, "ab", 2);
+    pipe.produce(2);
+    REQUIRE(pipe.writeSpan(space)==5);
+    memcpy(space, "cdefg", 5);
+    pipe.produce(5);
+    REQUIRE(pipe.writeSpan(space)==0);
+    REQUIRE(pipe.size()==7);
+
+    const char* data;
+    REQUIRE(pipe.readSpan(data)==2);
+    REQUIRE(std::string(data, 2)=="ab");
+    pipe.consume(2);
+    REQUIRE(pipe.readSpan(data)==5);
+    REQUIRE(std::string(data, 5)=="cdefg");
+    pipe.consume(5);
+    REQUIRE_FALSE(pipe.readable());
+}
+
+/**
+ * Sends a counting sequence from a producer thread through the pipe, and
+ * checks it arrives complete and in order. Each side yields when the pipe
+ * is full or empty rather than spinning, so this runs on one CPU.
+ */
+static bool stress(int size, bool blocks)
+{
+    Pipe<char> pipe(size);
+    const int count = 200000;
+    std::thread producer([&pipe, count, blocks]() {
+        char block[13];
+        for (int sent = 0; sent<count; ) {
+            if (!pipe.writeable())
+                std::this_thread::yield();
+            else if (blocks) {
+                int n = 0;
+                while (n<13 && sent+n<count) {
+                    block[n] = char(sent+n);
+                    n++;
+                }
+                sent += pipe.put(block, n);
+            }
+            else
+                pipe.putc(char(sent++));
+        }
+    });
+
+    bool ordered = true;
+    char block[11];
+    for (int received = 0; received<count; ) {
+        if (!pipe.readable())
+            std::this_thread::yield();
+        else if (blocks) {
+            int n = pipe.get(block, std::min(11, count-received));
+            for (int i=0; i<n; i++)
+                ordered = ordered && block[i]==char(received+i);
+            received += n;
+        }
+        else
+            ordered = ordered && pipe.getc()==char(received++);
+    }
+    producer.join();
+    return ordered && !pipe.readable();
+}
+
+SCENARIO("Pipe passes data between threads without loss", "[pipe]")
+{
+    SECTION("one element at a time") {
+        REQUIRE(stress(7, false));
+        REQUIRE(stress(256, false));
+    }
+    SECTION("in blocks") {
+        REQUIRE(stress(7, true));
+        REQUIRE(stress(256, true));
+    }
+}
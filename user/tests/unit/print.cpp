@@ -1,6 +1,11 @@
 
 #include "catch.hpp"
 #include "spark_wiring_print.h"
+#include <stdarg.h>
+#include <limits.h>
+#include <math.h>
+#include <string>
+#include <vector>
 
 
 class BufferPrint : public Print
@@ -56,3 +61,162 @@ SCENARIO("Print.printf() with a a > 20 char string", "[print]")
     print.printf("abcdabcdabcdabcd %d xyzxyzxyzxyzxyzxyzxyzxyz", 100);
     REQUIRE(String("abcdabcdabcdabcd 100 xyzxyzxyzxyzxyzxyzxyzxyz") == print.result());
 }
+
+/**
+ * Records the size of each write.
+ */
+class ChunkPrint : public BufferPrint
+{
+public:
+    std::vector<size_t> writes;
+
+    using BufferPrint::write;
+
+    size_t write(const uint8_t* buffer, size_t size) override
+    {
+        writes.push_back(size);
+        return Print::write(buffer, size);
+    }
+};
+
+static std::string c_format(const char* format, ...)
+{
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return buf;
+}
+
+#define REQUIRE_PRINTF(...) \
+    do { \
+        BufferPrint print; \
+        print.printf(__VA_ARGS__); \
+        REQUIRE(std::string(print.result().c_str()) == c_format(__VA_ARGS__)); \
+    } while (0)
+
+SCENARIO("Print.printf() formats integers the same as the C library", "[print]")
+{
+    REQUIRE_PRINTF("%d %i %u", 0, -1, 42u);
+    REQUIRE_PRINTF("%d %d", INT_MIN, INT_MAX);
+    REQUIRE_PRINTF("%ld %lu", LONG_MIN, ULONG_MAX);
+    REQUIRE_PRINTF("%lld %llu", LLONG_MIN, ULLONG_MAX);
+    REQUIRE_PRINTF("%hhd %hd %hhu %hu", 300, 70000, 300, 70000);
+    REQUIRE_PRINTF("%zu %zd", sizeof(int), (ptrdiff_t)-5);
+    REQUIRE_PRINTF("[%5d] [%-5d] [%05d] [%+d] [% d] [%+05d]", 42, 42, 42, 42, 42, -42);
+    REQUIRE_PRINTF("[%.3d] [%8.3d] [%-8.3d] [%08.3d] [%.0d]", 7, 7, -7, 7, 0);
+    REQUIRE_PRINTF("%x %X %o %#x %#X %#o %#o", 255u, 255u, 8u, 255u, 255u, 8u, 0u);
+    REQUIRE_PRINTF("[%#10x] [%#010x] [%-#10x] [%#x]", 0xbeefu, 0xbeefu, 0xbeefu, 0u);
+    REQUIRE_PRINTF("%llx %llo", 0x123456789abcdefULL, 0x123456789abcdefULL);
+    REQUIRE_PRINTF("[%*d] [%-*d] [%.*d] [%*d]", 6, 1, 6, 2, 4, 3, -6, 4);
+}
+
+SCENARIO("Print.printf() formats strings and characters the same as the C library", "[print]")
+{
+    REQUIRE_PRINTF("%s|%10s|%-10s|%.2s|%8.3s", "abc", "abc", "abc", "abc", "abcdef");
+    REQUIRE_PRINTF("%c%c%c [%3c] [%-3c]", 'a', 'b', 'c', 'x', 'y');
+    REQUIRE_PRINTF("100%% %s", "done");
+    REQUIRE_PRINTF("%s", "");
+}
+
+SCENARIO("Print.printf() formats floating point values the same as the C library", "[print]")
+{
+    REQUIRE_PRINTF("%f %f %f", 0.0, 1.5, -123.456);
+    REQUIRE_PRINTF("%.0f %.1f %.10f", 2.5, 0.05, 1.0/3);
+    REQUIRE_PRINTF("[%10.2f] [%-10.2f] [%010.2f] [%+.2f] [% .2f] [%+010.2f]", 3.14159, 3.14159, -3.14159, 3.14159, 3.14159, 3.14159);
+    REQUIRE_PRINTF("%e %E %.3e %g %G %g %g", 12345.678, 0.000123, 1e100, 0.0001, 1e-10, 123456789.0, 100.0);
+    REQUIRE_PRINTF("%#g %#.0f %#.0e", 1.0, 3.0, 3.0);
+    REQUIRE_PRINTF("%f %f %F [%08f] [%-8f]", INFINITY, -INFINITY, NAN, INFINITY, NAN);
+    REQUIRE_PRINTF("%a %A %.2a [%012a]", 1.0, 255.5, 3.0, 1.0);
+    REQUIRE_PRINTF("%Lf", (long double)2.25);
+    REQUIRE_PRINTF("%f", 1e30);
+    REQUIRE_PRINTF("%F %+F % f [%+12.3f] [%-+12.3f]", -INFINITY, INFINITY, 0.5, 2.0625, -0.001);
+    REQUIRE_PRINTF("%.2f %.2f %.3f %.0f %.0f", 0.125, 0.375, 1.0005, 0.5, 1.5);
+    REQUIRE_PRINTF("%.20f %.40f", 0.1, 1e-30);
+}
+
+SCENARIO("Print.print() formats doubles with the given number of digits", "[print]")
+{
+    BufferPrint test;
+    test.print(1.999, 2);
+    test.print(' ');
+    test.print(-0.125, 2);
+    test.print(' ');
+    test.print(4294967296.5, 1);
+    test.print(' ');
+    test.print(1e300, 2);
+    test.print(' ');
+    test.print(0.1, -1);
+    test.print(' ');
+    test.println(1e-9, -1);
+    REQUIRE(test.result()=="2.00 -0.12 4294967296.5 ovf 0.1 1e-09\r\n");
+}
+
+SCENARIO("Print.printf() writes output longer than its buffer in chunks", "[print]")
+{
+    ChunkPrint print;
+    std::string expected;
+    for (int i=0; i<50; i++)
+        expected += c_format("line %d: %s\n", i, "some text");
+    for (int i=0; i<50; i++)
+        print.printf("line %d: %s\n", i, "some text");
+    REQUIRE(std::string(print.result().c_str()) == expected);
+
+    ChunkPrint chunked;
+    size_t n = chunked.printf("%s%300s%s", "start", "middle", "end");
+    REQUIRE(n == 308);
+    REQUIRE(chunked.result().length() == 308);
+    REQUIRE(chunked.writes.size() == 5);
+    for (size_t size : chunked.writes)
+        REQUIRE(size <= 64);
+}
+
+SCENARIO("Print.printf() returns the number of characters written", "[print]")
+{
+    BufferPrint print;
+    REQUIRE(print.printf("%d-%s", 123, "abc") == 7);
+    REQUIRE(print.printlnf("%d", 5) == 3);
+}
+
+SCENARIO("Print.printf() stores the count for %n", "[print]")
+{
+    BufferPrint print;
+    int count = 0;
+    print.printf("abc%n%d", &count, 10);
+    REQUIRE(count == 3);
+}
+
+SCENARIO("Print.printf() stores the count for %n in the size given", "[print]")
+{
+    BufferPrint print;
+    struct { signed char count; char after[3]; } chars = { 0, { 'x', 'y', 'z' } };
+    struct { short count; short after; } shorts = { 0, 0x5A5A };
+    long long longlong = -1;
+    size_t size = 0;
+    print.printf("abc%hhn%hn%lln%zn", &chars.count, &shorts.count, &longlong, &size);
+    REQUIRE(chars.count == 3);
+    REQUIRE(chars.after[0] == 'x');
+    REQUIRE(chars.after[2] == 'z');
+    REQUIRE(shorts.count == 3);
+    REQUIRE(shorts.after == 0x5A5A);
+    REQUIRE(longlong == 3);
+    REQUIRE(size == 3);
+}
+
+SCENARIO("Print subclasses can still call the C library vprintf", "[print]")
+{
+    struct Logger : public BufferPrint
+    {
+        // unqualified lookup finds the member first when Print has one
+        int (*c_vprintf())(const char*, va_list) { return vprintf; }
+    } logger;
+    REQUIRE(logger.c_vprintf() == &::vprintf);
+}
+
+SCENARIO("String::format() produces long strings", "[print]")
+{
+    String s = String::format("%s-%0100d-%s", "a", 7, "b");
+    REQUIRE(s.length() == 104);
+    REQUIRE(std::string(s.c_str()) == c_format("%s-%0100d-%s", "a", 7, "b"));
+}
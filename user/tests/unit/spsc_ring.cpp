@@ -0,0 +1,144 @@
+
+#include "spsc_ring.h"
+#include "catch.hpp"
+#include <thread>
+#include <string>
+#include <string.h>
+
+SCENARIO("SPSCRing holds one element less than its size", "[spsc_ring]")
+{
+    uint8_t storage[5];
+    SPSCRing<uint8_t> ring(storage, sizeof(storage));
+    REQUIRE(ring.empty());
+    REQUIRE(ring.capacity()==4);
+    REQUIRE(ring.space()==4);
+
+    for (uint8_t i=0; i<4; i++)
+        REQUIRE(ring.put(i));
+    REQUIRE(ring.full());
+    REQUIRE_FALSE(ring.put(9));
+    REQUIRE(ring.available()==4);
+
+    uint8_t c;
+    REQUIRE(ring.peek(c));
+    REQUIRE(c==0);
+    for (uint8_t i=0; i<4; i++) {
+        REQUIRE(ring.get(c));
+        REQUIRE(c==i);
+    }
+    REQUIRE_FALSE(ring.get(c));
+    REQUIRE(ring.empty());
+}
+
+SCENARIO("SPSCRing without storage is always empty and full", "[spsc_ring]")
+{
+    SPSCRing<uint8_t> ring;
+    uint8_t c = 1;
+    REQUIRE(ring.empty());
+    REQUIRE(ring.full());
+    REQUIRE(ring.capacity()==0);
+    REQUIRE_FALSE(ring.put(c));
+    REQUIRE_FALSE(ring.get(c));
+    REQUIRE(ring.write(&c, 1)==0);
+}
+
+SCENARIO("SPSCRing bulk reads and writes wrap around the end", "[spsc_ring]")
+{
+    char storage[7];
+    SPSCRing<char> ring(storage, sizeof(storage));
+    char buf[16];
+    for (int round=0; round<10; round++) {
+        REQUIRE(ring.write("abcd", 4)==4);
+        REQUIRE(ring.available()==4);
+        REQUIRE(ring.read(buf, 3)==3);
+        REQUIRE(std::string(buf, 3)=="abc");
+        REQUIRE(ring.read(buf, sizeof(buf))==1);
+        REQUIRE(buf[0]=='d');
+    }
+    REQUIRE(ring.write("0123456789", 10)==6);
+    REQUIRE(ring.space()==0);
+    REQUIRE(ring.read(buf, sizeof(buf))==6);
+    REQUIRE(std::string(buf, 6)=="012345");
+}
+
+SCENARIO("SPSCRing gives contiguous blocks for copying in place", "[spsc_ring]")
+{
+    char storage[8];
+    SPSCRing<char> ring(storage, sizeof(storage));
+    ring.write("xxxxxx", 6);
+    ring.consume(6);
+
+    char* space;
+    REQUIRE(ring.writable(space)==2);
+    REQUIRE(space==storage+6);
+    space[0] = 'a'; space[1] = 'b';
+    ring.produce(2);
+    REQUIRE(ring.writable(space)==5);
+    REQUIRE(space==storage);
+    memcpy(space, "cdefg", 5);
+    ring.produce(5);
+    REQUIRE(ring.full());
+
+    const char* data;
+    REQUIRE(ring.readable(data)==2);
+    REQUIRE(std::string(data, 2)=="ab");
+    ring.consume(2);
+    REQUIRE(ring.readable(data)==5);
+    REQUIRE(std::string(data, 5)=="cdefg");
+    ring.clear();
+    REQUIRE(ring.empty());
+}
+
+SCENARIO("SPSCRing follows a head moved by hardware", "[spsc_ring]")
+{
+    char storage[8];
+    SPSCRing<char> ring(storage, sizeof(storage));
+    // a circular DMA transfer that has written 5 bytes
+    memcpy(storage, "hello", 5);
+    ring.setHead(5);
+    REQUIRE(ring.available()==5);
+    char buf[8];
+    REQUIRE(ring.read(buf, 4)==4);
+
+    // the transfer wraps, writing " worl" after the "o"
+    memcpy(storage+5, " wo", 3);
+    memcpy(storage, "rl", 2);
+    ring.setHead(2);
+    REQUIRE(ring.available()==6);
+    REQUIRE(ring.read(buf, sizeof(buf))==6);
+    REQUIRE(std::string(buf, 6)=="o worl");
+    REQUIRE(ring.empty());
+}
+
+SCENARIO("SPSCRing passes data between threads without loss", "[spsc_ring]")
+{
+    uint32_t storage[61];
+    SPSCRing<uint32_t> ring(storage, 61);
+    const uint32_t count = 200000;
+
+    std::thread producer([&ring, count]() {
+        uint32_t block[7];
+        uint32_t next = 0;
+        while (next<count) {
+            uint32_t n = 0;
+            while (n<7 && next+n<count) {
+                block[n] = next+n;
+                n++;
+            }
+            next += ring.write(block, n);
+        }
+    });
+
+    uint32_t expected = 0;
+    bool ordered = true;
+    while (expected<count) {
+        uint32_t value;
+        if (ring.get(value)) {
+            ordered = ordered && value==expected;
+            expected++;
+        }
+    }
+    producer.join();
+    REQUIRE(ordered);
+    REQUIRE(ring.empty());
+}
@@ -0,0 +1,200 @@
+
+#include "catch.hpp"
+#include "spark_wiring_stream.h"
+#include "fake_timer_hal.h"
+#include <string>
+#include <deque>
+
+static system_tick_t& now = fakeClock.millis;
+
+/**
+ * A stream whose data arrives at given times. Waiting moves the clock on to
+ * the next arrival, or to the end of the timeout.
+ */
+class TimedStream : public Stream
+{
+    std::deque<std::pair<system_tick_t, char>> pending;
+    std::string received;
+
+    void receive()
+    {
+        while (!pending.empty() && pending.front().first<=now) {
+            received += pending.front().second;
+            pending.pop_front();
+        }
+    }
+
+public:
+    unsigned reads = 0;
+    unsigned waits = 0;
+    system_tick_t lastWait = 0;
+
+    void arrive(system_tick_t at, const std::string& data)
+    {
+        for (char c : data)
+            pending.push_back(std::make_pair(at, c));
+    }
+
+    virtual int available() override
+    {
+        receive();
+        return received.length();
+    }
+
+    virtual int read() override
+    {
+        reads++;
+        int c = peek();
+        if (c>=0)
+            received.erase(0, 1);
+        return c;
+    }
+
+    virtual int peek() override
+    {
+        receive();
+        return received.empty() ? -1 : (unsigned char)received[0];
+    }
+
+    virtual void flush() override {}
+    virtual size_t write(uint8_t) override { return 1; }
+
+    virtual bool waitAvailable(system_tick_t timeout) override
+    {
+        waits++;
+        lastWait = timeout;
+        if (!available()) {
+            if (!pending.empty() && pending.front().first-now<timeout)
+                now = pending.front().first;
+            else
+                now += timeout;
+        }
+        return available()>0;
+    }
+};
+
+/**
+ * A stream that reports data is available but then has none to read.
+ */
+class SpuriousStream : public TimedStream
+{
+public:
+    virtual bool waitAvailable(system_tick_t timeout) override
+    {
+        TimedStream::waitAvailable(timeout);
+        now -= timeout-100;
+        return true;
+    }
+};
+
+/**
+ * A stream that relies on the default waitAvailable(), with the clock moving
+ * on each time it is polled.
+ */
+class PolledStream : public Stream
+{
+public:
+    unsigned polls = 0;
+    system_tick_t readyAt = 0;
+
+    virtual int available() override
+    {
+        polls++;
+        now++;
+        return now>=readyAt ? 1 : 0;
+    }
+    virtual int read() override { return -1; }
+    virtual int peek() override { return -1; }
+    virtual void flush() override {}
+    virtual size_t write(uint8_t) override { return 1; }
+};
+
+SCENARIO("Stream waits for data instead of polling read()", "[stream]")
+{
+    now = 1000;
+    TimedStream stream;
+    stream.arrive(1100, "he");
+    stream.arrive(1500, "llo");
+    char buf[5];
+    REQUIRE(stream.readBytes(buf, sizeof(buf))==5);
+    REQUIRE(std::string(buf, 5)=="hello");
+    REQUIRE(stream.waits==2);
+    REQUIRE(stream.reads==7);
+    REQUIRE(now==1500);
+}
+
+SCENARIO("Stream timed reads give up after the timeout", "[stream]")
+{
+    now = 0;
+    TimedStream stream;
+    stream.setTimeout(250);
+    stream.arrive(100, "ab");
+    stream.arrive(500, "c");
+    REQUIRE(stream.readString()=="ab");
+    REQUIRE(now==350);
+    REQUIRE(stream.waits==2);
+    REQUIRE(stream.lastWait==250);
+
+}
+
+SCENARIO("Stream waits only for what is left of the timeout", "[stream]")
+{
+    now = 0;
+    SpuriousStream stream;
+    stream.setTimeout(250);
+    REQUIRE(stream.read()==-1);
+    char c;
+    REQUIRE(stream.readBytes(&c, 1)==0);
+    REQUIRE(stream.waits==3);
+    REQUIRE(stream.lastWait==50);
+    REQUIRE(now==300);
+}
+
+SCENARIO("Stream parses numbers that arrive in pieces", "[stream]")
+{
+    now = 0;
+    TimedStream stream;
+    stream.arrive(10, "x-12");
+    stream.arrive(600, "34,");
+    stream.arrive(700, "5.25 ");
+    REQUIRE(stream.parseInt()==-1234);
+    REQUIRE(stream.read()==',');
+    REQUIRE(stream.parseFloat()==Approx(5.25));
+}
+
+SCENARIO("Stream reads a line up to the terminator", "[stream]")
+{
+    now = 0;
+    TimedStream stream;
+    stream.arrive(0, "GET");
+    stream.arrive(900, " /\nrest");
+    REQUIRE(stream.readStringUntil('\n')=="GET /");
+    REQUIRE(stream.waits==1);
+}
+
+SCENARIO("Stream with a zero timeout reads only what has arrived", "[stream]")
+{
+    now = 0;
+    TimedStream stream;
+    stream.setTimeout(0);
+    stream.arrive(0, "a");
+    stream.arrive(1, "b");
+    REQUIRE(stream.readString()=="a");
+    REQUIRE(stream.waits==0);
+}
+
+SCENARIO("Stream waitAvailable polls available() by default", "[stream]")
+{
+    now = 0;
+    PolledStream stream;
+    stream.readyAt = 20;
+    REQUIRE(stream.waitAvailable(100));
+    REQUIRE(stream.polls==20);
+
+    now = 0;
+    stream.polls = 0;
+    stream.readyAt = 1000;
+    REQUIRE_FALSE(stream.waitAvailable(50));
+    REQUIRE(now>=50);
+    REQUIRE(now<60);
+}
@@ -70,6 +70,24 @@ TEST_CASE("Can convert negative float no decimals rounding up") {
     REQUIRE(String(-123.2, 0)=="-123");
 }
 
+TEST_CASE("Can convert float to string with the shortest digits") {
+    REQUIRE(String(0.1, -1)=="0.1");
+    REQUIRE(String(0.1f, -1)=="0.1");
+    REQUIRE(String(double(0.1f), -1)=="0.10000000149011612");
+    REQUIRE(String(1e25, -1)=="1e+25");
+}
+
+TEST_CASE("Can convert large float to string") {
+    String s(1e100, 2);
+    REQUIRE(s.length()==104);
+    REQUIRE(s.startsWith("10000000000000000159028911097599180468360808563945281389781327557747838772170381060813469985856815104.00"));
+    s = "x=";
+    s += String(1e30f, 0);
+    REQUIRE(s=="x=1000000015047466219876688855040");
+    REQUIRE(s.concat(1e20));
+    REQUIRE(s.endsWith("100000000000000000000.000000"));
+}
+
 TEST_CASE("Can format a string using printf like syntax") {
     REQUIRE(String::format("%d %s %s please", 3, "lemon", "curries")==String("3 lemon curries please"));
 }
@@ -77,3 +95,184 @@ TEST_CASE("Can format a string using printf like syntax") {
 TEST_CASE("Can convert a string to lowercase") {
     REQUIRE(String("In LOWERCAse").toLowerCase()==String("in lowercase"));
 }
+
+TEST_CASE("Short strings are stored inline") {
+    String s("abc");
+    REQUIRE(s=="abc");
+    REQUIRE(s.length()==3);
+    const char* p = s.c_str();
+    REQUIRE((p>=(const char*)&s && p<(const char*)(&s+1)));
+}
+
+TEST_CASE("A string that grows beyond the inline buffer keeps its value") {
+    String s("abcdef");
+    s += "ghijklmnop";
+    s += 'q';
+    REQUIRE(s=="abcdefghijklmnopq");
+    REQUIRE(s.length()==17);
+}
+
+TEST_CASE("A string can be appended to itself") {
+    String s("0123456789");
+    s += s;
+    REQUIRE(s=="01234567890123456789");
+    String t("ab");
+    t += t;
+    t += t;
+    REQUIRE(t=="abababab");
+}
+
+TEST_CASE("Moving a string takes over its buffer") {
+    String s("a string that doesn't fit inline");
+    const char* p = s.c_str();
+    String t(std::move(s));
+    REQUIRE(t.c_str()==p);
+    REQUIRE(t=="a string that doesn't fit inline");
+    REQUIRE(s.length()==0);
+    REQUIRE(s=="");
+
+    String u("xyz");
+    u = std::move(t);
+    REQUIRE(u.c_str()==p);
+}
+
+TEST_CASE("Moving a short string copies it inline") {
+    String s("abc");
+    String t(std::move(s));
+    REQUIRE(t=="abc");
+    String u;
+    u = std::move(t);
+    REQUIRE(u=="abc");
+}
+
+TEST_CASE("Concatenation chains produce the expected value") {
+    String name("temp");
+    String result = name + "=" + 21 + ", humidity=" + 45u + "%" + ", light=" + 1234L + ", status=" + String("ok") + '!';
+    REQUIRE(result=="temp=21, humidity=45%, light=1234, status=ok!");
+}
+
+TEST_CASE("Concatenation chains longer than the helper buffer produce the expected value") {
+    String part("0123456789");
+    String result = part + part + part + part + part + part + part + part + part + part;
+    REQUIRE(result.length()==100);
+    REQUIRE(result.substring(90)=="0123456789");
+}
+
+TEST_CASE("Concatenation with a null string invalidates the result") {
+    const char* null = nullptr;
+    String s = String("abc") + null;
+    REQUIRE(s.c_str()==nullptr);
+}
+
+TEST_CASE("Replace can grow a string beyond the inline buffer") {
+    String s("a-b-c");
+    s.replace("-", "---");
+    REQUIRE(s=="a---b---c");
+}
+
+TEST_CASE("Reserve keeps the existing value") {
+    String s("abc");
+    REQUIRE(s.reserve(100));
+    REQUIRE(s=="abc");
+    s += "def";
+    REQUIRE(s=="abcdef");
+}
+
+#if defined(__GLIBC__)
+/**
+ * Counts heap allocations, so that the number made by String operations can be checked.
+ */
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+static bool count_allocations = false;
+static unsigned allocations = 0;
+
+extern "C" void* malloc(size_t size) __THROW
+{
+    if (count_allocations) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) __THROW
+{
+    if (count_allocations) allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) __THROW
+{
+    if (count_allocations) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void free(void* ptr) __THROW
+{
+    __libc_free(ptr);
+}
+
+template <typename F> unsigned allocations_for(F f)
+{
+    allocations = 0;
+    count_allocations = true;
+    f();
+    count_allocations = false;
+    return allocations;
+}
+
+TEST_CASE("Short strings don't allocate", "[string][benchmark]") {
+    // previously 1 allocation per string
+    unsigned count = allocations_for([] {
+        String a("abc");
+        String b(42);
+        String c = a;
+        String d;
+        d = "xyz";
+    });
+    WARN("short strings: " << count << " allocations");
+    REQUIRE(count==0);
+}
+
+TEST_CASE("Building a payload with + makes one allocation", "[string][benchmark]") {
+    // previously 10 allocations, one per operand
+    String device("photon");
+    unsigned count = allocations_for([&] {
+        String payload = "{\"d\":\"" + device + "\",\"t\":" + 21 + ",\"h\":" + 45 + ",\"l\":" + 1234 + "}";
+    });
+    WARN("payload with +: " << count << " allocations");
+    REQUIRE(count==1);
+}
+
+TEST_CASE("Appending a character at a time grows geometrically", "[string][benchmark]") {
+    // previously 1 allocation per character
+    unsigned count = allocations_for([] {
+        String s;
+        for (int i=0; i<200; i++)
+            s += 'x';
+    });
+    WARN("200 appends: " << count << " allocations");
+    REQUIRE(count<=10);
+}
+
+TEST_CASE("Appending after reserve doesn't allocate", "[string][benchmark]") {
+    String s;
+    s.reserve(200);
+    unsigned count = allocations_for([&] {
+        for (int i=0; i<40; i++)
+            s += "abcde";
+    });
+    REQUIRE(count==0);
+}
+
+TEST_CASE("Returning a string by value doesn't copy it", "[string][benchmark]") {
+    String s("a string that doesn't fit inline");
+    unsigned count = allocations_for([&] {
+        String t(std::move(s));
+        String u;
+        u = std::move(t);
+    });
+    REQUIRE(count==0);
+}
+#endif
@@ -0,0 +1,168 @@
+
+#include "spark_wiring_tcpclient.h"
+#include "fake_socket_hal.h"
+#undef WARN     // the logging macro from service_debug.h
+#include "catch.hpp"
+#include <chrono>
+
+static void connect(TCPClient& client)
+{
+    fakeSocket.reset();
+    REQUIRE(client.connect(IPAddress(10, 0, 0, 1), 80));
+    fakeSocket.resetCounts();
+}
+
+static std::string payload(size_t length)
+{
+    std::string s;
+    for (size_t i=0; i<length; i++)
+        s += char('a'+(i*7)%26);
+    return s;
+}
+
+SCENARIO("TCPClient reads into the caller's buffer when nothing is buffered", "[tcpclient]")
+{
+    TCPClient client;
+    connect(client);
+    const std::string data = payload(10000);
+    fakeSocket.incoming = data;
+
+    std::string received;
+    uint8_t buf[4096];
+    int n;
+    while ((n = client.read(buf, sizeof(buf)))>0)
+        received.append((const char*)buf, n);
+    REQUIRE(received==data);
+    // one receive per 1460-byte segment and one to find there's no more
+    REQUIRE(fakeSocket.receiveCalls==8);
+}
+
+SCENARIO("TCPClient bulk reads return buffered data first", "[tcpclient]")
+{
+    TCPClient client;
+    connect(client);
+    fakeSocket.incoming = "hello world";
+    fakeSocket.maxReceive = 8;
+    REQUIRE(client.read()=='h');
+
+    uint8_t buf[16];
+    REQUIRE(client.read(buf, sizeof(buf))==7);
+    REQUIRE(std::string((char*)buf, 7)=="ello wo");
+    REQUIRE(client.read(buf, sizeof(buf))==3);
+    REQUIRE(std::string((char*)buf, 3)=="rld");
+    REQUIRE(client.read(buf, sizeof(buf))==-1);
+    REQUIRE(client.read()==-1);
+}
+
+SCENARIO("TCPClient uses a receive buffer supplied by the application", "[tcpclient]")
+{
+    uint8_t rx[1024];
+    TCPClient client(rx, sizeof(rx));
+    connect(client);
+    fakeSocket.incoming = payload(5000);
+    fakeSocket.maxReceive = 5000;
+    REQUIRE(client.available()==1024);
+    REQUIRE(client.peek()=='a');
+
+    std::string received;
+    int c;
+    while ((c = client.read())>=0)
+        received += char(c);
+    REQUIRE(received==payload(5000));
+    REQUIRE(fakeSocket.receiveCalls==6);
+}
+
+SCENARIO("TCPClient collects writes in the transmit buffer until flush", "[tcpclient]")
+{
+    uint8_t rx[256], tx[256];
+    TCPClient client(rx, sizeof(rx), tx, sizeof(tx));
+    connect(client);
+
+    client.print("GET /index.html HTTP/1.0\r\n");
+    client.print("Host: ");
+    client.println("example.com");
+    client.printf("Content-Length: %d\r\n\r\n", 0);
+    REQUIRE(fakeSocket.sendCalls==0);
+
+    client.flush();
+    REQUIRE(fakeSocket.sendCalls==1);
+    REQUIRE(fakeSocket.sent=="GET /index.html HTTP/1.0\r\nHost: example.com\r\nContent-Length: 0\r\n\r\n");
+    client.flush();
+    REQUIRE(fakeSocket.sendCalls==1);
+}
+
+SCENARIO("TCPClient sends buffered output when the buffer fills", "[tcpclient]")
+{
+    uint8_t tx[100];
+    TCPClient client(NULL, 0, tx, sizeof(tx));
+    connect(client);
+
+    const std::string data = payload(250);
+    for (char c : data)
+        client.write(uint8_t(c));
+    REQUIRE(fakeSocket.sendCalls==2);
+    REQUIRE(fakeSocket.sent==data.substr(0, 200));
+
+    // the buffer is topped up and sent, and the rest sent without copying
+    const std::string large = payload(1000);
+    REQUIRE(client.write((const uint8_t*)large.data(), large.length())==large.length());
+    REQUIRE(fakeSocket.sendCalls==4);
+    REQUIRE(fakeSocket.sent==data+large);
+
+    client.print("end");
+    client.stop();
+    REQUIRE(fakeSocket.sent==data+large+"end");
+}
+
+SCENARIO("TCPClient sends buffered output before reading the reply", "[tcpclient]")
+{
+    uint8_t tx[64];
+    TCPClient client(NULL, 0, tx, sizeof(tx));
+    connect(client);
+    client.print("PING");
+    fakeSocket.incoming = "PONG";
+    REQUIRE(client.available()==4);
+    REQUIRE(fakeSocket.sent=="PING");
+}
+
+SCENARIO("TCPClient flush discards received data without a transmit buffer", "[tcpclient]")
+{
+    TCPClient client;
+    connect(client);
+    fakeSocket.incoming = payload(300);
+    client.flush();
+    REQUIRE(client.available()==0);
+    REQUIRE(client.write((const uint8_t*)"x", 1)==1);
+    REQUIRE(fakeSocket.sent=="x");
+}
+
+SCENARIO("TCPClient bulk download makes fewer socket calls", "[.][tcpclient][benchmark]")
+{
+    using namespace std::chrono;
+    const std::string data = payload(300*1024);
+
+    TCPClient client;
+    connect(client);
+    fakeSocket.incoming = data;
+    size_t total = 0;
+    auto start = high_resolution_clock::now();
+    while (client.read()>=0)
+        total++;
+    auto bytewise = duration_cast<microseconds>(high_resolution_clock::now()-start).count();
+    unsigned bytewiseCalls = fakeSocket.receiveCalls;
+    REQUIRE(total==data.length());
+
+    connect(client);
+    fakeSocket.incoming = data;
+    uint8_t buf[1460];
+    int n;
+    total = 0;
+    start = high_resolution_clock::now();
+    while ((n = client.read(buf, sizeof(buf)))>0)
+        total += n;
+    auto bulk = duration_cast<microseconds>(high_resolution_clock::now()-start).count();
+    REQUIRE(total==data.length());
+
+    WARN("300KB by read(): " << bytewiseCalls << " socket_receive calls, " << bytewise << " us");
+    WARN("300KB by read(buf, 1460): " << fakeSocket.receiveCalls << " socket_receive calls, " << bulk << " us");
+}
@@ -0,0 +1,216 @@
+
+#include "spark_wiring_time.h"
+#include "catch.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <random>
+#include <chrono>
+
+static time_t rtcTime;
+
+extern "C" {
+
+time_t HAL_RTC_Get_UnixTime(void)
+{
+    return rtcTime;
+}
+
+void HAL_RTC_Set_UnixTime(time_t value)
+{
+    rtcTime = value;
+}
+
+}
+
+static bool sameCalendar(const struct tm& a, const struct tm& b)
+{
+    return a.tm_year==b.tm_year && a.tm_mon==b.tm_mon && a.tm_mday==b.tm_mday &&
+        a.tm_hour==b.tm_hour && a.tm_min==b.tm_min && a.tm_sec==b.tm_sec &&
+        a.tm_wday==b.tm_wday && a.tm_yday==b.tm_yday;
+}
+
+static std::string iso8601(time_t t)
+{
+    char buf[32];
+    size_t length = Time.formatISO8601(t, buf, sizeof(buf));
+    REQUIRE(length==strlen(buf));
+    return buf;
+}
+
+// 2^30 seconds, 2004-01-10T13:37:04Z
+static const time_t SAMPLE_TIME = 1024*1024*1024;
+
+SCENARIO("civil_time converts the same as gmtime", "[time]")
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int64_t> times(-2208988800LL, 4102444800LL);     // 1900 - 2100
+    for (int i=0; i<100000; i++) {
+        time_t t = times(rng);
+        struct tm civil, c;
+        civil_time(t, &civil);
+        gmtime_r(&t, &c);
+        INFO(t);
+        REQUIRE(sameCalendar(civil, c));
+        REQUIRE(civil_to_time(&civil)==t);
+    }
+}
+
+SCENARIO("civil_advance rolls over minutes, days, months and years", "[time]")
+{
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int64_t> times(0, 4102444800LL);
+    std::uniform_int_distribution<int> steps(0, 3);
+    const time_t step[] = { 1, 59, 3601, 86399 };
+    struct tm civil;
+    time_t t = 946684799;    // 1999-12-31T23:59:59Z
+    civil_time(t, &civil);
+    for (int i=0; i<100000; i++) {
+        time_t delta = step[steps(rng)];
+        if (i%1000==0)
+            delta = times(rng)-t;       // also jump backwards and far ahead
+        t += delta;
+        civil_advance(&civil, delta);
+        struct tm c;
+        gmtime_r(&t, &c);
+        INFO(t);
+        REQUIRE(sameCalendar(civil, c));
+    }
+}
+
+SCENARIO("civil_dst_transition finds the day from the rule", "[time]")
+{
+    const civil_dst_rule_t us_start = { 3, 2, 0, 2 }, us_end = { 11, 1, 0, 2 };
+    REQUIRE(civil_dst_transition(2015, &us_start, -5*3600)==1425798000);    // 2015-03-08T07:00:00Z
+    REQUIRE(civil_dst_transition(2015, &us_end, -4*3600)==1446357600);      // 2015-11-01T06:00:00Z
+
+    const civil_dst_rule_t eu_start = { 3, 5, 0, 2 }, eu_end = { 10, 5, 0, 3 };
+    REQUIRE(civil_dst_transition(2015, &eu_start, 3600)==1427590800);       // 2015-03-29T01:00:00Z
+    REQUIRE(civil_dst_transition(2015, &eu_end, 7200)==1445734800);         // 2015-10-25T01:00:00Z
+    REQUIRE(civil_dst_transition(2016, &eu_end, 7200)==1477789200);         // 2016-10-30T01:00:00Z
+}
+
+SCENARIO("civil time formats as ISO 8601 and asctime", "[time]")
+{
+    struct tm civil;
+    civil_time(SAMPLE_TIME, &civil);
+    char buf[32];
+    REQUIRE(civil_format_iso8601(&civil, 0, buf, sizeof(buf))==20);
+    REQUIRE(std::string(buf)=="2004-01-10T13:37:04Z");
+    REQUIRE(civil_format_iso8601(&civil, -18900, buf, sizeof(buf))==25);
+    REQUIRE(std::string(buf)=="2004-01-10T13:37:04-05:15");
+    REQUIRE(civil_format_iso8601(&civil, 1800, buf, sizeof(buf))==25);
+    REQUIRE(std::string(buf)=="2004-01-10T13:37:04+00:30");
+    REQUIRE(civil_format_iso8601(&civil, 0, buf, 5)==20);
+    REQUIRE(std::string(buf)=="2004");
+
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int64_t> times(0, 4102444800LL);
+    for (int i=0; i<1000; i++) {
+        time_t t = times(rng);
+        civil_time(t, &civil);
+        char c[32];
+        asctime_r(&civil, c);
+        c[strlen(c)-1] = 0;
+        REQUIRE(civil_format_asctime(&civil, buf, sizeof(buf))==strlen(c));
+        REQUIRE(std::string(buf)==c);
+    }
+}
+
+SCENARIO("Time converts to the local time zone", "[time]")
+{
+    Time.zone(-5.25);
+    REQUIRE(Time.timeStr(SAMPLE_TIME)=="Sat Jan 10 08:22:04 2004");
+    REQUIRE(Time.format(SAMPLE_TIME, TIME_FORMAT_DEFAULT)=="Sat Jan 10 08:22:04 2004");
+    REQUIRE(Time.format(SAMPLE_TIME, TIME_FORMAT_ISO8601_FULL)=="2004-01-10T08:22:04-05:15");
+    REQUIRE(Time.format(SAMPLE_TIME, "%H:%M %z")=="08:22 -05:15");
+    REQUIRE(Time.hour(SAMPLE_TIME)==8);
+    REQUIRE(Time.hourFormat12(SAMPLE_TIME)==8);
+    REQUIRE(Time.minute(SAMPLE_TIME)==22);
+    REQUIRE(Time.second(SAMPLE_TIME)==4);
+    REQUIRE(Time.day(SAMPLE_TIME)==10);
+    REQUIRE(Time.weekday(SAMPLE_TIME)==7);
+    REQUIRE(Time.month(SAMPLE_TIME)==1);
+    REQUIRE(Time.year(SAMPLE_TIME)==2004);
+
+    Time.zone(0);
+    REQUIRE(Time.hour(SAMPLE_TIME)==13);
+    REQUIRE(Time.hourFormat12(SAMPLE_TIME)==1);
+    REQUIRE(Time.isPM(SAMPLE_TIME));
+    REQUIRE(iso8601(SAMPLE_TIME)=="2004-01-10T13:37:04Z");
+
+    rtcTime = SAMPLE_TIME;
+    REQUIRE(Time.timeStr()=="Sat Jan 10 13:37:04 2004");
+    for (int i=0; i<100; i++)
+        rtcTime += 3599;
+    REQUIRE(Time.timeStr()=="Wed Jan 14 17:35:24 2004");
+}
+
+SCENARIO("Time follows the daylight saving time rule", "[time]")
+{
+    Time.zone(1);
+    Time.setDSTRule({ 3, 5, 0, 2 }, { 10, 5, 0, 3 });
+
+    REQUIRE_FALSE(Time.isDST(1427590799));
+    REQUIRE(iso8601(1427590799)=="2015-03-29T01:59:59+01:00");
+    REQUIRE(Time.isDST(1427590800));
+    REQUIRE(iso8601(1427590800)=="2015-03-29T03:00:00+02:00");
+    REQUIRE(Time.hour(1427590800)==3);
+
+    REQUIRE(iso8601(1445734799)=="2015-10-25T02:59:59+02:00");
+    REQUIRE(iso8601(1445734800)=="2015-10-25T02:00:00+01:00");
+    REQUIRE_FALSE(Time.isDST(1445734800));
+
+    // the next year's transitions
+    REQUIRE(Time.isDST(1477789199));
+    REQUIRE_FALSE(Time.isDST(1477789200));
+
+    // southern hemisphere, Sydney
+    Time.zone(10);
+    Time.setDSTRule({ 10, 1, 0, 2 }, { 4, 1, 0, 3 });
+    REQUIRE(iso8601(1420070400)=="2015-01-01T11:00:00+11:00");      // 2015-01-01T00:00:00Z
+    REQUIRE(iso8601(1435708800)=="2015-07-01T10:00:00+10:00");      // 2015-07-01T00:00:00Z
+
+    Time.clearDSTRule();
+    REQUIRE(iso8601(1420070400)=="2015-01-01T10:00:00+10:00");
+    Time.zone(0);
+}
+
+template <typename F>
+static long nanosecondsPerCall(F convert)
+{
+    using namespace std::chrono;
+    const unsigned count = 1000000;
+    auto start = high_resolution_clock::now();
+    for (unsigned i=0; i<count; i++)
+        convert(SAMPLE_TIME+i);
+    return duration_cast<nanoseconds>(high_resolution_clock::now()-start).count()/count;
+}
+
+static volatile int sink;
+
+SCENARIO("Calendar conversion is faster than the C library", "[.][time][benchmark]")
+{
+    Time.zone(-5);
+    long c_hour = nanosecondsPerCall([](time_t t) {
+        t -= 5*3600;
+        sink = localtime(&t)->tm_hour;
+    });
+    long hour = nanosecondsPerCall([](time_t t) { sink = Time.hour(t); });
+    long c_full = nanosecondsPerCall([](time_t t) { struct tm c; gmtime_r(&t, &c); sink = c.tm_hour; });
+    long full = nanosecondsPerCall([](time_t t) { struct tm c; civil_time(t, &c); sink = c.tm_hour; });
+    long c_iso = nanosecondsPerCall([](time_t t) {
+        char buf[32];
+        t -= 5*3600;
+        sink = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S-05:00", localtime(&t));
+    });
+    long iso = nanosecondsPerCall([](time_t t) {
+        char buf[32];
+        sink = Time.formatISO8601(t, buf, sizeof(buf));
+    });
+    Time.zone(0);
+
+    WARN("hour: localtime " << c_hour << " ns, Time.hour " << hour << " ns");
+    WARN("full conversion: gmtime_r " << c_full << " ns, civil_time " << full << " ns");
+    WARN("ISO 8601: localtime+strftime " << c_iso << " ns, Time.formatISO8601 " << iso << " ns");
+}
@@ -0,0 +1,186 @@
+
+#include "spark_wiring_udp.h"
+#include "fake_socket_hal.h"
+#undef WARN     // the logging macro from service_debug.h
+#include "catch.hpp"
+#include <string>
+
+static void begin(UDP& udp)
+{
+    fakeSocket.reset();
+    REQUIRE(udp.begin(8888));
+    fakeSocket.resetCounts();
+}
+
+static void receive(const std::string& data, uint8_t last=2, uint16_t port=5000)
+{
+    fakeSocket.datagrams.push_back(FakeDatagram(data, 192, 168, 1, last, port));
+}
+
+static std::string readPacket(UDP& udp)
+{
+    std::string s;
+    int c;
+    while ((c = udp.read())>=0)
+        s += char(c);
+    return s;
+}
+
+SCENARIO("UDP without a queue reads one packet at a time", "[udp]")
+{
+    UDP udp;
+    begin(udp);
+    receive("one");
+    receive("two");
+    REQUIRE(udp.parsePacket()==3);
+    REQUIRE(readPacket(udp)=="one");
+    REQUIRE(udp.parsePacket()==3);
+    REQUIRE(readPacket(udp)=="two");
+    REQUIRE(udp.parsePacket()==0);
+}
+
+SCENARIO("UDP queues packets with their sender", "[udp]")
+{
+    UDP udp;
+    REQUIRE(udp.setReceiveQueue(4, 32));
+    begin(udp);
+    receive("first", 10, 1000);
+    receive("second", 11, 1001);
+    UDP::receiveAllQueued();
+    REQUIRE(udp.queuedPackets()==2);
+    REQUIRE(fakeSocket.datagrams.empty());
+
+    receive("third", 12, 1002);
+    REQUIRE(udp.parsePacket()==5);
+    REQUIRE(udp.remoteIP()==IPAddress(192, 168, 1, 10));
+    REQUIRE(udp.remotePort()==1000);
+    REQUIRE(udp.peek()=='f');
+    REQUIRE(readPacket(udp)=="first");
+    REQUIRE(udp.queuedPackets()==2);
+
+    REQUIRE(udp.parsePacket()==6);
+    REQUIRE(udp.remoteIP()==IPAddress(192, 168, 1, 11));
+    REQUIRE(udp.remotePort()==1001);
+    uint8_t buf[4];
+    REQUIRE(udp.read(buf, sizeof(buf))==4);
+    REQUIRE(std::string((char*)buf, 4)=="seco");
+
+    REQUIRE(udp.parsePacket()==5);
+    REQUIRE(udp.remotePort()==1002);
+    REQUIRE(readPacket(udp)=="third");
+    REQUIRE(udp.parsePacket()==0);
+    REQUIRE(udp.droppedPackets()==0);
+}
+
+SCENARIO("UDP counts packets dropped when the queue is full", "[udp]")
+{
+    UDP udp;
+    uint8_t storage[200];
+    REQUIRE(UDP::queueStorageSize(3, 16)<=sizeof(storage));
+    REQUIRE(udp.setReceiveQueue(3, 16, storage));
+    begin(udp);
+    for (int i=0; i<5; i++)
+        receive(std::string(1, char('a'+i)));
+    REQUIRE(udp.receiveQueued()==3);
+    REQUIRE(udp.droppedPackets()==2);
+
+    REQUIRE(udp.parsePacket()==1);
+    REQUIRE(udp.read()=='a');
+    // the packet being read still occupies its slot
+    receive("f");
+    udp.receiveQueued();
+    REQUIRE(udp.droppedPackets()==3);
+    REQUIRE(udp.parsePacket()==1);
+    REQUIRE(udp.read()=='b');
+    receive("g");
+    udp.receiveQueued();
+    REQUIRE(udp.queuedPackets()==2);
+    REQUIRE(udp.droppedPackets()==3);
+}
+
+SCENARIO("UDP truncates queued packets longer than the slot", "[udp]")
+{
+    UDP udp;
+    udp.setReceiveQueue(2, 8);
+    begin(udp);
+    receive("0123456789");
+    REQUIRE(udp.parsePacket()==8);
+    REQUIRE(readPacket(udp)=="01234567");
+}
+
+SCENARIO("UDP receivePacket takes packets from the queue in order", "[udp]")
+{
+    UDP udp;
+    udp.setBuffer(0);
+    udp.setReceiveQueue(4, 32);
+    begin(udp);
+    receive("one");
+    receive("two");
+    udp.receiveQueued();
+    receive("three");
+
+    char buf[16];
+    REQUIRE(udp.receivePacket(buf, sizeof(buf))==3);
+    REQUIRE(std::string(buf, 3)=="one");
+    REQUIRE(udp.receivePacket(buf, sizeof(buf))==3);
+    REQUIRE(std::string(buf, 3)=="two");
+    REQUIRE(udp.receivePacket(buf, sizeof(buf))==5);
+    REQUIRE(std::string(buf, 5)=="three");
+    REQUIRE(udp.receivePacket(buf, sizeof(buf))==0);
+}
+
+SCENARIO("UDP receivePacket doesn't truncate queued packets silently", "[udp]")
+{
+    UDP udp;
+    udp.setBuffer(0);
+    udp.setReceiveQueue(4, 32);
+    begin(udp);
+    receive("too long");
+    receive("ok");
+    udp.receiveQueued();
+
+    char buf[4];
+    REQUIRE(udp.receivePacket(buf, sizeof(buf))<0);
+    REQUIRE(udp.queuedPackets()==1);
+    REQUIRE(udp.receivePacket(buf, sizeof(buf))==2);
+    REQUIRE(std::string(buf, 2)=="ok");
+}
+
+SCENARIO("UDP can change or remove the receive queue", "[udp]")
+{
+    UDP udp;
+    udp.setReceiveQueue(4, 32);
+    begin(udp);
+    receive("queued");
+    udp.receiveQueued();
+    REQUIRE(udp.parsePacket()==6);
+
+    REQUIRE(udp.setReceiveQueue(0, 0));
+    REQUIRE(udp.available()==0);
+    receive("direct");
+    UDP::receiveAllQueued();
+    REQUIRE(fakeSocket.datagrams.size()==1);
+    REQUIRE(udp.parsePacket()==6);
+    REQUIRE(readPacket(udp)=="direct");
+}
+
+SCENARIO("UDP sends several packets in one call", "[udp]")
+{
+    UDP udp;
+    begin(udp);
+    const uint8_t a[] = "alpha", b[] = "beta";
+    UDP::Datagram packets[] = {
+        { a, 5, IPAddress(10, 0, 0, 1), 1234 },
+        { b, 4, IPAddress(10, 0, 0, 2), 4321 },
+    };
+    REQUIRE(udp.sendPackets(packets, 2)==2);
+    REQUIRE(fakeSocket.sentDatagrams.size()==2);
+    REQUIRE(fakeSocket.sentDatagrams[0].data=="alpha");
+    REQUIRE(fakeSocket.sentDatagrams[0].port==1234);
+    REQUIRE(fakeSocket.sentDatagrams[1].data=="beta");
+    REQUIRE(fakeSocket.sentDatagrams[1].ip[3]==2);
+    REQUIRE(fakeSocket.sentDatagrams[1].port==4321);
+
+    udp.stop();
+    REQUIRE(udp.sendPackets(packets, 2)==0);
+}
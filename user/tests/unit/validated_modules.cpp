@@ -0,0 +1,97 @@
+#include "catch.hpp"
+#include "validated_modules.h"
+
+static int verify_calls;
+static bool verify_result;
+
+static bool verify(const validated_module_t* module)
+{
+    verify_calls++;
+    return verify_result;
+}
+
+struct Records
+{
+    validated_module_t modules[4];
+
+    Records()
+    {
+        memset(modules, 0xFF, sizeof(modules));     // erased flash
+        verify_calls = 0;
+        verify_result = true;
+    }
+
+    bool check(const validated_module_t& module, int& updated)
+    {
+        return validated_modules_check(modules, 4, &module, verify, &updated);
+    }
+};
+
+SCENARIO("A validated module isn't CRC checked again", "[validated_modules]")
+{
+    Records records;
+    validated_module_t user = { 0x80A0000, 0x1F000, 0x1234, 0xABCD };
+    int updated;
+
+    REQUIRE(records.check(user, updated));
+    REQUIRE(verify_calls==1);
+    REQUIRE(updated==0);
+
+    // the next boot, with the module unchanged
+    REQUIRE(records.check(user, updated));
+    REQUIRE(verify_calls==1);
+    REQUIRE(updated==-1);
+}
+
+SCENARIO("A changed module is CRC checked and replaces its record", "[validated_modules]")
+{
+    Records records;
+    validated_module_t system = { 0x8020000, 0x40000, 0x1111, 0x2222 };
+    validated_module_t user = { 0x80A0000, 0x1F000, 0x1234, 0xABCD };
+    int updated;
+    REQUIRE(records.check(system, updated));
+    REQUIRE(records.check(user, updated));
+    REQUIRE(updated==1);
+
+    GIVEN("a new module_info header") {
+        user.info_crc++;
+    }
+    GIVEN("a new module CRC") {
+        user.crc++;
+    }
+    GIVEN("a new length") {
+        user.length += 4;
+    }
+    REQUIRE(records.check(user, updated));
+    REQUIRE(verify_calls==3);
+    REQUIRE(updated==1);
+    REQUIRE(records.check(system, updated));
+    REQUIRE(verify_calls==3);
+}
+
+SCENARIO("A module that fails its CRC check isn't recorded", "[validated_modules]")
+{
+    Records records;
+    validated_module_t user = { 0x80A0000, 0x1F000, 0x1234, 0xABCD };
+    int updated;
+    verify_result = false;
+
+    REQUIRE_FALSE(records.check(user, updated));
+    REQUIRE(updated==-1);
+    REQUIRE_FALSE(records.check(user, updated));
+    REQUIRE(verify_calls==2);
+}
+
+SCENARIO("The last validated module record is replaced when all are used", "[validated_modules]")
+{
+    Records records;
+    int updated;
+    for (uint32_t i=0; i<5; i++) {
+        validated_module_t module = { 0x8020000+i*0x20000, 0x100, i, i };
+        REQUIRE(records.check(module, updated));
+        REQUIRE(updated==int(i<4 ? i : 3));
+    }
+    validated_module_t first = { 0x8020000, 0x100, 0, 0 };
+    REQUIRE(records.check(first, updated));
+    REQUIRE(verify_calls==5);
+}
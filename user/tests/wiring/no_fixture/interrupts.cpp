@@ -0,0 +1,101 @@
+/**
+ ******************************************************************************
+ * @file    interrupts.cpp
+ * @brief   Interrupt handler latency
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#include "application.h"
+#include "unit-test/unit-test.h"
+
+#if SYSTEM_HW_TICKS
+
+// An output pin still drives its input, so setting it raises the interrupt
+static const pin_t EDGE_PIN = D2;
+static const unsigned EDGES = 100;
+
+static volatile uint32_t edgeTicks;
+static volatile unsigned edgeCount;
+
+static void onEdge()
+{
+    edgeTicks = System.ticks();
+    edgeCount++;
+}
+
+struct EdgeCounter
+{
+    void onEdge()
+    {
+        ::onEdge();
+    }
+};
+
+static EdgeCounter counter;
+
+/**
+ * Measures the mean time from setting the pin to the handler running, in
+ * system ticks, using the cycle counter.
+ */
+static uint32_t edgeLatency()
+{
+    uint32_t total = 0;
+    edgeCount = 0;
+    for (unsigned i=0; i<EDGES; i++) {
+        pinResetFast(EDGE_PIN);
+        delayMicroseconds(10);
+        uint32_t start = System.ticks();
+        pinSetFast(EDGE_PIN);
+        while (edgeCount==i && System.ticks()-start<System.ticksPerMicrosecond()*1000);
+        total += edgeTicks-start;
+    }
+    detachInterrupt(EDGE_PIN);
+    Serial.printlnf("%lu ticks from edge to handler", total/EDGES);
+    return total/EDGES;
+}
+
+test(INTERRUPTS_handler_latency) {
+    pinMode(EDGE_PIN, OUTPUT);
+    pinResetFast(EDGE_PIN);
+
+    const uint32_t limit = System.ticksPerMicrosecond()*10;
+
+    Serial.print("std::function: ");
+    attachInterrupt(EDGE_PIN, wiring_interrupt_handler_t(onEdge), RISING);
+    assertLess(edgeLatency(), limit);
+    assertEqual(edgeCount, EDGES);
+
+    Serial.print("function pointer: ");
+    attachInterrupt(EDGE_PIN, onEdge, RISING);
+    assertLess(edgeLatency(), limit);
+    assertEqual(edgeCount, EDGES);
+
+    Serial.print("member function: ");
+    attachInterrupt(EDGE_PIN, &EdgeCounter::onEdge, &counter, RISING);
+    assertLess(edgeLatency(), limit);
+    assertEqual(edgeCount, EDGES);
+
+    Serial.print("compile-time member function: ");
+    attachInterrupt<EdgeCounter, &EdgeCounter::onEdge>(EDGE_PIN, &counter, RISING);
+    assertLess(edgeLatency(), limit);
+    assertEqual(edgeCount, EDGES);
+
+    pinMode(EDGE_PIN, INPUT);
+}
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef CIVIL_TIME_H
+#define	CIVIL_TIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/**
+ * When daylight saving time starts or ends, such as "the second Sunday in
+ * March at 2:00".
+ */
+typedef struct civil_dst_rule_t {
+    uint8_t month;      // 1-12
+    uint8_t week;       // 1-4 for the first to fourth weekday in the month, 5 for the last
+    uint8_t weekday;    // 0-6, Sunday is 0
+    uint8_t hour;       // 0-23, the local time shown just before the change
+} civil_dst_rule_t;
+
+/**
+ * Converts seconds since 1970 to the calendar time in UTC, the same as gmtime_r()
+ * but without using the C library. tm_year is the years since 1900 and
+ * tm_isdst is 0.
+ */
+void civil_time(time_t time, struct tm* calendar);
+
+/**
+ * Converts a calendar time in UTC back to seconds since 1970. Only the year,
+ * month, day, hour, minute and second are used, and they must be in range.
+ */
+time_t civil_to_time(const struct tm* calendar);
+
+/**
+ * Moves a calendar time on by a number of seconds. Less than a day ahead
+ * only updates the fields that change, rolling the day over at midnight;
+ * anything else is converted in full.
+ */
+void civil_advance(struct tm* calendar, time_t seconds);
+
+/**
+ * The time in UTC at which a daylight saving time rule takes effect in a year.
+ *
+ * @param year      The year, e.g. 2015.
+ * @param offset    Seconds ahead of UTC of the local time before the change.
+ */
+time_t civil_dst_transition(int year, const civil_dst_rule_t* rule, int32_t offset);
+
+/**
+ * Formats a calendar time as ISO 8601, e.g. "2004-01-10T08:22:04-05:15", or
+ * with a "Z" suffix when the offset is 0.
+ *
+ * @param offset    Seconds ahead of UTC of the calendar time.
+ * @return The length of the formatted time, at most 25 characters for years 0-9999.
+ * As with snprintf, at most size-1 characters are written, followed by a null terminator.
+ */
+size_t civil_format_iso8601(const struct tm* calendar, int32_t offset, char* buffer, size_t size);
+
+/**
+ * Formats a calendar time the same as asctime(), e.g. "Sat Jan 10 08:22:04 2004",
+ * without the final newline.
+ *
+ * @return The length of the formatted time, as for civil_format_iso8601().
+ */
+size_t civil_format_asctime(const struct tm* calendar, char* buffer, size_t size);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CIVIL_TIME_H */
@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+#ifndef FLOAT_CONVERT_H
+#define	FLOAT_CONVERT_H
+
+#include <stddef.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/**
+ * Digits after the decimal point beyond this are written as zeros by dtoa_fixed().
+ * Raising it increases the stack used for very large and very small values.
+ */
+#ifndef FLOAT_CONVERT_MAX_PRECISION
+#define FLOAT_CONVERT_MAX_PRECISION 60
+#endif
+
+/**
+ * Formats a value with a fixed number of digits after the decimal point,
+ * correctly rounded with ties to even, the same as printf("%.*f").
+ * Infinity and NaN are written as "inf", "-inf" and "nan".
+ *
+ * @return The length of the formatted value. As with snprintf, at most
+ * size-1 characters are written, followed by a null terminator.
+ */
+size_t dtoa_fixed(double value, int precision, char* buffer, size_t size);
+
+/**
+ * Formats a value using the fewest significant digits that convert back to the
+ * same value. Values from 1e-6 up to 1e21 are written in decimal notation
+ * and others in exponent notation, e.g. 1e+21.
+ * The result is at most 25 characters.
+ *
+ * @return The length of the formatted value, as for dtoa_fixed().
+ */
+size_t dtoa_shortest(double value, char* buffer, size_t size);
+
+/**
+ * The same as dtoa_shortest(), with the digits chosen for single precision.
+ */
+size_t ftoa_shortest(float value, char* buffer, size_t size);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FLOAT_CONVERT_H */
@@ -25,6 +25,7 @@
 #include "system_network.h"
 #include "cellular_hal.h"
 #include "spark_wiring_cellularsignal.h"
+#include "spark_wiring_string.h"
 
 #if Wiring_Cellular
 
@@ -66,6 +67,44 @@ public:
 
     CellularSignal RSSI();
 
+    /**
+     * Retrieves the data sent and received since the last call to
+     * resetDataUsage(), which is kept through sleep and reset.
+     */
+    bool dataUsage(CellularDataUsage& usage)
+    {
+        return cellular_data_usage_get(&usage, NULL)==0;
+    }
+
+    void resetDataUsage()
+    {
+        cellular_data_usage_reset(NULL);
+    }
+
+    /**
+     * Retrieves data usage as JSON, with the bytes spent on overhead such as
+     * headers, pings and retransmits.
+     */
+    String dataUsageReport()
+    {
+        CellularDataUsage usage;
+        if (!dataUsage(usage))
+            return String();
+        char buf[768];
+        cellular_data_usage_format(&usage, buf, sizeof(buf));
+        return String(buf);
+    }
+
+    /**
+     * Sends socket data to the modem in hex, within the write command, rather
+     * than after a prompt. Saves a round trip and a pause on each write, at
+     * the cost of twice the bytes on the modem's serial line.
+     */
+    bool setSocketHexMode(bool hex)
+    {
+        return cellular_socket_hex_mode(hex, NULL)==0;
+    }
+
     template<typename... Targs>
     inline int command(const char* format, Targs... Fargs)
     {
@@ -28,13 +28,58 @@
 #ifndef __SPARK_WIRING_INTERRUPTS_H
 #define __SPARK_WIRING_INTERRUPTS_H
 
-#include "spark_wiring.h"
+#include "spark_wiring_platform.h"
+#include "pinmap_hal.h"
 #include "interrupts_hal.h"
 #include <functional>
+#include <string.h>
 
 typedef std::function<void()> wiring_interrupt_handler_t;
 typedef void (*raw_interrupt_handler_t)(void);
 
+/**
+ * A member function handler and the instance it is called on. One is kept for
+ * each pin so that attaching a member function needs no allocation.
+ */
+struct wiring_interrupt_member_t
+{
+    void* instance;
+    // a pointer to member function is two words in the ARM and Itanium C++ ABIs
+    void* method[2];
+};
+
+/**
+ * Detaches any handler from the pin and returns the pin's member handler storage.
+ * @return NULL if the pin can't have an interrupt attached.
+ */
+wiring_interrupt_member_t* wiring_interrupt_member(uint16_t pin);
+
+/**
+ * Attaches a function that the HAL calls with `data` when the interrupt occurs.
+ */
+bool wiring_interrupt_attach(uint16_t pin, HAL_InterruptHandler dispatch, void* data, InterruptMode mode);
+
+template <typename T>
+void call_member_interrupt_handler(void* data)
+{
+    const wiring_interrupt_member_t* member = (const wiring_interrupt_member_t*)data;
+    void (T::*handler)();
+    memcpy(&handler, member->method, sizeof(handler));
+    (static_cast<T*>(member->instance)->*handler)();
+}
+
+template <void (*handler)()>
+void call_static_interrupt_handler(void* data)
+{
+    handler();
+}
+
+template <typename T, void (T::*handler)()>
+void call_static_member_interrupt_handler(void* data)
+{
+    (static_cast<T*>(data)->*handler)();
+}
+
 /*
  * GPIO Interrupts
  */
@@ -42,9 +87,33 @@ bool attachInterrupt(uint16_t pin, wiring_interrupt_handler_t handler, Interrupt
 bool attachInterrupt(uint16_t pin, raw_interrupt_handler_t handler, InterruptMode mode);
 template <typename T>
 bool attachInterrupt(uint16_t pin, void (T::*handler)(), T *instance, InterruptMode mode) {
-    using namespace std::placeholders;
-    return attachInterrupt(pin, std::bind(handler, instance), mode);
+    static_assert(sizeof(handler)<=sizeof(wiring_interrupt_member_t::method), "pointer to member function is too large");
+    wiring_interrupt_member_t* member = wiring_interrupt_member(pin);
+    if (!member)
+        return false;
+    member->instance = instance;
+    memcpy(member->method, &handler, sizeof(handler));
+    return wiring_interrupt_attach(pin, call_member_interrupt_handler<T>, member, mode);
+}
+
+/**
+ * Attaches a function chosen at compile time, which the interrupt calls directly,
+ * e.g. {@code attachInterrupt<count>(D2, RISING)}.
+ */
+template <void (*handler)()>
+bool attachInterrupt(uint16_t pin, InterruptMode mode) {
+    return wiring_interrupt_attach(pin, call_static_interrupt_handler<handler>, NULL, mode);
+}
+
+/**
+ * Attaches a member function chosen at compile time, which the interrupt calls
+ * directly on the instance, e.g. {@code attachInterrupt<Meter, &Meter::pulse>(D2, &meter, RISING)}.
+ */
+template <typename T, void (T::*handler)()>
+bool attachInterrupt(uint16_t pin, T* instance, InterruptMode mode) {
+    return wiring_interrupt_attach(pin, call_static_member_interrupt_handler<T, handler>, instance, mode);
 }
+
 void detachInterrupt(uint16_t pin);
 void interrupts(void);
 void noInterrupts(void);
@@ -30,6 +30,7 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdint.h> // for uint8_t
+#include <stdarg.h>
 
 #include "spark_wiring_string.h"
 #include "spark_wiring_printable.h"
@@ -72,7 +73,7 @@ class Print
     size_t print(unsigned int, int = DEC);
     size_t print(long, int = DEC);
     size_t print(unsigned long, int = DEC);
-    size_t print(double, int = 2);
+    size_t print(double, int = 2);     // negative digits: the shortest text that reads back as the same value
     size_t print(const Printable&);
 
     size_t println(const char[]);
@@ -88,6 +89,12 @@ class Print
 
     size_t printfln(const char* format, ...);
 
+    /**
+     * Writes formatted output in a single pass, without allocating.
+     * The output is passed to write() in chunks of up to 64 characters.
+     */
+    size_t vprintf_impl(bool newline, const char* format, va_list args);
+
     template <typename... Args>
     inline size_t printf(const char* format, Args... args)
     {
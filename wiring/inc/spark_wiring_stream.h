@@ -56,6 +56,14 @@ class Stream : public Print
     virtual int peek() = 0;
     virtual void flush() = 0;
 
+    /**
+     * Waits until data is available to read, or the timeout in milliseconds elapses.
+     * Returns true if data is available. Streams that are told when data arrives
+     * block the calling thread; the default polls available(), yielding to other
+     * threads in between.
+     */
+    virtual bool waitAvailable(system_tick_t timeout);
+
     Stream() {_timeout=1000;}
 
 // parsing methods
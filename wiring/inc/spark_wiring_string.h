@@ -75,6 +75,8 @@ public:
 	explicit String(unsigned int, unsigned char base=10);
 	explicit String(long, unsigned char base=10);
 	explicit String(unsigned long, unsigned char base=10);
+    // a negative number of decimal places gives the shortest text that
+    // converts back to the same value, e.g. String(0.1f, -1) is "0.1"
     explicit String(float, int decimalPlaces=6);
     explicit String(double, int decimalPlaces=6);
 	~String(void);
@@ -192,16 +194,32 @@ public:
         static String format(const char* format, ...);
 
 protected:
+	// short strings are stored in the object itself, in place of the
+	// capacity and flags, which are only used for other buffers.
+	enum { INLINE_SIZE = 8 };
+	enum { EXTERNAL_BUFFER = 1 };	// the buffer isn't owned by this String
+
 	char *buffer;	        // the actual char array
-	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
-	unsigned char flags;    // unused, for future features
+	union {
+		struct {
+			unsigned int capacity;  // the array length minus one (for the '\0')
+			unsigned char flags;
+		};
+		char inlineBuffer[INLINE_SIZE];
+	};
 protected:
 	void init(void);
 	void invalidate(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char grow(unsigned int maxStrLen);
+	unsigned char concatFloat(double num, int decimalPlaces, bool single);
 	unsigned char concat(const char *cstr, unsigned int length);
 
+	bool isInline() const { return buffer == inlineBuffer; }
+	bool ownsBuffer() const { return buffer && !isInline() && !(flags & EXTERNAL_BUFFER); }
+	unsigned int bufferCapacity() const { return isInline() ? INLINE_SIZE - 1 : (buffer ? capacity : 0); }
+
 	// copy and move
 	String & copy(const char *cstr, unsigned int length);
 	#ifdef __GXX_EXPERIMENTAL_CXX0X__
@@ -212,17 +230,32 @@ protected:
 
 };
 
+// Builds the concatenation in a buffer within the helper, so that a chain
+// such as a + ", " + b + ...  makes a single allocation, when the result
+// is assigned to a String. Longer results continue on the heap.
 class StringSumHelper : public String
 {
+	enum { SCRATCH_SIZE = 64 };
+	char scratch[SCRATCH_SIZE];
+
+	void useScratch()
+	{
+		buffer = scratch;
+		buffer[0] = 0;
+		capacity = SCRATCH_SIZE - 1;
+		flags = EXTERNAL_BUFFER;
+	}
+
 public:
-	StringSumHelper(const String &s) : String(s) {}
-	StringSumHelper(const char *p) : String(p) {}
-	StringSumHelper(char c) : String(c) {}
-	StringSumHelper(unsigned char num) : String(num) {}
-	StringSumHelper(int num) : String(num) {}
-	StringSumHelper(unsigned int num) : String(num) {}
-	StringSumHelper(long num) : String(num) {}
-	StringSumHelper(unsigned long num) : String(num) {}
+	StringSumHelper(const String &s) { useScratch(); if (!concat(s)) invalidate(); }
+	StringSumHelper(const char *p) { useScratch(); if (!concat(p)) invalidate(); }
+	StringSumHelper(char c) { useScratch(); concat(c); }
+	StringSumHelper(unsigned char num) { useScratch(); concat(num); }
+	StringSumHelper(int num) { useScratch(); concat(num); }
+	StringSumHelper(unsigned int num) { useScratch(); concat(num); }
+	StringSumHelper(long num) { useScratch(); concat(num); }
+	StringSumHelper(unsigned long num) { useScratch(); concat(num); }
+	StringSumHelper(const StringSumHelper &s) : String(s) {}
 };
 
 #include <ostream>
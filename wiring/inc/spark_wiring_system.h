@@ -35,6 +35,7 @@
 #include "core_hal.h"
 #include "system_user.h"
 #include "system_version.h"
+#include "system_timeline.h"
 
 #if defined(SPARK_PLATFORM) && PLATFORM_ID!=3
 #define SYSTEM_HW_TICKS 1
@@ -180,6 +181,22 @@ public:
         return info.versionNumber;
     }
 
+    /**
+     * Retrieves the times taken to reach each step from reset to the cloud
+     * connection, as JSON, e.g. for publishing.
+     * @param previous  When true, retrieves the timeline from before the last reset.
+     */
+    String bootTimeline(bool previous=false)
+    {
+        system_timeline_t timeline;
+        timeline.size = sizeof(timeline);
+        if (system_timeline_get(&timeline, previous, nullptr))
+            return String();
+        char buf[256];
+        system_timeline_format(&timeline, buf, sizeof(buf));
+        return String(buf);
+    }
+
     inline void enableUpdates()
     {
         set_flag(SYSTEM_FLAG_OTA_UPDATE_ENABLED, true);
@@ -39,8 +39,21 @@ class TCPClient : public Client {
 public:
 	TCPClient();
 	TCPClient(sock_handle_t sock);
+	/**
+	 * Creates a client that receives into the given buffer rather than the
+	 * internal TCPCLIENT_BUF_MAX_SIZE buffer. When a transmit buffer is given,
+	 * writes are collected and sent together by flush(), when the buffer is
+	 * full, or before reading. The buffers must outlive the client.
+	 */
+	TCPClient(uint8_t* rxBuffer, size_t rxSize, uint8_t* txBuffer=NULL, size_t txSize=0);
         virtual ~TCPClient() {};
 
+        /**
+         * Changes the receive and transmit buffers. Any unread received data is
+         * discarded and pending transmit data is sent.
+         */
+        void setBuffers(uint8_t* rxBuffer, size_t rxSize, uint8_t* txBuffer=NULL, size_t txSize=0);
+
         uint8_t status();
 	virtual int connect(IPAddress ip, uint16_t port, network_interface_t=0);
 	virtual int connect(const char *host, uint16_t port, network_interface_t=0);
@@ -48,8 +61,16 @@ public:
 	virtual size_t write(const uint8_t *buffer, size_t size);
 	virtual int available();
 	virtual int read();
+	/**
+	 * Reads up to size bytes. When nothing is buffered, data is received
+	 * directly into the given buffer.
+	 */
 	virtual int read(uint8_t *buffer, size_t size);
 	virtual int peek();
+	/**
+	 * Sends the buffered transmit data. Without a transmit buffer, discards
+	 * any unread received data.
+	 */
 	virtual void flush();
         void flush_buffer();
 	virtual void stop();
@@ -69,10 +90,17 @@ private:
 	static uint16_t _srcport;
 	sock_handle_t _sock;
 	uint8_t _buffer[TCPCLIENT_BUF_MAX_SIZE];
-	uint16_t _offset;
-	uint16_t _total;
+	uint8_t* _rxBuffer;     // NULL to use _buffer, so copies don't refer to another client's buffer
+	size_t _rxSize;
+	uint8_t* _txBuffer;
+	size_t _txSize;
+	size_t _txCount;
+	size_t _offset;
+	size_t _total;
         IPAddress _remoteIP;
 	inline int bufferCount();
+	inline uint8_t* rxBuffer() { return _rxBuffer ? _rxBuffer : _buffer; }
+	int sendPending();
 
 };
 
@@ -27,6 +27,7 @@
 #define __SPARK_WIRING_TIME_H
 
 #include "spark_wiring_string.h"
+#include "civil_time.h"
 #include <time.h>
 
 extern const char* TIME_FORMAT_DEFAULT;
@@ -60,6 +61,19 @@ public:
 	static void    zone(float GMT_Offset);		// set the time zone (+/-) offset from GMT
 	static void    setTime(time_t t);			// set the given time as unix/rtc time
 
+        /**
+         * Use daylight saving time each year from `start` until `end`, both given
+         * as the local time shown on the clock just before the change. For example
+         * US Eastern time is {3, 2, 0, 2} until {11, 1, 0, 2} with zone -5, and
+         * Central European time is {3, 5, 0, 2} until {10, 5, 0, 3} with zone 1.
+         *
+         * @param offset    The hours added to the time zone during daylight saving time.
+         */
+        static void setDSTRule(const civil_dst_rule_t& start, const civil_dst_rule_t& end, float offset=1.0);
+        static void clearDSTRule();
+        static bool isDST();                // true if daylight saving time is in effect now
+        static bool isDST(time_t t);        // true if daylight saving time is in effect at the given time
+
 
         /* return string representation of the current time */
         inline String timeStr()
@@ -70,11 +84,21 @@ public:
         /* return string representation for the given time */
         static String timeStr(time_t t);
 
+        /**
+         * Writes the given local time as ISO 8601, e.g. "2004-01-10T08:22:04-05:15",
+         * without allocating. The result is 25 characters at most.
+         *
+         * @return The length of the formatted time. As with snprintf, at most
+         * size-1 characters are written, followed by a null terminator.
+         */
+        static size_t formatISO8601(time_t t, char* buffer, size_t size);
+
         /**
          * Return a string representation of the given time using strftime().
          * This function takes several kilobytes of flash memory so it's kept separate
          * from `timeStr()` to reduce memory footprint for applications that don't use
-         * alternative time formats.
+         * alternative time formats. TIME_FORMAT_ISO8601_FULL is formatted directly
+         * without strftime().
          *
          * @param t
          * @param format_spec
@@ -27,10 +27,11 @@
 #ifndef __SPARK_WIRING_UDP_H
 #define __SPARK_WIRING_UDP_H
 
-#include "spark_wiring.h"
 #include "spark_wiring_printable.h"
 #include "spark_wiring_stream.h"
+#include "spark_wiring_ipaddress.h"
 #include "socket_hal.h"
+#include "inet_hal.h"
 
 
 class UDP : public Stream, public Printable {
@@ -89,11 +90,40 @@ private:
          */
         uint8_t _buffer_allocated;
 
+        /**
+         * The optional receive queue. Each slot holds the sender and length
+         * followed by up to _queue_packet_size bytes of data.
+         */
+        uint8_t* _queue;
+        uint16_t _queue_slots;
+        uint16_t _queue_packet_size;
+        uint16_t _queue_head;           // the slot of the oldest packet
+        uint16_t _queue_count;
+        uint8_t _queue_allocated;
+        uint8_t _queue_reading;         // non-zero while the oldest packet is being read
+
+        /**
+         * The number of packets discarded because the receive queue was full.
+         */
+        uint32_t _dropped;
+
+        /**
+         * The next UDP instance with a receive queue.
+         */
+        UDP* _next_queue;
+
+        uint8_t* queueSlot(uint16_t index) const;
+
+        /**
+         * The packet being read - either _buffer or the oldest packet in the receive queue.
+         */
+        uint8_t* readBuffer() const;
+
 
 
 public:
 	UDP();
-        virtual ~UDP() { stop(); releaseBuffer(); }
+        virtual ~UDP() { stop(); releaseBuffer(); setReceiveQueue(0, 0); }
         /**
          * @param buffer_size The size of the read/write buffer. Can be 0 if
          * only `readPacket()` and `sendPacket()` are used, as these methods
@@ -114,6 +144,46 @@ public:
          */
         void releaseBuffer();
 
+        /**
+         * Enables a queue of received packets, so packets that arrive between calls to
+         * parsePacket() are kept rather than left to overflow the socket. Waiting packets
+         * are moved to the queue every 10 ms from the timer thread on platforms with
+         * threading, after each call to loop(), and by parsePacket().
+         * When the queue is full, further packets are read and discarded, and counted
+         * by droppedPackets().
+         *
+         * @param packets       The number of packets the queue can hold. 0 disables the queue.
+         * @param packet_size   The largest packet stored. Longer packets are truncated.
+         * @param storage       Optional storage of queueStorageSize(packets, packet_size) bytes.
+         *  When not given, the queue is allocated dynamically.
+         * @return true if the queue was set.
+         */
+        bool setReceiveQueue(size_t packets, size_t packet_size, uint8_t* storage=NULL);
+
+        static size_t queueStorageSize(size_t packets, size_t packet_size);
+
+        /**
+         * Moves packets waiting in the socket to the receive queue.
+         * @return The number of packets now queued.
+         */
+        int receiveQueued();
+
+        /**
+         * The number of received packets waiting in the queue, not including the
+         * packet being read.
+         */
+        int queuedPackets() const { return _queue_count - (_queue_reading ? 1 : 0); }
+
+        /**
+         * The number of packets discarded because the receive queue was full.
+         */
+        uint32_t droppedPackets() const { return _dropped; }
+
+        /**
+         * Moves waiting packets to the queue for all UDP instances with a receive queue.
+         */
+        static void receiveAllQueued();
+
         /**
          * @param port  The local port to connect to.
          * @param nif   The network interface to connect to
@@ -140,14 +210,30 @@ public:
             return sendPacket((uint8_t*)buffer, buffer_size, destination, port);
         }
 
+        struct Datagram
+        {
+            const uint8_t* data;
+            size_t size;
+            IPAddress destination;
+            uint16_t port;
+        };
+
+        /**
+         * Sends several packets in one call. This does not require the UDP instance to have an allocated buffer.
+         * @return The number of packets sent, which is less than count if a send failed.
+         */
+        int sendPackets(const Datagram* packets, size_t count);
+
         /**
          * Retrieves a packet directly. This does not require the UDP instance to have an allocated buffer.
          * If the buffer is not large enough
-         * for the packet, the remainder that doesn't fit is discarded.
+         * for the packet, the remainder that doesn't fit is discarded. With a receive queue,
+         * a queued packet that doesn't fit is discarded and an error returned.
          *
          * @param buffer        The buffer to read data to
          * @param buf_size      The buffer size
-         * @return The number of bytes written to the buffer, or a negative value on error.
+         * @return The number of bytes written to the buffer, 0 if no packet is waiting,
+         *  or a negative value on error.
          */
         virtual int receivePacket(uint8_t* buffer, size_t buf_size);
         virtual int receivePacket(char* buffer, size_t buf_size) { return receivePacket((uint8_t*)buffer, buf_size); }
@@ -206,6 +292,9 @@ public:
 	virtual void flush();
 
 
+        /**
+         * The sender of the current packet, available after parsePacket().
+         */
 	virtual IPAddress remoteIP() { return _remoteIP; };
 	virtual uint16_t remotePort() { return _remotePort; };
 
@@ -40,10 +40,17 @@ public:
   virtual ~USARTSerial() {};
   void begin(unsigned long);
   void begin(unsigned long, uint8_t);
+  /**
+   * Begins with receive and transmit buffers supplied by the application, which
+   * can be any size and must remain valid until end(), which goes back to the
+   * default SERIAL_BUFFER_SIZE buffers. A NULL buffer uses the default buffer.
+   */
+  void begin(unsigned long baud, uint8_t* rxBuffer, size_t rxSize, uint8_t* txBuffer=NULL, size_t txSize=0);
   void halfduplex(bool);
   void end();
 
   virtual int available(void);
+  virtual bool waitAvailable(system_tick_t timeout);
   virtual int peek(void);
   virtual int read(void);
   virtual void flush(void);
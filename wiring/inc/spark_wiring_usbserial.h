@@ -32,6 +32,8 @@
 
 class USBSerial : public Stream
 {
+	system_tick_t _writeTimeout;
+
 public:
 	// public methods
 	USBSerial();
@@ -45,10 +47,24 @@ public:
 	int peek();
 
 	virtual size_t write(uint8_t byte);
+	virtual size_t write(const uint8_t *buffer, size_t size);
 	virtual int read();
+	/**
+	 * Reads up to `size` bytes that have been received, without waiting.
+	 * @return the number of bytes read.
+	 */
+	int read(uint8_t *buffer, size_t size);
 	virtual int available();
+	virtual bool waitAvailable(system_tick_t timeout);
 	virtual void flush();
 
+	/**
+	 * Sets how long in milliseconds a write waits for the host to take data
+	 * when the transmit buffer is full, before the rest is dropped. Once a
+	 * write has timed out, writes don't wait again until the host takes data.
+	 */
+	void setWriteTimeout(system_tick_t timeout) { _writeTimeout = timeout; }
+
 	using Print::write;
 };
 
@@ -0,0 +1,264 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/**
+ * Calendar conversion without the C library, which keeps the result of
+ * localtime() and asctime() in shared buffers and looks up the time zone on
+ * every call.
+ *
+ * Days are converted to dates with the algorithms from Howard Hinnant,
+ * "chrono-Compatible Low-Level Date Algorithms", which count 400 year eras
+ * starting in March so that the leap day is last.
+ */
+
+#include "civil_time.h"
+#include <string.h>
+
+namespace {
+
+const int32_t SECONDS_PER_DAY = 86400;
+
+// 1970-01-01 is day 719468 counting from 0000-03-01
+const int32_t EPOCH_DAYS = 719468;
+const int32_t DAYS_PER_ERA = 146097;
+
+const uint16_t days_before_month[2][12] = {
+    { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 },
+    { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335 },
+};
+
+const char weekday_names[] = "SunMonTueWedThuFriSat";
+const char month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+inline bool is_leap(int year)
+{
+    return (year%4==0 && year%100!=0) || year%400==0;
+}
+
+/**
+ * The number of days in a month, which is 0-11.
+ */
+inline int days_in_month(int year, int month)
+{
+    return month==1 ? (is_leap(year) ? 29 : 28) : 30+((month+1+(month>6))&1);
+}
+
+/**
+ * Days since 1970 of a date. The month is 1-12.
+ */
+time_t days_from_civil(int year, unsigned month, unsigned day)
+{
+    year -= month<=2;
+    const int era = (year>=0 ? year : year-399)/400;
+    const unsigned year_of_era = unsigned(year-era*400);
+    const unsigned day_of_year = (153*(month>2 ? month-3 : month+9)+2)/5+day-1;
+    const unsigned day_of_era = year_of_era*365+year_of_era/4-year_of_era/100+day_of_year;
+    return time_t(era)*DAYS_PER_ERA+time_t(day_of_era)-EPOCH_DAYS;
+}
+
+/**
+ * Sets the date fields from the days since 1970.
+ */
+void civil_from_days(time_t days, struct tm* calendar)
+{
+    const time_t z = days+EPOCH_DAYS;
+    const time_t era = (z>=0 ? z : z-DAYS_PER_ERA+1)/DAYS_PER_ERA;
+    const unsigned day_of_era = unsigned(z-era*DAYS_PER_ERA);
+    const unsigned year_of_era = (day_of_era-day_of_era/1460+day_of_era/36524-day_of_era/146096)/365;
+    const unsigned day_of_year = day_of_era-(365*year_of_era+year_of_era/4-year_of_era/100);
+    const unsigned mp = (5*day_of_year+2)/153;
+    const unsigned month = mp<10 ? mp+2 : mp-10;        // 0-11
+    const int year = int(year_of_era+era*400)+(month<2);
+
+    calendar->tm_year = year-1900;
+    calendar->tm_mon = month;
+    calendar->tm_mday = day_of_year-(153*mp+2)/5+1;
+    calendar->tm_yday = days_before_month[is_leap(year)][month]+calendar->tm_mday-1;
+    int weekday = int((days+4)%7);      // 1970-01-01 was a Thursday
+    calendar->tm_wday = weekday<0 ? weekday+7 : weekday;
+}
+
+/**
+ * Writes a number with at least `width` digits, zero padded.
+ */
+char* put_number(char* p, int value, int width)
+{
+    if (value<0) {
+        *p++ = '-';
+        value = -value;
+    }
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0'+value%10;
+        value /= 10;
+    } while (value);
+    while (width-->n)
+        *p++ = '0';
+    while (n)
+        *p++ = digits[--n];
+    return p;
+}
+
+inline char* put_two_digits(char* p, int value)
+{
+    *p++ = '0'+value/10;
+    *p++ = '0'+value%10;
+    return p;
+}
+
+inline char* put_name(char* p, const char* names, int index)
+{
+    memcpy(p, names+index*3, 3);
+    return p+3;
+}
+
+/**
+ * Copies formatted text to the caller's buffer with the same truncation as snprintf.
+ */
+size_t copy_out(const char* text, size_t length, char* buffer, size_t size)
+{
+    if (size) {
+        size_t n = length<size ? length : size-1;
+        memcpy(buffer, text, n);
+        buffer[n] = 0;
+    }
+    return length;
+}
+
+} // namespace
+
+void civil_time(time_t time, struct tm* calendar)
+{
+    time_t days = time/SECONDS_PER_DAY;
+    int32_t seconds = int32_t(time-days*SECONDS_PER_DAY);
+    if (seconds<0) {
+        seconds += SECONDS_PER_DAY;
+        days--;
+    }
+    calendar->tm_hour = seconds/3600;
+    calendar->tm_min = seconds/60%60;
+    calendar->tm_sec = seconds%60;
+    calendar->tm_isdst = 0;
+    civil_from_days(days, calendar);
+}
+
+time_t civil_to_time(const struct tm* calendar)
+{
+    time_t days = days_from_civil(calendar->tm_year+1900, calendar->tm_mon+1, calendar->tm_mday);
+    return days*SECONDS_PER_DAY+calendar->tm_hour*3600+calendar->tm_min*60+calendar->tm_sec;
+}
+
+void civil_advance(struct tm* calendar, time_t seconds)
+{
+    if (seconds<0 || seconds>=SECONDS_PER_DAY) {
+        int isdst = calendar->tm_isdst;
+        civil_time(civil_to_time(calendar)+seconds, calendar);
+        calendar->tm_isdst = isdst;
+        return;
+    }
+
+    int32_t second = calendar->tm_sec+int32_t(seconds);
+    if (second<60) {
+        calendar->tm_sec = second;
+        return;
+    }
+    int32_t of_day = calendar->tm_hour*3600+calendar->tm_min*60+second;
+    if (of_day>=SECONDS_PER_DAY) {
+        of_day -= SECONDS_PER_DAY;
+        calendar->tm_wday = calendar->tm_wday==6 ? 0 : calendar->tm_wday+1;
+        calendar->tm_yday++;
+        if (++calendar->tm_mday>days_in_month(calendar->tm_year+1900, calendar->tm_mon)) {
+            calendar->tm_mday = 1;
+            if (++calendar->tm_mon==12) {
+                calendar->tm_mon = 0;
+                calendar->tm_year++;
+                calendar->tm_yday = 0;
+            }
+        }
+    }
+    calendar->tm_hour = of_day/3600;
+    calendar->tm_min = of_day/60%60;
+    calendar->tm_sec = of_day%60;
+}
+
+time_t civil_dst_transition(int year, const civil_dst_rule_t* rule, int32_t offset)
+{
+    const int month = rule->month-1;
+    const time_t first = days_from_civil(year, rule->month, 1);
+    int weekday = int((first+4)%7);
+    if (weekday<0)
+        weekday += 7;
+    int day = 1+(rule->weekday+7-weekday)%7+(rule->week-1)*7;
+    while (day>days_in_month(year, month))
+        day -= 7;
+    return (first+day-1)*SECONDS_PER_DAY+rule->hour*3600-offset;
+}
+
+size_t civil_format_iso8601(const struct tm* calendar, int32_t offset, char* buffer, size_t size)
+{
+    char text[40];
+    char* p = put_number(text, calendar->tm_year+1900, 4);
+    *p++ = '-';
+    p = put_two_digits(p, calendar->tm_mon+1);
+    *p++ = '-';
+    p = put_two_digits(p, calendar->tm_mday);
+    *p++ = 'T';
+    p = put_two_digits(p, calendar->tm_hour);
+    *p++ = ':';
+    p = put_two_digits(p, calendar->tm_min);
+    *p++ = ':';
+    p = put_two_digits(p, calendar->tm_sec);
+    if (!offset) {
+        *p++ = 'Z';
+    }
+    else {
+        *p++ = offset<0 ? '-' : '+';
+        int32_t minutes = (offset<0 ? -offset : offset)/60;
+        p = put_two_digits(p, minutes/60%100);
+        *p++ = ':';
+        p = put_two_digits(p, minutes%60);
+    }
+    return copy_out(text, p-text, buffer, size);
+}
+
+size_t civil_format_asctime(const struct tm* calendar, char* buffer, size_t size)
+{
+    char text[40];
+    char* p = put_name(text, weekday_names, calendar->tm_wday);
+    *p++ = ' ';
+    p = put_name(p, month_names, calendar->tm_mon);
+    *p++ = ' ';
+    if (calendar->tm_mday<10) {
+        *p++ = ' ';
+        *p++ = '0'+calendar->tm_mday;
+    }
+    else {
+        p = put_two_digits(p, calendar->tm_mday);
+    }
+    *p++ = ' ';
+    p = put_two_digits(p, calendar->tm_hour);
+    *p++ = ':';
+    p = put_two_digits(p, calendar->tm_min);
+    *p++ = ':';
+    p = put_two_digits(p, calendar->tm_sec);
+    *p++ = ' ';
+    p = put_number(p, calendar->tm_year+1900, 1);
+    return copy_out(text, p-text, buffer, size);
+}
@@ -0,0 +1,664 @@
+/**
+ ******************************************************************************
+  Copyright (c) 2015 Particle Industries, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************
+ */
+
+/**
+ * Conversion of floating point values to text using only integer arithmetic,
+ * since floating point is done in software on Cortex-M3.
+ *
+ * Fixed notation computes round(value * 10^precision) exactly. Most values
+ * need only 64 and 128-bit arithmetic; very large or very small values use a
+ * small fixed-size big integer.
+ *
+ * The shortest representation uses Grisu2 from Florian Loitsch, "Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers" (2010). The digits
+ * always convert back to the same value, and are the shortest such digits for
+ * more than 99% of values. The table of cached powers is 87 entries (1 KB).
+ */
+
+#include "float_convert.h"
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+const uint64_t pow10_64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/**
+ * Writes to a buffer with the same truncation as snprintf.
+ */
+struct Output
+{
+    char* buffer;
+    size_t size;
+    size_t length;
+
+    Output(char* buffer_, size_t size_) : buffer(buffer_), size(size_), length(0) {}
+
+    void put(char c)
+    {
+        if (length+1<size)
+            buffer[length] = c;
+        length++;
+    }
+
+    void put(const char* s)
+    {
+        while (*s)
+            put(*s++);
+    }
+
+    size_t finish()
+    {
+        if (size)
+            buffer[length<size ? length : size-1] = 0;
+        return length;
+    }
+};
+
+inline uint64_t double_bits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * Splits a finite double into m * 2^e.
+ */
+inline void decompose(uint64_t bits, uint64_t& m, int& e)
+{
+    const int biased = int((bits >> 52) & 0x7FF);
+    m = bits & ((1ULL << 52) - 1);
+    if (biased) {
+        m |= 1ULL << 52;
+        e = biased - 1075;
+    }
+    else
+        e = -1074;
+}
+
+/**
+ * Writes NaN and infinity.
+ * @return true if the value is finite and was not written.
+ */
+bool write_special(Output& out, uint64_t bits)
+{
+    if (((bits >> 52) & 0x7FF) != 0x7FF)
+        return true;
+    if (bits & ((1ULL << 52) - 1))
+        out.put("nan");
+    else
+        out.put((bits >> 63) ? "-inf" : "inf");
+    return false;
+}
+
+/**
+ * The decimal digits of an integer, in groups of 9, least significant first.
+ */
+struct Digits
+{
+    uint32_t group[40];
+    int groups;
+
+    void from(uint64_t n)
+    {
+        groups = 0;
+        do {
+            if (n>>32) {
+                group[groups++] = uint32_t(n % 1000000000);
+                n /= 1000000000;
+            }
+            else {
+                // 32-bit division is much cheaper on Cortex-M
+                uint32_t small = uint32_t(n);
+                group[groups++] = small % 1000000000;
+                n = small / 1000000000;
+            }
+        } while (n);
+    }
+
+    int count() const
+    {
+        int n = (groups-1)*9;
+        uint32_t top = group[groups-1];
+        do {
+            n++;
+            top /= 10;
+        } while (top);
+        return n;
+    }
+
+    unsigned digit(int position) const
+    {
+        if (position/9 >= groups)
+            return 0;
+        return (group[position/9] / uint32_t(pow10_64[position%9])) % 10;
+    }
+
+    /**
+     * Writes the integer divided by 10^precision, followed by a number of extra zeros.
+     */
+    void write(Output& out, int precision, int zeros) const
+    {
+        int digits = count();
+        if (digits<precision+1)
+            digits = precision+1;
+        for (int position=digits-1; position>=0; position--) {
+            if (position==precision-1)
+                out.put('.');
+            out.put(char('0'+digit(position)));
+        }
+        if (zeros && !precision)
+            out.put('.');
+        while (zeros-->0)
+            out.put('0');
+    }
+};
+
+/**
+ * An unsigned integer of up to 34 32-bit words, enough for any double, or a double
+ * scaled by 10^FLOAT_CONVERT_MAX_PRECISION.
+ */
+struct BigInt
+{
+    uint32_t word[34];
+    int words;
+
+    void set(uint64_t n)
+    {
+        word[0] = uint32_t(n);
+        word[1] = uint32_t(n>>32);
+        words = word[1] ? 2 : (word[0] ? 1 : 0);
+    }
+
+    void trim()
+    {
+        while (words && !word[words-1])
+            words--;
+    }
+
+    void multiply(uint32_t factor)
+    {
+        uint32_t carry = 0;
+        for (int i=0; i<words; i++) {
+            uint64_t product = uint64_t(word[i])*factor + carry;
+            word[i] = uint32_t(product);
+            carry = uint32_t(product>>32);
+        }
+        if (carry)
+            word[words++] = carry;
+    }
+
+    void shift_left(int bits)
+    {
+        if (!words)
+            return;
+        const int whole = bits/32, part = bits%32;
+        if (part) {
+            word[words] = 0;
+            for (int i=words; i>0; i--)
+                word[i] = (word[i]<<part) | (word[i-1]>>(32-part));
+            word[0] <<= part;
+            words++;
+        }
+        if (whole) {
+            for (int i=words-1; i>=0; i--)
+                word[i+whole] = word[i];
+            for (int i=0; i<whole; i++)
+                word[i] = 0;
+            words += whole;
+        }
+        trim();
+    }
+
+    bool bit(int n) const
+    {
+        return n/32<words && ((word[n/32]>>(n%32)) & 1);
+    }
+
+    bool any_below(int n) const
+    {
+        for (int i=0; i<n/32 && i<words; i++)
+            if (word[i])
+                return true;
+        return n/32<words && (word[n/32] & ((1U<<(n%32))-1));
+    }
+
+    /**
+     * Divides by 2^bits, rounding to nearest with ties to even.
+     */
+    void shift_right_round(int bits)
+    {
+        const bool half = bits>0 && bit(bits-1);
+        const bool above_half = half && any_below(bits-1);
+        const int whole = bits/32, part = bits%32;
+        if (whole>=words) {
+            words = 0;
+        }
+        else {
+            for (int i=0; i<words-whole; i++) {
+                uint32_t low = word[i+whole] >> part;
+                uint32_t high = (part && i+whole+1<words) ? word[i+whole+1] << (32-part) : 0;
+                word[i] = low | high;
+            }
+            words -= whole;
+            trim();
+        }
+        if (half && (above_half || (words && (word[0] & 1)))) {
+            int i = 0;
+            while (i<words && ++word[i]==0)
+                i++;
+            if (i==words)
+                word[words++] = 1;
+        }
+    }
+
+    uint32_t divide(uint32_t divisor)
+    {
+        uint64_t remainder = 0;
+        for (int i=words-1; i>=0; i--) {
+            uint64_t current = (remainder<<32) | word[i];
+            word[i] = uint32_t(current / divisor);
+            remainder = current % divisor;
+        }
+        trim();
+        return uint32_t(remainder);
+    }
+
+    void to_digits(Digits& digits)
+    {
+        digits.groups = 0;
+        do {
+            digits.group[digits.groups++] = divide(1000000000);
+        } while (words);
+    }
+};
+
+/**
+ * The full 128-bit product of two 64-bit values.
+ */
+inline void multiply128(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low)
+{
+    const uint64_t a_lo = uint32_t(a), a_hi = a>>32, b_lo = uint32_t(b), b_hi = b>>32;
+    const uint64_t p0 = a_lo*b_lo, p1 = a_lo*b_hi, p2 = a_hi*b_lo, p3 = a_hi*b_hi;
+    const uint64_t middle = (p0>>32) + uint32_t(p1) + uint32_t(p2);
+    low = (middle<<32) | uint32_t(p0);
+    high = p3 + (p1>>32) + (p2>>32) + (middle>>32);
+}
+
+/**
+ * Computes round(m * 2^e * 10^precision) when the result fits in 64 bits.
+ */
+bool scale64(uint64_t m, int e, int precision, uint64_t& result)
+{
+    if (precision>19)
+        return false;
+    if (e>=0) {
+        if (e>11 || (m<<e) > UINT64_MAX/pow10_64[precision])
+            return false;
+        result = (m<<e)*pow10_64[precision];
+        return true;
+    }
+
+    const int k = -e;
+    uint64_t high, low;
+    multiply128(m, pow10_64[precision], high, low);
+    if (k>=128) {
+        result = 0;         // the product is less than 2^117
+        return true;
+    }
+
+    // quotient, remainder and half of the divisor
+    uint64_t q, rest_high, rest_low, half_high, half_low;
+    if (k>64) {
+        q = high >> (k-64);
+        rest_high = high & ((1ULL<<(k-64))-1); rest_low = low;
+        half_high = 1ULL<<(k-65); half_low = 0;
+    }
+    else if (k==64) {
+        q = high;
+        rest_high = 0; rest_low = low;
+        half_high = 0; half_low = 1ULL<<63;
+    }
+    else {
+        if (high>>k)
+            return false;
+        q = (high<<(64-k)) | (low>>k);
+        rest_high = 0; rest_low = low & ((1ULL<<k)-1);
+        half_high = 0; half_low = 1ULL<<(k-1);
+    }
+    const bool tie = rest_high==half_high && rest_low==half_low;
+    const bool above = rest_high>half_high || (rest_high==half_high && rest_low>half_low);
+    if (above || (tie && (q & 1))) {
+        if (q==UINT64_MAX)
+            return false;
+        q++;
+    }
+    result = q;
+    return true;
+}
+
+__attribute__((noinline)) void write_fixed_big(Output& out, uint64_t m, int e, int precision, int zeros)
+{
+    BigInt n;
+    Digits digits;
+    n.set(m);
+    if (e>=0) {
+        n.shift_left(e);
+        n.to_digits(digits);
+        digits.write(out, 0, precision+zeros);
+        return;
+    }
+    for (int p=precision; p>0; p-=9)
+        n.multiply(uint32_t(pow10_64[p>9 ? 9 : p]));
+    n.shift_right_round(-e);
+    n.to_digits(digits);
+    digits.write(out, precision, zeros);
+}
+
+struct DiyFp
+{
+    uint64_t f;
+    int e;
+};
+
+inline DiyFp multiply(const DiyFp& x, const DiyFp& y)
+{
+    uint64_t high, low;
+    multiply128(x.f, y.f, high, low);
+    DiyFp result = { high + (low>>63), x.e + y.e + 64 };
+    return result;
+}
+
+inline DiyFp normalize(DiyFp x)
+{
+    while (!(x.f & (1ULL<<63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+// 10^k for k = -348, -340, ..., 340 as normalized f * 2^e
+const uint64_t cached_power_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+const int16_t cached_power_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066
+};
+
+/**
+ * Finds the cached power that scales a value with binary exponent e to
+ * an exponent between -60 and -32.
+ * @param K receives the negated decimal exponent of the power.
+ */
+DiyFp cached_power(int e, int& K)
+{
+    // ceil((-61-e) * log10(2)) in fixed point
+    int k = (-61 - e)*78913;
+    k = (k>>18) + ((k & ((1<<18)-1)) ? 1 : 0) + 347;
+    const unsigned index = unsigned(k>>3) + 1;
+    K = -(-348 + int(index<<3));
+    DiyFp result = { cached_power_f[index], cached_power_e[index] };
+    return result;
+}
+
+void grisu_round(char* buffer, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest<wp_w && delta-rest>=ten_kappa &&
+           (rest+ten_kappa<wp_w || wp_w-rest>rest+ten_kappa-wp_w)) {
+        buffer[length-1]--;
+        rest += ten_kappa;
+    }
+}
+
+int digit_gen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int& K)
+{
+    const DiyFp one = { 1ULL << -Mp.e, Mp.e };
+    const uint64_t wp_w = Mp.f - W.f;
+    uint32_t p1 = uint32_t(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = 1;
+    while (kappa<10 && p1>=pow10_64[kappa])
+        kappa++;
+    int length = 0;
+    while (kappa>0) {
+        const uint32_t divisor = uint32_t(pow10_64[kappa-1]);
+        const uint32_t d = p1 / divisor;
+        p1 %= divisor;
+        if (d || length)
+            buffer[length++] = char('0' + d);
+        kappa--;
+        const uint64_t rest = (uint64_t(p1) << -one.e) + p2;
+        if (rest<=delta) {
+            K += kappa;
+            grisu_round(buffer, length, delta, rest, pow10_64[kappa] << -one.e, wp_w);
+            return length;
+        }
+    }
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        const char d = char(p2 >> -one.e);
+        if (d || length)
+            buffer[length++] = char('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2<delta) {
+            K += kappa;
+            grisu_round(buffer, length, delta, p2, one.f, -kappa<20 ? wp_w*pow10_64[-kappa] : 0);
+            return length;
+        }
+    }
+}
+
+/**
+ * Generates the shortest digits for f * 2^e, where normal values have the given
+ * number of significand bits.
+ * @return The number of digits. The value is digits * 10^K.
+ */
+int grisu2(uint64_t f, int e, int significand_bits, bool subnormal, char* buffer, int& K)
+{
+    DiyFp v = { f, e };
+
+    // the halfway points to the neighbouring values, which are closer below a power of 2
+    DiyFp plus = { (f<<1) + 1, e - 1 };
+    plus = normalize(plus);
+    DiyFp minus;
+    if (f==(1ULL<<(significand_bits-1)) && !subnormal) {
+        minus.f = (f<<2) - 1;
+        minus.e = e - 2;
+    }
+    else {
+        minus.f = (f<<1) - 1;
+        minus.e = e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    const DiyFp c_mk = cached_power(plus.e, K);
+    const DiyFp W = multiply(normalize(v), c_mk);
+    DiyFp Wp = multiply(plus, c_mk);
+    DiyFp Wm = multiply(minus, c_mk);
+    Wm.f++;
+    Wp.f--;
+    return digit_gen(W, Wp, Wp.f - Wm.f, buffer, K);
+}
+
+void write_exponent(Output& out, int exponent)
+{
+    out.put('e');
+    out.put(exponent<0 ? '-' : '+');
+    if (exponent<0)
+        exponent = -exponent;
+    if (exponent>=100)
+        out.put(char('0' + exponent/100));
+    out.put(char('0' + (exponent/10)%10));
+    out.put(char('0' + exponent%10));
+}
+
+/**
+ * Writes digits * 10^K in decimal or exponent notation.
+ */
+void write_shortest(Output& out, const char* digits, int length, int K)
+{
+    const int point = length + K;       // the position of the decimal point after the first digit
+    if (point>-6 && point<=21) {
+        if (point<=0) {
+            out.put("0.");
+            for (int i=point; i<0; i++)
+                out.put('0');
+        }
+        for (int i=0; i<length; i++) {
+            if (i==point && point>0)
+                out.put('.');
+            out.put(digits[i]);
+        }
+        for (int i=length; i<point; i++)
+            out.put('0');
+    }
+    else {
+        out.put(digits[0]);
+        if (length>1) {
+            out.put('.');
+            for (int i=1; i<length; i++)
+                out.put(digits[i]);
+        }
+        write_exponent(out, point-1);
+    }
+}
+
+size_t shortest(bool negative, uint64_t m, int e, int significand_bits, bool subnormal, Output& out)
+{
+    if (negative)
+        out.put('-');
+    if (!m)
+        out.put('0');
+    else {
+        char digits[20];
+        int K = 0;
+        int length = grisu2(m, e, significand_bits, subnormal, digits, K);
+        write_shortest(out, digits, length, K);
+    }
+    return out.finish();
+}
+
+} // namespace
+
+size_t dtoa_fixed(double value, int precision, char* buffer, size_t size)
+{
+    Output out(buffer, size);
+    const uint64_t bits = double_bits(value);
+    if (write_special(out, bits)) {
+        if (bits>>63)
+            out.put('-');
+        if (precision<0)
+            precision = 6;
+        int zeros = 0;
+        if (precision>FLOAT_CONVERT_MAX_PRECISION) {
+            zeros = precision-FLOAT_CONVERT_MAX_PRECISION;
+            precision = FLOAT_CONVERT_MAX_PRECISION;
+        }
+
+        uint64_t m, scaled;
+        int e;
+        decompose(bits, m, e);
+        if (scale64(m, e, precision, scaled)) {
+            Digits digits;
+            digits.from(scaled);
+            digits.write(out, precision, zeros);
+        }
+        else
+            write_fixed_big(out, m, e, precision, zeros);
+    }
+    return out.finish();
+}
+
+size_t dtoa_shortest(double value, char* buffer, size_t size)
+{
+    Output out(buffer, size);
+    const uint64_t bits = double_bits(value);
+    if (!write_special(out, bits))
+        return out.finish();
+    uint64_t m;
+    int e;
+    decompose(bits, m, e);
+    return shortest(bits>>63, m, e, 53, !(bits & (0x7FFULL<<52)), out);
+}
+
+size_t ftoa_shortest(float value, char* buffer, size_t size)
+{
+    Output out(buffer, size);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const int biased = int((bits >> 23) & 0xFF);
+    if (biased==0xFF) {
+        // the same as the double
+        write_special(out, double_bits(value));
+        return out.finish();
+    }
+    uint64_t m = bits & 0x7FFFFF;
+    int e = -149;
+    if (biased) {
+        m |= 1 << 23;
+        e = biased - 150;
+    }
+    return shortest(bits>>31, m, e, 24, !biased, out);
+}
@@ -27,7 +27,24 @@
  */
 #include "spark_wiring_interrupts.h"
 
-static wiring_interrupt_handler_t* handlers[16];
+static wiring_interrupt_handler_t* handlers[TOTAL_PINS];
+static wiring_interrupt_member_t members[TOTAL_PINS];
+
+static bool is_valid_interrupt_pin(uint16_t pin)
+{
+#if Wiring_Cellular == 1
+  /* safety check that prevents users from attaching an interrupt to D7
+   * which is shared with BATT_INT_PC13 for power management */
+  if (pin == D7) return false;
+#endif
+    return pin < TOTAL_PINS;
+}
+
+static void release_handler(uint16_t pin)
+{
+    delete handlers[pin];
+    handlers[pin] = NULL;
+}
 
 wiring_interrupt_handler_t* allocate_handler(uint16_t pin, wiring_interrupt_handler_t& fn)
 {
@@ -47,6 +64,27 @@ void call_raw_interrupt_handler(void* data)
     handler();
 }
 
+wiring_interrupt_member_t* wiring_interrupt_member(uint16_t pin)
+{
+    if (!is_valid_interrupt_pin(pin))
+        return NULL;
+    HAL_Interrupts_Detach(pin);
+    release_handler(pin);
+    return &members[pin];
+}
+
+bool wiring_interrupt_attach(uint16_t pin, HAL_InterruptHandler dispatch, void* data, InterruptMode mode)
+{
+    if (!is_valid_interrupt_pin(pin))
+        return false;
+    HAL_Interrupts_Detach(pin);
+    // the member storage is in use by the handler being attached
+    if (data != &members[pin])
+        release_handler(pin);
+    HAL_Interrupts_Attach(pin, dispatch, data, mode, NULL);
+    return true;
+}
+
 /*******************************************************************************
  * Function Name  : attachInterrupt
  * Description    : Arduino compatible function to attach hardware interrupts to
@@ -58,11 +96,8 @@ void call_raw_interrupt_handler(void* data)
 
 bool attachInterrupt(uint16_t pin, wiring_interrupt_handler_t fn, InterruptMode mode)
 {
-#if Wiring_Cellular == 1
-  /* safety check that prevents users from attaching an interrupt to D7
-   * which is shared with BATT_INT_PC13 for power management */
-  if (pin == D7) return false;
-#endif
+    if (!is_valid_interrupt_pin(pin))
+        return false;
     HAL_Interrupts_Detach(pin);
     wiring_interrupt_handler_t* handler = allocate_handler(pin, fn);
     if (handler) {
@@ -73,14 +108,7 @@ bool attachInterrupt(uint16_t pin, wiring_interrupt_handler_t fn, InterruptMode
 
 bool attachInterrupt(uint16_t pin, raw_interrupt_handler_t handler, InterruptMode mode)
 {
-#if Wiring_Cellular == 1
-  /* safety check that prevents users from attaching an interrupt to D7
-   * which is shared with BATT_INT_PC13 for power management */
-  if (pin == D7) return false;
-#endif
-    HAL_Interrupts_Detach(pin);
-    HAL_Interrupts_Attach(pin, call_raw_interrupt_handler, (void*)handler, mode, NULL);
-    return true;
+    return wiring_interrupt_attach(pin, call_raw_interrupt_handler, (void*)handler, mode);
 }
 
 
@@ -94,14 +122,11 @@ bool attachInterrupt(uint16_t pin, raw_interrupt_handler_t handler, InterruptMod
  *******************************************************************************/
 void detachInterrupt(uint16_t pin)
 {
-#if Wiring_Cellular == 1
     /* safety check that prevents users from detaching an interrupt from
      * BATT_INT_PC13 for power management which is shared with D7 */
-    if (pin == D7) return;
-#endif
+    if (!is_valid_interrupt_pin(pin)) return;
     HAL_Interrupts_Detach(pin);
-    delete handlers[pin];
-    handlers[pin] = NULL;
+    release_handler(pin);
 }
 
 /*******************************************************************************
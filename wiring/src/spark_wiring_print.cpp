@@ -27,9 +27,11 @@
 #include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <ctype.h>
 #include "spark_wiring_print.h"
 #include "spark_wiring_string.h"
 #include "spark_wiring_stream.h"
+#include "float_convert.h"
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -99,6 +101,10 @@ size_t Print::print(unsigned long n, int base)
 
 size_t Print::print(double n, int digits)
 {
+  if (digits < 0) {
+    char buf[32];
+    return write((const uint8_t*)buf, dtoa_shortest(n, buf, sizeof(buf)));
+  }
   return printFloat(n, digits);
 }
 
@@ -200,72 +206,430 @@ size_t Print::printNumber(unsigned long n, uint8_t base) {
 
 size_t Print::printFloat(double number, uint8_t digits)
 {
-  size_t n = 0;
+  char buf[48];
+  size_t length = dtoa_fixed(number, digits, buf, sizeof(buf));
+  if (length >= sizeof(buf)) return print("ovf");
+  return write((const uint8_t*)buf, length);
+}
 
-  if (isnan(number)) return print("nan");
-  if (isinf(number)) return print("inf");
-  if (number > 4294967040.0) return print ("ovf");  // constant determined empirically
-  if (number <-4294967040.0) return print ("ovf");  // constant determined empirically
+size_t Print::printf_impl(bool newline, const char* format, ...)
+{
+    va_list marker;
+    va_start(marker, format);
+    size_t n = vprintf_impl(newline, format, marker);
+    va_end(marker);
+    return n;
+}
 
-  // Handle negative numbers
-  if (number < 0.0)
-  {
-     n += print('-');
-     number = -number;
-  }
+namespace {
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i=0; i<digits; ++i)
-    rounding /= 10.0;
+/**
+ * Collects formatted output in a small buffer and writes it to the Print
+ * in chunks, so that output of any length is produced in a single pass
+ * with a fixed amount of stack.
+ */
+class PrintFormatter
+{
+    Print& out;
+    char buffer[64];
+    size_t pos;
+    size_t written;
+    size_t produced;
 
-  number += rounding;
+    enum Flags
+    {
+        LEFT = 1<<0,
+        PLUS = 1<<1,
+        SPACE = 1<<2,
+        ALT = 1<<3,
+        ZERO = 1<<4,
+    };
+
+    struct Spec
+    {
+        unsigned flags;
+        int width;
+        int precision;      // -1 when not given
+        char length;        // 0, 'H' (hh), 'h', 'l', 'L' (ll), 'j', 'z', 't', 'D' (long double)
+        char conversion;
+    };
+
+    void flush()
+    {
+        if (pos) {
+            written += out.write((const uint8_t*)buffer, pos);
+            pos = 0;
+        }
+    }
 
-  // Extract the integer part of the number and print it
-  unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  n += print(int_part);
+    void put(char c)
+    {
+        if (pos==sizeof(buffer))
+            flush();
+        buffer[pos++] = c;
+        produced++;
+    }
 
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0) {
-    n += print(".");
-  }
+    void put(const char* s, size_t length)
+    {
+        produced += length;
+        while (length) {
+            if (pos==sizeof(buffer))
+                flush();
+            size_t chunk = sizeof(buffer)-pos;
+            if (chunk>length)
+                chunk = length;
+            memcpy(buffer+pos, s, chunk);
+            pos += chunk;
+            s += chunk;
+            length -= chunk;
+        }
+    }
 
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0)
-  {
-    remainder *= 10.0;
-    int toPrint = int(remainder);
-    n += print(toPrint);
-    remainder -= toPrint;
-  }
+    void pad(char c, int count)
+    {
+        while (count-->0)
+            put(c);
+    }
 
-  return n;
-}
+    /**
+     * Writes a converted value with its sign or prefix, padded to the field width.
+     * @param zeros The number of zeros between the prefix and the digits.
+     */
+    void field(const Spec& spec, const char* prefix, size_t prefix_length, int zeros, const char* digits, size_t length)
+    {
+        int padding = spec.width - int(prefix_length + zeros + length);
+        if (!(spec.flags & LEFT))
+            pad(' ', padding);
+        put(prefix, prefix_length);
+        pad('0', zeros);
+        put(digits, length);
+        if (spec.flags & LEFT)
+            pad(' ', padding);
+    }
 
-size_t Print::printf_impl(bool newline, const char* format, ...)
-{
-    const int bufsize = 20;
-    char test[bufsize];
-    va_list marker;
-    va_start(marker, format);
-    size_t n = vsnprintf(test, bufsize, format, marker);
-    va_end(marker);
+    void integer(const Spec& spec, unsigned long long value, bool negative)
+    {
+        char digits[24];
+        char* end = digits+sizeof(digits);
+        char* p = end;
+        const char conversion = spec.conversion;
+        const unsigned base = (conversion=='o') ? 8 : (conversion=='x' || conversion=='X' || conversion=='p') ? 16 : 10;
+        const char* hex = conversion=='X' ? "0123456789ABCDEF" : "0123456789abcdef";
+
+        if (base==10) {
+            // 32-bit division is much cheaper than 64-bit on Cortex-M
+            while (value>0xFFFFFFFFu) {
+                *--p = '0' + char(value % 10);
+                value /= 10;
+            }
+            uint32_t small = uint32_t(value);
+            while (small) {
+                *--p = '0' + char(small % 10);
+                small /= 10;
+            }
+        }
+        else {
+            const unsigned shift = base==8 ? 3 : 4;
+            while (value) {
+                *--p = hex[value & (base-1)];
+                value >>= shift;
+            }
+        }
+
+        int length = end-p;
+        int zeros = 0;
+        if (spec.precision>=0) {
+            if (spec.precision>length)
+                zeros = spec.precision-length;
+        }
+        else if (length==0)
+            zeros = 1;
+
+        char prefix[2];
+        size_t prefix_length = 0;
+        if (conversion=='d' || conversion=='i') {
+            if (negative)
+                prefix[prefix_length++] = '-';
+            else if (spec.flags & PLUS)
+                prefix[prefix_length++] = '+';
+            else if (spec.flags & SPACE)
+                prefix[prefix_length++] = ' ';
+        }
+        else if (conversion=='o') {
+            if ((spec.flags & ALT) && zeros==0 && (length==0 || *p!='0'))
+                zeros = 1;
+        }
+        else if (base==16 && (((spec.flags & ALT) && length) || conversion=='p')) {
+            prefix[prefix_length++] = '0';
+            prefix[prefix_length++] = conversion=='X' ? 'X' : 'x';
+        }
+
+        if ((spec.flags & ZERO) && !(spec.flags & LEFT) && spec.precision<0) {
+            int fill = spec.width-int(prefix_length+length);
+            if (fill>zeros)
+                zeros = fill;
+        }
+        field(spec, prefix, prefix_length, zeros, p, length);
+    }
 
-    if (n<bufsize)
+    void string(const Spec& spec, const char* s)
     {
-        n = print(test);
+        if (!s)
+            s = "(null)";
+        size_t length = spec.precision>=0 ? strnlen(s, spec.precision) : strlen(s);
+        field(spec, "", 0, 0, s, length);
     }
-    else
+
+    /**
+     * Formats %f and %F without the C library.
+     * @return false if the value doesn't fit the buffer, or is NaN.
+     */
+    bool fixed(const Spec& spec, double value)
     {
-        char bigger[n+1];
-        va_start(marker, format);
-        n = vsnprintf(bigger, n+1, format, marker);
-        va_end(marker);
-        n = print(bigger);
+        if (isnan(value))
+            return false;   // the C library decides the sign
+        char digits[48];
+        const int precision = spec.precision<0 ? 6 : spec.precision;
+        // room for a leading sign and a trailing point
+        size_t length = dtoa_fixed(value, precision, digits+1, sizeof(digits)-2);
+        if (length>=sizeof(digits)-2)
+            return false;
+
+        char* text = digits+1;
+        const bool finite = !isinf(value);
+        if (text[0]!='-' && (spec.flags & (PLUS|SPACE))) {
+            *--text = (spec.flags & PLUS) ? '+' : ' ';
+            length++;
+        }
+        if (!finite && spec.conversion=='F') {
+            for (size_t i=0; i<length; i++)
+                text[i] = toupper(text[i]);
+        }
+        if (finite && !precision && (spec.flags & ALT))
+            text[length++] = '.';
+
+        size_t prefix_length = (text[0]=='-' || text[0]=='+' || text[0]==' ') ? 1 : 0;
+        int zeros = 0;
+        if ((spec.flags & ZERO) && !(spec.flags & LEFT) && finite) {
+            zeros = spec.width-length;
+        }
+        field(spec, text, prefix_length, zeros, text+prefix_length, length-prefix_length);
+        return true;
     }
+
+    void floating(const Spec& spec, double value)
+    {
+        if ((spec.conversion=='f' || spec.conversion=='F') && fixed(spec, value))
+            return;
+
+        // the sign and digits are produced by the C library, one conversion at a time,
+        // and the field is padded here, so the stack needed is bounded.
+        char format[12];
+        char* f = format;
+        *f++ = '%';
+        if (spec.flags & PLUS) *f++ = '+';
+        if (spec.flags & SPACE) *f++ = ' ';
+        if (spec.flags & ALT) *f++ = '#';
+        *f++ = '.';
+        *f++ = '*';
+        *f++ = spec.conversion;
+        *f = 0;
+
+        char digits[48];
+        int length;
+        if (spec.precision<0)
+        {
+            // the default precision, which for %a is as many digits as needed
+            f[-3] = spec.conversion;
+            f[-2] = 0;
+            length = snprintf(digits, sizeof(digits), format, value);
+        }
+        else
+            length = snprintf(digits, sizeof(digits), format, spec.precision, value);
+
+        if (length>=int(sizeof(digits))) {
+            // too long for the buffer - use exponent notation
+            const int max_precision = int(sizeof(digits))-16;
+            int precision = spec.precision<0 ? 6 : spec.precision>max_precision ? max_precision : spec.precision;
+            f[-3] = '.';
+            f[-2] = '*';
+            f[-1] = (spec.conversion>='a') ? 'e' : 'E';
+            length = snprintf(digits, sizeof(digits), format, precision, value);
+        }
+
+        size_t prefix_length = (digits[0]=='-' || digits[0]=='+' || digits[0]==' ') ? 1 : 0;
+        int zeros = 0;
+        bool finite = digits[prefix_length]>='0' && digits[prefix_length]<='9';
+        if (finite && (digits[prefix_length+1]=='x' || digits[prefix_length+1]=='X'))
+            prefix_length += 2;
+        if ((spec.flags & ZERO) && !(spec.flags & LEFT) && finite) {
+            zeros = spec.width-length;
+        }
+        field(spec, digits, prefix_length, zeros, digits+prefix_length, length-prefix_length);
+    }
+
+public:
+
+    PrintFormatter(Print& out_) : out(out_), pos(0), written(0), produced(0) {}
+
+    size_t format(const char* format, va_list args)
+    {
+        while (*format) {
+            const char* literal = format;
+            while (*format && *format!='%')
+                format++;
+            if (format>literal)
+                put(literal, format-literal);
+            if (!*format)
+                break;
+            format++;   // '%'
+
+            Spec spec = { 0, 0, -1, 0, 0 };
+            for (;;) {
+                char c = *format;
+                if (c=='-') spec.flags |= LEFT;
+                else if (c=='+') spec.flags |= PLUS;
+                else if (c==' ') spec.flags |= SPACE;
+                else if (c=='#') spec.flags |= ALT;
+                else if (c=='0') spec.flags |= ZERO;
+                else break;
+                format++;
+            }
+
+            if (*format=='*') {
+                spec.width = va_arg(args, int);
+                if (spec.width<0) {
+                    spec.flags |= LEFT;
+                    spec.width = -spec.width;
+                }
+                format++;
+            }
+            else {
+                while (*format>='0' && *format<='9')
+                    spec.width = spec.width*10 + (*format++ - '0');
+            }
+
+            if (*format=='.') {
+                format++;
+                spec.precision = 0;
+                if (*format=='*') {
+                    spec.precision = va_arg(args, int);
+                    if (spec.precision<0)
+                        spec.precision = -1;
+                    format++;
+                }
+                else {
+                    while (*format>='0' && *format<='9')
+                        spec.precision = spec.precision*10 + (*format++ - '0');
+                }
+            }
+
+            switch (*format) {
+                case 'h':
+                    spec.length = (*++format=='h') ? (format++, 'H') : 'h';
+                    break;
+                case 'l':
+                    spec.length = (*++format=='l') ? (format++, 'L') : 'l';
+                    break;
+                case 'j': case 'z': case 't':
+                    spec.length = *format++;
+                    break;
+                case 'L':
+                    spec.length = 'D';
+                    format++;
+                    break;
+            }
+
+            spec.conversion = *format;
+            if (!spec.conversion)
+                break;
+            format++;
+
+            switch (spec.conversion) {
+                case 'd': case 'i': {
+                    long long value;
+                    switch (spec.length) {
+                        case 'H': value = (signed char)va_arg(args, int); break;
+                        case 'h': value = (short)va_arg(args, int); break;
+                        case 'l': value = va_arg(args, long); break;
+                        case 'L': value = va_arg(args, long long); break;
+                        case 'j': value = va_arg(args, intmax_t); break;
+                        case 'z': value = (ptrdiff_t)va_arg(args, size_t); break;
+                        case 't': value = va_arg(args, ptrdiff_t); break;
+                        default: value = va_arg(args, int); break;
+                    }
+                    bool negative = value<0;
+                    integer(spec, negative ? 0ULL-(unsigned long long)value : (unsigned long long)value, negative);
+                    break;
+                }
+                case 'u': case 'o': case 'x': case 'X': {
+                    unsigned long long value;
+                    switch (spec.length) {
+                        case 'H': value = (unsigned char)va_arg(args, unsigned); break;
+                        case 'h': value = (unsigned short)va_arg(args, unsigned); break;
+                        case 'l': value = va_arg(args, unsigned long); break;
+                        case 'L': value = va_arg(args, unsigned long long); break;
+                        case 'j': value = va_arg(args, uintmax_t); break;
+                        case 'z': value = va_arg(args, size_t); break;
+                        case 't': value = va_arg(args, ptrdiff_t); break;
+                        default: value = va_arg(args, unsigned); break;
+                    }
+                    integer(spec, value, false);
+                    break;
+                }
+                case 'p':
+                    spec.flags &= ~ZERO;
+                    integer(spec, (uintptr_t)va_arg(args, void*), false);
+                    break;
+                case 'c': {
+                    char c = (char)va_arg(args, int);
+                    field(spec, "", 0, 0, &c, 1);
+                    break;
+                }
+                case 's':
+                    string(spec, va_arg(args, const char*));
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                    if (spec.length=='D')
+                        floating(spec, (double)va_arg(args, long double));
+                    else
+                        floating(spec, va_arg(args, double));
+                    break;
+                case 'n':
+                    switch (spec.length) {
+                        case 'H': *va_arg(args, signed char*) = produced; break;
+                        case 'h': *va_arg(args, short*) = produced; break;
+                        case 'l': *va_arg(args, long*) = produced; break;
+                        case 'L': *va_arg(args, long long*) = produced; break;
+                        case 'j': *va_arg(args, intmax_t*) = produced; break;
+                        case 'z': *va_arg(args, size_t*) = produced; break;
+                        case 't': *va_arg(args, ptrdiff_t*) = produced; break;
+                        default: *va_arg(args, int*) = produced; break;
+                    }
+                    break;
+                case '%':
+                    put('%');
+                    break;
+                default:
+                    // unknown conversion - written as is
+                    put('%');
+                    put(spec.conversion);
+                    break;
+            }
+        }
+        flush();
+        return written;
+    }
+};
+
+} // namespace
+
+size_t Print::vprintf_impl(bool newline, const char* format, va_list args)
+{
+    PrintFormatter formatter(*this);
+    size_t n = formatter.format(format, args);
     if (newline)
         n += println();
     return n;
 }
-
@@ -25,21 +25,40 @@
  */
 
 #include "spark_wiring_stream.h"
-#include "spark_wiring.h"       // for millis())
+#include "spark_wiring_ticks.h"
+#include <string.h>
+#if PLATFORM_THREADING
+#include "concurrent_hal.h"
+#endif
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 #define NO_SKIP_CHAR  1  // a magic char not found in a valid ASCII numeric field
 
+bool Stream::waitAvailable(system_tick_t timeout)
+{
+  system_tick_t start = millis();
+  while (available() <= 0) {
+    if (millis() - start >= timeout)
+      return false;
+#if PLATFORM_THREADING
+    os_thread_yield();
+#endif
+  }
+  return true;
+}
+
 // private method to read stream with timeout
 int Stream::timedRead()
 {
   int c;
   _startMillis = millis();
-  do {
+  for (;;) {
     c = read();
     if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
-  return -1;     // -1 indicates timeout
+    system_tick_t elapsed = millis() - _startMillis;
+    if (elapsed >= _timeout || !waitAvailable(_timeout - elapsed))
+      return -1;     // -1 indicates timeout
+  }
 }
 
 // private method to peek stream with timeout
@@ -47,11 +66,13 @@ int Stream::timedPeek()
 {
   int c;
   _startMillis = millis();
-  do {
+  for (;;) {
     c = peek();
     if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
-  return -1;     // -1 indicates timeout
+    system_tick_t elapsed = millis() - _startMillis;
+    if (elapsed >= _timeout || !waitAvailable(_timeout - elapsed))
+      return -1;     // -1 indicates timeout
+  }
 }
 
 // returns peek of the next digit in the stream or -1 if timeout
@@ -283,13 +304,19 @@ void serialReadLine(Stream *serialObj, char *dst, int max_len, system_tick_t tim
 
     while (1)
     {
-        if((timeout > 0) && ((millis()-last_millis) > timeout))
+        system_tick_t wait = 1000;
+        if (timeout > 0)
         {
-            //Abort after a specified timeout
-            break;
+            system_tick_t elapsed = millis()-last_millis;
+            if (elapsed > timeout)
+            {
+                //Abort after a specified timeout
+                break;
+            }
+            wait = timeout-elapsed+1;
         }
 
-        if (0 < serialObj->available())
+        if (serialObj->waitAvailable(wait))
         {
             c = serialObj->read();
 
@@ -32,36 +32,19 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include "string_convert.h"
+#include "float_convert.h"
 
-//These are very crude implementations - will refine later
-//------------------------------------------------------------------------------------------
-
-void dtoa (double val, unsigned char prec, char *sout) {
-    bool negative = val<0;
-    if (negative) {
-        val = -val;
-        *sout++ = '-';
-    }
-    long scale = 1;
-    for (uint8_t i=0; i<prec; i++)
-        scale *= 10;
-    val *= scale;   // capture all the significant digits
-    uint64_t fixed = uint64_t(val);
-    if ((val-fixed)>=0.5)    // round last digit
-        fixed++;
-
-    unsigned long first = (unsigned long)(fixed / scale);
-    unsigned long second = (unsigned long)(fixed % scale);
-
-    ultoa(first, sout, 10, 1);
-    if (prec) {
-        sout += strlen(sout);
-        *sout++ = '.';
-        ultoa(second, sout, 10, prec);
-    }
+/**
+ * Formats a float or double, using the shortest digits that read back as the
+ * same value when decimalPlaces is negative.
+ */
+static size_t format_float(double value, int decimalPlaces, bool single, char* buf, size_t size)
+{
+    if (decimalPlaces>=0)
+        return dtoa_fixed(value, decimalPlaces, buf, size);
+    return single ? ftoa_shortest(float(value), buf, size) : dtoa_shortest(value, buf, size);
 }
 
-
 /*********************************************/
 /*  Constructors                             */
 /*********************************************/
@@ -70,6 +53,7 @@ String::String(const char *cstr)
 {
 	init();
 	if (cstr) copy(cstr, strlen(cstr));
+	else invalidate();
 }
 
 String::String(const String &value)
@@ -143,21 +127,17 @@ String::String(unsigned long value, unsigned char base)
 String::String(float value, int decimalPlaces)
 {
 	init();
-	char buf[33];
-	dtoa(value, decimalPlaces, buf);
-        *this = buf;
+	concatFloat(value, decimalPlaces, true);
 }
 
 String::String(double value, int decimalPlaces)
 {
 	init();
-	char buf[33];
-	dtoa(value, decimalPlaces, buf);
-        *this = buf;
+	concatFloat(value, decimalPlaces, false);
 }
 String::~String()
 {
-	free(buffer);
+	if (ownsBuffer()) free(buffer);
 }
 
 /*********************************************/
@@ -166,22 +146,22 @@ String::~String()
 
 inline void String::init(void)
 {
-	buffer = NULL;
-	capacity = 0;
+	buffer = inlineBuffer;
+	buffer[0] = 0;
 	len = 0;
-	flags = 0;
 }
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	if (ownsBuffer()) free(buffer);
 	buffer = NULL;
 	capacity = len = 0;
+	flags = 0;
 }
 
 unsigned char String::reserve(unsigned int size)
 {
-	if (buffer && capacity >= size) return 1;
+	if (buffer && bufferCapacity() >= size) return 1;
 	if (changeBuffer(size)) {
 		if (len == 0) buffer[0] = 0;
 		return 1;
@@ -189,8 +169,35 @@ unsigned char String::reserve(unsigned int size)
 	return 0;
 }
 
+/**
+ * Reserves space for a longer string, growing the buffer by at least half
+ * so that repeated concatenation doesn't reallocate every time.
+ */
+unsigned char String::grow(unsigned int maxStrLen)
+{
+	unsigned int current = bufferCapacity();
+	if (buffer && current >= maxStrLen) return 1;
+	unsigned int size = current + current / 2;
+	if (size > maxStrLen && reserve(size)) return 1;
+	return reserve(maxStrLen);
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
+	if (!buffer && maxStrLen < INLINE_SIZE) {
+		buffer = inlineBuffer;
+		return 1;
+	}
+	if (!ownsBuffer()) {
+		// move from the inline or external buffer to the heap
+		char *newbuffer = (char *)malloc(maxStrLen + 1);
+		if (!newbuffer) return 0;
+		if (buffer) memcpy(newbuffer, buffer, len + 1);
+		buffer = newbuffer;
+		capacity = maxStrLen;
+		flags = 0;
+		return 1;
+	}
 	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
 	if (newbuffer) {
 		buffer = newbuffer;
@@ -211,29 +218,29 @@ String & String::copy(const char *cstr, unsigned int length)
 		return *this;
 	}
 	len = length;
-	strcpy(buffer, cstr);
+	memmove(buffer, cstr, length);
+	buffer[length] = 0;
 	return *this;
 }
 
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void String::move(String &rhs)
 {
-	if (buffer) {
-		if (capacity >= rhs.len) {
-			strcpy(buffer, rhs.buffer);
-			len = rhs.len;
-			rhs.len = 0;
-			return;
-		} else {
-			free(buffer);
-		}
+	if (!rhs.buffer) {
+		invalidate();
+		return;
 	}
+	// take over a heap buffer, unless the value is short enough to store inline
+	if (!rhs.ownsBuffer() || (!ownsBuffer() && rhs.len < INLINE_SIZE)) {
+		copy(rhs.buffer, rhs.len);
+		return;
+	}
+	if (ownsBuffer()) free(buffer);
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
+	flags = 0;
 	len = rhs.len;
-	rhs.buffer = NULL;
-	rhs.capacity = 0;
-	rhs.len = 0;
+	rhs.init();
 }
 #endif
 
@@ -283,9 +290,16 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	if (buffer && cstr >= buffer && cstr <= buffer + len) {
+		// appending part of this string, which may move
+		unsigned int offset = cstr - buffer;
+		if (!grow(newlen)) return 0;
+		cstr = buffer + offset;
+	}
+	else if (!grow(newlen)) return 0;
+	memcpy(buffer + len, cstr, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
@@ -340,16 +354,25 @@ unsigned char String::concat(unsigned long num)
 
 unsigned char String::concat(float num)
 {
-	char buf[20];
-	dtoa(num, 6, buf);
-	return concat(buf, strlen(buf));
+	return concatFloat(num, 6, true);
 }
 
 unsigned char String::concat(double num)
 {
-	char buf[20];
-	dtoa(num, 6, buf);
-	return concat(buf, strlen(buf));
+	return concatFloat(num, 6, false);
+}
+
+unsigned char String::concatFloat(double num, int decimalPlaces, bool single)
+{
+	char buf[48];
+	size_t length = format_float(num, decimalPlaces, single, buf, sizeof(buf));
+	if (length<sizeof(buf))
+		return concat(buf, length);
+	// large values are formatted in place
+	if (!reserve(len + length)) return 0;
+	format_float(num, decimalPlaces, single, buffer + len, length + 1);
+	len += length;
+	return 1;
 }
 
 /*********************************************/
@@ -674,7 +697,7 @@ String& String::replace(const String& find, const String& replace)
 			size += diff;
 		}
 		if (size == len) return *this;;
-		if (size > capacity && !changeBuffer(size)) return *this; // XXX: tell user!
+		if (size > bufferCapacity() && !changeBuffer(size)) return *this; // XXX: tell user!
 		int index = len - 1;
 		while (index >= 0 && (index = lastIndexOf(find, index)) >= 0) {
 			readFrom = buffer + index + find.len;
@@ -786,21 +809,12 @@ String::String(const Printable& printable)
 
 String String::format(const char* fmt, ...)
 {
+    String result;
+    StringPrintableHelper help(result);
     va_list marker;
     va_start(marker, fmt);
-    const int bufsize = 5;
-    char test[bufsize];
-    size_t n = vsnprintf(test, bufsize, fmt, marker);
+    help.vprintf_impl(false, fmt, marker);
     va_end(marker);
-
-    String result;
-    result.reserve(n);  // internally adds +1 for null terminator
-    if (result.buffer) {
-        va_start(marker, fmt);
-        n = vsnprintf(result.buffer, n+1, fmt, marker);
-        va_end(marker);
-        result.len = n;
-    }
     return result;
 }
 
@@ -46,11 +46,33 @@ TCPClient::TCPClient() : TCPClient(socket_handle_invalid())
 {
 }
 
-TCPClient::TCPClient(sock_handle_t sock) : _sock(sock)
+TCPClient::TCPClient(sock_handle_t sock) : _sock(sock), _rxBuffer(NULL), _rxSize(sizeof(_buffer)),
+    _txBuffer(NULL), _txSize(0), _txCount(0)
 {
   flush_buffer();
 }
 
+TCPClient::TCPClient(uint8_t* rxBuffer, size_t rxSize, uint8_t* txBuffer, size_t txSize) : TCPClient(socket_handle_invalid())
+{
+  setBuffers(rxBuffer, rxSize, txBuffer, txSize);
+}
+
+void TCPClient::setBuffers(uint8_t* rxBuffer, size_t rxSize, uint8_t* txBuffer, size_t txSize)
+{
+  sendPending();
+  flush_buffer();
+  if (rxBuffer && rxSize) {
+    _rxBuffer = rxBuffer;
+    _rxSize = rxSize;
+  }
+  else {
+    _rxBuffer = NULL;
+    _rxSize = sizeof(_buffer);
+  }
+  _txBuffer = txSize ? txBuffer : NULL;
+  _txSize = _txBuffer ? txSize : 0;
+}
+
 int TCPClient::connect(const char* host, uint16_t port, network_interface_t nif)
 {
     stop();
@@ -116,7 +138,60 @@ size_t TCPClient::write(uint8_t b)
 
 size_t TCPClient::write(const uint8_t *buffer, size_t size)
 {
+    if (!_txSize)
         return status() ? socket_send(_sock, buffer, size) : -1;
+
+    if (!isOpen(_sock))
+        return -1;
+    size_t written = 0;
+    while (written < size)
+    {
+        if (_txCount == _txSize && sendPending() < 0)
+            break;
+        if (!_txCount && size - written >= _txSize)
+        {
+            // at least a full buffer - send it without copying
+            sock_result_t sent = status() ? socket_send(_sock, buffer + written, size - written) : -1;
+            if (sent <= 0)
+            {
+                setWriteError();
+                break;
+            }
+            written += sent;
+            continue;
+        }
+        size_t count = _txSize - _txCount;
+        if (count > size - written)
+            count = size - written;
+        memcpy(_txBuffer + _txCount, buffer + written, count);
+        _txCount += count;
+        written += count;
+    }
+    return written;
+}
+
+/**
+ * Sends the buffered transmit data.
+ * @return 0 on success, or a negative value if the data couldn't be sent, in which
+ * case it is discarded.
+ */
+int TCPClient::sendPending()
+{
+    int result = 0;
+    size_t sent = 0;
+    while (sent < _txCount)
+    {
+        sock_result_t ret = status() ? socket_send(_sock, _txBuffer + sent, _txCount - sent) : -1;
+        if (ret <= 0)
+        {
+            setWriteError();
+            result = -1;
+            break;
+        }
+        sent += ret;
+    }
+    _txCount = 0;
+    return result;
 }
 
 int TCPClient::bufferCount()
@@ -134,12 +209,16 @@ int TCPClient::available()
         flush_buffer();
     }
 
+    // the peer may be waiting for buffered output before it replies
+    if (_txCount)
+        sendPending();
+
     if(Network.from(nif).ready() && isOpen(_sock))
     {
         // Have room
-        if ( _total < arraySize(_buffer))
+        if ( _total < _rxSize)
         {
-            int ret = socket_receive(_sock, _buffer + _total , arraySize(_buffer)-_total, 0);
+            int ret = socket_receive(_sock, rxBuffer() + _total , _rxSize-_total, 0);
             if (ret > 0)
             {
                 DEBUG("recv(=%d)",ret);
@@ -154,24 +233,37 @@ int TCPClient::available()
 
 int TCPClient::read()
 {
-  return (bufferCount() || available()) ? _buffer[_offset++] : -1;
+  return (bufferCount() || available()) ? rxBuffer()[_offset++] : -1;
 }
 
 int TCPClient::read(uint8_t *buffer, size_t size)
 {
-        int read = -1;
-        if (bufferCount() || available())
+        int read = bufferCount();
+        if (read)
         {
-          read = (size > (size_t) bufferCount()) ? bufferCount() : size;
-          memcpy(buffer, &_buffer[_offset], read);
+          if (size < (size_t) read)
+            read = size;
+          memcpy(buffer, rxBuffer() + _offset, read);
           _offset += read;
+          return read;
         }
-        return read;
+
+        // nothing buffered - receive directly into the caller's buffer
+        flush_buffer();
+        if (_txCount)
+          sendPending();
+        if (size && Network.from(nif).ready() && isOpen(_sock))
+        {
+          int ret = socket_receive(_sock, buffer, size, 0);
+          if (ret > 0)
+            return ret;
+        }
+        return -1;
 }
 
 int TCPClient::peek()
 {
-  return  (bufferCount() || available()) ? _buffer[_offset] : -1;
+  return  (bufferCount() || available()) ? rxBuffer()[_offset] : -1;
 }
 
 void TCPClient::flush_buffer()
@@ -182,6 +274,11 @@ void TCPClient::flush_buffer()
 
 void TCPClient::flush()
 {
+  if (_txSize)
+  {
+    sendPending();
+    return;
+  }
   while (available())
     read();
 }
@@ -191,6 +288,8 @@ void TCPClient::stop()
 {
   DEBUG("_sock %d closesocket", _sock);
 
+  if (_txCount)
+      sendPending();
   if (isOpen(_sock))
       socket_close(_sock);
   _sock = socket_handle_invalid();
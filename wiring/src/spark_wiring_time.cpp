@@ -27,6 +27,7 @@
 #include "rtc_hal.h"
 #include "stdio.h"
 #include "stdlib.h"
+#include <atomic>
 
 
 const char* TIME_FORMAT_DEFAULT = "asctime";
@@ -47,64 +48,122 @@ const char* TIME_FORMAT_ISO8601_FULL = "%Y-%m-%dT%H:%M:%S%z";
 //	int tm_isdst;       /* daylight saving time             */
 //};
 
-struct tm calendar_time_cache;	// a cache of calendar time structure elements
-time_t unix_time_cache;  		// a cache of unix_time that was updated
-time_t time_zone_cache;			// a cache of the time zone that was set
+/**
+ * The settings that decide the local time. `generation` changes whenever they do,
+ * so that a cached calendar time for the old settings isn't used.
+ */
+static struct {
+    int32_t zone;               // seconds ahead of UTC, without daylight saving time
+    int32_t dst_offset;         // seconds added while daylight saving time is in effect
+    civil_dst_rule_t dst_start;
+    civil_dst_rule_t dst_end;
+    bool dst;                   // when the daylight saving time rules are used
+    uint32_t generation;
+} time_settings;
+
+/**
+ * The local calendar time for the last time converted, which is moved on by the
+ * seconds since then rather than converted in full. The daylight saving time
+ * transitions are computed once for each year.
+ */
+struct CalendarCache
+{
+    uint32_t generation;
+    time_t time;                // UTC
+    int32_t offset;             // seconds ahead of UTC of `calendar`
+    struct tm calendar;
+    time_t year_start;          // the UTC times the transitions are for
+    time_t year_end;
+    time_t dst_start;
+    time_t dst_end;
+};
 
-/* Time utility functions */
-static struct tm Convert_UnixTime_To_CalendarTime(time_t unix_time);
-//static time_t Convert_CalendarTime_To_UnixTime(struct tm calendar_time);
-//static struct tm Get_CalendarTime(void);
-//static void Set_CalendarTime(struct tm t);
-static void Refresh_UnixTime_Cache(time_t unix_time);
+/**
+ * The calendar cache is shared by all threads and may also be used from an
+ * interrupt. Readers take a copy and check that the sequence number didn't change
+ * while copying, and writers skip updating the cache when it is already being
+ * updated. The sequence number is odd while the cache is being written and
+ * 0 until it is first written.
+ */
+static std::atomic<unsigned> cache_sequence;
+static CalendarCache calendar_cache;
 
-/* Convert Unix/RTC time to Calendar time */
-static struct tm Convert_UnixTime_To_CalendarTime(time_t unix_time)
+static bool Load_Calendar_Cache(CalendarCache& cache)
 {
-	struct tm *calendar_time;
-	calendar_time = localtime(&unix_time);
-	calendar_time->tm_year += 1900;
-	return *calendar_time;
+    unsigned sequence = cache_sequence.load(std::memory_order_acquire);
+    if (!sequence || (sequence & 1))
+        return false;
+    cache = calendar_cache;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return cache_sequence.load(std::memory_order_relaxed)==sequence;
 }
 
-/* Convert Calendar time to Unix/RTC time */
-/*
-static time_t Convert_CalendarTime_To_UnixTime(struct tm calendar_time)
+static void Store_Calendar_Cache(const CalendarCache& cache)
 {
-	calendar_time.tm_year -= 1900;
-	time_t unix_time = mktime(&calendar_time);
-	return unix_time;
+    unsigned sequence = cache_sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) || !cache_sequence.compare_exchange_strong(sequence, sequence+1, std::memory_order_acquire))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+    calendar_cache = cache;
+    cache_sequence.store(sequence+2, std::memory_order_release);
 }
-*/
 
-/* Get converted Calendar time */
-/*
- static struct tm Get_CalendarTime(void)
+/**
+ * Computes the daylight saving time transitions for the year containing the given time.
+ */
+static void Update_DST_Transitions(CalendarCache& cache, time_t t)
 {
-	time_t unix_time = HAL_RTC_Get_UnixTime();
-	unix_time += time_zone_cache;
-	struct tm calendar_time = Convert_UnixTime_To_CalendarTime(unix_time);
-	return calendar_time;
+    struct tm calendar;
+    civil_time(t+time_settings.zone, &calendar);
+    int year = calendar.tm_year+1900;
+    calendar.tm_mon = 0;
+    calendar.tm_mday = 1;
+    calendar.tm_hour = calendar.tm_min = calendar.tm_sec = 0;
+    cache.year_start = civil_to_time(&calendar)-time_settings.zone;
+    calendar.tm_year++;
+    cache.year_end = civil_to_time(&calendar)-time_settings.zone;
+    cache.dst_start = civil_dst_transition(year, &time_settings.dst_start, time_settings.zone);
+    cache.dst_end = civil_dst_transition(year, &time_settings.dst_end, time_settings.zone+time_settings.dst_offset);
 }
- */
 
-/* Set Calendar time as Unix/RTC time */
-/*
-static void Set_CalendarTime(struct tm calendar_time)
+/* Convert Unix/RTC time to local Calendar time */
+static struct tm Convert_UnixTime_To_CalendarTime(time_t unix_time, int32_t* offset=NULL)
 {
-	HAL_RTC_Set_UnixTime(Convert_CalendarTime_To_UnixTime(calendar_time));
+    CalendarCache cache;
+    bool cached = Load_Calendar_Cache(cache) && cache.generation==time_settings.generation;
+    if (!cached) {
+        cache.generation = time_settings.generation;
+        cache.year_start = cache.year_end = 0;
+    }
+
+    bool dst = false;
+    if (time_settings.dst) {
+        if (unix_time<cache.year_start || unix_time>=cache.year_end)
+            Update_DST_Transitions(cache, unix_time);
+        if (cache.dst_start<cache.dst_end)
+            dst = unix_time>=cache.dst_start && unix_time<cache.dst_end;
+        else    // the southern hemisphere
+            dst = unix_time>=cache.dst_start || unix_time<cache.dst_end;
+    }
+    int32_t local_offset = time_settings.zone+(dst ? time_settings.dst_offset : 0);
+
+    if (cached)
+        civil_advance(&cache.calendar, (unix_time+local_offset)-(cache.time+cache.offset));
+    else
+        civil_time(unix_time+local_offset, &cache.calendar);
+    cache.calendar.tm_isdst = dst;
+    cache.time = unix_time;
+    cache.offset = local_offset;
+    Store_Calendar_Cache(cache);
+
+    if (offset)
+        *offset = local_offset;
+    return cache.calendar;
 }
-*/
 
-/* Refresh Unix/RTC time cache */
-static void Refresh_UnixTime_Cache(time_t unix_time)
+static void Time_Settings_Changed()
 {
-    unix_time += time_zone_cache;
-    if(unix_time != unix_time_cache)
-    {
-            calendar_time_cache = Convert_UnixTime_To_CalendarTime(unix_time);
-            unix_time_cache = unix_time;
-    }
+    time_settings.generation++;
 }
 
 const char* TimeClass::format_spec = TIME_FORMAT_DEFAULT;
@@ -118,8 +177,7 @@ int TimeClass::hour()
 /* the hour for the given time */
 int TimeClass::hour(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return calendar_time_cache.tm_hour;
+	return Convert_UnixTime_To_CalendarTime(t).tm_hour;
 }
 
 /* current hour in 12 hour format */
@@ -131,13 +189,13 @@ int TimeClass::hourFormat12()
 /* the hour for the given time in 12 hour format */
 int TimeClass::hourFormat12(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	if(calendar_time_cache.tm_hour == 0)
+	int hour = Convert_UnixTime_To_CalendarTime(t).tm_hour;
+	if(hour == 0)
 		return 12;	//midnight
-	else if( calendar_time_cache.tm_hour > 12)
-		return calendar_time_cache.tm_hour - 12 ;
+	else if( hour > 12)
+		return hour - 12 ;
 	else
-		return calendar_time_cache.tm_hour ;
+		return hour ;
 }
 
 /* returns true if time now is AM */
@@ -173,8 +231,7 @@ int TimeClass::minute()
 /* the minute for the given time */
 int TimeClass::minute(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return calendar_time_cache.tm_min;
+	return Convert_UnixTime_To_CalendarTime(t).tm_min;
 }
 
 /* current seconds */
@@ -186,8 +243,7 @@ int TimeClass::second()
 /* the second for the given time */
 int TimeClass::second(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return calendar_time_cache.tm_sec;
+	return Convert_UnixTime_To_CalendarTime(t).tm_sec;
 }
 
 /* current day */
@@ -199,8 +255,7 @@ int TimeClass::day()
 /* the day for the given time */
 int TimeClass::day(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return calendar_time_cache.tm_mday;
+	return Convert_UnixTime_To_CalendarTime(t).tm_mday;
 }
 
 /* the current weekday */
@@ -212,8 +267,7 @@ int TimeClass::weekday()
 /* the weekday for the given time */
 int TimeClass::weekday(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return (calendar_time_cache.tm_wday + 1);//Arduino's weekday representation
+	return (Convert_UnixTime_To_CalendarTime(t).tm_wday + 1);//Arduino's weekday representation
 }
 
 /* current month */
@@ -225,8 +279,7 @@ int TimeClass::month()
 /* the month for the given time */
 int TimeClass::month(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return (calendar_time_cache.tm_mon + 1);//Arduino's month representation
+	return (Convert_UnixTime_To_CalendarTime(t).tm_mon + 1);//Arduino's month representation
 }
 
 /* current four digit year */
@@ -238,8 +291,7 @@ int TimeClass::year()
 /* the year for the given time */
 int TimeClass::year(time_t t)
 {
-	Refresh_UnixTime_Cache(t);
-	return calendar_time_cache.tm_year;
+	return Convert_UnixTime_To_CalendarTime(t).tm_year + 1900;
 }
 
 /* return the current time as seconds since Jan 1 1970 */
@@ -255,7 +307,37 @@ void TimeClass::zone(float GMT_Offset)
 	{
 		return;
 	}
-	time_zone_cache = GMT_Offset * 3600;
+	time_settings.zone = GMT_Offset * 3600;
+	Time_Settings_Changed();
+}
+
+/* use daylight saving time between the given times each year */
+void TimeClass::setDSTRule(const civil_dst_rule_t& start, const civil_dst_rule_t& end, float offset)
+{
+	time_settings.dst_start = start;
+	time_settings.dst_end = end;
+	time_settings.dst_offset = offset * 3600;
+	time_settings.dst = true;
+	Time_Settings_Changed();
+}
+
+/* stop using daylight saving time */
+void TimeClass::clearDSTRule()
+{
+	time_settings.dst = false;
+	Time_Settings_Changed();
+}
+
+/* returns true if daylight saving time is in effect now */
+bool TimeClass::isDST()
+{
+	return isDST(now());
+}
+
+/* returns true if daylight saving time is in effect at the given time */
+bool TimeClass::isDST(time_t t)
+{
+	return Convert_UnixTime_To_CalendarTime(t).tm_isdst;
 }
 
 /* set the given time as unix/rtc time */
@@ -267,14 +349,20 @@ void TimeClass::setTime(time_t t)
 /* return string representation for the given time */
 String TimeClass::timeStr(time_t t)
 {
-	t += time_zone_cache;
-	tm* calendar_time = localtime(&t);
-        char* ascstr = asctime(calendar_time);
-        int len = strlen(ascstr);
-        ascstr[len-1] = 0; // remove final newline
+	struct tm calendar_time = Convert_UnixTime_To_CalendarTime(t);
+	char ascstr[26];
+	civil_format_asctime(&calendar_time, ascstr, sizeof(ascstr));
 	return String(ascstr);
 }
 
+/* write the given time as ISO 8601 */
+size_t TimeClass::formatISO8601(time_t t, char* buffer, size_t size)
+{
+	int32_t offset;
+	struct tm calendar_time = Convert_UnixTime_To_CalendarTime(t, &offset);
+	return civil_format_iso8601(&calendar_time, offset, buffer, size);
+}
+
 String TimeClass::format(time_t t, const char* format_spec)
 {
     if (format_spec==NULL)
@@ -283,9 +371,14 @@ String TimeClass::format(time_t t, const char* format_spec)
     if (!format_spec || !strcmp(format_spec,TIME_FORMAT_DEFAULT)) {
         return timeStr(t);
     }
-    t += time_zone_cache;
-    tm* calendar_time = localtime(&t);
-    return timeFormatImpl(calendar_time, format_spec, time_zone_cache);
+    if (!strcmp(format_spec, TIME_FORMAT_ISO8601_FULL)) {
+        char buf[32];
+        formatISO8601(t, buf, sizeof(buf));
+        return String(buf);
+    }
+    int32_t offset;
+    struct tm calendar_time = Convert_UnixTime_To_CalendarTime(t, &offset);
+    return timeFormatImpl(&calendar_time, format_spec, offset);
 }
 
 String TimeClass::timeFormatImpl(tm* calendar_time, const char* format, int time_zone)
@@ -294,13 +387,13 @@ String TimeClass::timeFormatImpl(tm* calendar_time, const char* format, int time
     strcpy(format_str, format);
     size_t len = strlen(format_str);
 
-    char time_zone_str[10];
+    char time_zone_str[16];
     // while we are not using stdlib for managing the timezone, we have to do this manually
     if (!time_zone) {
         strcpy(time_zone_str, "Z");
     }
     else {
-        snprintf(time_zone_str, 10, "%+03d:%02u", time_zone/3600, abs(time_zone/60)%60);
+        snprintf(time_zone_str, sizeof(time_zone_str), "%c%02d:%02d", time_zone<0 ? '-' : '+', abs(time_zone)/3600, abs(time_zone)/60%60);
     }
 
     // replace %z with the timezone
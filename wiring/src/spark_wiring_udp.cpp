@@ -31,6 +31,9 @@
 #include "inet_hal.h"
 #include "spark_macros.h"
 #include "spark_wiring_network.h"
+#if PLATFORM_THREADING
+#include "concurrent_hal.h"
+#endif
 
 using namespace spark;
 
@@ -39,7 +42,91 @@ static bool inline isOpen(sock_handle_t sd)
    return sd != socket_handle_invalid();
 }
 
-UDP::UDP() : _sock(socket_handle_invalid()), _offset(0), _total(0), _buffer(0), _buffer_size(512)
+static void setAddress(sockaddr_t& address, const IPAddress& ip, uint16_t port)
+{
+    address.sa_family = AF_INET;
+
+    address.sa_data[0] = (port & 0xFF00) >> 8;
+    address.sa_data[1] = (port & 0x00FF);
+
+    address.sa_data[2] = ip[0];
+    address.sa_data[3] = ip[1];
+    address.sa_data[4] = ip[2];
+    address.sa_data[5] = ip[3];
+}
+
+/**
+ * The start of each slot in the receive queue.
+ */
+struct QueuedPacket
+{
+    HAL_IPAddress ip;
+    uint16_t port;
+    uint16_t length;
+};
+
+/**
+ * The UDP instances with a receive queue.
+ */
+static UDP* queues = NULL;
+
+#if PLATFORM_THREADING
+
+#define UDP_QUEUE_PERIOD 10     //!< ms between filling the receive queues in the background
+
+/**
+ * The receive queues are also filled from the timer thread, so packets are
+ * kept while loop() is busy or delayed. The mutex guards the list of queues
+ * and the positions in each.
+ */
+static os_mutex_recursive_t queue_mutex = NULL;
+static os_timer_t queue_timer = NULL;
+
+static void queueTimerRun(os_timer_t timer)
+{
+    // skip this turn rather than hold up the timer thread while the application has the queues
+    if (!os_mutex_recursive_trylock(queue_mutex))
+    {
+        UDP::receiveAllQueued();
+        os_mutex_recursive_unlock(queue_mutex);
+    }
+}
+
+static void startQueueTimer()
+{
+    if (!queue_mutex)
+        os_mutex_recursive_create(&queue_mutex);
+    if (!queue_timer)
+        os_timer_create(&queue_timer, UDP_QUEUE_PERIOD, queueTimerRun, NULL, NULL);
+    if (queue_timer)
+        os_timer_change(queue_timer, OS_TIMER_CHANGE_START, false, 0, 0, NULL);
+}
+
+static void stopQueueTimer()
+{
+    if (queue_timer)
+        os_timer_change(queue_timer, OS_TIMER_CHANGE_STOP, false, 0, 0, NULL);
+}
+
+class QueueLock
+{
+    bool locked;
+public:
+    QueueLock() : locked(queue_mutex && !os_mutex_recursive_lock(queue_mutex)) {}
+    ~QueueLock() { if (locked) os_mutex_recursive_unlock(queue_mutex); }
+};
+
+#else
+
+static void startQueueTimer() {}
+static void stopQueueTimer() {}
+struct QueueLock { QueueLock() {} };
+
+#endif
+
+UDP::UDP() : _sock(socket_handle_invalid()), _offset(0), _total(0), _buffer(0), _buffer_size(512), _buffer_allocated(0),
+    _queue(NULL), _queue_slots(0), _queue_packet_size(0), _queue_head(0), _queue_count(0), _queue_allocated(0),
+    _queue_reading(0), _dropped(0), _next_queue(NULL)
 {
 }
 
@@ -97,9 +184,118 @@ int UDP::available()
     return _total - _offset;
 }
 
+size_t UDP::queueStorageSize(size_t packets, size_t packet_size)
+{
+    return packets * (sizeof(QueuedPacket) + packet_size);
+}
+
+uint8_t* UDP::queueSlot(uint16_t index) const
+{
+    return _queue + index * (sizeof(QueuedPacket) + _queue_packet_size);
+}
+
+uint8_t* UDP::readBuffer() const
+{
+    return _queue_reading ? queueSlot(_queue_head) + sizeof(QueuedPacket) : _buffer;
+}
+
+bool UDP::setReceiveQueue(size_t packets, size_t packet_size, uint8_t* storage)
+{
+    if (packets)
+        startQueueTimer();
+    QueueLock lock;
+    for (UDP** next = &queues; *next; next = &(*next)->_next_queue)
+    {
+        if (*next == this)
+        {
+            *next = _next_queue;
+            break;
+        }
+    }
+    flush();
+    if (_queue_allocated)
+        delete[] _queue;
+    _queue = NULL;
+    _queue_slots = _queue_packet_size = _queue_head = _queue_count = 0;
+    _queue_allocated = false;
+    _next_queue = NULL;
+
+    bool ok = !packets;
+    if (packets && packet_size && packets <= 0xFFFF && packet_size <= 0xFFFF)
+    {
+        if (!storage)
+        {
+            storage = new uint8_t[queueStorageSize(packets, packet_size)];
+            _queue_allocated = storage != NULL;
+        }
+        if (storage)
+        {
+            _queue = storage;
+            _queue_slots = packets;
+            _queue_packet_size = packet_size;
+            _next_queue = queues;
+            queues = this;
+            ok = true;
+        }
+    }
+    if (!queues)
+        stopQueueTimer();
+    return ok;
+}
+
+int UDP::receiveQueued()
+{
+    QueueLock lock;
+    if (!_queue || !isOpen(_sock) || !Network.from(_nif).ready())
+        return queuedPackets();
+
+    // bounded, so a flood of packets can't hold up the caller
+    for (unsigned i = 0; i < _queue_slots * 2u; i++)
+    {
+        const bool full = _queue_count == _queue_slots;
+        uint8_t* slot = queueSlot((_queue_head + _queue_count) % _queue_slots);
+        uint8_t discard[4];
+        sockaddr_t remoteSockAddr;
+        socklen_t remoteSockAddrLen = sizeof(remoteSockAddr);
+        int ret = socket_receivefrom(_sock, full ? discard : slot + sizeof(QueuedPacket),
+                full ? sizeof(discard) : _queue_packet_size, 0, &remoteSockAddr, &remoteSockAddrLen);
+        if (ret <= 0)
+            break;
+        if (full)
+        {
+            _dropped++;
+            continue;
+        }
+        QueuedPacket packet;
+        packet.ip = IPAddress(&remoteSockAddr.sa_data[2]).raw();
+        packet.port = remoteSockAddr.sa_data[0] << 8 | remoteSockAddr.sa_data[1];
+        packet.length = ret;
+        memcpy(slot, &packet, sizeof(packet));
+        _queue_count++;
+    }
+    return queuedPackets();
+}
+
+void UDP::receiveAllQueued()
+{
+    QueueLock lock;
+    for (UDP* udp = queues; udp; udp = udp->_next_queue)
+        udp->receiveQueued();
+}
+
+/**
+ * Called after each loop() when UDP is used. Without threading this is the
+ * only time the receive queues are filled in the background.
+ */
+void udpQueueRun()
+{
+    UDP::receiveAllQueued();
+}
+
 void UDP::stop()
 {
     DEBUG("_sock %d closesocket", _sock);
+    QueueLock lock;
     if (isOpen(_sock))
     {
         socket_close(_sock);
@@ -147,21 +343,28 @@ int UDP::endPacket()
 int UDP::sendPacket(const uint8_t* buffer, size_t buffer_size, IPAddress remoteIP, uint16_t port)
 {
     sockaddr_t remoteSockAddr;
-    remoteSockAddr.sa_family = AF_INET;
-
-    remoteSockAddr.sa_data[0] = (port & 0xFF00) >> 8;
-    remoteSockAddr.sa_data[1] = (port & 0x00FF);
-
-    remoteSockAddr.sa_data[2] = remoteIP[0];
-    remoteSockAddr.sa_data[3] = remoteIP[1];
-    remoteSockAddr.sa_data[4] = remoteIP[2];
-    remoteSockAddr.sa_data[5] = remoteIP[3];
+    setAddress(remoteSockAddr, remoteIP, port);
 
     int rv = socket_sendto(_sock, buffer, buffer_size, 0, &remoteSockAddr, sizeof(remoteSockAddr));
     DEBUG("sendto(buffer=%lx, size=%d)=%d",buffer, buffer_size , rv);
     return rv;
 }
 
+int UDP::sendPackets(const Datagram* packets, size_t count)
+{
+    sockaddr_t remoteSockAddr;
+    size_t sent = 0;
+    for (; sent < count; sent++)
+    {
+        const Datagram& packet = packets[sent];
+        setAddress(remoteSockAddr, packet.destination, packet.port);
+        if (socket_sendto(_sock, packet.data, packet.size, 0, &remoteSockAddr, sizeof(remoteSockAddr)) < 0)
+            break;
+    }
+    DEBUG("sendPackets(count=%d)=%d", count, sent);
+    return sent;
+}
+
 size_t UDP::write(uint8_t byte)
 {
     return write(&byte, 1);
@@ -179,6 +382,21 @@ size_t UDP::write(const uint8_t *buffer, size_t size)
 
 int UDP::parsePacket()
 {
+    if (_queue) {
+        QueueLock lock;
+        flush();        // releases the previous packet
+        receiveQueued();
+        if (_queue_count) {
+            QueuedPacket packet;
+            memcpy(&packet, queueSlot(_queue_head), sizeof(packet));
+            _remoteIP = packet.ip;
+            _remotePort = packet.port;
+            _total = packet.length;
+            _queue_reading = true;
+        }
+        return available();
+    }
+
     if (!_buffer && _buffer_size) {
         setBuffer(_buffer_size);
     }
@@ -195,6 +413,20 @@ int UDP::parsePacket()
 
 int UDP::receivePacket(uint8_t* buffer, size_t size)
 {
+    if (_queue && buffer) {
+        // take the next packet from the queue so packets are read in order.
+        // Like a socket read, nothing waiting gives 0, and a packet that
+        // doesn't fit the buffer is discarded with an error.
+        QueueLock lock;
+        int ret = parsePacket();
+        if (ret > int(size))
+            ret = -1;
+        else if (ret > 0)
+            read(buffer, size);
+        flush();
+        return ret;
+    }
+
     int ret = -1;
     if(Network.from(_nif).ready() && isOpen(_sock) && buffer)
     {
@@ -213,7 +445,7 @@ int UDP::receivePacket(uint8_t* buffer, size_t size)
 
 int UDP::read()
 {
-  return available() ? _buffer[_offset++] : -1;
+  return available() ? readBuffer()[_offset++] : -1;
 }
 
 int UDP::read(unsigned char* buffer, size_t len)
@@ -221,8 +453,8 @@ int UDP::read(unsigned char* buffer, size_t len)
     int read = -1;
     if (available())
     {
-    read = min(int(len), available());
-      memcpy(buffer, &_buffer[_offset], read);
+      read = (int(len) < available()) ? int(len) : available();
+      memcpy(buffer, readBuffer() + _offset, read);
       _offset += read;
     }
     return read;
@@ -230,20 +462,27 @@ int UDP::read(unsigned char* buffer, size_t len)
 
 int UDP::peek()
 {
-    return available() ? _buffer[_offset] : -1;
+    return available() ? readBuffer()[_offset] : -1;
 }
 
 void UDP::flush()
 {
   _offset = 0;
   _total = 0;
+  QueueLock lock;
+  if (_queue_reading)
+  {
+      _queue_reading = false;
+      _queue_head = (_queue_head + 1) % _queue_slots;
+      _queue_count--;
+  }
 }
 
 size_t UDP::printTo(Print& p) const
 {
     // can't use available() since this is a `const` method, and available is part of the Stream interface, and is non-const.
     int size = _total - _offset;
-    return p.write(_buffer+_offset, size);
+    return p.write(readBuffer()+_offset, size);
 }
 
 int UDP::joinMulticast(const IPAddress& ip)
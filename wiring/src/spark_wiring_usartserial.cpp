@@ -41,6 +41,14 @@ void USARTSerial::begin(unsigned long baud)
   HAL_USART_Begin(_serial, baud);
 }
 
+void USARTSerial::begin(unsigned long baud, uint8_t* rxBuffer, size_t rxSize, uint8_t* txBuffer, size_t txSize)
+{
+  if (isEnabled())
+    end();
+  HAL_USART_Set_Buffers(_serial, rxBuffer, rxSize, txBuffer, txSize);
+  HAL_USART_Begin(_serial, baud);
+}
+
 // TODO
 void USARTSerial::begin(unsigned long baud, byte config)
 {
@@ -62,6 +70,11 @@ int USARTSerial::available(void)
   return HAL_USART_Available_Data(_serial);
 }
 
+bool USARTSerial::waitAvailable(system_tick_t timeout)
+{
+  return HAL_USART_Wait_Available(_serial, timeout)>0;
+}
+
 int USARTSerial::peek(void)
 {
   return HAL_USART_Peek_Data(_serial);
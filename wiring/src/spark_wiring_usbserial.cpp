@@ -29,7 +29,7 @@
 //
 // Constructor
 //
-USBSerial::USBSerial()
+USBSerial::USBSerial() : _writeTimeout(100)
 {
 }
 
@@ -54,15 +54,29 @@ int USBSerial::read()
 	return USB_USART_Receive_Data(false);
 }
 
+int USBSerial::read(uint8_t *buffer, size_t size)
+{
+	return USB_USART_Receive_Data_Bulk(buffer, size);
+}
+
 int USBSerial::available()
 {
 	return USB_USART_Available_Data();
 }
 
+bool USBSerial::waitAvailable(system_tick_t timeout)
+{
+	return USB_USART_Wait_Available(timeout)>0;
+}
+
 size_t USBSerial::write(uint8_t byte)
 {
-	USB_USART_Send_Data(byte);
-	return 1;
+	return USB_USART_Send_Data_Bulk(&byte, 1, _writeTimeout);
+}
+
+size_t USBSerial::write(const uint8_t *buffer, size_t size)
+{
+	return USB_USART_Send_Data_Bulk(buffer, size, _writeTimeout);
 }
 
 void USBSerial::flush()
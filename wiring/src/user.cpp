@@ -59,10 +59,16 @@ void serialEventRun() __attribute__((weak));
 void serialEvent() __attribute__((weak));
 void serialEvent1() __attribute__((weak));
 
+/**
+ * Provided by UDP when it is used, to fill the receive queues.
+ */
+void udpQueueRun() __attribute__((weak));
+
 #if PLATFORM_ID==3
 // gcc doesn't allow weak functions to not exist, so they must be defined.
 __attribute__((weak)) void serialEvent() {}
 __attribute__((weak)) void serialEvent1() {}
+__attribute__((weak)) void udpQueueRun() {}
 #endif
 
 #if Wiring_Serial2
@@ -109,6 +115,7 @@ void serialEventRun()
     if (serialEventRun5) serialEventRun5();
 #endif
 
+    if (udpQueueRun) udpQueueRun();
 }
 
 #if defined(STM32F2XX)